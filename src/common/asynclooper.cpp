@@ -1,8 +1,17 @@
 #include "asynclooper.h"
 #include <numeric>
 #include <chrono>
+#include <algorithm>
 #include "log.h"
 
+#if LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
 AsyncLooper::AsyncLooper(StringContentView tag, std::function<void()> func, unsigned rate_per_sec, bool single_inst) : 
     _tag(tag), _loopFunc(func)
 {
@@ -67,9 +76,123 @@ unsigned AsyncLooper::getRate()
     return _rate;
 }
 
+AsyncLooper::JitterStats AsyncLooper::getJitterStats() const
+{
+    JitterStats s;
+    s.loops = _statLoops.load(std::memory_order_relaxed);
+    s.overruns = _statOverruns.load(std::memory_order_relaxed);
+    s.meanLateNs = s.loops ? _statLateSumNs.load(std::memory_order_relaxed) / (long long)s.loops : 0;
+    s.maxLateNs = _statLateMaxNs.load(std::memory_order_relaxed);
+    return s;
+}
+
+void AsyncLooper::resetJitterStats()
+{
+    _statLoops = 0;
+    _statOverruns = 0;
+    _statLateSumNs = 0;
+    _statLateMaxNs = 0;
+}
+
+void AsyncLooper::recordWakeup(long long lateNs, long long periodNs)
+{
+    // only one thread runs the loop at a time, so plain load/store is enough
+    if (lateNs < 0) lateNs = 0;
+    _statLoops.store(_statLoops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    _statLateSumNs.store(_statLateSumNs.load(std::memory_order_relaxed) + lateNs, std::memory_order_relaxed);
+    if (lateNs > _statLateMaxNs.load(std::memory_order_relaxed))
+        _statLateMaxNs.store(lateNs, std::memory_order_relaxed);
+    if (periodNs > 0 && lateNs > periodNs)
+        _statOverruns.store(_statOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void AsyncLooper::setThreadSchedParams(const StringContent& threadName, int realtimePriority, int cpuAffinity)
+{
 #if WIN32
+    if (realtimePriority > 0)
+    {
+        if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+            LOG_WARNING << "[Looper] " << threadName << ": SetThreadPriority failed: " << GetLastError();
+    }
+    if (cpuAffinity >= 0)
+    {
+        if (!SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpuAffinity))
+            LOG_WARNING << "[Looper] " << threadName << ": SetThreadAffinityMask failed: " << GetLastError();
+    }
+
+#elif LINUX
+    pthread_setname_np(pthread_self(), threadName.substr(0, 15).c_str());
+
+    if (realtimePriority > 0)
+    {
+        sched_param param{};
+        param.sched_priority = std::clamp(realtimePriority, sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+        if (int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param); err != 0)
+        {
+            // usually EPERM without CAP_SYS_NICE or rtprio limits. Keep running with normal priority
+            LOG_WARNING << "[Looper] " << threadName << ": SCHED_FIFO " << param.sched_priority << " failed: " << strerror(err);
+        }
+    }
+    if (cpuAffinity >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpuAffinity, &set);
+        if (int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set); err != 0)
+        {
+            LOG_WARNING << "[Looper] " << threadName << ": Set affinity to CPU " << cpuAffinity << " failed: " << strerror(err);
+        }
+    }
+#endif
+}
+
+void AsyncLooper::applyThreadSchedParams()
+{
+    setThreadSchedParams(_tag, _realtimePriority, _cpuAffinity);
+}
 
 void AsyncLooper::loopStart()
+{
+    if (_running) return;
+
+    if (_rate > 0 && _cpuAffinity < 0 && _allowPool && TickScheduler::isRunning())
+    {
+        _running = true;
+        long long periodNs = 1000000000LL / _rate;
+        _schedTaskID = TickScheduler::addTask(_tag, [this, periodNs](long long lateNs)
+            {
+                recordWakeup(lateNs, periodNs);
+                run();
+            }, periodNs);
+        LOG_DEBUG << "[Looper] " << _tag << ": Started " << _rate << "/s (pooled)";
+        return;
+    }
+
+    _threadLoopStart();
+}
+
+void AsyncLooper::loopEnd()
+{
+    if (!_running) return;
+
+    if (_schedTaskID != TickScheduler::INVALID_TASK)
+    {
+        _running = false;
+        TickScheduler::removeTask(_schedTaskID);
+        _schedTaskID = TickScheduler::INVALID_TASK;
+
+        auto stats = getJitterStats();
+        LOG_DEBUG << "[Looper] " << _tag << ": Ended " << _rate << "/s (pooled). Late avg " << stats.meanLateNs / 1000 << "us, max "
+            << stats.maxLateNs / 1000 << "us, overrun " << stats.overruns << "/" << stats.loops;
+        return;
+    }
+
+    _threadLoopEnd();
+}
+
+#if WIN32
+
+void AsyncLooper::_threadLoopStart()
 {
     if (!_running)
     {
@@ -88,6 +211,8 @@ void AsyncLooper::loopStart()
                     using namespace std::chrono;
                     using namespace std::chrono_literals;
 
+                    applyThreadSchedParams();
+
                     tStart = duration_cast<microseconds>(high_resolution_clock::now().time_since_epoch()).count();
 
                     while (_running)
@@ -106,6 +231,11 @@ void AsyncLooper::loopStart()
                             //SleepEx(100, TRUE);
                             WaitForSingleObjectEx(handler, 1000, TRUE);
                         }
+                        if (us > 0)
+                        {
+                            auto tw = duration_cast<microseconds>(high_resolution_clock::now().time_since_epoch()).count();
+                            recordWakeup((tw - tStart - us) * 1000, us * 1000);
+                        }
 
                         run();
 
@@ -139,7 +269,7 @@ void AsyncLooper::loopStart()
     }
 }
 
-void AsyncLooper::loopEnd()
+void AsyncLooper::_threadLoopEnd()
 {
     if (_running)
     {
@@ -162,26 +292,80 @@ void AsyncLooper::loopEnd()
     }
 }
 
-#else // FALLBACK
-void AsyncLooper::_loopWithSleep()
+#else // LINUX / FALLBACK
+
+// Sleep to absolute deadlines so that the time spent in the loop body does not add up.
+// If a deadline is missed, the following ticks run back-to-back to catch up; if we fell
+// too far behind (system suspend, debugger, etc.) the timeline is reset instead.
+void AsyncLooper::_loopWithDeadline()
 {
+    applyThreadSchedParams();
+
+    const long long periodNs = _rate > 0 ? 1000000000LL / _rate : 0;
+    const long long resetThresholdNs = periodNs * 4;
+
+#if LINUX
+    auto nowNs = []() -> long long
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    };
+#else
+    auto nowNs = []() -> long long
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    };
+#endif
+
+    long long deadline = nowNs();
     while (_running)
     {
+        if (periodNs > 0)
+        {
+            deadline += periodNs;
+
+#if LINUX
+            timespec ts;
+            ts.tv_sec = deadline / 1000000000LL;
+            ts.tv_nsec = deadline % 1000000000LL;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && _running);
+#else
+            std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+#endif
+
+            long long t = nowNs();
+            recordWakeup(t - deadline, periodNs);
+            if (t - deadline > resetThresholdNs)
+            {
+                deadline = t;
+            }
+        }
+
         run();
-        std::this_thread::sleep_for(std::chrono::milliseconds(_rateTime));
     }
 }
 
-void AsyncLooper::loopStart()
+void AsyncLooper::_threadLoopStart()
 {
-    handler = std::thread(&AsyncLooper::_loopWithSleep, this);
-    _running = true;
+    if (!_running)
+    {
+        _running = true;
+        handler = std::thread(&AsyncLooper::_loopWithDeadline, this);
+        LOG_DEBUG << "[Looper] " << _tag << ": Started " << _rate << "/s";
+    }
 }
 
-void AsyncLooper::loopEnd()
+void AsyncLooper::_threadLoopEnd()
 {
     if (!_running) return;
     _running = false;
-    handler.join();
+    if (handler.joinable())
+        handler.join();
+
+    auto stats = getJitterStats();
+    LOG_DEBUG << "[Looper] " << _tag << ": Ended " << _rate << "/s. Late avg " << stats.meanLateNs / 1000 << "us, max " 
+        << stats.maxLateNs / 1000 << "us, overrun " << stats.overruns << "/" << stats.loops;
 }
 #endif
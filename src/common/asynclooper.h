@@ -2,7 +2,9 @@
 #include <functional>
 #include <shared_mutex>
 #include <map>
+#include <atomic>
 #include "types.h"
+#include "tick_scheduler.h"
 
 #if WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -11,7 +13,8 @@
 typedef HANDLE LooperHandler;
 
 #elif LINUX
-typedef void* LooperHandler;
+#include <thread>
+typedef std::thread LooperHandler;
 
 #else // FALLBACK
 #include <thread>
@@ -23,6 +26,16 @@ typedef std::thread LooperHandler;
 // Should be OS-specific to provide reasonable performance.
 class AsyncLooper
 {
+public:
+    // Wake-up lateness against the scheduled deadline, collected by the loop thread
+    struct JitterStats
+    {
+        unsigned long long loops = 0;
+        unsigned long long overruns = 0;    // woke up more than one period late
+        long long meanLateNs = 0;
+        long long maxLateNs = 0;
+    };
+
 protected:
     StringContent _tag;
     unsigned _rate;
@@ -31,6 +44,17 @@ protected:
 
     LooperHandler handler;
 
+    int _cpuAffinity = -1;          // -1: any core
+    int _realtimePriority = 0;      // 0: normal scheduling
+    bool _allowPool = true;
+
+    TickScheduler::TaskID _schedTaskID = TickScheduler::INVALID_TASK;  // valid if running on TickScheduler pool
+
+    std::atomic<unsigned long long> _statLoops{ 0 };
+    std::atomic<unsigned long long> _statOverruns{ 0 };
+    std::atomic<long long> _statLateSumNs{ 0 };
+    std::atomic<long long> _statLateMaxNs{ 0 };
+
 #ifdef _DEBUG
     int64_t _runThreadID = 0;
 #endif
@@ -51,7 +75,35 @@ public:
     bool isRunning() const { return _running; }
     unsigned getRate();
 
+    // Loopers run on the TickScheduler pool while it is running, except when pinned to a core,
+    //  with rate 0 or with pooling disallowed. Otherwise a dedicated thread is created.
+    bool isPooled() const { return _schedTaskID != TickScheduler::INVALID_TASK; }
+    // Keep a dedicated thread (high resolution timer on Windows) for latency sensitive loops. Takes effect on next loopStart
+    void setAllowPool(bool allow) { _allowPool = allow; }
+
+    // Pin the loop thread to a core. Takes effect on next loopStart
+    void setCPUAffinity(int cpu) { _cpuAffinity = cpu; }
+    // Linux: SCHED_FIFO priority 1-99. Windows: any value > 0 means TIME_CRITICAL. Takes effect on next loopStart
+    void setRealtimePriority(int priority) { _realtimePriority = priority; }
+
+    JitterStats getJitterStats() const;
+    void resetJitterStats();
+
+    // Apply name / priority / affinity to the calling thread
+    static void setThreadSchedParams(const StringContent& threadName, int realtimePriority, int cpuAffinity);
+
+protected:
+    void applyThreadSchedParams();
+    void recordWakeup(long long lateNs, long long periodNs);
+
 private:
     std::function<void()> _loopFunc;
     void run();
+
+    void _threadLoopStart();
+    void _threadLoopEnd();
+
+#if !WIN32
+    void _loopWithDeadline();
+#endif
 };
@@ -18,125 +18,125 @@ enum class GetResult
 	ERR_TIMEOUT
 };
 
+struct HttpRequest
+{
+	std::string url;
+	std::string etag;			// sent as If-None-Match if not empty
+	std::string lastModified;	// sent as If-Modified-Since if not empty
+
+	GetResult result = GetResult::ERR_UNKNOWN;
+	bool notModified = false;
+	std::string body;
+	std::string newEtag;
+	std::string newLastModified;
+
+	CURL* conn = nullptr;
+	curl_slist* headers = nullptr;
+};
+
 static size_t _GETWriteCallback(void* contents, size_t size, size_t nmemb, void* userp)
 {
 	size_t realsize = size * nmemb;
-	std::stringstream& ss = *(std::stringstream*)userp;
+	std::string& body = *(std::string*)userp;
 
-	ss.write((char*)contents, realsize);
+	body.append((char*)contents, realsize);
 
 	return realsize;
 }
 
-GetResult GET(const std::string& url, std::string& result)
+static size_t _GETHeaderCallback(char* buffer, size_t size, size_t nitems, void* userp)
 {
-	std::string https, host, port, target;
-	static LazyRE2 regexURL{ R"(http(s?)\:\/\/(.+?)(?:\:([\d]{1,5}))?(\/(?:.*)*))" };
-	if (RE2::FullMatch(url, *regexURL, &https, &host, &port, &target))
-	{
-		if (port.empty())
-		{
-			port = https.empty() ? "80" : "443";
-		}
-	}
-	else
-	{
-		return GetResult::ERR_RESOLVE;
-	}
-	int iport = toInt(port);
+	size_t realsize = size * nitems;
+	HttpRequest& req = *(HttpRequest*)userp;
 
-	CURLcode code;
-	CURL* conn = curl_easy_init();
+	std::string_view line(buffer, realsize);
+	while (!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+		line.remove_suffix(1);
 
-	code = curl_easy_setopt(conn, CURLOPT_FOLLOWLOCATION, 1);
-	if (code != CURLE_OK)
+	// validators of the last response only; redirects send their own headers
+	if (line.substr(0, 5) == "HTTP/")
 	{
-		LOG_ERROR << "[TableBMS] CURLOPT_FOLLOWLOCATION " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
+		req.newEtag.clear();
+		req.newLastModified.clear();
+		return realsize;
 	}
 
-	code = curl_easy_setopt(conn, CURLOPT_TIMEOUT, 10);
-	if (code != CURLE_OK)
-	{
-		LOG_ERROR << "[TableBMS] CURLOPT_TIMEOUT " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
-	}
+	size_t colon = line.find(':');
+	if (colon == line.npos)
+		return realsize;
+	std::string key(line.substr(0, colon));
+	std::string_view value = line.substr(colon + 1);
+	while (!value.empty() && value.front() == ' ')
+		value.remove_prefix(1);
 
-	code = curl_easy_setopt(conn, CURLOPT_CONNECTTIMEOUT, 10);
-	if (code != CURLE_OK)
-	{
-		LOG_ERROR << "[TableBMS] CURLOPT_CONNECTTIMEOUT " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
-	}
+	if (strEqual(key, "ETag", true))
+		req.newEtag = value;
+	else if (strEqual(key, "Last-Modified", true))
+		req.newLastModified = value;
 
-	code = curl_easy_setopt(conn, CURLOPT_SSL_VERIFYHOST, 0);
-	if (code != CURLE_OK)
-	{
-		LOG_ERROR << "[TableBMS] CURLOPT_SSL_VERIFYHOST " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
-	}
+	return realsize;
+}
 
-	code = curl_easy_setopt(conn, CURLOPT_SSL_VERIFYPEER, 0);
-	if (code != CURLE_OK)
-	{
-		LOG_ERROR << "[TableBMS] CURLOPT_SSL_VERIFYPEER " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
+#define SETOPT(option, value) \
+	if (CURLcode code = curl_easy_setopt(conn, option, value); code != CURLE_OK) \
+	{ \
+		LOG_ERROR << "[TableBMS] " #option " " << code; \
+		return false; \
 	}
 
-	code = curl_easy_setopt(conn, CURLOPT_URL, url.c_str());
-	if (code != CURLE_OK)
+static bool setupRequest(CURL* conn, HttpRequest& req)
+{
+	std::string https, host, port, target;
+	static LazyRE2 regexURL{ R"(http(s?)\:\/\/(.+?)(?:\:([\d]{1,5}))?(\/(?:.*)*))" };
+	if (!RE2::FullMatch(req.url, *regexURL, &https, &host, &port, &target))
 	{
-		LOG_ERROR << "[TableBMS] CURLOPT_URL " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
+		req.result = GetResult::ERR_RESOLVE;
+		return false;
 	}
-
-	code = curl_easy_setopt(conn, CURLOPT_PORT, iport);
-	if (code != CURLE_OK)
+	if (port.empty())
 	{
-		LOG_ERROR << "[TableBMS] CURLOPT_PORT " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
+		port = https.empty() ? "80" : "443";
 	}
+	long iport = toInt(port);
 
 	static curl_version_info_data* curlversion = curl_version_info(CURLVERSION_NOW);
 	static std::string ua = (boost::format("curl/%d.%d.%d") % (curlversion->version_num >> 16 & 0xFF) % (curlversion->version_num >> 8 & 0xFF) % (curlversion->version_num & 0xFF)).str();
-	code = curl_easy_setopt(conn, CURLOPT_USERAGENT, ua.c_str());
-	if (code != CURLE_OK)
-	{
-		LOG_ERROR << "[TableBMS] CURLOPT_USERAGENT " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
-	}
-
-	std::stringstream bodyStream;
 
-	code = curl_easy_setopt(conn, CURLOPT_WRITEFUNCTION, _GETWriteCallback);
-	if (code != CURLE_OK)
+	req.result = GetResult::ERR_SYSTEM;
+	SETOPT(CURLOPT_PRIVATE, &req);
+	SETOPT(CURLOPT_FOLLOWLOCATION, 1L);
+	SETOPT(CURLOPT_TIMEOUT, 10L);
+	SETOPT(CURLOPT_CONNECTTIMEOUT, 10L);
+	SETOPT(CURLOPT_SSL_VERIFYHOST, 0L);
+	SETOPT(CURLOPT_SSL_VERIFYPEER, 0L);
+	SETOPT(CURLOPT_URL, req.url.c_str());
+	SETOPT(CURLOPT_PORT, iport);
+	SETOPT(CURLOPT_USERAGENT, ua.c_str());
+	SETOPT(CURLOPT_WRITEFUNCTION, _GETWriteCallback);
+	SETOPT(CURLOPT_WRITEDATA, &req.body);
+	SETOPT(CURLOPT_HEADERFUNCTION, _GETHeaderCallback);
+	SETOPT(CURLOPT_HEADERDATA, &req);
+
+	if (!req.etag.empty())
+		req.headers = curl_slist_append(req.headers, ("If-None-Match: " + req.etag).c_str());
+	if (!req.lastModified.empty())
+		req.headers = curl_slist_append(req.headers, ("If-Modified-Since: " + req.lastModified).c_str());
+	if (req.headers)
 	{
-		LOG_ERROR << "[TableBMS] CURLOPT_WRITEFUNCTION " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
+		SETOPT(CURLOPT_HTTPHEADER, req.headers);
 	}
 
-	code = curl_easy_setopt(conn, CURLOPT_WRITEDATA, &bodyStream);
-	if (code != CURLE_OK)
-	{
-		LOG_ERROR << "[TableBMS] CURLOPT_WRITEDATA " << code;
-		curl_easy_cleanup(conn);
-		return GetResult::ERR_SYSTEM;
-	}
+	req.result = GetResult::ERR_UNKNOWN;
+	return true;
+}
+
+#undef SETOPT
 
-	code = curl_easy_perform(conn);
+static GetResult finishRequest(CURL* conn, CURLcode code)
+{
 	if (code != CURLE_OK)
 	{
 		LOG_ERROR << "[TableBMS] curl_easy_perform " << code;
-		curl_easy_cleanup(conn);
 		switch (code)
 		{
 		case CURLE_OUT_OF_MEMORY: return GetResult::ERR_SYSTEM;
@@ -156,175 +156,392 @@ GetResult GET(const std::string& url, std::string& result)
 	if (code != CURLE_OK)
 	{
 		LOG_ERROR << "[TableBMS] CURLINFO_RESPONSE_CODE " << code;
-		curl_easy_cleanup(conn);
 		return GetResult::ERR_SYSTEM;
 	}
 
-	if (response_code / 100 == 2)
+	if (response_code / 100 == 2 || response_code == 304)
 	{
-		result = bodyStream.str();
-		curl_easy_cleanup(conn);
 		return GetResult::OK;
 	}
 	else
 	{
 		LOG_ERROR << "[TableBMS] HTTP " << response_code;
-		curl_easy_cleanup(conn);
 		return GetResult::ERR_HTTP;
 	}
 }
 
-void DifficultyTableBMS::updateFromUrl(std::function<void(DifficultyTable::UpdateResult)> finishedCallback)
+// Runs all requests concurrently on one curl multi handle and blocks until every one has finished or cancel is set
+static void GETMulti(const std::vector<HttpRequest*>& requests, const std::atomic<bool>* cancel = nullptr)
 {
-	if (!strEqual(url.substr(0, 7), "http://", true) && !strEqual(url.substr(0, 8), "https://", true) ||
-		url.substr(8).find('/') == url.npos)
+	if (requests.empty()) return;
+
+	CURLM* multi = curl_multi_init();
+	if (multi == nullptr)
 	{
-		LOG_ERROR << "[TableBMS] URL error: " << url;
-		finishedCallback(UpdateResult::WEB_PATH_ERROR);
+		LOG_ERROR << "[TableBMS] curl_multi_init failed";
+		for (auto req : requests)
+			req->result = GetResult::ERR_SYSTEM;
 		return;
 	}
-	std::string remotePath = url.substr(0, url.find_last_of('/') + 1);
-	
-	std::string webUrl, headerUrl, dataUrl;
+	curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, 4L);
 
-	// parse HTML
-	webUrl = url;
-	if (!strEqual(webUrl.substr(webUrl.length() - 5), ".json", true))
+	for (auto req : requests)
 	{
-		std::string headerFileName;
-		std::string body;
-
-		LOG_INFO << "[TableBMS] GET: " << webUrl;
-		auto result = GET(webUrl, body);
-		if (result == GetResult::OK)
+		req->body.clear();
+		req->notModified = false;
+		req->conn = curl_easy_init();
+		if (req->conn == nullptr)
 		{
-			// <meta name="bmstable" content="./header.json">
-			std::string content;
-			static const LazyRE2 re{ R"(meta +name=['"]bmstable['"] *content=['"](.+)['"])"};
-			if (RE2::PartialMatch(body, *re, &content))
-			{
-				headerFileName = content;
-				LOG_DEBUG << "[TableBMS] bmstable: " << content;
-			}
+			req->result = GetResult::ERR_SYSTEM;
+			continue;
 		}
-		else
+		if (!setupRequest(req->conn, *req) || curl_multi_add_handle(multi, req->conn) != CURLM_OK)
 		{
-			switch (result)
-			{
-			case GetResult::ERR_RESOLVE:	  finishedCallback(DifficultyTable::UpdateResult::WEB_PATH_ERROR); break;
-			case GetResult::ERR_CONNECT:
-			case GetResult::ERR_WRITE:
-			case GetResult::ERR_READ:		 
-			case GetResult::ERR_HTTP:		  finishedCallback(DifficultyTable::UpdateResult::WEB_CONNECT_ERR); break;
-			case GetResult::ERR_TIMEOUT:	  finishedCallback(DifficultyTable::UpdateResult::WEB_TIMEOUT); break;
-			default:						  finishedCallback(DifficultyTable::UpdateResult::INTERNAL_ERROR); break;
-			}
+			curl_easy_cleanup(req->conn);
+			req->conn = nullptr;
+			if (req->result == GetResult::ERR_UNKNOWN)
+				req->result = GetResult::ERR_SYSTEM;
 		}
+	}
 
-		if (!headerFileName.empty())
+	int running = 0;
+	do
+	{
+		if (CURLMcode mc = curl_multi_perform(multi, &running); mc != CURLM_OK)
 		{
-			if (strEqual(headerFileName.substr(0, 7), "http://", true) || strEqual(headerFileName.substr(0, 8), "https://", true))
-				headerUrl = headerFileName;
-			else
-				headerUrl = remotePath + headerFileName;
-			LOG_INFO << "[TableBMS] Header URL: " << headerUrl;
+			LOG_ERROR << "[TableBMS] curl_multi_perform " << mc;
+			break;
 		}
-		else
+		if (cancel && cancel->load(std::memory_order_relaxed))
+		{
+			LOG_INFO << "[TableBMS] Cancelled with " << running << " requests in flight";
+			break;
+		}
+		if (running > 0)
+			curl_multi_wait(multi, nullptr, 0, cancel ? 100 : 1000, nullptr);
+	} while (running > 0);
+
+	CURLMsg* msg = nullptr;
+	int msgLeft = 0;
+	while ((msg = curl_multi_info_read(multi, &msgLeft)) != nullptr)
+	{
+		if (msg->msg != CURLMSG_DONE) continue;
+
+		HttpRequest* req = nullptr;
+		curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char**)&req);
+		if (req == nullptr) continue;
+
+		req->result = finishRequest(msg->easy_handle, msg->data.result);
+		if (req->result == GetResult::OK)
 		{
-			finishedCallback(UpdateResult::WEB_PARSE_FAILED);
-			return;
+			long response_code = 0;
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
+			req->notModified = (response_code == 304);
 		}
 	}
-	else
+
+	for (auto req : requests)
 	{
-		headerUrl = webUrl;
+		if (req->conn)
+		{
+			curl_multi_remove_handle(multi, req->conn);
+			curl_easy_cleanup(req->conn);
+			req->conn = nullptr;
+		}
+		if (req->headers)
+		{
+			curl_slist_free_all(req->headers);
+			req->headers = nullptr;
+		}
+		if (req->result != GetResult::OK)
+			req->body.clear();
 	}
+	curl_multi_cleanup(multi);
+}
 
-	// parse Header
-	if (!headerUrl.empty())
+GetResult GET(const std::string& url, std::string& result)
+{
+	HttpRequest req;
+	req.url = url;
+	GETMulti({ &req });
+	if (req.result == GetResult::OK)
+		result = std::move(req.body);
+	return req.result;
+}
+
+static bool isAbsoluteUrl(const std::string& url)
+{
+	return strEqual(url.substr(0, 7), "http://", true) || strEqual(url.substr(0, 8), "https://", true);
+}
+
+static DifficultyTable::UpdateResult toUpdateResult(GetResult result, DifficultyTable::UpdateResult pathError,
+	DifficultyTable::UpdateResult connectError, DifficultyTable::UpdateResult timeout)
+{
+	switch (result)
 	{
-		std::string body;
+	case GetResult::ERR_RESOLVE:	return pathError;
+	case GetResult::ERR_CONNECT:
+	case GetResult::ERR_WRITE:
+	case GetResult::ERR_READ:
+	case GetResult::ERR_HTTP:		return connectError;
+	case GetResult::ERR_TIMEOUT:	return timeout;
+	default:						return DifficultyTable::UpdateResult::INTERNAL_ERROR;
+	}
+}
+
+// Validators of the downloaded header.json and data.json, stored as cache.json in the table folder
+struct TableCacheValidator
+{
+	std::string url;
+	std::string etag;
+	std::string lastModified;
+};
 
-		LOG_INFO << "[TableBMS] GET header: " << headerUrl;
-		auto result = GET(headerUrl, body);
-		if (result == GetResult::OK)
+static bool readFile(const Path& path, std::string& content)
+{
+	std::ifstream ifs(path, std::ios_base::binary | std::ios_base::ate);
+	if (ifs.fail()) return false;
+	content.resize(size_t(ifs.tellg()));
+	ifs.seekg(0);
+	ifs.read(content.data(), content.size());
+	return !ifs.fail();
+}
+
+static void writeFile(const Path& path, const std::string& content)
+{
+	if (!fs::exists(path.parent_path())) fs::create_directories(path.parent_path());
+	std::ofstream ofs(path, std::ios_base::binary);
+	ofs << content;
+	ofs.close();
+}
+
+static void loadCacheValidators(const Path& tablePath, TableCacheValidator& header, TableCacheValidator& data)
+{
+	std::string content;
+	if (!readFile(tablePath / "cache.json", content)) return;
+	try
+	{
+		tao::json::value v = tao::json::from_string(content);
+		auto read = [&](const char* key, TableCacheValidator& out)
 		{
-			if (!body.empty())
+			if (auto p = v.find(key); p != nullptr && p->is_object())
 			{
-				parseHeader(body);
-
-				auto tablePath = getFolderPath();
-				if (!fs::exists(tablePath)) fs::create_directories(tablePath);
-				std::ofstream ofs(tablePath / "header.json", std::ios_base::binary);
-				ofs << body;
-				ofs.close();
+				if (auto s = p->find("url"); s != nullptr && s->is_string()) out.url = s->get_string();
+				if (auto s = p->find("etag"); s != nullptr && s->is_string()) out.etag = s->get_string();
+				if (auto s = p->find("last_modified"); s != nullptr && s->is_string()) out.lastModified = s->get_string();
 			}
+		};
+		read("header", header);
+		read("data", data);
+	}
+	catch (std::exception& e)
+	{
+		LOG_WARNING << "[TableBMS] cache.json Error: " << to_utf8(e.what(), eFileEncoding::LATIN1);
+	}
+}
+
+static void saveCacheValidators(const Path& tablePath, const TableCacheValidator& header, const TableCacheValidator& data)
+{
+	auto write = [](const TableCacheValidator& in)
+	{
+		return tao::json::value{ { "url", in.url }, { "etag", in.etag }, { "last_modified", in.lastModified } };
+	};
+	tao::json::value v{ { "header", write(header) }, { "data", write(data) } };
+	writeFile(tablePath / "cache.json", tao::json::to_string(v));
+}
+
+void DifficultyTableBMS::updateFromUrl(std::function<void(DifficultyTable::UpdateResult)> finishedCallback)
+{
+	updateFromUrl({ this }, [&](DifficultyTableBMS&, UpdateResult result) { finishedCallback(result); });
+}
+
+void DifficultyTableBMS::updateFromUrl(const std::vector<DifficultyTableBMS*>& tables, 
+	std::function<void(DifficultyTableBMS&, DifficultyTable::UpdateResult)> finishedCallback, const std::atomic<bool>* cancel)
+{
+	// Every table goes through the same three steps (HTML -> header -> data). Each step is fetched for all
+	//  tables at once, so the total wait is about three round trips no matter how many tables there are.
+	//  header.json and data.json already on disk are revalidated with ETag / Last-Modified.
+	struct Update
+	{
+		DifficultyTableBMS* table = nullptr;
+		bool finished = false;
+		std::string remotePath;
+		std::string headerUrl;
+		std::string dataUrl;
+		Path tablePath;
+		TableCacheValidator headerCache;
+		TableCacheValidator dataCache;
+		HttpRequest req;
+	};
+	std::vector<Update> updates(tables.size());
+
+	auto finish = [&](Update& u, UpdateResult result)
+	{
+		u.finished = true;
+		finishedCallback(*u.table, result);
+	};
+
+	auto fetch = [&](const std::function<bool(Update&)>& prepare)
+	{
+		std::vector<HttpRequest*> requests;
+		for (auto& u : updates)
+		{
+			if (!u.finished && prepare(u))
+				requests.push_back(&u.req);
 		}
-		else
+		GETMulti(requests, cancel);
+	};
+
+	for (size_t i = 0; i < tables.size(); ++i)
+	{
+		Update& u = updates[i];
+		u.table = tables[i];
+		const std::string& url = u.table->url;
+		if (!isAbsoluteUrl(url) || url.substr(8).find('/') == url.npos)
 		{
-			switch (result)
-			{
-			case GetResult::ERR_RESOLVE:	  finishedCallback(DifficultyTable::UpdateResult::WEB_PATH_ERROR); break;
-			case GetResult::ERR_CONNECT:
-			case GetResult::ERR_WRITE:
-			case GetResult::ERR_READ:
-			case GetResult::ERR_HTTP:		  finishedCallback(DifficultyTable::UpdateResult::WEB_CONNECT_ERR); break;
-			case GetResult::ERR_TIMEOUT:	  finishedCallback(DifficultyTable::UpdateResult::WEB_TIMEOUT); break;
-			default:						  finishedCallback(DifficultyTable::UpdateResult::INTERNAL_ERROR); break;
-			}
+			LOG_ERROR << "[TableBMS] URL error: " << url;
+			finish(u, UpdateResult::WEB_PATH_ERROR);
+			continue;
 		}
+		u.remotePath = url.substr(0, url.find_last_of('/') + 1);
+		u.tablePath = u.table->getFolderPath();
+		loadCacheValidators(u.tablePath, u.headerCache, u.dataCache);
+
+		if (strEqual(url.substr(url.length() - 5), ".json", true))
+			u.headerUrl = url;
+	}
 
-		if (!data_url.empty() && !name.empty())
+	// parse HTML
+	fetch([](Update& u)
+	{
+		if (!u.headerUrl.empty()) return false;
+		u.req = HttpRequest();
+		u.req.url = u.table->url;
+		LOG_INFO << "[TableBMS] GET: " << u.req.url;
+		return true;
+	});
+	for (auto& u : updates)
+	{
+		if (u.finished || !u.headerUrl.empty()) continue;
+		if (u.req.result != GetResult::OK)
 		{
-			if (strEqual(data_url.substr(0, 7), "http://", true) || strEqual(data_url.substr(0, 8), "https://", true))
-				dataUrl = data_url;
-			else
-				dataUrl = remotePath + data_url;
-			LOG_INFO << "[TableBMS] Data URL: " << dataUrl;
+			finish(u, toUpdateResult(u.req.result, UpdateResult::WEB_PATH_ERROR, UpdateResult::WEB_CONNECT_ERR, UpdateResult::WEB_TIMEOUT));
+			continue;
 		}
-		else
+
+		// <meta name="bmstable" content="./header.json">
+		std::string headerFileName;
+		static const LazyRE2 re{ R"(meta +name=['"]bmstable['"] *content=['"](.+)['"])"};
+		if (!RE2::PartialMatch(u.req.body, *re, &headerFileName) || headerFileName.empty())
 		{
-			finishedCallback(UpdateResult::HEADER_PARSE_FAILED);
-			return;
+			finish(u, UpdateResult::WEB_PARSE_FAILED);
+			continue;
 		}
+		LOG_DEBUG << "[TableBMS] bmstable: " << headerFileName;
+
+		u.headerUrl = isAbsoluteUrl(headerFileName) ? headerFileName : u.remotePath + headerFileName;
+		LOG_INFO << "[TableBMS] Header URL: " << u.headerUrl;
 	}
 
-	// parse Data
-	if (!dataUrl.empty())
+	// parse Header
+	fetch([](Update& u)
+	{
+		u.req = HttpRequest();
+		u.req.url = u.headerUrl;
+		if (u.headerCache.url == u.headerUrl && fs::exists(u.tablePath / "header.json"))
+		{
+			u.req.etag = u.headerCache.etag;
+			u.req.lastModified = u.headerCache.lastModified;
+		}
+		LOG_INFO << "[TableBMS] GET header: " << u.req.url;
+		return true;
+	});
+	for (auto& u : updates)
 	{
-		std::string body;
+		if (u.finished) continue;
+		if (u.req.result != GetResult::OK)
+		{
+			finish(u, toUpdateResult(u.req.result, UpdateResult::HEADER_PATH_ERROR, UpdateResult::HEADER_CONNECT_ERR, UpdateResult::HEADER_TIMEOUT));
+			continue;
+		}
 
-		LOG_INFO << "[TableBMS] GET body: " << dataUrl;
-		auto result = GET(dataUrl, body);
-		if (result == GetResult::OK)
+		if (u.req.notModified)
 		{
-			parseBody(body);
+			LOG_INFO << "[TableBMS] Header not modified: " << u.headerUrl;
+			std::string body;
+			if (readFile(u.tablePath / "header.json", body))
+				u.table->parseHeader(body);
 		}
-		else
+		else if (!u.req.body.empty())
 		{
-			switch (result)
-			{
-			case GetResult::ERR_RESOLVE:	  finishedCallback(DifficultyTable::UpdateResult::WEB_PATH_ERROR); break;
-			case GetResult::ERR_CONNECT:
-			case GetResult::ERR_WRITE:
-			case GetResult::ERR_READ:
-			case GetResult::ERR_HTTP:		  finishedCallback(DifficultyTable::UpdateResult::WEB_CONNECT_ERR); break;
-			case GetResult::ERR_TIMEOUT:	  finishedCallback(DifficultyTable::UpdateResult::WEB_TIMEOUT); break;
-			default:						  finishedCallback(DifficultyTable::UpdateResult::INTERNAL_ERROR); break;
-			}
+			u.table->parseHeader(u.req.body);
+			writeFile(u.tablePath / "header.json", u.req.body);
+			u.headerCache = { u.headerUrl, u.req.newEtag, u.req.newLastModified };
+		}
+
+		if (u.table->data_url.empty() || u.table->name.empty())
+		{
+			finish(u, UpdateResult::HEADER_PARSE_FAILED);
+			continue;
+		}
+
+		u.dataUrl = isAbsoluteUrl(u.table->data_url) ? u.table->data_url : u.remotePath + u.table->data_url;
+		LOG_INFO << "[TableBMS] Data URL: " << u.dataUrl;
+	}
+
+	// parse Data
+	fetch([](Update& u)
+	{
+		u.req = HttpRequest();
+		u.req.url = u.dataUrl;
+		if (u.dataCache.url == u.dataUrl && fs::exists(u.tablePath / "data.json"))
+		{
+			u.req.etag = u.dataCache.etag;
+			u.req.lastModified = u.dataCache.lastModified;
+		}
+		LOG_INFO << "[TableBMS] GET body: " << u.req.url;
+		return true;
+	});
+	for (auto& u : updates)
+	{
+		if (u.finished) continue;
+		if (u.req.result != GetResult::OK)
+		{
+			finish(u, toUpdateResult(u.req.result, UpdateResult::DATA_PATH_ERROR, UpdateResult::DATA_CONNECT_ERR, UpdateResult::DATA_TIMEOUT));
+			continue;
 		}
 
-		if (!entries.empty())
+		auto& entries = u.table->entries;
+		if (u.req.notModified)
 		{
+			LOG_INFO << "[TableBMS] Data not modified: " << u.dataUrl;
+			std::string body;
+			if (entries.empty() && readFile(u.tablePath / "data.json", body))
+				u.table->parseBody(body);
 		}
 		else
 		{
-			finishedCallback(UpdateResult::DATA_PARSE_FAILED);
-			return;
+			// keep the entries we have if the new data is broken
+			auto prevEntries = std::move(entries);
+			entries.clear();
+			u.table->parseBody(u.req.body);
+			if (entries.empty())
+			{
+				entries = std::move(prevEntries);
+				finish(u, UpdateResult::DATA_PARSE_FAILED);
+				continue;
+			}
+			writeFile(u.tablePath / "data.json", u.req.body);
+			u.dataCache = { u.dataUrl, u.req.newEtag, u.req.newLastModified };
 		}
-	}
 
-	finishedCallback(UpdateResult::OK);
+		saveCacheValidators(u.tablePath, u.headerCache, u.dataCache);
+
+		if (entries.empty())
+			finish(u, UpdateResult::DATA_PARSE_FAILED);
+		else
+			finish(u, UpdateResult::OK);
+	}
 }
 
 bool DifficultyTableBMS::loadFromFile()
@@ -361,17 +578,13 @@ bool DifficultyTableBMS::loadFromFile()
 	parseHeader(headerFile.str());
 
 	// parse Data
-	std::ifstream dataifs(dataPath);
-	if (dataifs.fail())
+	std::string dataFile;
+	if (!readFile(dataPath, dataFile))
 	{
 		LOG_WARNING << "[TableBMS] Open data.json failed!";
 		return false;
 	}
-	std::stringstream dataFile;
-	dataFile << dataifs.rdbuf();
-	dataifs.sync();
-	dataifs.close();
-	parseBody(dataFile.str());
+	parseBody(dataFile);
 
 	return true;
 }
@@ -430,6 +643,66 @@ void DifficultyTableBMS::parseHeader(const std::string& content)
 
 }
 
+// SAX consumer for data.json. Builds entries while parsing, only level / md5 / title of each top-level
+//  object are kept; everything else (comments, urls, nested values) is skipped without building values
+struct TableBodyConsumer : tao::json::events::discard
+{
+	std::map<std::string, std::vector<std::shared_ptr<EntryBase>>>& entries;
+	size_t depth = 0;
+
+	enum class Field { NONE, LEVEL, MD5, TITLE } field = Field::NONE;
+	std::string level, md5, name;
+
+	TableBodyConsumer(std::map<std::string, std::vector<std::shared_ptr<EntryBase>>>& out) : entries(out) {}
+
+	void begin_array(const std::size_t = 0) { ++depth; }
+	void end_array(const std::size_t = 0) { --depth; }
+	void begin_object(const std::size_t = 0)
+	{
+		if (++depth == 2)
+		{
+			level = "0";
+			md5.clear();
+			name.clear();
+		}
+	}
+	void end_object(const std::size_t = 0)
+	{
+		if (depth-- == 2 && !level.empty() && !md5.empty())
+		{
+			auto pEntry = std::make_shared<EntryChart>();
+			pEntry->md5 = md5;
+			pEntry->_name = name;
+			entries[level].push_back(pEntry);
+		}
+	}
+
+	void key(const std::string_view k)
+	{
+		field = Field::NONE;
+		if (depth != 2) return;
+		if (k == "level") field = Field::LEVEL;
+		else if (k == "md5") field = Field::MD5;
+		else if (k == "title") field = Field::TITLE;
+	}
+	void member() { field = Field::NONE; }
+
+	void string(const std::string_view v)
+	{
+		if (depth != 2) return;
+		switch (field)
+		{
+		case Field::LEVEL: level = v; break;
+		case Field::MD5:   md5 = v; break;
+		case Field::TITLE: name = v; break;
+		default: break;
+		}
+	}
+	void number(const std::int64_t v) { if (depth == 2 && field == Field::LEVEL) level = std::to_string(v); }
+	void number(const std::uint64_t v) { if (depth == 2 && field == Field::LEVEL) level = std::to_string(v); }
+	void number(const double) {}
+};
+
 void DifficultyTableBMS::parseBody(const std::string& content)
 {
 	try
@@ -443,53 +716,19 @@ void DifficultyTableBMS::parseBody(const std::string& content)
 				bodyview = bodyview.substr(3);
 			}
 
-			std::vector<tao::json::value> header = tao::json::from_string(bodyview).get_array();
-			for (auto& entry : header)
+			// entries are only taken if the whole body parses
+			std::map<std::string, std::vector<std::shared_ptr<EntryBase>>> parsed;
+			TableBodyConsumer consumer(parsed);
+			tao::json::events::from_string(consumer, bodyview);
+			for (auto& [level, list] : parsed)
 			{
-				std::string level, md5, name;
-				switch (entry["level"].type())
-				{
-				case tao::json::type::UNSIGNED:    level = std::to_string(entry["level"].get_unsigned()); break;
-				case tao::json::type::SIGNED:      level = std::to_string(entry["level"].get_signed()); break;
-				case tao::json::type::STRING:      level = entry["level"].get_string(); break;
-				case tao::json::type::STRING_VIEW: level = entry["level"].get_string_view(); break;
-				default:						   level = "0"; break;
-				}
-
-				try
-				{
-					md5 = entry["md5"].get_string();
-				}
-				catch (std::bad_variant_access& e)
-				{
-				}
-
-				try
-				{
-					name = entry["title"].get_string();
-				}
-				catch (std::bad_variant_access& e)
-				{
-				}
-
-				if (!level.empty() && !md5.empty())
-				{
-					auto pEntry = std::make_shared<EntryChart>();
-					pEntry->md5 = md5;
-					pEntry->_name = name;
-					entries[level].push_back(pEntry);
-				}
+				auto& dst = entries[level];
+				dst.insert(dst.end(), list.begin(), list.end());
 			}
-
-			auto tablePath = getFolderPath();
-			if (!fs::exists(tablePath)) fs::create_directories(tablePath);
-			std::ofstream ofs(tablePath / "data.json", std::ios_base::binary);
-			ofs << content;
-			ofs.close();
 		}
 	}
 	catch (std::exception& e)
 	{
 		LOG_ERROR << "[TableBMS] Data JSON Error: " << to_utf8(e.what(), eFileEncoding::LATIN1);
 	}
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include "difficultytable.h"
 
 class DifficultyTableBMS: public DifficultyTable
@@ -14,6 +15,12 @@ protected:
 public:
 	virtual void updateFromUrl(std::function<void(UpdateResult)> finishedCallback) override;
 
+	// Update several tables concurrently. The callback is called once per table, on the calling thread.
+	//  Tables loaded from file keep their entries when the server replies not modified or the request fails.
+	//  Setting *cancel aborts the transfers in flight within about 100ms; unfinished tables report an error
+	static void updateFromUrl(const std::vector<DifficultyTableBMS*>& tables, std::function<void(DifficultyTableBMS&, UpdateResult)> finishedCallback,
+		const std::atomic<bool>* cancel = nullptr);
+
 	virtual bool loadFromFile() override;
 
 	Path getFolderPath() const;
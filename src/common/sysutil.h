@@ -86,6 +86,44 @@ void callWMEventHandler(void* arg1 = 0, void* arg2 = 0, void* arg3 = 0, void* ar
 long long getFileTimeNow();
 long long getFileLastWriteTime(const Path& p);
 
+// Read-only memory mapped file. data() is nullptr if the file could not be mapped
+class MappedFile
+{
+private:
+	const uint8_t* _data = nullptr;
+	size_t _size = 0;
+	void* _handle = nullptr;	// platform specific
+
+public:
+	explicit MappedFile(const Path& p);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* data() const { return _data; }
+	size_t size() const { return _size; }
+};
+
+// Watches directory trees for changes (inotify on Linux, ReadDirectoryChangesW on Windows).
+//  wait() returns the directories whose entries were created, written, removed or renamed since the last call.
+//  A directory may be reported more than once; debouncing is up to the caller.
+//  New sub directories are watched automatically
+class FolderWatcher
+{
+private:
+	void* _handle = nullptr;	// platform specific
+
+public:
+	FolderWatcher();
+	~FolderWatcher();
+	FolderWatcher(const FolderWatcher&) = delete;
+	FolderWatcher& operator=(const FolderWatcher&) = delete;
+
+	bool isValid() const { return _handle != nullptr; }
+	bool addTree(const Path& root);
+	std::vector<Path> wait(int timeoutMs);
+};
+
 enum class Languages
 {
 	EN,
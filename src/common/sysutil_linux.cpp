@@ -1,10 +1,15 @@
 #ifdef LINUX
 #include "sysutil.h"
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <unistd.h>
 
 std::tm local_time(const time_t* time)
 {
-    return localtime(time);
+    std::tm t;
+    localtime_r(time, &t);
+    return t;
 }
 
 void SetDebugThreadName(const char* name) {}
@@ -24,13 +29,13 @@ void GetExecutablePath(char* output, size_t bufsize, size_t& len)
 
     char szTmp[32];
     sprintf(szTmp, "/proc/%d/exe", getpid());
-    int bytes = MIN(readlink(szTmp, fullpath, sizeof(fullpath)), sizeof(fullpath) - 1);
+    ssize_t bytes = std::min<ssize_t>(readlink(szTmp, fullpath, sizeof(fullpath)), sizeof(fullpath) - 1);
     if (bytes >= 0)
         fullpath[bytes] = '\0';
 
     using namespace std::filesystem;
     auto parent = path(fullpath).parent_path();
-    strcpy(output, bufsize, (const char*)parent.u8string().c_str());
+    snprintf(output, bufsize, "%s", (const char*)parent.u8string().c_str());
     len = strlen(output);
 }
 
@@ -44,4 +49,134 @@ void callWMEventHandler(void* arg1, void* arg2, void* arg3, void* arg4)
 
 }
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+MappedFile::MappedFile(const Path& p)
+{
+    int fd = open(p.c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* addr = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            _data = (const uint8_t*)addr;
+            _size = (size_t)st.st_size;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data) munmap((void*)_data, _size);
+}
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unordered_map>
+struct FolderWatcherInotify
+{
+    int fd = -1;
+    std::unordered_map<int, Path> watches;     // wd -> directory
+
+    void addWatch(const Path& dir)
+    {
+        int wd = inotify_add_watch(fd, dir.c_str(), IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR);
+        if (wd >= 0)
+            watches[wd] = dir;
+    }
+    void addTree(const Path& root)
+    {
+        std::error_code ec;
+        if (!fs::is_directory(root, ec)) return;
+        addWatch(root);
+        for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec);
+            it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (ec) break;
+            if (it->is_directory(ec))
+                addWatch(it->path());
+        }
+    }
+};
+
+FolderWatcher::FolderWatcher()
+{
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return;
+
+    auto w = new FolderWatcherInotify;
+    w->fd = fd;
+    _handle = w;
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    if (_handle)
+    {
+        auto w = (FolderWatcherInotify*)_handle;
+        close(w->fd);
+        delete w;
+    }
+}
+
+bool FolderWatcher::addTree(const Path& root)
+{
+    if (!_handle) return false;
+    auto w = (FolderWatcherInotify*)_handle;
+    size_t count = w->watches.size();
+    w->addTree(root);
+    return w->watches.size() > count;
+}
+
+std::vector<Path> FolderWatcher::wait(int timeoutMs)
+{
+    std::vector<Path> changed;
+    if (!_handle) return changed;
+    auto w = (FolderWatcherInotify*)_handle;
+
+    pollfd pfd = { w->fd, POLLIN, 0 };
+    if (poll(&pfd, 1, timeoutMs) <= 0)
+        return changed;
+
+    alignas(inotify_event) char buf[16384];
+    ssize_t len;
+    while ((len = read(w->fd, buf, sizeof(buf))) > 0)
+    {
+        for (char* p = buf; p < buf + len; p += sizeof(inotify_event) + ((inotify_event*)p)->len)
+        {
+            const inotify_event& e = *(inotify_event*)p;
+            if (e.mask & IN_Q_OVERFLOW)
+            {
+                // events were dropped, report everything we watch
+                for (const auto& [wd, dir] : w->watches)
+                    changed.push_back(dir);
+                continue;
+            }
+            auto it = w->watches.find(e.wd);
+            if (it == w->watches.end())
+                continue;
+            if (e.mask & IN_IGNORED)
+            {
+                w->watches.erase(it);
+                continue;
+            }
+
+            changed.push_back(it->second);
+            if ((e.mask & IN_ISDIR) && (e.mask & (IN_CREATE | IN_MOVED_TO)) && e.len > 0)
+            {
+                Path sub = it->second / e.name;
+                w->addTree(sub);
+                changed.push_back(sub);
+            }
+        }
+    }
+    return changed;
+}
+
 #endif
\ No newline at end of file
@@ -156,4 +156,167 @@ long long getFileLastWriteTime(const Path& p)
     return std::chrono::duration_cast<std::chrono::seconds>(fs::last_write_time(p).time_since_epoch()).count() - 11644473600;
 }
 
+MappedFile::MappedFile(const Path& p)
+{
+    HANDLE hFile = CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return;
+
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0)
+    {
+        HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (hMapping != NULL)
+        {
+            _data = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (_data)
+            {
+                _size = (size_t)size.QuadPart;
+                _handle = hMapping;
+            }
+            else
+            {
+                CloseHandle(hMapping);
+            }
+        }
+    }
+    CloseHandle(hFile);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data) UnmapViewOfFile(_data);
+    if (_handle) CloseHandle((HANDLE)_handle);
+}
+
+// one overlapped ReadDirectoryChangesW per root, sub trees included
+struct FolderWatcherWin32
+{
+    struct Root
+    {
+        Path path;
+        HANDLE hDir = INVALID_HANDLE_VALUE;
+        OVERLAPPED overlapped = {};
+        alignas(DWORD) BYTE buffer[32768];
+
+        ~Root()
+        {
+            if (hDir != INVALID_HANDLE_VALUE)
+            {
+                CancelIo(hDir);
+                CloseHandle(hDir);
+            }
+            if (overlapped.hEvent) CloseHandle(overlapped.hEvent);
+        }
+
+        bool read()
+        {
+            ResetEvent(overlapped.hEvent);
+            return ReadDirectoryChangesW(hDir, buffer, sizeof(buffer), TRUE,
+                FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+                NULL, &overlapped, NULL);
+        }
+    };
+    std::vector<std::unique_ptr<Root>> roots;
+};
+
+FolderWatcher::FolderWatcher()
+{
+    _handle = new FolderWatcherWin32;
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    delete (FolderWatcherWin32*)_handle;
+}
+
+bool FolderWatcher::addTree(const Path& root)
+{
+    auto w = (FolderWatcherWin32*)_handle;
+
+    // WaitForMultipleObjects limit
+    if (w->roots.size() >= MAXIMUM_WAIT_OBJECTS) return false;
+
+    HANDLE hDir = CreateFileW(root.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (hDir == INVALID_HANDLE_VALUE) return false;
+
+    auto r = std::make_unique<FolderWatcherWin32::Root>();
+    r->path = root;
+    r->hDir = hDir;
+    r->overlapped.hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (!r->read())
+        return false;
+    w->roots.push_back(std::move(r));
+    return true;
+}
+
+std::vector<Path> FolderWatcher::wait(int timeoutMs)
+{
+    std::vector<Path> changed;
+    auto w = (FolderWatcherWin32*)_handle;
+    if (w->roots.empty())
+    {
+        Sleep(timeoutMs);
+        return changed;
+    }
+
+    std::vector<HANDLE> events;
+    for (auto& r : w->roots)
+        events.push_back(r->overlapped.hEvent);
+    if (WaitForMultipleObjects((DWORD)events.size(), events.data(), FALSE, timeoutMs) == WAIT_TIMEOUT)
+        return changed;
+
+    for (auto it = w->roots.begin(); it != w->roots.end(); )
+    {
+        auto& r = *it;
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(r->hDir, &r->overlapped, &bytes, FALSE))
+        {
+            DWORD err = GetLastError();
+            if (err == ERROR_IO_INCOMPLETE)
+            {
+                ++it;
+                continue;
+            }
+
+            // too many changes to report, check the whole tree and keep watching
+            changed.push_back(r->path);
+            if (err == ERROR_NOTIFY_ENUM_DIR && r->read())
+            {
+                ++it;
+                continue;
+            }
+
+            // root deleted, drive removed... Stop watching the root; a signalled event left behind
+            //  would make every wait return at once
+            it = w->roots.erase(it);
+            continue;
+        }
+
+        if (bytes == 0)
+        {
+            // buffer overflow, report the whole tree
+            changed.push_back(r->path);
+        }
+        for (BYTE* p = r->buffer; bytes > 0; )
+        {
+            const FILE_NOTIFY_INFORMATION& info = *(FILE_NOTIFY_INFORMATION*)p;
+            Path item = r->path / std::wstring(info.FileName, info.FileNameLength / sizeof(WCHAR));
+            changed.push_back(item.parent_path());
+            if (info.Action != FILE_ACTION_REMOVED && info.Action != FILE_ACTION_RENAMED_OLD_NAME && fs::is_directory(item))
+                changed.push_back(item);
+
+            if (info.NextEntryOffset == 0) break;
+            p += info.NextEntryOffset;
+        }
+        if (!r->read())
+        {
+            it = w->roots.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    return changed;
+}
+
 #endif
\ No newline at end of file
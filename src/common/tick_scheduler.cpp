@@ -0,0 +1,221 @@
+#include "tick_scheduler.h"
+#include <chrono>
+#include "asynclooper.h"
+#include "log.h"
+
+TickScheduler TickScheduler::_inst;
+
+static thread_local TickScheduler::TaskID currentTaskID = TickScheduler::INVALID_TASK;
+
+static long long nowNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+TickScheduler::~TickScheduler()
+{
+    // early exit paths may skip stop(); joinable threads would terminate the process
+    {
+        std::unique_lock lock(_mutex);
+        _running = false;
+    }
+    _cv.notify_all();
+    for (auto& t : _workers)
+    {
+        if (t.joinable())
+            t.join();
+    }
+}
+
+void TickScheduler::start(unsigned workers, int realtimePriority)
+{
+    std::unique_lock lock(_inst._mutex);
+    if (_inst._running) return;
+    if (workers == 0) workers = 1;
+
+    _inst._running = true;
+    for (unsigned i = 0; i < workers; ++i)
+    {
+        _inst._workers.emplace_back(&TickScheduler::workerLoop, &_inst, i, realtimePriority);
+    }
+    LOG_INFO << "[TickScheduler] Started with " << workers << " workers";
+}
+
+void TickScheduler::stop()
+{
+    {
+        std::unique_lock lock(_inst._mutex);
+        if (!_inst._running) return;
+        _inst._running = false;
+    }
+    _inst._cv.notify_all();
+    for (auto& t : _inst._workers)
+    {
+        if (t.joinable())
+            t.join();
+    }
+    _inst._workers.clear();
+
+    std::unique_lock lock(_inst._mutex);
+    for (auto& [id, task] : _inst._tasks)
+    {
+        LOG_WARNING << "[TickScheduler] Task still registered at stop: " << task->tag;
+    }
+    _inst._tasks.clear();
+    _inst._queue = decltype(_inst._queue)();
+    LOG_INFO << "[TickScheduler] Stopped";
+}
+
+bool TickScheduler::isRunning()
+{
+    std::unique_lock lock(_inst._mutex);
+    return _inst._running;
+}
+
+TickScheduler::TaskID TickScheduler::addTask(StringContentView tag, TaskFunc func, long long periodNs, long long budgetNs)
+{
+    assert(periodNs > 0);
+
+    auto task = std::make_shared<Task>();
+    task->tag = tag;
+    task->func = std::move(func);
+    task->periodNs = periodNs;
+    task->budgetNs = budgetNs > 0 ? budgetNs : periodNs;
+    task->deadline = nowNs() + periodNs;
+
+    TaskID id;
+    {
+        std::unique_lock lock(_inst._mutex);
+        id = _inst._nextID++;
+        _inst._tasks[id] = task;
+        _inst._queue.push({ task->deadline, id });
+    }
+    // the new deadline may be earlier than what the workers are waiting for; one of them re-checks
+    _inst._cv.notify_one();
+    return id;
+}
+
+void TickScheduler::removeTask(TaskID id)
+{
+    std::unique_lock lock(_inst._mutex);
+    auto it = _inst._tasks.find(id);
+    if (it == _inst._tasks.end()) return;
+
+    auto task = it->second;
+    task->removed = true;
+    _inst._tasks.erase(it);
+    // queued entry is skipped by workers when popped
+
+    if (currentTaskID != id &&
+        !_inst._cvRemoved.wait_for(lock, std::chrono::milliseconds(REMOVE_WAIT_MS), [&] { return !task->running; }))
+    {
+        LOG_WARNING << "[TickScheduler] " << task->tag << ": Task body still running after " << REMOVE_WAIT_MS << "ms, stop waiting";
+    }
+
+    if (task->overruns > 0)
+    {
+        auto s = makeStats(*task);
+        LOG_DEBUG << "[TickScheduler] " << s.tag << ": Over budget " << s.overruns << "/" << s.runs
+            << ", run avg " << s.meanRunNs / 1000 << "us, max " << s.maxRunNs / 1000 << "us, budget " << s.budgetNs / 1000 << "us";
+    }
+}
+
+std::vector<TickScheduler::TaskStats> TickScheduler::getStats()
+{
+    std::unique_lock lock(_inst._mutex);
+    std::vector<TaskStats> res;
+    res.reserve(_inst._tasks.size());
+    for (const auto& [id, task] : _inst._tasks)
+    {
+        res.push_back(makeStats(*task));
+    }
+    return res;
+}
+
+TickScheduler::TaskStats TickScheduler::makeStats(const Task& t)
+{
+    TaskStats s;
+    s.tag = t.tag;
+    s.periodNs = t.periodNs;
+    s.budgetNs = t.budgetNs;
+    s.runs = t.runs;
+    s.overruns = t.overruns;
+    s.meanRunNs = t.runs ? t.runSumNs / (long long)t.runs : 0;
+    s.maxRunNs = t.maxRunNs;
+    return s;
+}
+
+void TickScheduler::workerLoop(unsigned index, int realtimePriority)
+{
+    AsyncLooper::setThreadSchedParams("Tick Worker " + std::to_string(index), realtimePriority, -1);
+
+    std::unique_lock lock(_mutex);
+    while (_running)
+    {
+        if (_queue.empty())
+        {
+            _cv.wait(lock);
+            continue;
+        }
+
+        auto [deadline, id] = _queue.top();
+        auto it = _tasks.find(id);
+        if (it == _tasks.end())
+        {
+            // removed
+            _queue.pop();
+            continue;
+        }
+
+        long long t = nowNs();
+        if (t < deadline)
+        {
+            _cv.wait_until(lock, std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadline)));
+            continue;
+        }
+
+        _queue.pop();
+        auto task = it->second;
+        task->running = true;
+        lock.unlock();
+
+        currentTaskID = id;
+        long long tBegin = nowNs();
+        try
+        {
+            task->func(tBegin - deadline);
+        }
+        catch (std::exception& e)
+        {
+            LOG_WARNING << "[TickScheduler] " << task->tag << ": Exception: " << e.what();
+        }
+        long long tEnd = nowNs();
+        currentTaskID = INVALID_TASK;
+
+        lock.lock();
+        task->running = false;
+
+        long long runNs = tEnd - tBegin;
+        task->runs++;
+        task->runSumNs += runNs;
+        if (runNs > task->maxRunNs) task->maxRunNs = runNs;
+        if (runNs > task->budgetNs) task->overruns++;
+
+        if (!task->removed)
+        {
+            // same catch-up rule as AsyncLooper: run late ticks back-to-back, reset if too far behind
+            task->deadline = deadline + task->periodNs;
+            if (tEnd - task->deadline > task->periodNs * 4)
+                task->deadline = tEnd;
+            _queue.push({ task->deadline, id });
+
+            // hand off to one sleeping worker in case this one stays busy with the next due task
+            _cv.notify_one();
+        }
+        else
+        {
+            _cvRemoved.notify_all();
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <queue>
+#include <map>
+#include <memory>
+#include <vector>
+#include "types.h"
+
+// Runs periodic tasks on a small fixed pool of worker threads.
+// Tasks are picked by earliest deadline; a task never runs on two workers at once.
+// AsyncLooper registers here instead of spawning a thread when the pool is running.
+class TickScheduler
+{
+public:
+    typedef unsigned long long TaskID;
+    static constexpr TaskID INVALID_TASK = 0;
+
+    // lateNs: how late the worker picked the task up against its deadline
+    typedef std::function<void(long long lateNs)> TaskFunc;
+
+    struct TaskStats
+    {
+        StringContent tag;
+        long long periodNs = 0;
+        long long budgetNs = 0;
+        unsigned long long runs = 0;
+        unsigned long long overruns = 0;    // run time exceeded budget
+        long long meanRunNs = 0;
+        long long maxRunNs = 0;
+    };
+
+private:
+    struct Task
+    {
+        StringContent tag;
+        TaskFunc func;
+        long long periodNs = 0;
+        long long budgetNs = 0;
+        long long deadline = 0;
+        bool running = false;
+        bool removed = false;
+
+        unsigned long long runs = 0;
+        unsigned long long overruns = 0;
+        long long runSumNs = 0;
+        long long maxRunNs = 0;
+    };
+
+    typedef std::pair<long long, TaskID> QueueItem;   // deadline, id
+
+    std::mutex _mutex;
+    std::condition_variable _cv;            // workers: queue changed
+    std::condition_variable _cvRemoved;     // removeTask(): a removed task finished its run
+    std::map<TaskID, std::shared_ptr<Task>> _tasks;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> _queue;
+    std::vector<std::thread> _workers;
+    TaskID _nextID = 1;
+    bool _running = false;
+
+    static TickScheduler _inst;
+    TickScheduler() = default;
+    ~TickScheduler();
+
+public:
+    // Start worker threads. realtimePriority is applied to every worker, see AsyncLooper::setRealtimePriority
+    static void start(unsigned workers, int realtimePriority = 0);
+    // Stop and join workers. Tasks still registered are dropped
+    static void stop();
+    static bool isRunning();
+
+    // First run is one period from now. budgetNs <= 0 uses the period as budget
+    static TaskID addTask(StringContentView tag, TaskFunc func, long long periodNs, long long budgetNs = 0);
+    // Waits up to REMOVE_WAIT_MS for a running body to return, unless called from inside the task itself.
+    //  Bounded because bodies may wait on the main thread, which is often the one removing the task
+    static void removeTask(TaskID id);
+    static constexpr long long REMOVE_WAIT_MS = 1000;
+
+    static std::vector<TaskStats> getStats();
+
+private:
+    void workerLoop(unsigned index, int realtimePriority);
+    static TaskStats makeStats(const Task& t);
+};
@@ -7,17 +7,27 @@ void ConfigGeneral::setDefaults() noexcept
 	set(A_MODE, A_MODE_AUTO);
 	set(A_BUFCOUNT, 4);
 	set(A_BUFLEN, 256);
+	set(A_ASYNC_IO, false);
+	set(A_MIXER, A_MIXER_FMOD);
+	set(A_BGM_SCHEDULE_AHEAD, 300);
+	set(A_SAMPLE_MEMORY_BUDGET, 512);
 	set(V_RES_SUPERSAMPLE, 1);
 	set(V_DISPLAY_RES_X, CANVAS_WIDTH);
 	set(V_DISPLAY_RES_Y, CANVAS_HEIGHT);
 	set(V_WINMODE, V_WINMODE_WINDOWED);
 	set(V_MAXFPS, 480);
 	set(V_VSYNC, true);
+	set(V_BGA_MEMORY_BUDGET, 256);
 	set(E_PROFILE, PROFILE_DEFAULT);
 	set(E_LR2PATH, ".");
 	set(E_FOLDERS, std::vector<std::string>());
 	set(E_TABLES, std::vector<std::string>());
 	set(E_LOG_LEVEL, E_LOG_LEVEL_INFO);
+	set(E_LOOPER_REALTIME_PRIORITY, 0);
+	set(E_LOOPER_CPU_INPUT, -1);
+	set(E_LOOPER_CPU_SOUND, -1);
+	set(E_LOOPER_CPU_UPDATE, -1);
+	set(E_TICK_WORKERS, 3);
 }
 
 
@@ -45,6 +45,16 @@ namespace cfg {
 
 	constexpr char A_BUFCOUNT[] = "BufferCount";
 
+	constexpr char A_ASYNC_IO[] = "AsyncIO";
+
+	constexpr char A_MIXER[] = "AudioMixer";
+    constexpr char A_MIXER_FMOD[] = "FMOD";
+    constexpr char A_MIXER_NATIVE[] = "Native";
+
+	constexpr char A_BGM_SCHEDULE_AHEAD[] = "BGMScheduleAhead";
+
+	constexpr char A_SAMPLE_MEMORY_BUDGET[] = "SampleMemoryBudget";     // MB of decoded keysounds
+
     //////////////////////////////////////////////////////////////////////////////// 
     // Video
 
@@ -67,6 +77,8 @@ namespace cfg {
 
 	constexpr char V_VSYNC[] = "VSync";
 
+	constexpr char V_BGA_MEMORY_BUDGET[] = "BGAMemoryBudget";     // MB of BGA textures and cached pictures
+
     //////////////////////////////////////////////////////////////////////////////// 
     // etc
     constexpr char E_PROFILE[] = "Profile";
@@ -80,6 +92,12 @@ namespace cfg {
     constexpr char E_LOG_LEVEL_WARNING[] = "Warning";
     constexpr char E_LOG_LEVEL_ERROR[] = "Error";
 
+    constexpr char E_LOOPER_REALTIME_PRIORITY[] = "LooperRealtimePriority";    // 0: off
+    constexpr char E_LOOPER_CPU_INPUT[] = "LooperCPUInput";                     // -1: any
+    constexpr char E_LOOPER_CPU_SOUND[] = "LooperCPUSound";
+    constexpr char E_LOOPER_CPU_UPDATE[] = "LooperCPUUpdate";
+    constexpr char E_TICK_WORKERS[] = "TickSchedulerWorkers";                   // 0: one thread per looper
+
     constexpr char PROFILE_DEFAULT[] = "default";
 
 }
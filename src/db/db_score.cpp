@@ -150,174 +150,295 @@ ScoreDB::ScoreDB(const char* path): SQLite(path, "SCORE")
         LOG_ERROR << "[ScoreDB] Create table score_course_bms ERROR! " << errmsg();
         abort();
     }
+
+    writer = std::thread(&ScoreDB::writerLoop, this);
 }
 
-std::shared_ptr<ScoreBMS> ScoreDB::getScoreBMS(const char* tableName, const HashMD5& hash) const
+ScoreDB::~ScoreDB()
 {
-    std::string hashStr = hash.hexdigest();
-    if (cache[tableName].find(hashStr) != cache[tableName].end())
-        return cache[tableName][hashStr];
-
-    /*
-    char sqlbuf[64] = { 0 };
-    sprintf(sqlbuf, "SELECT * FROM %s WHERE md5=?", tableName);
-    auto result = query(sqlbuf, SCORE_BMS_PARAM_COUNT, { hashStr });
-
-    if (!result.empty())
     {
-        const auto& r = result[0];
-        auto ret = std::make_shared<ScoreBMS>();
-        convert_score_bms(ret, r);
-        cache[hashStr] = ret;
-        return ret;
+        std::unique_lock l(writeMutex);
+        writerRunning = false;
     }
-    else
+    writeCond.notify_all();
+    if (writer.joinable())
+        writer.join();
+}
+
+const char* ScoreDB::tableName(ScoreTableType table)
+{
+    switch (table)
     {
-        cache[hashStr] = nullptr;
-        return nullptr;
+    case TABLE_CHART: return "score_bms";
+    case TABLE_COURSE: return "score_course_bms";
+    default: return "";
     }
-    */
-    cache[tableName][hashStr] = nullptr;
+}
+
+std::shared_ptr<ScoreBMS> ScoreDB::ScoreTableBMS::find(const HashMD5& key) const
+{
+    if (auto it = index.find(key); it != index.end())
+        return record[it->second];
     return nullptr;
 }
 
-void ScoreDB::updateScoreBMS(const char* tableName, const HashMD5& hash, const ScoreBMS& score)
+void ScoreDB::ScoreTableBMS::set(const HashMD5& key, std::shared_ptr<ScoreBMS> score)
 {
-    std::string hashStr = hash.hexdigest();
+    if (auto it = index.find(key); it != index.end())
+    {
+        lamp[it->second] = score->lamp;
+        rate[it->second] = score->rate;
+        record[it->second] = std::move(score);
+        return;
+    }
+    index[key] = (uint32_t)hash.size();
+    hash.push_back(key);
+    lamp.push_back(score->lamp);
+    rate.push_back(score->rate);
+    record.push_back(std::move(score));
+}
+
+void ScoreDB::ScoreTableBMS::clear()
+{
+    index.clear();
+    hash.clear();
+    lamp.clear();
+    rate.clear();
+    record.clear();
+}
+
+std::shared_ptr<ScoreBMS> ScoreDB::getScoreBMS(ScoreTableType table, const HashMD5& hash) const
+{
+    // every score is preloaded; a miss means not played
+    std::shared_lock l(cacheMutex);
+    return cache[table].find(hash);
+}
 
-    auto pRecord = getScoreBMS(tableName, hash);
-    if (pRecord)
+// keep only what is stored in the table, like reading the row back
+static std::shared_ptr<ScoreBMS> makeStoredScore(const ScoreBMS& in)
+{
+    auto out = std::make_shared<ScoreBMS>();
+    out->notes = in.notes;
+    out->score = in.score;
+    out->rate = in.rate;
+    out->fast = in.fast;
+    out->slow = in.slow;
+    out->maxcombo = in.maxcombo;
+    out->addtime = in.addtime;
+    out->playcount = in.playcount;
+    out->clearcount = in.clearcount;
+    out->exscore = in.exscore;
+    out->lamp = in.lamp;
+    out->pgreat = in.pgreat;
+    out->great = in.great;
+    out->good = in.good;
+    out->bad = in.bad;
+    out->kpoor = in.kpoor;
+    out->miss = in.miss;
+    out->bp = in.bp;
+    out->combobreak = in.combobreak;
+    out->replayFileName = in.replayFileName;
+    return out;
+}
+
+void ScoreDB::updateScoreBMS(ScoreTableType table, const HashMD5& hash, const ScoreBMS& score)
+{
+    std::shared_ptr<ScoreBMS> stored;
     {
-        auto record = *pRecord;
+        std::unique_lock l(cacheMutex);
 
-        if (score.notes != record.notes)
+        auto pRecord = cache[table].find(hash);
+        if (pRecord)
         {
-            record.notes = score.notes;
-        }
+            auto record = *pRecord;
 
-        if (score.score > record.score)
-        {
-            record.score = score.score;
-        }
+            if (score.notes != record.notes)
+            {
+                record.notes = score.notes;
+            }
 
-        if (score.exscore > record.exscore)
-        {
-            record.rate = score.rate;
-            record.fast = score.fast;
-            record.slow = score.slow;
-            record.exscore = score.exscore;
-            record.pgreat = score.pgreat;
-            record.great = score.great;
-            record.good = score.good;
-            record.bad = score.bad;
-            record.kpoor = score.kpoor;
-            record.miss = score.miss;
-            record.combobreak = score.combobreak;
-            record.replayFileName = score.replayFileName;
-        }
-        else if (score.exscore == record.exscore)
-        {
-            if (score.maxcombo > record.maxcombo || score.bp < record.bp || (int)score.lamp >(int)record.lamp)
+            if (score.score > record.score)
+            {
+                record.score = score.score;
+            }
+
+            if (score.exscore > record.exscore)
+            {
+                record.rate = score.rate;
+                record.fast = score.fast;
+                record.slow = score.slow;
+                record.exscore = score.exscore;
+                record.pgreat = score.pgreat;
+                record.great = score.great;
+                record.good = score.good;
+                record.bad = score.bad;
+                record.kpoor = score.kpoor;
+                record.miss = score.miss;
+                record.combobreak = score.combobreak;
                 record.replayFileName = score.replayFileName;
-        }
+            }
+            else if (score.exscore == record.exscore)
+            {
+                if (score.maxcombo > record.maxcombo || score.bp < record.bp || (int)score.lamp >(int)record.lamp)
+                    record.replayFileName = score.replayFileName;
+            }
 
-        if (score.maxcombo > record.maxcombo)
-        {
-            record.maxcombo = score.maxcombo;
-        }
+            if (score.maxcombo > record.maxcombo)
+            {
+                record.maxcombo = score.maxcombo;
+            }
 
-        if (score.bp < record.bp)
-        {
-            record.bp = score.bp;
-        }
+            if (score.bp < record.bp)
+            {
+                record.bp = score.bp;
+            }
 
-        if (score.playcount > record.playcount)
-        {
-            record.playcount = score.playcount;
-        }
+            if (score.playcount > record.playcount)
+            {
+                record.playcount = score.playcount;
+            }
 
-        if (score.clearcount > record.clearcount)
-        {
-            record.clearcount = score.clearcount;
-        }
+            if (score.clearcount > record.clearcount)
+            {
+                record.clearcount = score.clearcount;
+            }
 
-        if ((int)score.lamp > (int)record.lamp)
-        {
-            record.lamp = score.lamp;
-        }
+            if ((int)score.lamp > (int)record.lamp)
+            {
+                record.lamp = score.lamp;
+            }
 
-        if (score.bp < record.bp)
+            if (score.bp < record.bp)
+            {
+                record.bp = score.bp;
+            }
+
+            stored = makeStoredScore(record);
+        }
+        else
         {
-            record.bp = score.bp;
+            stored = makeStoredScore(score);
         }
-
-        char sqlbuf[224] = { 0 };
-        sprintf(sqlbuf, "UPDATE %s SET notes=?,score=?,rate=?,fast=?,slow=?,maxcombo=?,addtime=?,pc=?,clearcount=?,exscore=?,lamp=?,"
-            "pgreat=?,great=?,good=?,bad=?,bpoor=?,miss=?,bp=?,cb=?,replay=? WHERE md5=?", tableName);
-        exec(sqlbuf,
-            { record.notes, record.score, record.rate, record.fast, record.slow,
-            record.maxcombo, (long long)std::time(nullptr), record.playcount, record.clearcount, record.exscore, (int)record.lamp,
-            record.pgreat, record.great, record.good, record.bad, record.kpoor, record.miss, record.bp, record.combobreak, record.replayFileName,
-            hashStr });
-        cache[tableName].erase(hashStr);
+        stored->addtime = (long long)std::time(nullptr);
+        cache[table].set(hash, stored);
     }
-    else
+
     {
-        char sqlbuf[224] = { 0 };
-        sprintf(sqlbuf, "INSERT INTO %s(md5,notes,score,rate,fast,slow,maxcombo,addtime,pc,clearcount,exscore,lamp,"
-            "pgreat,great,good,bad,bpoor,miss,bp,cb,replay) VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)", tableName);
-        exec(sqlbuf,
-            { hashStr,
-            score.notes, score.score, score.rate, score.fast, score.slow,
-            score.maxcombo, (long long)std::time(nullptr), score.playcount, score.clearcount, score.exscore, (int)score.lamp,
-            score.pgreat, score.great, score.good, score.bad, score.kpoor, score.miss, score.bp, score.combobreak, score.replayFileName });
+        std::unique_lock l(writeMutex);
+        writeQueue.push_back({ table, hash, *stored });
     }
+    writeCond.notify_one();
+}
 
-    char sqlbuf[96] = { 0 };
-    sprintf(sqlbuf, "SELECT * FROM %s WHERE md5=?", tableName);
-    auto result = query(sqlbuf, SCORE_BMS_PARAM_COUNT, { hashStr });
-    if (!result.empty())
+void ScoreDB::writerLoop()
+{
+    std::unique_lock l(writeMutex);
+    while (true)
     {
-        const auto& r = result[0];
-        auto ret = std::make_shared<ScoreBMS>();
-        convert_score_bms(ret, r);
-        cache[tableName][hashStr] = ret;
+        writeCond.wait(l, [this] { return !writeQueue.empty() || !writerRunning; });
+        if (writeQueue.empty())
+            break;
+
+        std::deque<PendingWrite> batch;
+        batch.swap(writeQueue);
+        writerBusy = true;
+        l.unlock();
+
+        std::unique_lock dbLock(dbMutex);
+        transactionStart();
+        for (const auto& [table, hash, record] : batch)
+        {
+            char sqlbuf[224] = { 0 };
+            sprintf(sqlbuf, "INSERT OR REPLACE INTO %s(md5,notes,score,rate,fast,slow,maxcombo,addtime,pc,clearcount,exscore,lamp,"
+                "pgreat,great,good,bad,bpoor,miss,bp,cb,replay) VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)", tableName(table));
+            if (SQLITE_OK != exec(sqlbuf,
+                { hash.hexdigest(),
+                record.notes, record.score, record.rate, record.fast, record.slow,
+                record.maxcombo, record.addtime, record.playcount, record.clearcount, record.exscore, (int)record.lamp,
+                record.pgreat, record.great, record.good, record.bad, record.kpoor, record.miss, record.bp, record.combobreak, record.replayFileName }))
+            {
+                LOG_ERROR << "[ScoreDB] Write score " << hash.hexdigest() << " ERROR! " << errmsg();
+            }
+        }
+        transactionStop();
+        dbLock.unlock();
+
+        l.lock();
+        writerBusy = false;
+        writeIdleCond.notify_all();
     }
 }
 
+void ScoreDB::flush()
+{
+    std::unique_lock l(writeMutex);
+    writeIdleCond.wait(l, [this] { return writeQueue.empty() && !writerBusy; });
+}
+
 std::shared_ptr<ScoreBMS> ScoreDB::getChartScoreBMS(const HashMD5& hash) const
 {
-    return getScoreBMS("score_bms", hash);
+    return getScoreBMS(TABLE_CHART, hash);
 }
 
 void ScoreDB::updateChartScoreBMS(const HashMD5& hash, const ScoreBMS& score)
 {
-    return updateScoreBMS("score_bms", hash, score);
+    return updateScoreBMS(TABLE_CHART, hash, score);
 }
 
 std::shared_ptr<ScoreBMS> ScoreDB::getCourseScoreBMS(const HashMD5& hash) const
 {
-    return getScoreBMS("score_course_bms", hash);
+    return getScoreBMS(TABLE_COURSE, hash);
 }
 
 void ScoreDB::updateCourseScoreBMS(const HashMD5& hash, const ScoreBMS& score)
 {
-    return updateScoreBMS("score_course_bms", hash, score);
+    return updateScoreBMS(TABLE_COURSE, hash, score);
 }
 
-void ScoreDB::preloadScore()
+std::vector<std::shared_ptr<ScoreBMS>> ScoreDB::getChartScoreBMS(const std::vector<HashMD5>& hashes) const
 {
-    cache.clear();
-    for (auto& r : query("SELECT * FROM score_course_bms", SCORE_BMS_PARAM_COUNT))
+    std::vector<std::shared_ptr<ScoreBMS>> ret(hashes.size());
+    std::shared_lock l(cacheMutex);
+    const auto& t = cache[TABLE_CHART];
+    for (size_t i = 0; i < hashes.size(); ++i)
+        ret[i] = t.find(hashes[i]);
+    return ret;
+}
+
+void ScoreDB::getChartLampRateBMS(const std::vector<HashMD5>& hashes, std::vector<ScoreBMS::Lamp>& lamps, std::vector<double>& rates) const
+{
+    lamps.assign(hashes.size(), ScoreBMS::Lamp::NOPLAY);
+    rates.assign(hashes.size(), 0.);
+    std::shared_lock l(cacheMutex);
+    const auto& t = cache[TABLE_CHART];
+    for (size_t i = 0; i < hashes.size(); ++i)
     {
-        auto ret = std::make_shared<ScoreBMS>();
-        convert_score_bms(ret, r);
-        cache["score_course_bms"][ANY_STR(r[0])] = ret;
+        if (auto it = t.index.find(hashes[i]); it != t.index.end())
+        {
+            lamps[i] = t.lamp[it->second];
+            rates[i] = t.rate[it->second];
+        }
     }
-    for (auto& r : query("SELECT * FROM score_bms", SCORE_BMS_PARAM_COUNT))
+}
+
+void ScoreDB::preloadScore()
+{
+    flush();
+
+    std::unique_lock l(cacheMutex);
+    std::unique_lock dbLock(dbMutex);
+    for (ScoreTableType table : { TABLE_COURSE, TABLE_CHART })
     {
-        auto ret = std::make_shared<ScoreBMS>();
-        convert_score_bms(ret, r);
-        cache["score_bms"][ANY_STR(r[0])] = ret;
+        auto& t = cache[table];
+        t.clear();
+
+        char sqlbuf[64] = { 0 };
+        sprintf(sqlbuf, "SELECT * FROM %s", tableName(table));
+        for (auto& r : query(sqlbuf, SCORE_BMS_PARAM_COUNT))
+        {
+            auto ret = std::make_shared<ScoreBMS>();
+            convert_score_bms(ret, r);
+            t.set(HashMD5(ANY_STR(r[0])), ret);
+        }
     }
-}
\ No newline at end of file
+}
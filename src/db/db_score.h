@@ -3,6 +3,12 @@
 #include <vector>
 #include <memory>
 #include <map>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
 #include "common/types.h"
 #include "db_conn.h"
 
@@ -18,18 +24,58 @@ class ScoreBMS;
 class ScoreDB : public SQLite
 {
 protected:
-    mutable std::unordered_map<std::string, std::unordered_map<std::string, std::shared_ptr<ScoreBMS>>> cache;
+    // Scores of one table, keyed by binary hash. Lamp and rate are also kept as plain columns
+    //  so list sorting can read them without touching the records
+    struct ScoreTableBMS
+    {
+        std::unordered_map<HashMD5, uint32_t> index;
+        std::vector<HashMD5> hash;
+        std::vector<ScoreBMS::Lamp> lamp;
+        std::vector<double> rate;
+        std::vector<std::shared_ptr<ScoreBMS>> record;
+
+        std::shared_ptr<ScoreBMS> find(const HashMD5& key) const;
+        void set(const HashMD5& key, std::shared_ptr<ScoreBMS> score);
+        void clear();
+    };
+    enum ScoreTableType
+    {
+        TABLE_CHART,
+        TABLE_COURSE,
+        TABLE_COUNT,
+    };
+    static const char* tableName(ScoreTableType table);
+
+    mutable std::shared_mutex cacheMutex;
+    ScoreTableBMS cache[TABLE_COUNT];
+
+    // write-behind: results are applied to the cache at once and written to sqlite by the writer thread
+    struct PendingWrite
+    {
+        ScoreTableType table;
+        HashMD5 hash;
+        ScoreBMS record;
+    };
+    std::mutex dbMutex;         // sqlite access from the writer thread
+    std::mutex writeMutex;
+    std::condition_variable writeCond;
+    std::condition_variable writeIdleCond;
+    std::deque<PendingWrite> writeQueue;
+    bool writerRunning = true;
+    bool writerBusy = false;
+    std::thread writer;
+    void writerLoop();
 
 public:
     ScoreDB() = delete;
     ScoreDB(const char* path);
-    ~ScoreDB() = default;
+    ~ScoreDB();
     ScoreDB(ScoreDB&) = delete;
     ScoreDB& operator= (ScoreDB&) = delete;
 
 protected:
-    std::shared_ptr<ScoreBMS> getScoreBMS(const char* tableName, const HashMD5& hash) const;
-    void updateScoreBMS(const char* tableName, const HashMD5& hash, const ScoreBMS& score);
+    std::shared_ptr<ScoreBMS> getScoreBMS(ScoreTableType table, const HashMD5& hash) const;
+    void updateScoreBMS(ScoreTableType table, const HashMD5& hash, const ScoreBMS& score);
 
 public:
     std::shared_ptr<ScoreBMS> getChartScoreBMS(const HashMD5& hash) const;
@@ -38,5 +84,10 @@ public:
     std::shared_ptr<ScoreBMS> getCourseScoreBMS(const HashMD5& hash) const;
     void updateCourseScoreBMS(const HashMD5& hash, const ScoreBMS& score);
 
+    // Resolve a whole list under one lock. Missing scores are nullptr / NOPLAY / 0
+    std::vector<std::shared_ptr<ScoreBMS>> getChartScoreBMS(const std::vector<HashMD5>& hashes) const;
+    void getChartLampRateBMS(const std::vector<HashMD5>& hashes, std::vector<ScoreBMS::Lamp>& lamps, std::vector<double>& rates) const;
+
     void preloadScore();
+    void flush();   // blocks until queued writes are in the database
 };
@@ -1,5 +1,7 @@
 #include <set>
 #include <regex>
+#include <algorithm>
+#include <sstream>
 #include "common/utils.h"
 #include "db_song.h"
 #include "common/log.h"
@@ -183,7 +185,7 @@ bool convert_bms(std::shared_ptr<ChartFormatBMSMeta> chart, const std::vector<st
 }
 
 
-SongDB::SongDB(const char* path) : SQLite(path, "SONG")
+SongDB::SongDB(const char* path) : SQLite(path, "SONG"), dbPath(fs::u8path(path))
 {
     if (exec("PRAGMA cache_size = -512000") != SQLITE_OK)
     {
@@ -232,6 +234,72 @@ SongDB::SongDB(const char* path) : SQLite(path, "SONG")
         LOG_ERROR << "[SongDB] Create gamemode index for song ERROR! " << errmsg();
     }
 
+    initSearchIndex();
+}
+
+void SongDB::initSearchIndex()
+{
+    // FTS5 index over the searchable columns, reading text from the song table (external content).
+    // Triggers keep it in sync with every INSERT / DELETE / UPDATE on song, including folder removal.
+    // trigram (SQLite 3.34+) matches any substring including CJK; unicode61 only matches word prefixes.
+    if (auto q = query("SELECT sql FROM sqlite_master WHERE type='table' AND name='song_fts'", 1); !q.empty())
+    {
+        searchIndexType = ANY_STR(q[0][0]).find("trigram") != std::string::npos ? SEARCH_TRIGRAM : SEARCH_TOKEN;
+    }
+    else
+    {
+        bool hasTrigram = false;
+        if (auto v = query("SELECT sqlite_version()", 1); !v.empty())
+        {
+            int major = 0, minor = 0;
+            if (sscanf(ANY_STR(v[0][0]).c_str(), "%d.%d", &major, &minor) == 2)
+                hasTrigram = major > 3 || (major == 3 && minor >= 34);
+        }
+
+        const char* createSql = hasTrigram ?
+            "CREATE VIRTUAL TABLE song_fts USING fts5(title, title2, artist, artist2, genre, version, "
+            "content='song', tokenize='trigram')" :
+            "CREATE VIRTUAL TABLE song_fts USING fts5(title, title2, artist, artist2, genre, version, "
+            "content='song', tokenize='unicode61 remove_diacritics 2', prefix='1 2 3')";
+        if (exec(createSql) != SQLITE_OK)
+        {
+            LOG_WARNING << "[SongDB] FTS5 not available, search falls back to LIKE scan: " << errmsg();
+            searchIndexType = SEARCH_LIKE;
+            return;
+        }
+        searchIndexType = hasTrigram ? SEARCH_TRIGRAM : SEARCH_TOKEN;
+
+        LOG_INFO << "[SongDB] Building search index (" << (hasTrigram ? "trigram" : "unicode61") << ")";
+        if (exec("INSERT INTO song_fts(song_fts) VALUES('rebuild')") != SQLITE_OK)
+        {
+            LOG_ERROR << "[SongDB] Build search index ERROR! " << errmsg();
+        }
+    }
+
+    static const char* triggers[] =
+    {
+        "CREATE TRIGGER IF NOT EXISTS song_fts_insert AFTER INSERT ON song BEGIN "
+        "INSERT INTO song_fts(rowid, title, title2, artist, artist2, genre, version) "
+        "VALUES(new.rowid, new.title, new.title2, new.artist, new.artist2, new.genre, new.version); END",
+
+        "CREATE TRIGGER IF NOT EXISTS song_fts_delete AFTER DELETE ON song BEGIN "
+        "INSERT INTO song_fts(song_fts, rowid, title, title2, artist, artist2, genre, version) "
+        "VALUES('delete', old.rowid, old.title, old.title2, old.artist, old.artist2, old.genre, old.version); END",
+
+        "CREATE TRIGGER IF NOT EXISTS song_fts_update AFTER UPDATE ON song BEGIN "
+        "INSERT INTO song_fts(song_fts, rowid, title, title2, artist, artist2, genre, version) "
+        "VALUES('delete', old.rowid, old.title, old.title2, old.artist, old.artist2, old.genre, old.version); "
+        "INSERT INTO song_fts(rowid, title, title2, artist, artist2, genre, version) "
+        "VALUES(new.rowid, new.title, new.title2, new.artist, new.artist2, new.genre, new.version); END",
+    };
+    for (const char* sql : triggers)
+    {
+        if (exec(sql) != SQLITE_OK)
+        {
+            LOG_ERROR << "[SongDB] Create search index trigger ERROR! " << errmsg();
+            searchIndexType = SEARCH_LIKE;
+        }
+    }
 }
 
 SongDB::~SongDB()
@@ -386,32 +454,109 @@ std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findChartByName(const Hash
 {
     LOG_INFO << "[SongDB] Search for songs matching: " << tagRaw;
 
-    std::string tag = tagRaw;
-    static const std::pair<RE2, re2::StringPiece> search_replace_pattern[]
+    // build MATCH expression; trigram needs at least 3 characters to use the index
+    std::string match;
+    if (searchIndexType == SEARCH_TRIGRAM)
     {
-        {"%", "\\\\%"},
-        {"_", "\\\\_"},
-    };
-    for (const auto& [in, out] : search_replace_pattern)
+        size_t chars = std::count_if(tagRaw.begin(), tagRaw.end(), [](char c) { return (c & 0xC0) != 0x80; });
+        if (chars >= 3)
+        {
+            // whole input as one phrase, same substring semantics as LIKE
+            match = "\"";
+            for (char c : tagRaw)
+            {
+                if (c == '"') match += '"';
+                match += c;
+            }
+            match += "\"";
+        }
+    }
+    else if (searchIndexType == SEARCH_TOKEN &&
+        std::all_of(tagRaw.begin(), tagRaw.end(), [](char c) { return (c & 0x80) == 0; }))
     {
-        RE2::GlobalReplace(&tag, in, out);
+        // every word as a prefix term, implicitly AND'ed.
+        // unicode61 does not split CJK text into words, non-ASCII input goes to the LIKE scan
+        std::istringstream iss(tagRaw);
+        std::string word;
+        while (iss >> word)
+        {
+            std::string term = "\"";
+            for (char c : word)
+            {
+                if (c == '"') term += '"';
+                term += c;
+            }
+            term += "\"*";
+            if (!match.empty()) match += ' ';
+            match += term;
+        }
     }
 
-    std::stringstream ss;
-    ss << "SELECT * FROM song WHERE ";
-    if (folder != ROOT_FOLDER_HASH) 
-        ss << "parent=" << folder.hexdigest() << " AND ";
-    ss << "(title   LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "title2  LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "artist  LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "artist2 LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "genre   LIKE '%' || ? || '%' ESCAPE '\\' OR "
-        << "version LIKE '%' || ? || '%' ESCAPE '\\' )";
-    if (limit > 0) 
-        ss << " LIMIT " << limit;
+    std::vector<std::vector<std::any>> result;
+    if (!match.empty())
+    {
+        std::stringstream ss;
+        ss << "SELECT song.* FROM song_fts JOIN song ON song.rowid = song_fts.rowid WHERE song_fts MATCH ? ";
+        if (folder != ROOT_FOLDER_HASH)
+            ss << "AND song.parent=? ";
+        // title weighs most, then artist, then the rest
+        ss << "ORDER BY bm25(song_fts, 10.0, 5.0, 5.0, 2.0, 1.0, 1.0)";
+        if (limit > 0)
+            ss << " LIMIT " << limit;
+
+        std::string strSql = ss.str();
+        if (folder != ROOT_FOLDER_HASH)
+            result = query(strSql.c_str(), SONG_PARAM_COUNT, { match, folder.hexdigest() });
+        else
+            result = query(strSql.c_str(), SONG_PARAM_COUNT, { match });
+    }
+    // word prefixes miss mid-word fragments ("999" in "1999"); the token index appends the LIKE hits
+    //  after its ranked ones so results are never narrower than a plain LIKE search
+    if (match.empty() || (searchIndexType == SEARCH_TOKEN && (limit == 0 || result.size() < limit)))
+    {
+        std::string tag = tagRaw;
+        static const std::pair<RE2, re2::StringPiece> search_replace_pattern[]
+        {
+            {"%", "\\\\%"},
+            {"_", "\\\\_"},
+        };
+        for (const auto& [in, out] : search_replace_pattern)
+        {
+            RE2::GlobalReplace(&tag, in, out);
+        }
 
-    std::string strSql = ss.str();
-    auto result = query(strSql.c_str(), SONG_PARAM_COUNT, {tag, tag, tag, tag, tag, tag});
+        std::stringstream ss;
+        ss << "SELECT * FROM song WHERE ";
+        if (folder != ROOT_FOLDER_HASH)
+            ss << "parent='" << folder.hexdigest() << "' AND ";
+        ss << "(title   LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "title2  LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "artist  LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "artist2 LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "genre   LIKE '%' || ? || '%' ESCAPE '\\' OR "
+            << "version LIKE '%' || ? || '%' ESCAPE '\\' )";
+        if (limit > 0)
+            ss << " LIMIT " << limit + result.size();   // room for rows already found by MATCH
+
+        std::string strSql = ss.str();
+        auto likeResult = query(strSql.c_str(), SONG_PARAM_COUNT, { tag, tag, tag, tag, tag, tag });
+        if (result.empty())
+        {
+            result = std::move(likeResult);
+        }
+        else
+        {
+            std::set<std::pair<std::string, std::string>> found;     // parent, file
+            for (const auto& r : result)
+                found.insert({ ANY_STR(r[1]), ANY_STR(r[2]) });
+            for (auto& r : likeResult)
+            {
+                if (limit > 0 && result.size() >= limit) break;
+                if (found.insert({ ANY_STR(r[1]), ANY_STR(r[2]) }).second)
+                    result.push_back(std::move(r));
+            }
+        }
+    }
 
     std::vector<std::shared_ptr<ChartFormatBase>> ret;
     for (const auto& r : result)
@@ -456,40 +601,14 @@ std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findChartByHash(const Hash
 
     std::vector<std::shared_ptr<ChartFormatBase>> ret;
 
-    if (songQueryHashMap.find(target) == songQueryHashMap.end())
-    {
-        return ret;
-    }
-    for (const auto& index : songQueryHashMap.at(target))
+    for (auto row : catalog.songByMd5.find(target))
     {
-        const auto& r = songQueryPool[index];
-        switch (eChartFormat(ANY_INT(r[3])))
-        {
-        case eChartFormat::BMS:
-        {
-            auto p = std::make_shared<ChartFormatBMSMeta>();
-            if (convert_bms(p, r))
-            {
-                if (p->fileName.is_absolute())
-                {
-                    p->absolutePath = p->fileName;
-                    ret.push_back(p);
-                }
-                else
-                {
-                    auto& [hasFolderPath, folderPath] = getFolderPath(p->folderHash);
-                    if (hasFolderPath)
-                    {
-                        p->absolutePath = folderPath / p->fileName;
-                        ret.push_back(p);
-                    }
-                }
-            }
-            break;
-        }
+        auto& [hasFolderPath, folderPath] = getFolderPath(catalog.song.parent[row]);
+        if (!hasFolderPath && !PathFromUTF8(catalog.str(catalog.song.file[row])).is_absolute())
+            continue;
 
-        default: break;
-        }
+        if (auto p = getCatalogChart(row, folderPath); p != nullptr)
+            ret.push_back(p);
     }
 
     if (checksum)
@@ -515,6 +634,32 @@ std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findChartByHash(const Hash
     return ret;
 }
 
+std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findFirstChartByHash(const std::vector<HashMD5>& targets) const
+{
+    std::vector<std::shared_ptr<ChartFormatBase>> ret(targets.size());
+
+    // a folder path is only known if the folder was there at the last scan
+    std::unordered_map<HashMD5, std::pair<bool, Path>> folderPaths;
+    for (size_t i = 0; i < targets.size(); ++i)
+    {
+        for (auto row : catalog.songByMd5.find(targets[i]))
+        {
+            const HashMD5& parent = catalog.song.parent[row];
+            auto it = folderPaths.find(parent);
+            if (it == folderPaths.end())
+                it = folderPaths.emplace(parent, getFolderPath(parent)).first;
+
+            auto& [hasFolderPath, folderPath] = it->second;
+            if (!hasFolderPath && !PathFromUTF8(catalog.str(catalog.song.file[row])).is_absolute())
+                continue;
+
+            if (ret[i] = getCatalogChart(row, folderPath); ret[i] != nullptr)
+                break;
+        }
+    }
+    return ret;
+}
+
 // chart may duplicate, return all found
 std::vector<std::shared_ptr<ChartFormatBase>> SongDB::findChartFromTime(const HashMD5& folder, unsigned long long addTime) const
 {
@@ -573,37 +718,225 @@ void SongDB::prepareCache()
 
     // compress db i/o
     freeCache();
+    applyCache(buildCache());
+}
+
+SongCatalog SongDB::buildCache() const
+{
+    SongCatalog catalog;
+
+    // taken before reading, a write in between only makes the stamp older
+    catalog.source = getDatabaseStamp();
+
+    auto str = [](const std::any& a) { return a.has_value() ? ANY_STR(a) : std::string(); };
+    auto integer = [](const std::any& a) { return a.has_value() ? ANY_INT(a) : 0LL; };
+
+    // read in chunks so the generic query rows never exist for the whole table at once
+    static constexpr long long CHUNK_ROWS = 16384;
+    long long lastRowid = 0;
+    for (bool more = true; more; )
+    {
+        auto rows = query("SELECT *,rowid FROM song WHERE rowid>? ORDER BY rowid LIMIT ?", SONG_PARAM_COUNT + 1, { lastRowid, CHUNK_ROWS });
+        more = rows.size() == CHUNK_ROWS;
+        if (!rows.empty())
+            lastRowid = integer(rows.back()[SONG_PARAM_COUNT]);
+
+        auto& c = catalog.song;
+        for (const auto& row : rows)
+        {
+            song_all_params p(row);
+            c.md5.push_back(HashMD5(p.md5));
+            c.parent.push_back(HashMD5(p.parent));
+            c.file.push_back(catalog.intern(p.file));
+            c.type.push_back((uint8_t)p.type);
+            c.title.push_back(catalog.intern(p.title));
+            c.title2.push_back(catalog.intern(p.title2));
+            c.artist.push_back(catalog.intern(p.artist));
+            c.artist2.push_back(catalog.intern(p.artist2));
+            c.genre.push_back(catalog.intern(p.genre));
+            c.version.push_back(catalog.intern(p.version));
+            c.level.push_back((float)p.level);
+            c.bpm.push_back((float)p.bpm);
+            c.minbpm.push_back((float)p.minbpm);
+            c.maxbpm.push_back((float)p.maxbpm);
+            c.length.push_back((uint32_t)p.length);
+            c.totalnotes.push_back((uint32_t)p.totalnotes);
+            c.stagefile.push_back(catalog.intern(p.stagefile));
+            c.bannerfile.push_back(catalog.intern(p.bannerfile));
+            c.gamemode.push_back((int32_t)p.gamemode);
+            c.judgerank.push_back((int32_t)p.judgerank);
+            c.total.push_back((int32_t)p.total);
+            c.playlevel.push_back((int32_t)p.playlevel);
+            c.difficulty.push_back((int32_t)p.difficulty);
+            c.flags.push_back(
+                (p.longnote ? SongCatalog::FLAG_LN : 0) |
+                (p.landmine ? SongCatalog::FLAG_MINE : 0) |
+                (p.metricmod ? SongCatalog::FLAG_METRICMOD : 0) |
+                (p.stop ? SongCatalog::FLAG_STOP : 0) |
+                (p.bga ? SongCatalog::FLAG_BGA : 0) |
+                (p.random ? SongCatalog::FLAG_RANDOM : 0));
+            c.addtime.push_back(p.addtime);
+        }
+    }
+
+    for (const auto& row : query("SELECT * FROM folder", FOLDER_PARAM_COUNT))
+    {
+        auto& c = catalog.folder;
+        c.md5.push_back(HashMD5(str(row[0])));
+        c.parent.push_back(row[1].has_value() ? HashMD5(ANY_STR(row[1])) : HashMD5());
+        c.name.push_back(catalog.intern(str(row[2])));
+        c.type.push_back((uint8_t)integer(row[3]));
+        c.path.push_back(catalog.intern(str(row[4])));
+        c.modtime.push_back(integer(row[5]));
+    }
+
+    catalog.finalize();
+    return catalog;
+}
+
+void SongDB::applyCache(SongCatalog&& next)
+{
+    catalog = std::move(next);
+
+    {
+        std::unique_lock l(chartViewMutex);
+        chartViews.clear();
+        chartViews.resize(catalog.songCount());
+    }
+
+    LOG_DEBUG << "[SongDB] applyCache: " << catalog.songCount() << " charts, " << catalog.folderCount() << " folders, "
+        << catalog.memoryUsage() / 1024 << "KB";
+}
+
+std::string SongDB::getDatabaseStamp() const
+{
+    std::error_code ec;
+    auto size = fs::file_size(dbPath, ec);
+    if (ec) return "";
+    auto time = fs::last_write_time(dbPath, ec);
+    if (ec) return "";
+    return std::to_string(size) + ":" + std::to_string(time.time_since_epoch().count());
+}
+
+static std::string snapshotKey(const std::string& stamp, const std::vector<Path>& roots)
+{
+    std::string key = stamp;
+    for (const auto& r : roots)
+    {
+        key += '\n';
+        key += r.u8string();
+    }
+    return key;
+}
+
+bool SongDB::saveCacheSnapshot(const Path& path, const std::vector<Path>& roots) const
+{
+    if (catalog.source.empty())
+        return false;
 
-    size_t count = 0;
-    for (auto& row : query("SELECT * FROM song", SONG_PARAM_COUNT))
+    if (catalog.source != getDatabaseStamp())
     {
-        songQueryHashMap[HashMD5(ANY_STR(row[0]))].push_back(count);
-        songQueryParentMap[HashMD5(ANY_STR(row[1]))].push_back(count);
-        songQueryPool.push_back(std::move(row));
-        count++;
+        LOG_INFO << "[SongDB] Catalog is older than song.db, snapshot not saved";
+        return false;
     }
 
-    count = 0;
-    for (auto& row : query("SELECT * FROM folder", FOLDER_PARAM_COUNT))
+    if (!catalog.save(path, snapshotKey(catalog.source, roots)))
     {
-        folderQueryHashMap[HashMD5(ANY_STR(row[0]))].push_back(count);
-        if (row[1].has_value()) 
-            folderQueryParentMap[HashMD5(ANY_STR(row[1]))].push_back(count);
-        folderQueryPool.push_back(std::move(row));
-        count++;
+        LOG_WARNING << "[SongDB] Save catalog snapshot failed: " << path.u8string();
+        return false;
     }
+    LOG_INFO << "[SongDB] Saved catalog snapshot: " << catalog.songCount() << " charts, " << catalog.folderCount() << " folders";
+    return true;
+}
+
+bool SongDB::loadCacheSnapshot(const Path& path, const std::vector<Path>& roots)
+{
+    std::string stamp = getDatabaseStamp();
+    if (stamp.empty())
+        return false;
+
+    SongCatalog next;
+    next.source = stamp;
+    if (!next.load(path, snapshotKey(stamp, roots)))
+    {
+        LOG_INFO << "[SongDB] Catalog snapshot is missing or outdated";
+        return false;
+    }
+
+    LOG_INFO << "[SongDB] Loaded catalog snapshot: " << next.songCount() << " charts, " << next.folderCount() << " folders";
+    freeCache();
+    applyCache(std::move(next));
+    return true;
 }
 
 void SongDB::freeCache()
 {
-    songQueryPool.clear();
-    songQueryPool.shrink_to_fit();
-    songQueryHashMap.clear();
-    songQueryParentMap.clear();
-    folderQueryPool.clear();
-    folderQueryPool.shrink_to_fit();
-    folderQueryHashMap.clear();
-    folderQueryParentMap.clear();
+    catalog.clear();
+
+    std::unique_lock l(chartViewMutex);
+    chartViews.clear();
+    chartViews.shrink_to_fit();
+}
+
+std::shared_ptr<ChartFormatBase> SongDB::getCatalogChart(SongCatalog::Row row, const Path& folderPath) const
+{
+    std::unique_lock l(chartViewMutex);
+    if (row < chartViews.size())
+    {
+        if (auto p = chartViews[row].lock(); p != nullptr)
+            return p;
+    }
+
+    const auto& c = catalog.song;
+    if (eChartFormat(c.type[row]) != eChartFormat::BMS)
+        return nullptr;
+
+    auto chart = std::make_shared<ChartFormatBMSMeta>();
+    chart->fileHash       = c.md5[row];
+    chart->folderHash     = c.parent[row];
+    chart->fileName       = PathFromUTF8(catalog.str(c.file[row]));
+    chart->title          = catalog.str(c.title[row]);
+    chart->title2         = catalog.str(c.title2[row]);
+    chart->artist         = catalog.str(c.artist[row]);
+    chart->artist2        = catalog.str(c.artist2[row]);
+    chart->genre          = catalog.str(c.genre[row]);
+    chart->version        = catalog.str(c.version[row]);
+    chart->levelEstimated = c.level[row];
+    chart->startBPM       = c.bpm[row];
+    chart->minBPM         = c.minbpm[row];
+    chart->maxBPM         = c.maxbpm[row];
+    chart->totalLength    = c.length[row];
+    chart->totalNotes     = c.totalnotes[row];
+    chart->stagefile      = catalog.str(c.stagefile[row]);
+    chart->banner         = catalog.str(c.bannerfile[row]);
+    chart->gamemode       = c.gamemode[row];
+    chart->rank           = c.judgerank[row];
+    chart->total          = c.total[row];
+    chart->playLevel      = c.playlevel[row];
+    chart->difficulty     = c.difficulty[row];
+    chart->haveLN         = c.flags[row] & SongCatalog::FLAG_LN;
+    chart->haveMine       = c.flags[row] & SongCatalog::FLAG_MINE;
+    chart->haveMetricMod  = c.flags[row] & SongCatalog::FLAG_METRICMOD;
+    chart->haveStop       = c.flags[row] & SongCatalog::FLAG_STOP;
+    chart->haveBPMChange  = c.maxbpm[row] != c.minbpm[row];
+    chart->haveBGA        = c.flags[row] & SongCatalog::FLAG_BGA;
+    chart->haveRandom     = c.flags[row] & SongCatalog::FLAG_RANDOM;
+    chart->addTime        = c.addtime[row];
+
+    if (chart->totalNotes > 0)
+    {
+        chart->haveNote = true;
+        chart->notes_total = chart->totalNotes;
+    }
+
+    if (chart->fileName.is_absolute())
+        chart->absolutePath = chart->fileName;
+    else
+        chart->absolutePath = folderPath / chart->fileName;
+
+    if (row < chartViews.size())
+        chartViews[row] = chart;
+    return chart;
 }
 
 int SongDB::initializeFolders(const std::vector<Path>& paths)
@@ -716,6 +1049,32 @@ int SongDB::addSubFolder(Path path, const HashMD5& parentHash)
     return count;
 }
 
+int SongDB::refreshFolder(Path path)
+{
+    path = (path / ".").lexically_normal();
+
+    // refresh the nearest folder registered in db; a new or removed folder is picked up by its parent
+    while (!path.empty())
+    {
+        if (fs::is_directory(path))
+        {
+            for (const auto& p : { path, fs::absolute(path) })
+            {
+                if (auto q = query("SELECT pathmd5,type FROM folder WHERE path=?", 2, { p.u8string() }); !q.empty())
+                {
+                    LOG_DEBUG << "[SongDB] Refresh changed folder " << p.u8string();
+                    return refreshExistingFolder(HashMD5(ANY_STR(q[0][0])), p, (FolderType)ANY_INT(q[0][1]));
+                }
+            }
+        }
+
+        Path parent = (path.has_filename() ? path : path.parent_path()).parent_path();
+        if (parent == path || parent.empty()) break;
+        path = (parent / ".").lexically_normal();
+    }
+    return 0;
+}
+
 int SongDB::removeFolder(const HashMD5& hash, bool removeSong)
 {
     if (removeSong)
@@ -733,8 +1092,10 @@ void SongDB::waitLoadingFinish()
     {
         LOG_DEBUG << "[SongDB] Waiting for all loading threads...";
 
-        // wait for all tasks
+        // wait for all tasks; queued ones are dropped if loading was cancelled
         boost::asio::thread_pool& pool = *(boost::asio::thread_pool*)threadPool;
+        if (stopRequested)
+            pool.stop();
         pool.join();
 
         LOG_DEBUG << "[SongDB] All loading threads finished, continue";
@@ -903,7 +1264,7 @@ int SongDB::refreshExistingFolder(const HashMD5& hash, const Path& path, FolderT
                     }
                     else
                     {
-                        long long fstime = getFileLastWriteTime(path);
+                        long long fstime = getFileLastWriteTime(chart->absolutePath);
                         if (auto q = query("SELECT addtime FROM song WHERE md5=? AND parent=?", 1, { chart->fileHash.hexdigest(), hash.hexdigest() }); !q.empty())
                         {
                             long long dbTime = ANY_INT(q[0][0]);
@@ -1086,12 +1447,11 @@ HashMD5 SongDB::getFolderParent(const HashMD5& folder) const
 
 std::pair<bool, Path> SongDB::getFolderPath(const HashMD5& folder) const
 {
-    if (!folderQueryHashMap.empty())
+    if (catalog.folderCount() > 0)
     {
-        if (folderQueryHashMap.find(folder) != folderQueryHashMap.end())
+        if (auto rows = catalog.folderByMd5.find(folder); !rows.empty())
         {
-            auto cols = folderQueryPool[folderQueryHashMap.at(folder)[0]];
-            return { true, PathFromUTF8(ANY_STR(cols[4])) };
+            return { true, PathFromUTF8(catalog.str(catalog.folder.path[*rows.begin()])) };
         }
     }
     else
@@ -1150,50 +1510,46 @@ std::shared_ptr<EntryFolderRegular> SongDB::browse(HashMD5 root, bool recursive)
 
     std::shared_ptr<EntryFolderRegular> list = std::make_shared<EntryFolderRegular>(root, path);
 
-    if (folderQueryParentMap.find(root) != folderQueryParentMap.end())
+    for (auto row : catalog.folderByParent.find(root))
     {
-        for (const auto& index : folderQueryParentMap.at(root))
+        const auto& c = catalog.folder;
+        const auto& md5 = c.md5[row];
+        auto name = catalog.str(c.name[row]);
+        auto type = (FolderType)c.type[row];
+        auto path = catalog.str(c.path[row]);
+        auto modtime = c.modtime[row];
+
+        switch (type)
         {
-            const auto& c = folderQueryPool[index];
-            auto md5 = ANY_STR(c[0]);
-            auto parent = ANY_STR(c[1]);
-            auto name = ANY_STR(c[2]);
-            auto type = (FolderType)ANY_INT(c[3]);
-            auto path = ANY_STR(c[4]);
-            auto modtime = ANY_INT(c[5]);
-
-            switch (type)
-            {
-            case FOLDER:
+        case FOLDER:
+        {
+            if (recursive)
             {
-                if (recursive)
-                {
-                    auto sub = browse(md5, false);
-                    if (sub && !sub->empty())
-                    {
-                        sub->_name = name;
-                        sub->_addTime = modtime;
-                        list->pushEntry(sub);
-                    }
-                }
-                else
+                auto sub = browse(md5, false);
+                if (sub && !sub->empty())
                 {
-                    auto sub = std::make_shared<EntryFolderRegular>(md5, PathFromUTF8(path), name, "");
+                    sub->_name = name;
                     sub->_addTime = modtime;
                     list->pushEntry(sub);
                 }
-                break;
             }
-            case SONG_BMS:
-                auto bmsList = browseSong(md5);
-                // name is set inside browseSong
-                if (bmsList && !bmsList->empty())
-                {
-                    bmsList->_addTime = modtime;
-                    list->pushEntry(bmsList);
-                }
-                break;
+            else
+            {
+                auto sub = std::make_shared<EntryFolderRegular>(md5, PathFromUTF8(path), name, "");
+                sub->_addTime = modtime;
+                list->pushEntry(sub);
             }
+            break;
+        }
+        case SONG_BMS:
+            auto bmsList = browseSong(md5);
+            // name is set inside browseSong
+            if (bmsList && !bmsList->empty())
+            {
+                bmsList->_addTime = modtime;
+                list->pushEntry(bmsList);
+            }
+            break;
         }
     }
 
@@ -1213,36 +1569,16 @@ std::shared_ptr<EntryFolderSong> SongDB::browseSong(HashMD5 root)
     std::shared_ptr<EntryFolderSong> list = std::make_shared<EntryFolderSong>(root, path);
     bool isNameSet = false;
 
-    if (songQueryParentMap.find(root) != songQueryParentMap.end())
+    for (auto row : catalog.songByParent.find(root))
     {
-        for (const auto& index : songQueryParentMap.at(root))
+        if (auto p = getCatalogChart(row, path); p != nullptr)
         {
-            const auto& c = songQueryPool[index];
-            auto type = (eChartFormat)ANY_INT(c[3]);
-            switch (type)
-            {
-            case eChartFormat::BMS:
+            list->pushChart(p);
+            if (!isNameSet)
             {
-                auto p = std::make_shared<ChartFormatBMSMeta>();
-                if (convert_bms(p, c))
-                {
-                    if (p->fileName.is_absolute())
-                        p->absolutePath = p->fileName;
-                    else
-                        p->absolutePath = path / p->fileName;
-
-                    list->pushChart(p);
-                }
-                if (!isNameSet)
-                {
-                    isNameSet = true;
-                    list->_name = p->title;
-                    list->_name2 = p->title2;
-                }
-                break;
-            }
-            default:
-                break;
+                isNameSet = true;
+                list->_name = p->title;
+                list->_name2 = p->title2;
             }
         }
     }
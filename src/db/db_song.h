@@ -1,8 +1,11 @@
 #pragma once
+#include <atomic>
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include "db_conn.h"
+#include "db_song_catalog.h"
 #include "common/types.h"
 #include "common/utils.h"
 #include "common/entry/entry_folder.h"
@@ -46,32 +49,61 @@ public:
     SongDB(SongDB&) = delete;
     SongDB& operator= (SongDB&) = delete;
 
+protected:
+    Path dbPath;
+
 protected:
     bool addChart(const HashMD5& folder, const Path& path);
     bool removeChart(const Path& path, const HashMD5& parent);
     bool removeChart(const HashMD5& md5, const HashMD5& parent);
     
 public:
+    // ranked by relevance when the full-text index is available
     std::vector<std::shared_ptr<ChartFormatBase>> findChartByName(const HashMD5& folder, const std::string&, unsigned limit = 1000) const;  // search from genre, version, artist, artist2, title, title2
     std::vector<std::shared_ptr<ChartFormatBase>> findChartByHash(const HashMD5&, bool checksum = true) const;  // chart may duplicate, return a list
+    std::vector<std::shared_ptr<ChartFormatBase>> findFirstChartByHash(const std::vector<HashMD5>&) const;       // one per hash, nullptr if not found. Trusts the last scan, no file checks
     std::vector<std::shared_ptr<ChartFormatBase>> findChartFromTime(const HashMD5& folder, unsigned long long addTime) const;
 
 protected:
-    std::vector<std::vector<std::any>> songQueryPool;
-    std::unordered_map<HashMD5, std::vector<size_t>> songQueryHashMap;
-    std::unordered_map<HashMD5, std::vector<size_t>> songQueryParentMap;
-    std::vector<std::vector<std::any>> folderQueryPool;
-    std::unordered_map<HashMD5, std::vector<size_t>> folderQueryHashMap;
-    std::unordered_map<HashMD5, std::vector<size_t>> folderQueryParentMap;
+    enum SearchIndexType
+    {
+        SEARCH_LIKE,        // no FTS5, scan with LIKE
+        SEARCH_TRIGRAM,     // FTS5 trigram, substring match
+        SEARCH_TOKEN,       // FTS5 unicode61, word prefix match
+    };
+    SearchIndexType searchIndexType = SEARCH_LIKE;
+    void initSearchIndex();
+
+protected:
+    SongCatalog catalog;
+
+    // Chart objects handed out from catalog rows. Reused while anyone still holds them,
+    //  so reopening a folder does not allocate again
+    mutable std::mutex chartViewMutex;
+    mutable std::vector<std::weak_ptr<ChartFormatBase>> chartViews;
+    std::shared_ptr<ChartFormatBase> getCatalogChart(SongCatalog::Row row, const Path& folderPath) const;
+
 public:
     void prepareCache();
     void freeCache();
 
+    // prepareCache in two steps: build a new catalog from db on any thread, then swap it in
+    //  while nobody is reading the old one
+    SongCatalog buildCache() const;
+    void applyCache(SongCatalog&& next);
+
+    // Warm start: the catalog is saved at exit and loaded at the next launch instead of scanning the folders,
+    //  as long as song.db has not been written since the catalog was read and the library folders are the same
+    std::string getDatabaseStamp() const;     // size and write time of song.db, empty if unavailable
+    bool saveCacheSnapshot(const Path& path, const std::vector<Path>& roots) const;
+    bool loadCacheSnapshot(const Path& path, const std::vector<Path>& roots);
+
 public:
     int initializeFolders(const std::vector<Path>& paths);
     int addSubFolder(Path path, const HashMD5& parent = ROOT_FOLDER_HASH);
     void waitLoadingFinish();
     int removeFolder(const HashMD5& hash, bool removeSong = false);
+    int refreshFolder(Path path);   // rescan a changed folder, regardless of modification time
 
 protected:
     int addNewFolder(const HashMD5& hash, const Path& path, const HashMD5& parent);
@@ -102,6 +134,6 @@ public:
     std::string addCurrentPath;
     void resetAddSummary();
 
-    bool stopRequested = false;
-    void stopLoading();
+    std::atomic<bool> stopRequested = false;     // loading loops check this; may be set from any thread
+    void stopLoading();     // also releases the loading pool, call on the thread that loads
 };
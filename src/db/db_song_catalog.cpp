@@ -0,0 +1,239 @@
+#include "db_song_catalog.h"
+#include <fstream>
+#include "common/utils.h"
+
+static size_t tableSizeFor(size_t count)
+{
+    size_t size = 16;
+    while (size < count * 2) size <<= 1;
+    return size;
+}
+
+size_t SongCatalog::HashIndex::findSlot(const HashMD5& key) const
+{
+    // md5 is uniformly distributed, the folded hash is good enough for linear probing
+    const size_t mask = slots.size() - 1;
+    size_t i = std::hash<HashMD5>()(key) & mask;
+    while (slots[i] != 0 && groups[slots[i] - 1].key != key)
+        i = (i + 1) & mask;
+    return i;
+}
+
+void SongCatalog::HashIndex::build(const std::vector<HashMD5>& keys)
+{
+    clear();
+
+    // count rows per key
+    std::vector<uint32_t> rowGroup(keys.size(), 0);
+    slots.assign(tableSizeFor(keys.size()), 0);
+    for (size_t r = 0; r < keys.size(); ++r)
+    {
+        if (keys[r].empty()) continue;
+        size_t s = findSlot(keys[r]);
+        if (slots[s] == 0)
+        {
+            groups.push_back({ keys[r], 0, 0 });
+            slots[s] = (uint32_t)groups.size();
+        }
+        groups[slots[s] - 1].count++;
+        rowGroup[r] = slots[s];
+    }
+
+    // shrink the table to the number of distinct keys
+    slots.assign(tableSizeFor(groups.size()), 0);
+    uint32_t offset = 0;
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        slots[findSlot(groups[g].key)] = (uint32_t)g + 1;
+        groups[g].begin = offset;
+        offset += groups[g].count;
+        groups[g].count = 0;
+    }
+
+    // fill rows in insertion order
+    rows.resize(offset);
+    for (size_t r = 0; r < keys.size(); ++r)
+    {
+        if (rowGroup[r] == 0) continue;
+        Group& g = groups[rowGroup[r] - 1];
+        rows[g.begin + g.count++] = (Row)r;
+    }
+}
+
+void SongCatalog::HashIndex::clear()
+{
+    slots.clear();
+    slots.shrink_to_fit();
+    groups.clear();
+    groups.shrink_to_fit();
+    rows.clear();
+    rows.shrink_to_fit();
+}
+
+SongCatalog::HashIndex::Range SongCatalog::HashIndex::find(const HashMD5& key) const
+{
+    if (slots.empty() || key.empty()) return {};
+    size_t s = findSlot(key);
+    if (slots[s] == 0) return {};
+    const Group& g = groups[slots[s] - 1];
+    return { rows.data() + g.begin, rows.data() + g.begin + g.count };
+}
+
+size_t SongCatalog::HashIndex::memoryUsage() const
+{
+    return slots.capacity() * sizeof(uint32_t) + groups.capacity() * sizeof(Group) + rows.capacity() * sizeof(Row);
+}
+
+SongCatalog::StrRef SongCatalog::intern(const std::string& s)
+{
+    if (s.empty()) return 0;
+    if (auto it = internMap.find(s); it != internMap.end())
+        return it->second;
+
+    StrRef ref = (StrRef)arena.size();
+    arena.append(s.c_str(), s.size() + 1);
+    internMap.emplace(s, ref);
+    return ref;
+}
+
+template <typename Catalog, typename F>
+static void forEachColumn(Catalog& c, F&& f)
+{
+    auto& song = c.song;
+    auto& folder = c.folder;
+    f(song.md5); f(song.parent); f(song.file); f(song.type); f(song.title); f(song.title2);
+    f(song.artist); f(song.artist2); f(song.genre); f(song.version); f(song.level); f(song.bpm);
+    f(song.minbpm); f(song.maxbpm); f(song.length); f(song.totalnotes); f(song.stagefile); f(song.bannerfile);
+    f(song.gamemode); f(song.judgerank); f(song.total); f(song.playlevel); f(song.difficulty); f(song.flags);
+    f(song.addtime);
+    f(folder.md5); f(folder.parent); f(folder.name); f(folder.type); f(folder.path); f(folder.modtime);
+}
+
+void SongCatalog::finalize()
+{
+    internMap.clear();
+    internMap.rehash(0);
+    arena.shrink_to_fit();
+
+    forEachColumn(*this, [](auto& v) { v.shrink_to_fit(); });
+
+    songByMd5.build(song.md5);
+    songByParent.build(song.parent);
+    folderByMd5.build(folder.md5);
+    folderByParent.build(folder.parent);
+}
+
+void SongCatalog::clear()
+{
+    source.clear();
+    song = SongColumns();
+    folder = FolderColumns();
+    songByMd5.clear();
+    songByParent.clear();
+    folderByMd5.clear();
+    folderByParent.clear();
+    internMap.clear();
+    arena.assign(1, '\0');
+    arena.shrink_to_fit();
+}
+
+size_t SongCatalog::memoryUsage() const
+{
+    size_t bytes = arena.capacity();
+    forEachColumn(*this, [&bytes](const auto& v) { bytes += v.capacity() * sizeof(v[0]); });
+    bytes += songByMd5.memoryUsage() + songByParent.memoryUsage() + folderByMd5.memoryUsage() + folderByParent.memoryUsage();
+    return bytes;
+}
+
+static constexpr char SNAPSHOT_MAGIC[4] = { 'L', 'V', 'S', 'C' };
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+bool SongCatalog::save(const Path& path, const std::string& key) const
+{
+    // write aside and rename, a broken snapshot is never picked up
+    Path tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios_base::binary | std::ios_base::trunc);
+        if (ofs.fail()) return false;
+
+        auto writeBlock = [&ofs](const void* data, uint64_t bytes)
+        {
+            ofs.write((const char*)&bytes, sizeof(bytes));
+            ofs.write((const char*)data, bytes);
+        };
+        ofs.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        ofs.write((const char*)&SNAPSHOT_VERSION, sizeof(SNAPSHOT_VERSION));
+        writeBlock(key.data(), key.size());
+        writeBlock(arena.data(), arena.size());
+        // plain values only; HashMD5 is a byte array and a flag
+        forEachColumn(*this, [&](const auto& v) { writeBlock(v.data(), v.size() * sizeof(v[0])); });
+        if (ofs.fail()) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool SongCatalog::load(const Path& path, const std::string& key)
+{
+    std::ifstream ifs(path, std::ios_base::binary);
+    if (ifs.fail()) return false;
+
+    auto readBlock = [&ifs](auto& out, size_t elemSize) -> bool
+    {
+        uint64_t bytes = 0;
+        ifs.read((char*)&bytes, sizeof(bytes));
+        if (ifs.fail() || bytes % elemSize != 0) return false;
+        out.resize(size_t(bytes / elemSize));
+        ifs.read((char*)out.data(), bytes);
+        return !ifs.fail();
+    };
+
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    uint32_t version = 0;
+    ifs.read(magic, sizeof(magic));
+    ifs.read((char*)&version, sizeof(version));
+    if (ifs.fail() || memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || version != SNAPSHOT_VERSION)
+        return false;
+
+    std::string fileKey;
+    if (!readBlock(fileKey, 1) || fileKey != key)
+        return false;
+
+    SongCatalog c;
+    bool ok = readBlock(c.arena, 1) && !c.arena.empty() && c.arena.back() == '\0';
+    forEachColumn(c, [&](auto& v) { ok = ok && readBlock(v, sizeof(v[0])); });
+    if (!ok) return false;
+
+    // every column of a table has one value per row, string refs stay inside the arena
+    bool consistent = true;
+    const size_t songs = c.song.md5.size();
+    const size_t folders = c.folder.md5.size();
+    auto rows = [&](const auto& v, size_t n) { consistent = consistent && v.size() == n; };
+    auto refs = [&](const std::vector<StrRef>& v, size_t n)
+    {
+        rows(v, n);
+        for (StrRef r : v) consistent = consistent && r < c.arena.size();
+    };
+    rows(c.song.parent, songs); refs(c.song.file, songs); rows(c.song.type, songs); refs(c.song.title, songs);
+    refs(c.song.title2, songs); refs(c.song.artist, songs); refs(c.song.artist2, songs); refs(c.song.genre, songs);
+    refs(c.song.version, songs); rows(c.song.level, songs); rows(c.song.bpm, songs); rows(c.song.minbpm, songs);
+    rows(c.song.maxbpm, songs); rows(c.song.length, songs); rows(c.song.totalnotes, songs); refs(c.song.stagefile, songs);
+    refs(c.song.bannerfile, songs); rows(c.song.gamemode, songs); rows(c.song.judgerank, songs); rows(c.song.total, songs);
+    rows(c.song.playlevel, songs); rows(c.song.difficulty, songs); rows(c.song.flags, songs); rows(c.song.addtime, songs);
+    rows(c.folder.parent, folders); refs(c.folder.name, folders); rows(c.folder.type, folders); refs(c.folder.path, folders);
+    rows(c.folder.modtime, folders);
+    if (!consistent) return false;
+
+    c.finalize();
+    c.source = source;
+    *this = std::move(c);
+    return true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "common/hash.h"
+#include "common/types.h"
+
+// Read-only in-memory copy of the song and folder tables, built by SongDB::prepareCache.
+//  Columns are stored as struct-of-arrays, every string lives once in a shared arena, and rows are
+//  looked up through open-addressing hash indexes. A row costs about 140 bytes plus its unique strings.
+class SongCatalog
+{
+public:
+    typedef uint32_t Row;
+    typedef uint32_t StrRef;    // offset into the string arena, 0 is the empty string
+
+    // Open-addressing multimap from hash to rows. Rows of the same key keep insertion order
+    class HashIndex
+    {
+    public:
+        struct Range
+        {
+            const Row* first = nullptr;
+            const Row* last = nullptr;
+            const Row* begin() const { return first; }
+            const Row* end() const { return last; }
+            bool empty() const { return first == last; }
+            size_t size() const { return last - first; }
+        };
+
+    private:
+        struct Group
+        {
+            HashMD5 key;
+            uint32_t begin = 0;
+            uint32_t count = 0;
+        };
+        std::vector<uint32_t> slots;    // group index + 1, 0 is empty
+        std::vector<Group> groups;
+        std::vector<Row> rows;          // grouped by key
+
+        size_t findSlot(const HashMD5& key) const;
+
+    public:
+        void build(const std::vector<HashMD5>& keys);   // empty keys are not indexed
+        void clear();
+        Range find(const HashMD5& key) const;
+        size_t memoryUsage() const;
+    };
+
+    enum SongFlag : uint8_t
+    {
+        FLAG_LN = 1 << 0,
+        FLAG_MINE = 1 << 1,
+        FLAG_METRICMOD = 1 << 2,
+        FLAG_STOP = 1 << 3,
+        FLAG_BGA = 1 << 4,
+        FLAG_RANDOM = 1 << 5,
+    };
+
+    struct SongColumns
+    {
+        std::vector<HashMD5> md5;
+        std::vector<HashMD5> parent;
+        std::vector<StrRef> file;
+        std::vector<uint8_t> type;
+        std::vector<StrRef> title;
+        std::vector<StrRef> title2;
+        std::vector<StrRef> artist;
+        std::vector<StrRef> artist2;
+        std::vector<StrRef> genre;
+        std::vector<StrRef> version;
+        std::vector<float> level;
+        std::vector<float> bpm;
+        std::vector<float> minbpm;
+        std::vector<float> maxbpm;
+        std::vector<uint32_t> length;
+        std::vector<uint32_t> totalnotes;
+        std::vector<StrRef> stagefile;
+        std::vector<StrRef> bannerfile;
+        std::vector<int32_t> gamemode;
+        std::vector<int32_t> judgerank;
+        std::vector<int32_t> total;
+        std::vector<int32_t> playlevel;
+        std::vector<int32_t> difficulty;
+        std::vector<uint8_t> flags;     // SongFlag
+        std::vector<int64_t> addtime;
+    };
+
+    struct FolderColumns
+    {
+        std::vector<HashMD5> md5;
+        std::vector<HashMD5> parent;    // empty for root
+        std::vector<StrRef> name;
+        std::vector<uint8_t> type;
+        std::vector<StrRef> path;
+        std::vector<int64_t> modtime;
+    };
+
+private:
+    std::string arena{ '\0' };
+    std::unordered_map<std::string, StrRef> internMap;     // only alive while building
+
+public:
+    std::string source;     // state of the database the rows were read from, see SongDB::getDatabaseStamp
+    SongColumns song;
+    FolderColumns folder;
+    HashIndex songByMd5;
+    HashIndex songByParent;
+    HashIndex folderByMd5;
+    HashIndex folderByParent;
+
+public:
+    StrRef intern(const std::string& s);
+    std::string_view str(StrRef ref) const { return std::string_view(arena.data() + ref); }
+
+    size_t songCount() const { return song.md5.size(); }
+    size_t folderCount() const { return folder.md5.size(); }
+    bool empty() const { return song.md5.empty() && folder.md5.empty(); }
+
+    // call after all rows are pushed
+    void finalize();
+    void clear();
+    size_t memoryUsage() const;
+
+    // Binary snapshot of the columns and the string arena; indexes are rebuilt on load.
+    //  key describes what the rows were read from. load fails if the file was saved with another key
+    bool save(const Path& path, const std::string& key) const;
+    bool load(const Path& path, const std::string& key);
+};
@@ -0,0 +1,160 @@
+#include "db_song_watcher.h"
+#include "common/sysutil.h"
+
+SongFolderWatcher::SongFolderWatcher(std::shared_ptr<SongDB> db, const std::vector<Path>& roots, std::function<bool()> canImport):
+    db(db), roots(roots), canImport(canImport)
+{
+    // without folder events the thread still serves rescan requests
+    if (!watcher.isValid())
+        LOG_WARNING << "[SongWatcher] Folder watching is not available";
+    else
+    {
+        for (const auto& r : roots)
+        {
+            if (!watcher.addTree(r))
+                LOG_WARNING << "[SongWatcher] Watch folder failed: " << r.u8string();
+        }
+    }
+    thread = std::thread(&SongFolderWatcher::loop, this);
+}
+
+SongFolderWatcher::~SongFolderWatcher()
+{
+    stop();
+}
+
+void SongFolderWatcher::stop()
+{
+    running = false;
+    if (thread.joinable())
+    {
+        // cut a running import short. It winds down the loading pool on the watcher thread,
+        //  so nothing else may touch the pool until the thread is joined
+        db->stopRequested = true;
+        thread.join();
+    }
+}
+
+void SongFolderWatcher::loop()
+{
+    using namespace std::chrono;
+    std::map<Path, steady_clock::time_point> dirty;    // directory -> last event
+
+    while (running)
+    {
+        auto now = steady_clock::now();
+        if (watcher.isValid())
+        {
+            for (auto& dir : watcher.wait(200))
+                dirty[(dir / ".").lexically_normal()] = now;
+        }
+        else
+            std::this_thread::sleep_for(milliseconds(200));
+
+        if (!canImport()) continue;
+
+        if (rescanRequested.exchange(false))
+        {
+            // covers every pending directory as well
+            dirty.clear();
+            importing = true;
+            importRescan();
+            importing = false;
+            continue;
+        }
+
+        now = steady_clock::now();
+        std::vector<Path> ready;
+        for (auto it = dirty.begin(); it != dirty.end(); )
+        {
+            if (now - it->second >= milliseconds(DEBOUNCE_MS))
+            {
+                ready.push_back(it->first);
+                it = dirty.erase(it);
+            }
+            else
+                ++it;
+        }
+        if (ready.empty()) continue;
+
+        importing = true;
+        std::unique_lock l(importMutex);
+
+        // the previous catalog is not applied yet; it is rebuilt below anyway
+        pendingCatalog.reset();
+        updateReady = false;
+
+        db->resetAddSummary();
+        int count = 0;
+        for (const auto& dir : ready)
+        {
+            if (!running) break;
+            LOG_INFO << "[SongWatcher] Folder changed: " << dir.u8string();
+            count += std::max(0, db->refreshFolder(dir));
+        }
+        db->waitLoadingFinish();
+
+        int added = db->addChartSuccess - db->addChartModified;
+        int updated = db->addChartModified;
+        int deleted = db->addChartDeleted;
+        LOG_INFO << "[SongWatcher] Imported " << ready.size() << " folders: " << added << " added, " << updated << " updated, " << deleted << " deleted";
+
+        pendingCatalog = std::make_unique<SongCatalog>(db->buildCache());
+        pendingSummary.folders.insert(pendingSummary.folders.end(), ready.begin(), ready.end());
+        pendingSummary.added += added;
+        pendingSummary.updated += updated;
+        pendingSummary.deleted += deleted;
+        updateReady = true;
+        importing = false;
+    }
+}
+
+void SongFolderWatcher::importRescan()
+{
+    std::unique_lock l(importMutex);
+
+    LOG_INFO << "[SongWatcher] Checking all folders...";
+    std::string stamp = db->getDatabaseStamp();
+    db->initializeFolders(roots);
+
+    int added = db->addChartSuccess - db->addChartModified;
+    int updated = db->addChartModified;
+    int deleted = db->addChartDeleted;
+    LOG_INFO << "[SongWatcher] Checked all folders: " << added << " added, " << updated << " updated, " << deleted << " deleted";
+
+    // nothing written, the catalog in use is still exact
+    if (!running || (!stamp.empty() && stamp == db->getDatabaseStamp()))
+        return;
+
+    pendingCatalog = std::make_unique<SongCatalog>(db->buildCache());
+    if (added || updated || deleted)
+        pendingSummary.folders.insert(pendingSummary.folders.end(), roots.begin(), roots.end());
+    pendingSummary.added += added;
+    pendingSummary.updated += updated;
+    pendingSummary.deleted += deleted;
+    pendingSummary.rescanned = true;
+    updateReady = true;
+}
+
+bool SongFolderWatcher::applyUpdate(Summary& summary)
+{
+    std::unique_lock l(importMutex, std::try_to_lock);
+    if (!l.owns_lock() || pendingCatalog == nullptr)
+        return false;
+
+    db->applyCache(std::move(*pendingCatalog));
+    pendingCatalog.reset();
+    updateReady = false;
+    summary = std::move(pendingSummary);
+    pendingSummary = Summary();
+    return true;
+}
+
+std::unique_lock<std::mutex> SongFolderWatcher::pause()
+{
+    std::unique_lock l(importMutex);
+    pendingCatalog.reset();
+    pendingSummary = Summary();
+    updateReady = false;
+    return l;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "db_song.h"
+
+// Keeps the song library up to date while the game is running.
+//  Changes under the library folders are collected per directory and imported once the directory has been
+//  quiet for DEBOUNCE_MS, so copying a song folder triggers one import. Imports and catalog rebuilds run on
+//  the watcher thread; the select scene picks the result up with applyUpdate().
+class SongFolderWatcher
+{
+public:
+    static constexpr long long DEBOUNCE_MS = 1500;
+
+    struct Summary
+    {
+        std::vector<Path> folders;
+        int added = 0;
+        int updated = 0;
+        int deleted = 0;
+        bool rescanned = false;         // all library folders were checked, see rescan()
+    };
+
+private:
+    std::shared_ptr<SongDB> db;
+    std::vector<Path> roots;
+    std::function<bool()> canImport;    // imports are held back while this returns false
+    FolderWatcher watcher;
+    std::thread thread;
+    std::atomic<bool> running = true;
+    std::atomic<bool> rescanRequested = false;
+
+    std::mutex importMutex;             // held while importing; applying needs it too
+    std::atomic<bool> importing = false;
+    std::atomic<bool> updateReady = false;  // pendingCatalog is set
+    std::unique_ptr<SongCatalog> pendingCatalog;
+    Summary pendingSummary;
+
+    void loop();
+    void importRescan();
+
+public:
+    SongFolderWatcher(std::shared_ptr<SongDB> db, const std::vector<Path>& roots, std::function<bool()> canImport);
+    ~SongFolderWatcher();
+    SongFolderWatcher(const SongFolderWatcher&) = delete;
+    SongFolderWatcher& operator=(const SongFolderWatcher&) = delete;
+
+    // Swaps in the catalog of a finished import. Call where the song catalog is not being read.
+    //  Returns false without blocking if nothing is ready or an import is running
+    bool applyUpdate(Summary& summary);
+    bool hasUpdate() const { return updateReady; }     // applyUpdate would have something to apply
+    bool isImporting() const { return importing; }
+
+    // Checks every library folder like a cold start does, in background. Used after a warm start
+    void rescan() { rescanRequested = true; }
+
+    // Stops watching and cancels a running import, then joins the watcher thread.
+    //  Loading in the song db stays cancelled. A finished import can still be applied afterwards
+    void stop();
+
+    // Hold the returned lock while refreshing folders manually. Waits for a running import, see isImporting().
+    //  A catalog not applied yet is dropped; the refresh rebuilds it from the db, which has the import as well
+    std::unique_lock<std::mutex> pause();
+};
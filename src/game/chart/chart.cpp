@@ -205,6 +205,9 @@ void ChartObjectBase::resetNoteListsIterators()
         _noteListIterators[i]  = _noteLists[i].begin();
     for (size_t i = 0; i < _bgmNoteLists.size(); ++i)      
         _bgmNoteListIters[i] = _bgmNoteLists[i].begin();
+    _bgmNoteListScheduleIters.resize(_bgmNoteLists.size());
+    for (size_t i = 0; i < _bgmNoteLists.size(); ++i)
+        _bgmNoteListScheduleIters[i] = _bgmNoteLists[i].begin();
     for (size_t i = 0; i < _specialNoteLists.size(); ++i)   
         _specialNoteListIters[i] = _specialNoteLists[i].begin();
     _bpmNoteListIter = _bpmNoteList.begin();
@@ -336,6 +339,7 @@ void ChartObjectBase::update(const Time& rt)
 
     noteExpired.clear();
     noteBgmExpired.clear();
+    noteBgmUpcoming.clear();
     noteSpecialExpired.clear();
 
     preUpdate(vt);
@@ -402,6 +406,20 @@ void ChartObjectBase::update(const Time& rt)
             it = nextNoteBgm(idx);
         }
     } 
+    // BGM notes coming within lookahead
+    if (_bgmLookahead > 0)
+    {
+        Time until = at + _bgmLookahead;
+        for (size_t idx = 0; idx < _bgmNoteLists.size(); ++idx)
+        {
+            auto& it = _bgmNoteListScheduleIters[idx];
+            while (it != _bgmNoteLists[idx].end() && until >= it->time)
+            {
+                noteBgmUpcoming.push_back(*it);
+                ++it;
+            }
+        }
+    }
     // Skip expired extended note
     for (size_t idx = 0; idx < _specialNoteLists.size(); ++idx)
     {
@@ -168,6 +168,8 @@ public:
 protected:
     std::array<NoteIterator, chart::LANE_COUNT>                     _noteListIterators;
     std::vector<decltype(_bgmNoteLists)::value_type::iterator>      _bgmNoteListIters;
+    std::vector<decltype(_bgmNoteLists)::value_type::iterator>      _bgmNoteListScheduleIters;  // lookahead cursor
+    Time                                                            _bgmLookahead = 0;
     std::vector<decltype(_specialNoteLists)::value_type::iterator>  _specialNoteListIters;
     decltype(_bpmNoteList)::iterator                                _bpmNoteListIter;
 
@@ -220,6 +222,8 @@ public:
     void reset();
     void resetNoteListsIterators();            // set after parsing
     /*virtual*/ void update(const Time& rt);    // call with RELATIVE time
+    // Fill noteBgmUpcoming with BGM notes up to t ahead of the current time; 0 disables
+    void setBgmLookahead(const Time& t) { _bgmLookahead = t; }
     virtual void preUpdate(const Time& rt) = 0;
     virtual void postUpdate(const Time& rt) = 0;
     constexpr auto getCurrentBar() -> decltype(_currentBar) { return _currentBar; }
@@ -229,6 +233,7 @@ public:
 public:
     std::list<HitableNote>  noteExpired;
     std::list<Note>   noteBgmExpired;
+    std::list<Note>   noteBgmUpcoming;     // BGM notes entering the lookahead window; each note is listed once
     std::list<Note>   noteSpecialExpired;
 
 public:
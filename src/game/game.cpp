@@ -8,7 +8,9 @@
 #include "game/skin/skin_mgr.h"
 #include "common/utils.h"
 #include "common/sysutil.h"
+#include "common/tick_scheduler.h"
 #include "game/scene/scene_context.h"
+#include "game/scene/scene_pre_select.h"
 #include "game/runtime/generic_info.h"
 
 #include "common/chartformat/chartformat_bms.h"
@@ -131,6 +133,12 @@ int main(int argc, char* argv[])
     if (auto ginit = graphics_init())
         return ginit;
 
+    // loopers started from now on run on the worker pool, except input and sound
+    if (int tickWorkers = ConfigMgr::get('E', cfg::E_TICK_WORKERS, 3); tickWorkers > 0)
+    {
+        TickScheduler::start(tickWorkers, ConfigMgr::get('E', cfg::E_LOOPER_REALTIME_PRIORITY, 0));
+    }
+
     // init sound
     if (auto sinit = SoundMgr::initFMOD())
         return sinit;
@@ -307,9 +315,13 @@ int main(int argc, char* argv[])
 
     SoundMgr::stopUpdate();
 
+    TickScheduler::stop();
+
     SceneMgr::clean();	// clean resources before releasing framework
     graphics_free();
 
+    ScenePreSelect::shutdownLibrary();
+
     ImGui::DestroyContext();
 
     ConfigMgr::save();
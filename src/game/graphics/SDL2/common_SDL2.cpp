@@ -4,6 +4,8 @@
 #include "SDL2_gfxPrimitives.h"
 #include "common/log.h"
 #include "common/sysutil.h"
+#include "common/utils.h"
+#include "game/graphics/dxa.h"
 
 #include <memory>
 #include <map>
@@ -129,10 +131,35 @@ bool isGIF(const char* filePath)
     return strcmp("GIF", ext) == 0;
 }
 
+// Opens a file from disk, or from a mounted DXA archive if the file was not extracted
+static std::shared_ptr<SDL_RWops> openImageRW(const char* filePath)
+{
+    SDL_RWops* rw = SDL_RWFromFile(filePath, "rb");
+    if (rw != nullptr)
+        return std::shared_ptr<SDL_RWops>(rw, [](SDL_RWops* s) { s->close(s); });
+
+    DXArchiveSegment entry;
+    if (filePath[0] != '\0' && findDxaEntry(PathFromUTF8(filePath), entry) && entry.data)
+    {
+        rw = SDL_RWFromConstMem(&*entry.data, (int)entry.size);
+        if (rw != nullptr)
+        {
+            // the segment must outlive the RWops
+            return std::shared_ptr<SDL_RWops>(rw, [entry](SDL_RWops* s) { s->close(s); });
+        }
+    }
+    return nullptr;
+}
+
 Image::Image(const std::filesystem::path& path) : Image(path.u8string().c_str()) {}
 
+Image::Image(const std::filesystem::path& path, bool onMainThread) :
+    Image(path.u8string().c_str(), openImageRW(path.u8string().c_str()), onMainThread)
+{
+}
+
 Image::Image(const char* filePath) : 
-    Image(filePath, std::shared_ptr<SDL_RWops>(SDL_RWFromFile(filePath, "rb"), [](SDL_RWops* s) { if (s) s->close(s); }))
+    Image(filePath, openImageRW(filePath))
 {
 }
 
@@ -141,7 +168,7 @@ Image::Image(const char* format, void* data, size_t size):
 {
 }
 
-Image::Image(const char* path, std::shared_ptr<SDL_RWops>&& rw): _path(path), _pRWop(rw)
+Image::Image(const char* path, std::shared_ptr<SDL_RWops>&& rw, bool onMainThread): _path(path), _pRWop(rw)
 {
     if (!_pRWop && !_path.empty())
     {
@@ -149,29 +176,26 @@ Image::Image(const char* path, std::shared_ptr<SDL_RWops>&& rw): _path(path), _p
             LOG_WARNING << "[Image] Load image file error! " << SDL_GetError();
         return;
     }
+
+    std::function<SDL_Surface*()> load;
     if (isTGA(path))
-    {
-        _pSurface = std::shared_ptr<SDL_Surface>(
-            pushAndWaitMainThreadTask<SDL_Surface*>(std::bind(IMG_LoadTGA_RW, &*_pRWop)),
-            std::bind(pushAndWaitMainThreadTask<void, SDL_Surface*>, SDL_FreeSurface, _1));
-    }
+        load = std::bind(IMG_LoadTGA_RW, &*_pRWop);
     else if (isPNG(path))
-    {
-        _pSurface = std::shared_ptr<SDL_Surface>(
-            pushAndWaitMainThreadTask<SDL_Surface*>(std::bind(IMG_LoadPNG_RW, &*_pRWop)),
-            std::bind(pushAndWaitMainThreadTask<void, SDL_Surface*>, SDL_FreeSurface, _1));
-    }
+        load = std::bind(IMG_LoadPNG_RW, &*_pRWop);
     else if (isGIF(path))
+        load = std::bind(IMG_LoadGIF_RW, &*_pRWop);
+    else
+        load = std::bind(IMG_Load_RW, &*_pRWop, SDL_LOAD_NOAUTOFREE);
+
+    if (onMainThread)
     {
         _pSurface = std::shared_ptr<SDL_Surface>(
-            pushAndWaitMainThreadTask<SDL_Surface*>(std::bind(IMG_LoadGIF_RW, &*_pRWop)),
+            pushAndWaitMainThreadTask<SDL_Surface*>(load),
             std::bind(pushAndWaitMainThreadTask<void, SDL_Surface*>, SDL_FreeSurface, _1));
     }
     else
     {
-        _pSurface = std::shared_ptr<SDL_Surface>(
-            pushAndWaitMainThreadTask<SDL_Surface*>(std::bind(IMG_Load_RW, &*_pRWop, SDL_LOAD_NOAUTOFREE)),
-            std::bind(pushAndWaitMainThreadTask<void, SDL_Surface*>, SDL_FreeSurface, _1));
+        _pSurface = std::shared_ptr<SDL_Surface>(load(), SDL_FreeSurface);
     }
 
     if (!_pSurface)
@@ -212,6 +236,56 @@ void Image::setTransparentColorRGB(Color c)
     }
 }
 
+Image Image::convertedRGBA() const
+{
+    Image img(*this);
+    if (!_pSurface) return img;
+
+    auto pSurfaceTmp = std::shared_ptr<SDL_Surface>(SDL_ConvertSurfaceFormat(&*_pSurface, SDL_PIXELFORMAT_RGBA32, 0), SDL_FreeSurface);
+    if (!pSurfaceTmp)
+    {
+        LOG_WARNING << "[Image] Convert surface error! " << SDL_GetError();
+        img.loaded = false;
+    }
+    img._pSurface = pSurfaceTmp;
+    return img;
+}
+
+Image Image::colorKeyed(Color c) const
+{
+    // a converted copy, so the color key never touches the shared source surface
+    Image img = convertedRGBA();
+    auto pSurfaceTmp = img._pSurface;
+    if (!pSurfaceTmp) return img;
+
+    const auto* fmt = pSurfaceTmp->format;
+    const Uint32 rgbMask = fmt->Rmask | fmt->Gmask | fmt->Bmask;
+    const Uint32 key = SDL_MapRGB(fmt, c.r, c.g, c.b) & rgbMask;
+    SDL_LockSurface(&*pSurfaceTmp);
+    for (int y = 0; y < pSurfaceTmp->h; ++y)
+    {
+        Uint32* row = (Uint32*)((Uint8*)pSurfaceTmp->pixels + y * pSurfaceTmp->pitch);
+        for (int x = 0; x < pSurfaceTmp->w; ++x)
+        {
+            if ((row[x] & rgbMask) == key)
+                row[x] = 0;
+        }
+    }
+    SDL_UnlockSurface(&*pSurfaceTmp);
+
+    img._haveAlphaLayer = true;
+    return img;
+}
+
+size_t Image::getBytes() const
+{
+    if (!_pSurface) return 0;
+    size_t bytes = (size_t)_pSurface->pitch * _pSurface->h;
+    if (_pSurface->format->palette)
+        bytes += _pSurface->format->palette->ncolors * sizeof(SDL_Color);
+    return bytes;
+}
+
 Rect Image::getRect() const
 {
     return Rect(
@@ -288,6 +362,8 @@ Texture::Texture(int w, int h, PixelFormat fmt, bool target)
 		sdlfmt = SDL_PIXELFORMAT_UYVY; break;
 	case PixelFormat::YVYU:
 		sdlfmt = SDL_PIXELFORMAT_YVYU; break;
+	case PixelFormat::RGBA32:
+		sdlfmt = SDL_PIXELFORMAT_RGBA32; break;
 	default:
 		sdlfmt = SDL_PIXELFORMAT_UNKNOWN; break;
 	}
@@ -322,6 +398,17 @@ int Texture::updateYUV(uint8_t* Y, int Ypitch, uint8_t* U, int Upitch, uint8_t*
         V, Vpitch);
 }
 
+int Texture::updateRGBA(const Image& srcImage)
+{
+    assert(IsMainThread());
+
+    if (!loaded || !srcImage._pSurface) return -1;
+    const auto* pSurface = &*srcImage._pSurface;
+    if (pSurface->format->format != SDL_PIXELFORMAT_RGBA32) return -2;
+    if (pSurface->w != textureRect.w || pSurface->h != textureRect.h) return -3;
+    return SDL_UpdateTexture(&*_pTexture, nullptr, pSurface->pixels, pSurface->pitch);
+}
+
 void Texture::_draw(std::shared_ptr<SDL_Texture> pTex, const Rect* srcRect, RectF dstRectF,
 	const Color c, const BlendMode b, const bool filter, const double angle, const Point* center)
 {
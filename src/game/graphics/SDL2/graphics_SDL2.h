@@ -9,6 +9,7 @@
 #include "SDL_filesystem.h"
 #include "SDL_ttf.h"
 #include <vector>
+#include <list>
 #include <memory>
 #include <string>
 #include <filesystem>
@@ -136,13 +137,20 @@ private:
     bool loaded = false;
     bool _haveAlphaLayer = false;
 private:
-    Image(const char* path, std::shared_ptr<SDL_RWops>&& rw);
+    Image(const char* path, std::shared_ptr<SDL_RWops>&& rw, bool onMainThread = true);
 public:
 	Image(const std::filesystem::path& path);
+    // Decodes on the calling thread instead of the main thread. For loaders decoding many images in parallel
+    Image(const std::filesystem::path& path, bool onMainThread);
     Image(const char* filePath);
     Image(const char* format, void* bmp, size_t size);
     ~Image();
     void setTransparentColorRGB(Color c);
+    // Copy converted to RGBA. Runs on the calling thread
+    Image convertedRGBA() const;
+    // Copy converted to RGBA with pixels of color c made fully transparent. Runs on the calling thread
+    Image colorKeyed(Color c) const;
+    size_t getBytes() const;
     bool hasAlphaLayer() const { return _haveAlphaLayer; }
 public:
     Rect getRect() const;
@@ -201,6 +209,8 @@ public:
 		UYVY,		// U0 + Y0 + V0 + Y1
 		YVYU,		// Y0 + V0 + Y1 + U0
 
+		RGBA32,		// R + G + B + A bytes
+
 	};
 
 public:
@@ -214,6 +224,8 @@ public:
 	Rect getRect() const { return textureRect; }
 	bool isLoaded() const { return loaded; }
     int updateYUV(uint8_t* Y, int Ypitch, uint8_t* U, int Upitch, uint8_t* V, int Vpitch);
+    // Streaming RGBA32 texture only; image must be RGBA and the same size
+    int updateRGBA(const Image& srcImage);
 };
 
 
@@ -251,6 +263,12 @@ protected:
     Color _outlineColor;
     int _outlineWidth = 0;
 
+    // Textures of recently rendered texts, most recent first. Sprites showing a rotating set of texts
+    //  (select bar titles) reserve room here, so a text moving to another sprite is not rendered again
+    typedef std::pair<std::string, uint32_t> TextCacheKey;     // text, color
+    std::list<std::pair<TextCacheKey, std::shared_ptr<Texture>>> _textCache;
+    size_t _textCacheSize = 0;
+
 public:
     TTFFont(const char* filePath, int ptsize);
     TTFFont(const char* filePath, int ptsize, int faceIndex);
@@ -265,7 +283,12 @@ public:
     
     // Rendering Interfaces
     std::shared_ptr<Texture> TextUTF8(const char* text, const Color& c);
+    std::shared_ptr<Texture> TextUTF8Cached(const char* text, const Color& c);
     Rect getRectUTF8(const char* text);
+
+    void reserveTextCache(size_t count) { _textCacheSize += count; }
+    void releaseTextCache(size_t count);
+    void clearTextCache();
     //Rect getRectUTF16(const char* text);
 };
 
@@ -33,6 +33,7 @@ void TTFFont::setStyle(TTFStyle style)
     assert(IsMainThread());
     if (!loaded) return;
 
+    clearTextCache();
     switch (style)
     {
     case TTFStyle::Normal:    pushMainThreadTask(std::bind(TTF_SetFontStyle, _pFont, TTF_STYLE_NORMAL)); break;
@@ -46,6 +47,7 @@ void TTFFont::setOutline(int width, const Color& c)
     assert(IsMainThread());
     if (!loaded) return;
 
+    clearTextCache();
     if (width == 0)
     {
         if (_pFontOutline != NULL)
@@ -76,6 +78,7 @@ void TTFFont::setHinting(TTFHinting mode)
     assert(IsMainThread());
     if (!loaded) return;
 
+    clearTextCache();
     switch (mode)
     {
     case TTFHinting::Normal:    TTF_SetFontHinting(_pFont, TTF_HINTING_NORMAL); break;
@@ -89,6 +92,7 @@ void TTFFont::setKerning(bool enabled)
     assert(IsMainThread());
     if (!loaded) return;
 
+    clearTextCache();
     pushMainThreadTask(std::bind(TTF_SetFontKerning, _pFont, enabled));
 }
 
@@ -122,6 +126,42 @@ std::shared_ptr<Texture> TTFFont::TextUTF8(const char* text, const Color& c)
     return pTexture;
 }
 
+std::shared_ptr<Texture> TTFFont::TextUTF8Cached(const char* text, const Color& c)
+{
+    assert(IsMainThread());
+    if (_textCacheSize == 0) return TextUTF8(text, c);
+
+    TextCacheKey key{ text, c.hex() };
+    for (auto it = _textCache.begin(); it != _textCache.end(); ++it)
+    {
+        if (it->first == key)
+        {
+            _textCache.splice(_textCache.begin(), _textCache, it);
+            return _textCache.front().second;
+        }
+    }
+
+    auto pTexture = TextUTF8(text, c);
+    if (pTexture == nullptr) return nullptr;
+
+    _textCache.emplace_front(std::move(key), pTexture);
+    while (_textCache.size() > _textCacheSize)
+        _textCache.pop_back();
+    return pTexture;
+}
+
+void TTFFont::releaseTextCache(size_t count)
+{
+    _textCacheSize -= std::min(count, _textCacheSize);
+    while (_textCache.size() > _textCacheSize)
+        _textCache.pop_back();
+}
+
+void TTFFont::clearTextCache()
+{
+    _textCache.clear();
+}
+
 Rect TTFFont::getRectUTF8(const char* text)
 {
     assert(IsMainThread());
@@ -1,9 +1,22 @@
 #include "dxa.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <execution>
 #include <fstream>
+#include <numeric>
+#include <set>
+#include <shared_mutex>
 #include <vector>
 #include <filesystem>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+#include "common/encoding.h"
+#include "common/sysutil.h"
+#include "common/utils.h"
 
 // Codes are from DXArchive (DX Library -> Tool -> DXArchive -> Source) , with some modification
 // Original author: 山田 巧 (Takumi Yamada)
@@ -152,36 +165,44 @@ void KeyCreate(const char* Source, unsigned char* Key)
 }
 
 // 鍵文字列を使用して Xor 演算( Key は必ず DXA_KEYSTR_LENGTH_VER5 の長さがなければならない )
-void KeyConv(void* Data, int Size, int Position, unsigned char* Key)
+// Copies Size bytes from Src to Dest (may be the same buffer) while applying the key stream from Position.
+//  The key is expanded to 48 bytes, a multiple of both the key length and the vector width.
+void KeyConv(void* Dest, const void* Src, size_t Size, size_t Position, const unsigned char* Key)
 {
-	Position %= DXA_KEYSTR_LENGTH_VER5;
-
-	int i, j;
-
-	j = Position;
-	for (i = 0; i < Size; i++)
+	constexpr size_t PATTERN_LENGTH = DXA_KEYSTR_LENGTH_VER5 * 4;
+	alignas(16) u8 pattern[PATTERN_LENGTH];
+	for (size_t i = 0; i < PATTERN_LENGTH; ++i)
+		pattern[i] = Key[(Position + i) % DXA_KEYSTR_LENGTH_VER5];
+
+	u8* dp = (u8*)Dest;
+	const u8* sp = (const u8*)Src;
+	size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128i k0 = _mm_load_si128((const __m128i*)pattern);
+	const __m128i k1 = _mm_load_si128((const __m128i*)(pattern + 16));
+	const __m128i k2 = _mm_load_si128((const __m128i*)(pattern + 32));
+	for (; i + PATTERN_LENGTH <= Size; i += PATTERN_LENGTH)
 	{
-		((u8*)Data)[i] ^= Key[j];
-
-		j++;
-		if (j == DXA_KEYSTR_LENGTH_VER5) j = 0;
+		_mm_storeu_si128((__m128i*)(dp + i), _mm_xor_si128(_mm_loadu_si128((const __m128i*)(sp + i)), k0));
+		_mm_storeu_si128((__m128i*)(dp + i + 16), _mm_xor_si128(_mm_loadu_si128((const __m128i*)(sp + i + 16)), k1));
+		_mm_storeu_si128((__m128i*)(dp + i + 32), _mm_xor_si128(_mm_loadu_si128((const __m128i*)(sp + i + 32)), k2));
 	}
-}
-
-// ファイルから読み込んだデータを鍵文字列を使用して Xor 演算する関数( Key は必ず DXA_KEYSTR_LENGTH_VER5 の長さがなければならない )
-void KeyConvFileRead(void* Data, int Size, std::ifstream& fp, unsigned char* Key, int Position = -1)
-{
-	int pos;
-
-	// ファイルの位置を取得しておく
-	if (Position == -1)  pos = fp.tellg();
-	else                 pos = Position;
-
-	// 読み込む
-	fp.read((char*)Data, Size);
-
-	// データを鍵文字列を使って Xor 演算
-	KeyConv(Data, Size, pos, Key);
+#else
+	u64 k[PATTERN_LENGTH / 8];
+	memcpy(k, pattern, PATTERN_LENGTH);
+	for (; i + PATTERN_LENGTH <= Size; i += PATTERN_LENGTH)
+	{
+		for (size_t w = 0; w < PATTERN_LENGTH / 8; ++w)
+		{
+			u64 v;
+			memcpy(&v, sp + i + w * 8, 8);
+			v ^= k[w];
+			memcpy(dp + i + w * 8, &v, 8);
+		}
+	}
+#endif
+	for (; i < Size; ++i)
+		dp[i] = sp[i] ^ pattern[i % PATTERN_LENGTH];
 }
 
 // デコード( 戻り値:解凍後のサイズ  -1 はエラー  Dest に NULL を入れることも可能 )
@@ -307,307 +328,161 @@ int Decompress(void* Src, void* Dest)
 	return (int)destsize;
 }
 
-// 指定のディレクトリデータにあるファイルを展開する
-int DirectoryDecode(u8* NameP, u8* DirP, u8* FileP, DARC_HEAD_VER5* Head, DARC_DIRECTORY_VER5* Dir, std::ifstream& ArcP, unsigned char* Key, Path DirPath, DXArchive& output)
+// One file of the archive, located in the mapped image
+struct ArchiveEntry
 {
-	// ディレクトリ情報がある場合は、まず展開用のディレクトリを作成する
-	if (Dir->DirectoryAddress != 0xffffffff && Dir->ParentDirectoryAddress != 0xffffffff)
+	std::string path;			// relative, '/' separated, UTF-8
+	size_t offset;
+	u32 dataSize;
+	u32 compressedSize;			// 0xffffffff: not compressed
+	size_t keyPosition;
+};
+
+// Names are stored in the code page of the packing machine; LR2 era archives are Shift-JIS.
+//  Ver 0x0004+ headers record the code page
+eFileEncoding NameEncoding(const DARC_HEAD_VER5& Head)
+{
+	if (Head.Version < 0x0004) return eFileEncoding::SHIFT_JIS;
+	switch (Head.CodePage)
 	{
-		DARC_FILEHEAD_VER5* DirFile;
-
-		// DARC_FILEHEAD_VER5 のアドレスを取得
-		DirFile = (DARC_FILEHEAD_VER5*)(FileP + Dir->DirectoryAddress);
-
-		DirPath /= GetOriginalFileName(NameP + DirFile->NameAddress);
-	}
-
-	// 展開処理開始
-	{
-		u32 i, FileHeadSize;
-		DARC_FILEHEAD_VER5* File;
-
-		// 格納されているファイルの数だけ繰り返す
-		FileHeadSize = Head->Version >= 0x0002 ? sizeof(DARC_FILEHEAD_VER5) : sizeof(DARC_FILEHEAD_VER1);
-		File = (DARC_FILEHEAD_VER5*)(FileP + Dir->FileHeadAddress);
-		for (i = 0; i < Dir->FileHeadNum; i++, File = (DARC_FILEHEAD_VER5*)((u8*)File + FileHeadSize))
-		{
-			// ディレクトリかどうかで処理を分岐
-			if (File->Attributes & FILE_ATTRIBUTE_DIRECTORY)
-			{
-				// ディレクトリの場合は再帰をかける
-				DirectoryDecode(NameP, DirP, FileP, Head, (DARC_DIRECTORY_VER5*)(DirP + File->DataAddress), ArcP, Key, DirPath, output);
-			}
-			else
-			{
-				DXArchiveSegment DestP;
-				//DestP.path = (DirPath / GetOriginalFileName(NameP + File->NameAddress)).u8string();
-				//DestP.size = DXA_BUFFERSIZE_VER5;
-				//DestP.data.assign(DestP.size, 0);
-
-				// データがある場合のみ転送
-				if (File->DataSize != 0)
-				{
-					// 初期位置をセットする
-					if (ArcP.tellg() != (Head->DataStartAddress + File->DataAddress))
-						ArcP.seekg(Head->DataStartAddress + File->DataAddress);
-
-					// データが圧縮されているかどうかで処理を分岐
-					if (Head->Version >= 0x0002 && File->CompressedDataSize != 0xffffffff)
-					{
-						void* temp;
-
-						// 圧縮されている場合
-
-						// 圧縮データが収まるメモリ領域の確保
-						temp = malloc(File->CompressedDataSize);
-
-						// 圧縮データの読み込み
-						if (Head->Version >= 0x0005)
-						{
-							KeyConvFileRead(temp, File->CompressedDataSize, ArcP, Key, File->DataSize);
-						}
-						else
-						{
-							KeyConvFileRead(temp, File->CompressedDataSize, ArcP, Key);
-						}
-
-						// 解凍
-						DestP.size = File->DataSize;
-						DestP.data = std::shared_ptr<uint8_t>(new uint8_t[DestP.size]);
-						Decompress(temp, &*DestP.data);
-
-						// メモリの解放
-						free(temp);
-					}
-					else
-					{
-						// 圧縮されていない場合
-
-						// 転送処理開始
-						{
-							u32 MoveSize, WriteSize;
-
-							WriteSize = 0;
-							DestP.size = File->DataSize;
-							DestP.data = std::shared_ptr<uint8_t>(new uint8_t[DestP.size]);
-							while (WriteSize < File->DataSize)
-							{
-								MoveSize = File->DataSize - WriteSize > DXA_BUFFERSIZE_VER5 ? DXA_BUFFERSIZE_VER5 : File->DataSize - WriteSize;
-
-								// ファイルの反転読み込み
-								if (Head->Version >= 0x0005)
-								{
-									KeyConvFileRead(&*DestP.data + WriteSize, MoveSize, ArcP, Key, File->DataSize + WriteSize);
-								}
-								else
-								{
-									KeyConvFileRead(&*DestP.data + WriteSize, MoveSize, ArcP, Key);
-								}
-
-								WriteSize += MoveSize;
-							}
-						}
-					}
-				}
-
-				output[(DirPath / GetOriginalFileName(NameP + File->NameAddress)).u8string()] = DestP;
-			}
-		}
+	case 65001: return eFileEncoding::UTF8;
+	case 949:   return eFileEncoding::EUC_KR;
+	default:    return eFileEncoding::SHIFT_JIS;
 	}
+}
 
-	// 終了
-	return 0;
+// UTF-8 name of a file or directory
+std::string GetFileNameUTF8(const u8* NameP, u32 NameAddress, eFileEncoding Encoding)
+{
+	std::string name = GetOriginalFileName((u8*)NameP + NameAddress);
+	if (Encoding == eFileEncoding::UTF8 || std::all_of(name.begin(), name.end(), [](char c) { return (u8)c < 0x80; }))
+		return name;
+	return to_utf8(name, Encoding);
 }
 
-// 指定のディレクトリデータにあるファイルを展開する
-int DirectoryDecode(u8* NameP, u8* DirP, u8* FileP, DARC_HEAD_VER5* Head, DARC_DIRECTORY_VER5* Dir, std::ifstream& ArcP, unsigned char* Key, Path DirPath)
+// 指定のディレクトリデータにあるファイルを列挙する
+bool CollectEntries(const u8* NameP, const u8* DirP, const u8* FileP, const DARC_HEAD_VER5& Head, const DARC_DIRECTORY_VER5* Dir,
+	const std::string& DirPath, size_t archiveSize, std::vector<ArchiveEntry>& output, int depth = 0)
 {
-	if (!std::filesystem::exists(DirPath))
-		std::filesystem::create_directories(DirPath);
+	const eFileEncoding Encoding = NameEncoding(Head);
+	if (depth > 64) return false;
 
-	// ディレクトリ情報がある場合は、まず展開用のディレクトリを作成する
+	std::string path = DirPath;
 	if (Dir->DirectoryAddress != 0xffffffff && Dir->ParentDirectoryAddress != 0xffffffff)
 	{
-		DARC_FILEHEAD_VER5* DirFile;
-
-		// DARC_FILEHEAD_VER5 のアドレスを取得
-		DirFile = (DARC_FILEHEAD_VER5*)(FileP + Dir->DirectoryAddress);
+		const DARC_FILEHEAD_VER5* DirFile = (const DARC_FILEHEAD_VER5*)(FileP + Dir->DirectoryAddress);
+		path += GetFileNameUTF8(NameP, DirFile->NameAddress, Encoding);
+		path += '/';
+	}
 
-		DirPath /= GetOriginalFileName(NameP + DirFile->NameAddress);
+	u32 FileHeadSize = Head.Version >= 0x0002 ? sizeof(DARC_FILEHEAD_VER5) : sizeof(DARC_FILEHEAD_VER1);
+	const DARC_FILEHEAD_VER5* File = (const DARC_FILEHEAD_VER5*)(FileP + Dir->FileHeadAddress);
+	for (u32 i = 0; i < Dir->FileHeadNum; i++, File = (const DARC_FILEHEAD_VER5*)((const u8*)File + FileHeadSize))
+	{
+		if (File->Attributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if (!CollectEntries(NameP, DirP, FileP, Head, (const DARC_DIRECTORY_VER5*)(DirP + File->DataAddress), path, archiveSize, output, depth + 1))
+				return false;
+			continue;
+		}
 
-		if (!std::filesystem::exists(DirPath))
-			std::filesystem::create_directories(DirPath);
+		ArchiveEntry e;
+		e.path = path + GetFileNameUTF8(NameP, File->NameAddress, Encoding);
+		e.offset = (size_t)Head.DataStartAddress + File->DataAddress;
+		e.dataSize = File->DataSize;
+		e.compressedSize = Head.Version >= 0x0002 ? File->CompressedDataSize : 0xffffffff;
+		// ver5 keys each file from its size, older versions from the file offset
+		e.keyPosition = Head.Version >= 0x0005 ? File->DataSize : e.offset;
+
+		size_t stored = e.compressedSize != 0xffffffff ? e.compressedSize : e.dataSize;
+		if (e.dataSize != 0 && e.offset + stored > archiveSize)
+			return false;
+		output.push_back(std::move(e));
 	}
+	return true;
+}
 
-	// 展開処理開始
-	{
-		u32 i, FileHeadSize;
-		DARC_FILEHEAD_VER5* File;
+DXArchiveSegment DecodeEntry(const u8* archive, const ArchiveEntry& e, const u8* Key)
+{
+	DXArchiveSegment seg;
+	seg.size = e.dataSize;
+	if (e.dataSize == 0) return seg;
 
-		// 格納されているファイルの数だけ繰り返す
-		FileHeadSize = Head->Version >= 0x0002 ? sizeof(DARC_FILEHEAD_VER5) : sizeof(DARC_FILEHEAD_VER1);
-		File = (DARC_FILEHEAD_VER5*)(FileP + Dir->FileHeadAddress);
-		for (i = 0; i < Dir->FileHeadNum; i++, File = (DARC_FILEHEAD_VER5*)((u8*)File + FileHeadSize))
+	seg.data = std::shared_ptr<uint8_t>(new uint8_t[e.dataSize], std::default_delete<uint8_t[]>());
+	if (e.compressedSize != 0xffffffff)
+	{
+		std::vector<u8> temp(e.compressedSize);
+		KeyConv(temp.data(), archive + e.offset, e.compressedSize, e.keyPosition, Key);
+		if (e.compressedSize < 9 || *(u32*)temp.data() != e.dataSize)
 		{
-			// ディレクトリかどうかで処理を分岐
-			if (File->Attributes & FILE_ATTRIBUTE_DIRECTORY)
-			{
-				// ディレクトリの場合は再帰をかける
-				DirectoryDecode(NameP, DirP, FileP, Head, (DARC_DIRECTORY_VER5*)(DirP + File->DataAddress), ArcP, Key, DirPath);
-			}
-			else
-			{
-				// Do not override existing files
-				Path filePath((DirPath / GetOriginalFileName(NameP + File->NameAddress)));
-				if (std::filesystem::exists(filePath) && std::filesystem::is_regular_file(filePath))
-					continue;
-
-				// データがある場合のみ転送
-				if (File->DataSize != 0)
-				{
-					// 初期位置をセットする
-					if (ArcP.tellg() != (Head->DataStartAddress + File->DataAddress))
-						ArcP.seekg(Head->DataStartAddress + File->DataAddress);
-
-					// データが圧縮されているかどうかで処理を分岐
-					if (Head->Version >= 0x0002 && File->CompressedDataSize != 0xffffffff)
-					{
-						void* temp;
-
-						// 圧縮されている場合
-
-						// 圧縮データが収まるメモリ領域の確保
-						temp = malloc(File->CompressedDataSize);
-
-						// 圧縮データの読み込み
-						if (Head->Version >= 0x0005)
-						{
-							KeyConvFileRead(temp, File->CompressedDataSize, ArcP, Key, File->DataSize);
-						}
-						else
-						{
-							KeyConvFileRead(temp, File->CompressedDataSize, ArcP, Key);
-						}
-
-						// 解凍
-						auto buffer = std::shared_ptr<uint8_t>(new uint8_t[File->DataSize]);
-						Decompress(temp, &*buffer);
-
-						// メモリの解放
-						free(temp);
-
-						std::ofstream ofs((DirPath / GetOriginalFileName(NameP + File->NameAddress)), std::ios_base::binary);
-						ofs.write((const char*)&*buffer, File->DataSize);
-
-					}
-					else
-					{
-						// 圧縮されていない場合
-
-						// 転送処理開始
-						{
-							u32 MoveSize, WriteSize;
-
-							WriteSize = 0;
-
-							auto buffer = std::shared_ptr<uint8_t>(new uint8_t[DXA_BUFFERSIZE_VER5]);
-
-							while (WriteSize < File->DataSize)
-							{
-								MoveSize = File->DataSize - WriteSize > DXA_BUFFERSIZE_VER5 ? DXA_BUFFERSIZE_VER5 : File->DataSize - WriteSize;
-
-								// ファイルの反転読み込み
-								if (Head->Version >= 0x0005)
-								{
-									KeyConvFileRead(&*buffer + WriteSize, MoveSize, ArcP, Key, File->DataSize + WriteSize);
-								}
-								else
-								{
-									KeyConvFileRead(&*buffer + WriteSize, MoveSize, ArcP, Key);
-								}
-
-								WriteSize += MoveSize;
-							}
-
-							std::ofstream ofs((DirPath / GetOriginalFileName(NameP + File->NameAddress)), std::ios_base::binary);
-							ofs.write((const char*)&*buffer, File->DataSize);
-						}
-					}
-				}
-			}
+			seg.size = 0;
+			seg.data.reset();
+			return seg;
 		}
+		Decompress(temp.data(), &*seg.data);
 	}
-
-	// 終了
-	return 0;
+	else
+	{
+		KeyConv(&*seg.data, archive + e.offset, e.dataSize, e.keyPosition, Key);
+	}
+	return seg;
 }
 
-int DecodeArchive(Path& path, DXArchive* output = NULL)
+// Parses the header and lists the files. Returns false if the file is not a supported archive
+bool ReadArchive(const MappedFile& file, u8* Key, std::vector<ArchiveEntry>& entries)
 {
-	u8* HeadBuffer = NULL;
 	DARC_HEAD_VER5 Head;
-	u8 Key[DXA_KEYSTR_LENGTH_VER5];
+	if (file.data() == nullptr || file.size() < sizeof(Head)) return false;
 
 	// 鍵文字列の作成
 	KeyCreate(NULL, Key);
+	KeyConv(&Head, file.data(), sizeof(Head), 0, Key);
 
-	// アーカイブファイルを開く
-	std::string ps(path.string());
-	const char* ArchiveName = ps.c_str();
-	std::ifstream ArcP(ArchiveName, std::ios_base::binary);
-	if (!ArcP.is_open()) return {};
-
-	// ヘッダを解析する
+	// ＩＤの検査
+	if (Head.Head != DXA_HEAD_VER5)
 	{
-		KeyConvFileRead(&Head, sizeof(DARC_HEAD_VER5), ArcP, Key, 0);
+		// バージョン２以前か調べる
+		memset(Key, 0xffffffff, DXA_KEYSTR_LENGTH_VER5);
+		KeyConv(&Head, file.data(), sizeof(Head), 0, Key);
 
-		// ＩＤの検査
+		// バージョン２以前でもない場合はエラー
 		if (Head.Head != DXA_HEAD_VER5)
-		{
-			// バージョン２以前か調べる
-			memset(Key, 0xffffffff, DXA_KEYSTR_LENGTH_VER5);
-
-			ArcP.seekg(0);
-			KeyConvFileRead(&Head, sizeof(DARC_HEAD_VER5), ArcP, Key, 0);
-
-			// バージョン２以前でもない場合はエラー
-			if (Head.Head != DXA_HEAD_VER5)
-				return -1;
-		}
-
-		// バージョン検査
-		if (Head.Version > DXA_VER_VER5)
-			return -1;
-
-		// ヘッダのサイズ分のメモリを確保する
-		std::vector<dxa::u8> HeadBuffer(Head.HeadSize);
-
-		// ヘッダパックをメモリに読み込む
-		ArcP.seekg(Head.FileNameTableStartAddress);
-		if (Head.Version >= 0x0005)
-		{
-			KeyConvFileRead(HeadBuffer.data(), Head.HeadSize, ArcP, Key, 0);
-		}
-		else
-		{
-			KeyConvFileRead(HeadBuffer.data(), Head.HeadSize, ArcP, Key);
-		}
+			return false;
+	}
 
-		// 各アドレスをセットする
-		u8* FileP, * NameP, * DirP;
-		NameP = HeadBuffer.data();
-		FileP = NameP + Head.FileTableStartAddress;
-		DirP = NameP + Head.DirectoryTableStartAddress;
+	// バージョン検査
+	if (Head.Version > DXA_VER_VER5)
+		return false;
+	if ((size_t)Head.FileNameTableStartAddress + Head.HeadSize > file.size())
+		return false;
+
+	// ヘッダパックをメモリに読み込む
+	std::vector<u8> HeadBuffer(Head.HeadSize);
+	KeyConv(HeadBuffer.data(), file.data() + Head.FileNameTableStartAddress, Head.HeadSize,
+		Head.Version >= 0x0005 ? 0 : Head.FileNameTableStartAddress, Key);
+
+	const u8* NameP = HeadBuffer.data();
+	const u8* FileP = NameP + Head.FileTableStartAddress;
+	const u8* DirP = NameP + Head.DirectoryTableStartAddress;
+	return CollectEntries(NameP, DirP, FileP, Head, (const DARC_DIRECTORY_VER5*)DirP, "", file.size(), entries);
+}
 
-		// アーカイブの展開を開始する
-		if (output != NULL)
-			DirectoryDecode(NameP, DirP, FileP, &Head, (DARC_DIRECTORY_VER5*)DirP, ArcP, Key, ".", *output);
-		else
-			DirectoryDecode(NameP, DirP, FileP, &Head, (DARC_DIRECTORY_VER5*)DirP, ArcP, Key, path.parent_path() / path.stem());
-	}
+// Decodes all files in parallel
+bool DecodeArchive(const Path& path, std::vector<ArchiveEntry>& entries, std::vector<DXArchiveSegment>& segments)
+{
+	MappedFile file(path);
+	u8 Key[DXA_KEYSTR_LENGTH_VER5];
+	if (!ReadArchive(file, Key, entries))
+		return false;
 
-	// 終了
-	return 0;
+	segments.resize(entries.size());
+	std::vector<size_t> order(entries.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::for_each(std::execution::par, order.begin(), order.end(), [&](size_t i)
+	{
+		segments[i] = DecodeEntry(file.data(), entries[i], Key);
+	});
+	return true;
 }
 
 }
@@ -617,19 +492,147 @@ DXArchive extractDxaToMem(const StringPath& path)
 	Path p(path);
 	if (!std::filesystem::is_regular_file(p)) return {};
 
-	DXArchive a;
-	dxa::DecodeArchive(p, &a);
+	std::vector<dxa::ArchiveEntry> entries;
+	std::vector<DXArchiveSegment> segments;
+	if (!dxa::DecodeArchive(p, entries, segments)) return {};
 
+	DXArchive a;
+	for (size_t i = 0; i < entries.size(); ++i)
+		a[entries[i].path] = std::move(segments[i]);
 	return a;
 }
 
 int extractDxaToFile(const StringPath& path)
 {
 	Path p(path);
-	if (!std::filesystem::is_regular_file(p)) return {};
+	if (!std::filesystem::is_regular_file(p)) return -1;
 
-	DXArchive a;
-	dxa::DecodeArchive(p);
+	std::vector<dxa::ArchiveEntry> entries;
+	std::vector<DXArchiveSegment> segments;
+	if (!dxa::DecodeArchive(p, entries, segments)) return -1;
 
+	// Do not override existing files
+	Path root = p.parent_path() / p.stem();
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		Path filePath = root / PathFromUTF8(entries[i].path);
+		if (std::filesystem::exists(filePath) && std::filesystem::is_regular_file(filePath))
+			continue;
+
+		std::error_code ec;
+		std::filesystem::create_directories(filePath.parent_path(), ec);
+		std::ofstream ofs(filePath, std::ios_base::binary);
+		if (segments[i].data)
+			ofs.write((const char*)&*segments[i].data, segments[i].size);
+	}
 	return 0;
 }
+
+namespace
+{
+	std::shared_mutex dxaMountMutex;
+	std::map<std::string, int> dxaMountedArchives;		// archive -> mount count
+	std::map<std::string, DXArchiveSegment> dxaMountedEntries;
+
+	std::string dxaKey(const Path& p)
+	{
+		// LR2 skins are authored on Windows; match case-insensitively
+		return toLower(std::filesystem::absolute(p).lexically_normal().generic_u8string());
+	}
+
+	std::string dxaRoot(const Path& p)
+	{
+		return dxaKey(p.parent_path() / p.stem()) + "/";
+	}
+
+	bool globMatch(std::string_view str, std::string_view pattern)
+	{
+		size_t s = 0, p = 0, star = std::string_view::npos, mark = 0;
+		while (s < str.size())
+		{
+			if (p < pattern.size() && pattern[p] == '*') { star = p++; mark = s; }
+			else if (p < pattern.size() && pattern[p] == str[s]) { ++p; ++s; }
+			else if (star != std::string_view::npos) { p = star + 1; s = ++mark; }
+			else return false;
+		}
+		while (p < pattern.size() && pattern[p] == '*') ++p;
+		return p == pattern.size();
+	}
+}
+
+bool mountDxa(const StringPath& path)
+{
+	Path p(path);
+	std::string archiveKey = dxaKey(p);
+	{
+		std::unique_lock l(dxaMountMutex);
+		if (auto it = dxaMountedArchives.find(archiveKey); it != dxaMountedArchives.end())
+		{
+			++it->second;
+			return true;
+		}
+	}
+	if (!std::filesystem::is_regular_file(p)) return false;
+
+	std::vector<dxa::ArchiveEntry> entries;
+	std::vector<DXArchiveSegment> segments;
+	if (!dxa::DecodeArchive(p, entries, segments)) return false;
+
+	std::string root = dxaRoot(p);
+	std::unique_lock l(dxaMountMutex);
+	if (++dxaMountedArchives[archiveKey] > 1) return true;	// mounted by another thread meanwhile
+	for (size_t i = 0; i < entries.size(); ++i)
+		dxaMountedEntries.emplace(root + toLower(entries[i].path), std::move(segments[i]));
+	return true;
+}
+
+void unmountDxa(const StringPath& path)
+{
+	Path p(path);
+	std::unique_lock l(dxaMountMutex);
+	auto it = dxaMountedArchives.find(dxaKey(p));
+	if (it == dxaMountedArchives.end() || --it->second > 0) return;
+	dxaMountedArchives.erase(it);
+
+	// entries of one archive share its root prefix and are contiguous in the map
+	std::string root = dxaRoot(p);
+	auto first = dxaMountedEntries.lower_bound(root);
+	auto last = first;
+	while (last != dxaMountedEntries.end() && last->first.compare(0, root.size(), root) == 0) ++last;
+	dxaMountedEntries.erase(first, last);
+}
+
+void unmountAllDxa()
+{
+	std::unique_lock l(dxaMountMutex);
+	dxaMountedArchives.clear();
+	dxaMountedEntries.clear();
+}
+
+bool findDxaEntry(const StringPath& path, DXArchiveSegment& output)
+{
+	std::shared_lock l(dxaMountMutex);
+	if (dxaMountedEntries.empty()) return false;
+	auto it = dxaMountedEntries.find(dxaKey(Path(path)));
+	if (it == dxaMountedEntries.end()) return false;
+	output = it->second;
+	return true;
+}
+
+std::vector<Path> findDxaFiles(const StringPath& pattern)
+{
+	std::vector<Path> res;
+	std::shared_lock l(dxaMountMutex);
+	if (dxaMountedEntries.empty()) return res;
+
+	// fixed folder part of the pattern narrows the range
+	std::string key = dxaKey(Path(pattern));
+	size_t folderEnd = key.rfind('/', key.find('*'));
+	std::string_view prefix(key.data(), folderEnd == key.npos ? 0 : folderEnd + 1);
+	for (auto it = dxaMountedEntries.lower_bound(std::string(prefix)); it != dxaMountedEntries.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+	{
+		if (globMatch(it->first, key))
+			res.push_back(PathFromUTF8(it->first));
+	}
+	return res;
+}
@@ -2,16 +2,25 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/types.h"
 
 struct DXArchiveSegment
 {
-    size_t size;
+    size_t size = 0;
     std::shared_ptr<uint8_t> data;
 };
 
 using DXArchive = std::map<std::string, DXArchiveSegment>;
 
 DXArchive extractDxaToMem(const StringPath& path);
-int extractDxaToFile(const StringPath& path);
\ No newline at end of file
+int extractDxaToFile(const StringPath& path);
+
+// Mounted archives are served from memory as if extracted to "<archive folder>/<archive stem>/".
+// Lookups are case-insensitive. Mounts are counted per archive; memory is freed when the last user unmounts.
+bool mountDxa(const StringPath& path);
+void unmountDxa(const StringPath& path);
+void unmountAllDxa();
+bool findDxaEntry(const StringPath& path, DXArchiveSegment& output);
+std::vector<Path> findDxaFiles(const StringPath& pattern);     // '*' wildcards
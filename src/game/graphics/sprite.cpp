@@ -386,6 +386,15 @@ SpriteText::SpriteText(const SpriteTextBuilder& builder) : SpriteBase(builder)
     textHeight = builder.ptsize * 3 / 2;
     textColor = builder.color;
     editable = builder.editable;
+    cacheTexture = builder.cacheTexture;
+    if (cacheTexture && pFont)
+        pFont->reserveTextCache(TEXT_CACHE_PER_SPRITE);
+}
+
+SpriteText::~SpriteText()
+{
+    if (cacheTexture && pFont)
+        pFont->releaseTextCache(TEXT_CACHE_PER_SPRITE);
 }
 
 bool SpriteText::update(const Time& t)
@@ -420,7 +429,7 @@ void SpriteText::updateTextTexture(std::string&& text, const Color& c)
     this->text = text;
     textColor = c;
 
-    pTexture = pFont->TextUTF8(text.c_str(), c);
+    pTexture = cacheTexture ? pFont->TextUTF8Cached(text.c_str(), c) : pFont->TextUTF8(text.c_str(), c);
     if (pTexture)
     {
         textureRect = pTexture->getRect();
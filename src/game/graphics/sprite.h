@@ -298,6 +298,9 @@ public:
 // TTFFont contains Texture object
 class SpriteText: public SpriteBase, public iSpriteMouse
 {
+public:
+    static constexpr size_t TEXT_CACHE_PER_SPRITE = 2;     // font cache entries reserved by each caching sprite
+
 private:
     std::shared_ptr<TTFFont> pFont;
     unsigned textHeight;
@@ -307,6 +310,7 @@ protected:
     IndexText textInd;
 	TextAlign align;
     bool editable = false;
+    bool cacheTexture = false;      // text changes often between a few values, keep them in the font cache
 
 protected:
     std::string text;
@@ -327,13 +331,14 @@ public:
         unsigned ptsize = 72;
         Color color = 0xffffffff;
         bool editable = false;
+        bool cacheTexture = false;
 
         std::shared_ptr<SpriteText> build() const { return std::make_shared<SpriteText>(*this); }
     };
 public:
     SpriteText() = delete;
     SpriteText(const SpriteTextBuilder& builder);
-    virtual ~SpriteText() = default;
+    virtual ~SpriteText();
 
 public:
     virtual void updateText();
@@ -66,6 +66,7 @@ int SpriteBarEntry::setTitle(BarTitleType type, const SpriteText::SpriteTextBuil
 {
     SpriteText::SpriteTextBuilder tmpBuilder = builder;
     tmpBuilder.textInd = IndexText(int(IndexText::_SELECT_BAR_TITLE_FULL_0) + index);
+    tmpBuilder.cacheTexture = true;     // titles move to the next bar while scrolling
     sTitle[static_cast<size_t>(type)] = tmpBuilder.build();
     return 0;
 }
@@ -189,15 +190,11 @@ bool SpriteBarEntry::update(Time time)
         drawRivalLampSelfType = 0;
         drawRivalLampRivalType = 0;
 
-        auto [pEntry, pScore] = list[listidx];
+        const auto& info = list.barInfo(listidx);
         drawBodyOn = (index == gSelectContext.highlightBarIndex);
 
         // check new song
-        bool isNewEntry = false;
-        if (pEntry->type() == eEntryType::NEW_SONG_FOLDER)
-            isNewEntry = true;
-        else
-            isNewEntry = (pEntry->_addTime > std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() - State::get(IndexNumber::NEW_ENTRY_SECONDS));
+        bool isNewEntry = info.isNew;
 
         static const std::map<eEntryType, size_t> BAR_TYPE_MAP =
         {
@@ -219,8 +216,8 @@ bool SpriteBarEntry::update(Time time)
             {eEntryType::ARENA_LOBBY, (size_t)BarType::SONG},
         };
         size_t barTypeIdx = (size_t)BarType::SONG;
-        if (BAR_TYPE_MAP.find(pEntry->type()) != BAR_TYPE_MAP.end())
-            barTypeIdx = BAR_TYPE_MAP.at(pEntry->type());
+        if (BAR_TYPE_MAP.find(info.type) != BAR_TYPE_MAP.end())
+            barTypeIdx = BAR_TYPE_MAP.at(info.type);
         if (isNewEntry && (BarType)barTypeIdx == BarType::SONG)
         {
             barTypeIdx = (size_t)BarType::NEW_SONG;
@@ -279,65 +276,59 @@ bool SpriteBarEntry::update(Time time)
             (BarType)barTypeIdx == BarType::NEW_SONG || 
             (BarType)barTypeIdx == BarType::SONG_RIVAL)
         {
-            std::shared_ptr<ChartFormatBase> pf;
-            if (pEntry->type() == eEntryType::SONG || pEntry->type() == eEntryType::RIVAL_SONG)
-            {
-                pf = std::reinterpret_pointer_cast<EntryFolderSong>(pEntry)->getCurrentChart();
-            }
-            else if (pEntry->type() == eEntryType::CHART || pEntry->type() == eEntryType::RIVAL_CHART)
-            {
-                pf = std::reinterpret_pointer_cast<EntryChart>(pEntry)->_file;
-            }
-            if (pf)
+            if (info.isBMS)
             {
-                switch (pf->type())
-                {
-                case eChartFormat::BMS:
+                // level
+                if ((size_t)info.difficulty < sLevel.size() && sLevel[info.difficulty])
                 {
-                    const auto bms = std::reinterpret_pointer_cast<const ChartFormatBMSMeta>(pf);
+                    sLevel[info.difficulty]->update(time);
+                    sLevel[info.difficulty]->setHideInternal(false);
+                    drawLevelType = info.difficulty;
+                    drawLevel = true;
+                }
 
-                    // level
-                    if ((size_t)bms->difficulty < sLevel.size() && sLevel[bms->difficulty])
+                if (info.hasScore)
+                {
+                    // lamp
+                    // TODO rival entry has two lamps
+                    static const std::map<ScoreBMS::Lamp, BarLampType> BMS_LAMP_TYPE_MAP_OLD =
                     {
-                        sLevel[bms->difficulty]->update(time);
-                        sLevel[bms->difficulty]->setHideInternal(false);
-                        drawLevelType = bms->difficulty;
-                        drawLevel = true;
+                        {ScoreBMS::Lamp::NOPLAY,        BarLampType::NOPLAY      },
+                        {ScoreBMS::Lamp::FAILED,        BarLampType::FAILED      },
+                        {ScoreBMS::Lamp::ASSIST,        BarLampType::FAILED      },
+                        {ScoreBMS::Lamp::EASY,          BarLampType::EASY        },
+                        {ScoreBMS::Lamp::NORMAL,        BarLampType::NORMAL      },
+                        {ScoreBMS::Lamp::HARD,          BarLampType::HARD        },
+                        {ScoreBMS::Lamp::EXHARD,        BarLampType::HARD        },
+                        {ScoreBMS::Lamp::FULLCOMBO,     BarLampType::FULLCOMBO   },
+                        {ScoreBMS::Lamp::PERFECT,       BarLampType::FULLCOMBO   },
+                        {ScoreBMS::Lamp::MAX,           BarLampType::FULLCOMBO   }
+                    };
+                    static const std::map<ScoreBMS::Lamp, BarLampType> BMS_LAMP_TYPE_MAP =
+                    {
+                        {ScoreBMS::Lamp::NOPLAY,        BarLampType::NOPLAY      },
+                        {ScoreBMS::Lamp::FAILED,        BarLampType::FAILED      },
+                        {ScoreBMS::Lamp::ASSIST,        BarLampType::ASSIST_EASY },
+                        {ScoreBMS::Lamp::EASY,          BarLampType::EASY        },
+                        {ScoreBMS::Lamp::NORMAL,        BarLampType::NORMAL      },
+                        {ScoreBMS::Lamp::HARD,          BarLampType::HARD        },
+                        {ScoreBMS::Lamp::EXHARD,        BarLampType::EXHARD      }, // FIXME EXHARD
+                        {ScoreBMS::Lamp::FULLCOMBO,     BarLampType::FULLCOMBO   },
+                        {ScoreBMS::Lamp::PERFECT,       BarLampType::FULLCOMBO   }, // FIXME PERFECT
+                        {ScoreBMS::Lamp::MAX,           BarLampType::FULLCOMBO   }  // FIXME MAX
+                    };
+                    size_t lampTypeIdx = (BMS_LAMP_TYPE_MAP.find(info.lamp) != BMS_LAMP_TYPE_MAP.end()) ?
+                        (size_t)BMS_LAMP_TYPE_MAP.at(info.lamp) : (size_t)BarLampType::NOPLAY;
+                    if (sLamp[lampTypeIdx])
+                    {
+                        sLamp[lampTypeIdx]->update(time);
+                        sLamp[lampTypeIdx]->setHideInternal(false);
+                        drawLampType = lampTypeIdx;
+                        drawLamp = true;
                     }
-
-                    auto score = std::reinterpret_pointer_cast<ScoreBMS>(pScore);
-                    if (score)
+                    else
                     {
-                        // lamp
-                        // TODO rival entry has two lamps
-                        static const std::map<ScoreBMS::Lamp, BarLampType> BMS_LAMP_TYPE_MAP_OLD =
-                        {
-                            {ScoreBMS::Lamp::NOPLAY,        BarLampType::NOPLAY      },
-                            {ScoreBMS::Lamp::FAILED,        BarLampType::FAILED      },
-                            {ScoreBMS::Lamp::ASSIST,        BarLampType::FAILED      },
-                            {ScoreBMS::Lamp::EASY,          BarLampType::EASY        },
-                            {ScoreBMS::Lamp::NORMAL,        BarLampType::NORMAL      },
-                            {ScoreBMS::Lamp::HARD,          BarLampType::HARD        },
-                            {ScoreBMS::Lamp::EXHARD,        BarLampType::HARD        },
-                            {ScoreBMS::Lamp::FULLCOMBO,     BarLampType::FULLCOMBO   },
-                            {ScoreBMS::Lamp::PERFECT,       BarLampType::FULLCOMBO   },
-                            {ScoreBMS::Lamp::MAX,           BarLampType::FULLCOMBO   }
-                        };
-                        static const std::map<ScoreBMS::Lamp, BarLampType> BMS_LAMP_TYPE_MAP =
-                        {
-                            {ScoreBMS::Lamp::NOPLAY,        BarLampType::NOPLAY      },
-                            {ScoreBMS::Lamp::FAILED,        BarLampType::FAILED      },
-                            {ScoreBMS::Lamp::ASSIST,        BarLampType::ASSIST_EASY },
-                            {ScoreBMS::Lamp::EASY,          BarLampType::EASY        },
-                            {ScoreBMS::Lamp::NORMAL,        BarLampType::NORMAL      },
-                            {ScoreBMS::Lamp::HARD,          BarLampType::HARD        },
-                            {ScoreBMS::Lamp::EXHARD,        BarLampType::EXHARD      }, // FIXME EXHARD
-                            {ScoreBMS::Lamp::FULLCOMBO,     BarLampType::FULLCOMBO   },
-                            {ScoreBMS::Lamp::PERFECT,       BarLampType::FULLCOMBO   }, // FIXME PERFECT
-                            {ScoreBMS::Lamp::MAX,           BarLampType::FULLCOMBO   }  // FIXME MAX
-                        };
-                        size_t lampTypeIdx = (BMS_LAMP_TYPE_MAP.find(score->lamp) != BMS_LAMP_TYPE_MAP.end()) ?
-                            (size_t)BMS_LAMP_TYPE_MAP.at(score->lamp) : (size_t)BarLampType::NOPLAY;
+                        lampTypeIdx = (size_t)BMS_LAMP_TYPE_MAP_OLD.at(info.lamp);
                         if (sLamp[lampTypeIdx])
                         {
                             sLamp[lampTypeIdx]->update(time);
@@ -345,82 +336,64 @@ bool SpriteBarEntry::update(Time time)
                             drawLampType = lampTypeIdx;
                             drawLamp = true;
                         }
-                        else
+                    }
+
+                    if ((BarType)barTypeIdx == BarType::SONG_RIVAL)
+                    {
+                        // rank
+                        auto t = Option::getRankType(info.rivalRate);
+                        switch (t)
                         {
-                            lampTypeIdx = (size_t)BMS_LAMP_TYPE_MAP_OLD.at(score->lamp);
-                            if (sLamp[lampTypeIdx])
-                            {
-                                sLamp[lampTypeIdx]->update(time);
-                                sLamp[lampTypeIdx]->setHideInternal(false);
-                                drawLampType = lampTypeIdx;
-                                drawLamp = true;
-                            }
+                        case Option::RANK_0: drawRankType = (size_t)BarRankType::MAX;  break;
+                        case Option::RANK_1: drawRankType = (size_t)BarRankType::AAA;  break;
+                        case Option::RANK_2: drawRankType = (size_t)BarRankType::AA;   break;
+                        case Option::RANK_3: drawRankType = (size_t)BarRankType::A;    break;
+                        case Option::RANK_4: drawRankType = (size_t)BarRankType::B;    break;
+                        case Option::RANK_5: drawRankType = (size_t)BarRankType::C;    break;
+                        case Option::RANK_6: drawRankType = (size_t)BarRankType::D;    break;
+                        case Option::RANK_7: drawRankType = (size_t)BarRankType::E;    break;
+                        case Option::RANK_8: drawRankType = (size_t)BarRankType::F;    break;
+                        case Option::RANK_NONE: drawRankType = (size_t)BarRankType::NONE; break;
                         }
-
-                        if ((BarType)barTypeIdx == BarType::SONG_RIVAL)
+                        if (sRank[drawRankType])
                         {
-                            // rank
-                            auto t = Option::getRankType(score->rival_rate);
-                            switch (t)
-                            {
-                            case Option::RANK_0: drawRankType = (size_t)BarRankType::MAX;  break;
-                            case Option::RANK_1: drawRankType = (size_t)BarRankType::AAA;  break;
-                            case Option::RANK_2: drawRankType = (size_t)BarRankType::AA;   break;
-                            case Option::RANK_3: drawRankType = (size_t)BarRankType::A;    break;
-                            case Option::RANK_4: drawRankType = (size_t)BarRankType::B;    break;
-                            case Option::RANK_5: drawRankType = (size_t)BarRankType::C;    break;
-                            case Option::RANK_6: drawRankType = (size_t)BarRankType::D;    break;
-                            case Option::RANK_7: drawRankType = (size_t)BarRankType::E;    break;
-                            case Option::RANK_8: drawRankType = (size_t)BarRankType::F;    break;
-                            case Option::RANK_NONE: drawRankType = (size_t)BarRankType::NONE; break;
-                            }
-                            if (sRank[drawRankType])
-                            {
-                                sRank[drawRankType]->update(time);
-                                sRank[drawRankType]->setHideInternal(false);
-                                drawRank = true;
-                            }
-                            // win/lose/draw
-                            if ((size_t)score->rival_win < sRivalWinLose.size() && sRivalWinLose[score->rival_win])
-                            {
-                                sRivalWinLose[score->rival_win]->update(time);
-                                sRivalWinLose[score->rival_win]->setHideInternal(false);
-                                drawRivalType = score->rival_win;
-                                drawRival = true;
-                            }
-                            // rival lamp
-                            if (drawLamp && sRivalLampSelf[drawRivalLampSelfType])
-                            {
-                                drawRivalLampSelfType = drawLampType;
-                                drawRivalLampSelf = true;
-                                sRivalLampSelf[drawRivalLampSelfType]->update(time);
-                                sRivalLampSelf[drawRivalLampSelfType]->setHideInternal(false);
-                            }
-                            // rival lamp
-                            size_t rivalLampTypeIdx = (BMS_LAMP_TYPE_MAP.find(score->rival_lamp) != BMS_LAMP_TYPE_MAP.end()) ?
-                                (size_t)BMS_LAMP_TYPE_MAP.at(score->rival_lamp) : (size_t)BarLampType::NOPLAY;
-                            if (sRivalLampRival[rivalLampTypeIdx])
-                            {
-                                sRivalLampRival[rivalLampTypeIdx]->update(time);
-                                sRivalLampRival[rivalLampTypeIdx]->setHideInternal(false);
-                                drawRivalLampRivalType = rivalLampTypeIdx;
-                                drawRivalLampRival = true;
-                            }
+                            sRank[drawRankType]->update(time);
+                            sRank[drawRankType]->setHideInternal(false);
+                            drawRank = true;
+                        }
+                        // win/lose/draw
+                        if ((size_t)info.rivalWin < sRivalWinLose.size() && sRivalWinLose[info.rivalWin])
+                        {
+                            sRivalWinLose[info.rivalWin]->update(time);
+                            sRivalWinLose[info.rivalWin]->setHideInternal(false);
+                            drawRivalType = info.rivalWin;
+                            drawRival = true;
+                        }
+                        // rival lamp
+                        if (drawLamp && sRivalLampSelf[drawRivalLampSelfType])
+                        {
+                            drawRivalLampSelfType = drawLampType;
+                            drawRivalLampSelf = true;
+                            sRivalLampSelf[drawRivalLampSelfType]->update(time);
+                            sRivalLampSelf[drawRivalLampSelfType]->setHideInternal(false);
+                        }
+                        // rival lamp
+                        size_t rivalLampTypeIdx = (BMS_LAMP_TYPE_MAP.find(info.rivalLamp) != BMS_LAMP_TYPE_MAP.end()) ?
+                            (size_t)BMS_LAMP_TYPE_MAP.at(info.rivalLamp) : (size_t)BarLampType::NOPLAY;
+                        if (sRivalLampRival[rivalLampTypeIdx])
+                        {
+                            sRivalLampRival[rivalLampTypeIdx]->update(time);
+                            sRivalLampRival[rivalLampTypeIdx]->setHideInternal(false);
+                            drawRivalLampRivalType = rivalLampTypeIdx;
+                            drawRivalLampRival = true;
                         }
                     }
-                    break;
-                }
-                default:
-                    break;
                 }
             }
         }
         else if ((BarType)barTypeIdx == BarType::COURSE)
         {
-            auto ps = std::reinterpret_pointer_cast<EntryCourse>(pEntry);
-
-            auto score = std::dynamic_pointer_cast<ScoreBMS>(pScore);
-            if (score)
+            if (info.hasScore)
             {
                 static const std::map<ScoreBMS::Lamp, BarLampType> BMS_LAMP_TYPE_MAP_OLD =
                 {
@@ -448,8 +421,8 @@ bool SpriteBarEntry::update(Time time)
                     {ScoreBMS::Lamp::PERFECT,       BarLampType::FULLCOMBO   }, // FIXME PERFECT
                     {ScoreBMS::Lamp::MAX,           BarLampType::FULLCOMBO   }  // FIXME MAX
                 };
-                size_t lampTypeIdx = (BMS_LAMP_TYPE_MAP.find(score->lamp) != BMS_LAMP_TYPE_MAP.end()) ?
-                    (size_t)BMS_LAMP_TYPE_MAP.at(score->lamp) : (size_t)BarLampType::NOPLAY;
+                size_t lampTypeIdx = (BMS_LAMP_TYPE_MAP.find(info.lamp) != BMS_LAMP_TYPE_MAP.end()) ?
+                    (size_t)BMS_LAMP_TYPE_MAP.at(info.lamp) : (size_t)BarLampType::NOPLAY;
                 if (sLamp[lampTypeIdx])
                 {
                     sLamp[lampTypeIdx]->update(time);
@@ -459,7 +432,7 @@ bool SpriteBarEntry::update(Time time)
                 }
                 else
                 {
-                    lampTypeIdx = (size_t)BMS_LAMP_TYPE_MAP_OLD.at(score->lamp);
+                    lampTypeIdx = (size_t)BMS_LAMP_TYPE_MAP_OLD.at(info.lamp);
                     if (sLamp[lampTypeIdx])
                     {
                         sLamp[lampTypeIdx]->update(time);
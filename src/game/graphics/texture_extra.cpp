@@ -82,31 +82,27 @@ void TextureVideo::update()
 	if (!pVideo->haveVideo) return;
 	if (!pVideo->isPlaying()) return;
 
-	auto vrfc = pVideo->getDecodedFrames();
-	if (decoded_frames == vrfc) return;
-	decoded_frames = vrfc;
+	// several textures may share one video; each uploads when the presented frame changes
+	pVideo->present(Time());
+	auto serial = pVideo->getPresentedFrames();
+	if (presented_frames == serial) return;
+	presented_frames = serial;
 
-	using namespace std::chrono_literals;
-		
-	std::shared_lock l(pVideo->video_frame_mutex, std::try_to_lock);
-	if (l.owns_lock())
-	{
-		auto pf = pVideo->getFrame();
-		if (!pf) return;
+	auto pf = pVideo->getFrame();
+	if (!pf) return;
 
-		switch (format)
-		{
-		case Texture::PixelFormat::IYUV:
-			if (updateYUV(
-				pf->data[0], pf->linesize[0],
-				pf->data[1], pf->linesize[1],
-				pf->data[2], pf->linesize[2]) == 0)
-				updated = true;
-			break;
-
-		default:
-			break;
-		}
+	switch (format)
+	{
+	case Texture::PixelFormat::IYUV:
+		if (updateYUV(
+			pf->data[0], pf->linesize[0],
+			pf->data[1], pf->linesize[1],
+			pf->data[2], pf->linesize[2]) == 0)
+			updated = true;
+		break;
+
+	default:
+		break;
 	}
 }
 
@@ -140,7 +136,7 @@ void TextureVideo::draw(const Rect& srcRect, RectF dstRect,
 void TextureVideo::reset()
 {
 	seek(0);
-	decoded_frames = 0;
+	presented_frames = ~0;
 }
 
 std::shared_ptr<std::shared_mutex> TextureVideo::texMapMutex;
@@ -160,9 +156,11 @@ void TextureVideo::updateAll()
 
 #endif
 
-bool TextureBmsBga::addBmp(size_t idx, Path pBmp)
+TextureBmsBga::DecodedBmp TextureBmsBga::decodeBmp(size_t idx, Path pBmp)
 {
-	if (idx == size_t(-1)) return false;
+	DecodedBmp bmp;
+	bmp.idx = idx;
+	if (idx == size_t(-1)) return bmp;
 
 	if (!fs::exists(pBmp) && pBmp.has_extension() && toLower(pBmp.extension().string()) == ".bmp")
 	{
@@ -173,43 +171,104 @@ bool TextureBmsBga::addBmp(size_t idx, Path pBmp)
 			pBmp = pBmp.parent_path() / PathFromUTF8(pBmp.filename().stem().u8string() + ".png");
 		}
 	}
+	bmp.path = pBmp;
+
 	if (fs::exists(pBmp) && fs::is_regular_file(pBmp) && pBmp.has_extension())
 	{
 		if (video_file_extensions.find(toLower(pBmp.extension().u8string())) != video_file_extensions.end())
 		{
+			bmp.type = obj::Ty::VIDEO;
 #ifndef VIDEO_DISABLED
-			objs[idx].type = obj::Ty::VIDEO;
-			objs[idx].pt = std::make_shared<TextureVideo>(std::make_shared<sVideo>(pBmp, gSelectContext.pitchSpeed, false));
-			LOG_DEBUG << "[TextureBmsBga] added video: " << pBmp.u8string();
-			return true;
-#else
-			LOG_DEBUG << "[TextureBmsBga] video support is disabled: " << pBmp.u8string();
-			return false;
+			bmp.video = std::make_shared<sVideo>(pBmp, gSelectContext.pitchSpeed, false);
 #endif
 		}
 		else
 		{
-			objs[idx].type = obj::Ty::PIC;
-			objs[idx].pt = std::make_shared<Texture>(Image(pBmp));
+			bmp.type = obj::Ty::PIC;
+			bmp.image = std::make_shared<Image>(pBmp, false);
+			bmp.layerImage = std::make_shared<Image>(bmp.image->colorKeyed(Color(0, 0, 0, 255)));
+		}
+	}
+	return bmp;
+}
 
-			objs_layer[idx].type = obj::Ty::PIC;
-			Image layerImg(pBmp);
-			layerImg.setTransparentColorRGB(Color(0, 0, 0, 255));
-			objs_layer[idx].pt = std::make_shared<Texture>(layerImg);
+bool TextureBmsBga::addBmp(DecodedBmp& bmp)
+{
+	if (bmp.idx == size_t(-1)) return false;
+
+	switch (bmp.type)
+	{
+	case obj::Ty::VIDEO:
+#ifndef VIDEO_DISABLED
+		objs[bmp.idx].type = obj::Ty::VIDEO;
+		objs[bmp.idx].pt = std::make_shared<TextureVideo>(bmp.video);
+		LOG_DEBUG << "[TextureBmsBga] added video: " << bmp.path.u8string();
+		return true;
+#else
+		LOG_DEBUG << "[TextureBmsBga] video support is disabled: " << bmp.path.u8string();
+		return false;
+#endif
+
+	case obj::Ty::PIC:
+	{
+		objs[bmp.idx].type = obj::Ty::PIC;
+		objs_layer[bmp.idx].type = obj::Ty::PIC;
 
-			LOG_DEBUG << "[TextureBmsBga] added pic: " << pBmp.u8string();
+		size_t textureBytes = 0;
+		if (bmp.image->getBytes() > 0)
+		{
+			Rect rc = bmp.image->getRect();
+			textureBytes = (size_t)rc.w * rc.h * 4 * 2;		// base + layer
+		}
+		if (!streaming && uploadedBytes + textureBytes > memoryBudget)
+		{
+			streaming = true;
+			LOG_INFO << "[TextureBmsBga] BGA exceeds memory budget (" << memoryBudget / 1048576 << "MB), streaming the remaining pictures";
+		}
+
+		if (streaming)
+		{
+			std::unique_lock l(streamMutex);
+			auto& pic = streamPics[bmp.idx];
+			pic.path = bmp.path;
+			if (streamCacheBytes + bmp.image->getBytes() <= streamCacheBudget())
+			{
+				pic.image = bmp.image;
+				streamCacheBytes += bmp.image->getBytes();
+			}
+			bmp.image.reset();
+			bmp.layerImage.reset();
+
+			LOG_DEBUG << "[TextureBmsBga] cached pic: " << bmp.path.u8string();
 			return true;
 		}
+
+		objs[bmp.idx].pt = std::make_shared<Texture>(*bmp.image);
+		objs_layer[bmp.idx].pt = std::make_shared<Texture>(*bmp.layerImage);
+		uploadedBytes += textureBytes;
+
+		// surfaces are not needed after upload
+		bmp.image.reset();
+		bmp.layerImage.reset();
+
+		LOG_DEBUG << "[TextureBmsBga] added pic: " << bmp.path.u8string();
+		return true;
 	}
-	else
-	{
-		objs[idx].type = obj::Ty::EMPTY;
 
-		objs_layer[idx].type = obj::Ty::EMPTY;
+	default:
+		objs[bmp.idx].type = obj::Ty::EMPTY;
+
+		objs_layer[bmp.idx].type = obj::Ty::EMPTY;
 
-		LOG_DEBUG << "[TextureBmsBga] file not found, added dummy: " << pBmp.u8string();
+		LOG_DEBUG << "[TextureBmsBga] file not found, added dummy: " << bmp.path.u8string();
+		return false;
 	}
-	return false;
+}
+
+bool TextureBmsBga::addBmp(size_t idx, Path pBmp)
+{
+	auto bmp = decodeBmp(idx, pBmp);
+	return addBmp(bmp);
 }
 
 bool TextureBmsBga::setSlot(size_t idx, Time time, bool base, bool layer, bool poor)
@@ -284,6 +343,7 @@ void TextureBmsBga::seek(const Time& t)
 	seekSub(layerSlot, layerIdx, layerIt);
 	seekSub(poorSlot, poorIdx, poorIt);
 	inPoor = false;
+	if (streaming) updateStreamWindow();
 }
 
 void TextureBmsBga::update(const Time& t, bool poor)
@@ -319,6 +379,153 @@ void TextureBmsBga::update(const Time& t, bool poor)
 	seekSub(layerSlot, layerIdx, layerIt);
 	seekSub(poorSlot, poorIdx, poorIt);
 	inPoor = poor;
+	if (streaming) updateStreamWindow();
+}
+
+void TextureBmsBga::updateStreamWindow()
+{
+	// current and upcoming pictures of each channel, in display order
+	streamWindow.clear();
+	auto collect = [this](const decltype(baseSlot)& slot, decltype(baseSlot.begin()) it, bool layer, size_t count)
+	{
+		for (; it != slot.end() && count > 0; ++it)
+		{
+			auto o = objs.find(it->second);
+			if (o == objs.end() || o->second.type != obj::Ty::PIC) continue;
+
+			std::pair<size_t, bool> key{ it->second, layer };
+			if (std::find(streamWindow.begin(), streamWindow.end(), key) == streamWindow.end())
+			{
+				streamWindow.push_back(key);
+				--count;
+			}
+		}
+	};
+	collect(baseSlot, baseIt, false, STREAM_LOOKAHEAD);
+	collect(layerSlot, layerIt, true, STREAM_LOOKAHEAD);
+	collect(poorSlot, poorIt, false, STREAM_LOOKAHEAD_POOR);
+}
+
+void TextureBmsBga::updateStreaming()
+{
+	if (!streaming || !isLoaded())
+	{
+		// drop textures left from the previous chart
+		for (auto& slot : streamRing)
+			if (slot.texture) slot = StreamRingSlot();
+		return;
+	}
+
+	std::vector<std::pair<size_t, bool>> window;
+	{
+		std::shared_lock l(idxLock);
+		window = streamWindow;
+	}
+	++streamTick;
+
+	auto isWanted = [&window](const StreamRingSlot& s)
+	{
+		return s.idx != INDEX_INVALID && std::find(window.begin(), window.end(), std::make_pair(s.idx, s.layer)) != window.end();
+	};
+
+	std::vector<size_t> missing;
+	size_t uploads = 0;
+	for (const auto& entry : window)
+	{
+		const auto [idx, layer] = entry;
+		if (std::any_of(streamRing.begin(), streamRing.end(), [&entry](const StreamRingSlot& s) { return s.idx == entry.first && s.layer == entry.second; }))
+			continue;
+
+		std::shared_ptr<Image> image;
+		{
+			std::unique_lock l(streamMutex);
+			auto it = streamPics.find(idx);
+			if (it == streamPics.end()) continue;	// uploaded before streaming started
+			it->second.lastUse = streamTick;
+			image = it->second.image;
+		}
+		if (!image)
+		{
+			missing.push_back(idx);
+			continue;
+		}
+		if (uploads >= STREAM_UPLOADS_PER_FRAME) continue;
+
+		// window is never larger than the ring, so there is always a slot not needed soon
+		auto slot = std::find_if(streamRing.begin(), streamRing.end(), [&](const StreamRingSlot& s) { return !isWanted(s); });
+		if (slot == streamRing.end()) break;
+
+		Image rgba = layer ? image->colorKeyed(Color(0, 0, 0, 255)) : image->convertedRGBA();
+		if (rgba.getBytes() == 0) continue;
+		Rect rc = rgba.getRect();
+		if (!slot->texture || slot->texture->getRect().w != rc.w || slot->texture->getRect().h != rc.h)
+			slot->texture = std::make_shared<Texture>(rc.w, rc.h, PixelFormat::RGBA32, false);
+		if (slot->texture->updateRGBA(rgba) != 0) continue;
+		++uploads;
+
+		std::unique_lock l(idxLock);
+		if (slot->idx != INDEX_INVALID)
+			(slot->layer ? objs_layer : objs)[slot->idx].pt = nullptr;
+		slot->idx = idx;
+		slot->layer = layer;
+		(layer ? objs_layer : objs)[idx].pt = slot->texture;
+	}
+
+	// decode evicted pictures in the background; they are uploaded on a later frame
+	using namespace std::chrono_literals;
+	if (!missing.empty() && (!streamDecodeTask.valid() || streamDecodeTask.wait_for(0s) == std::future_status::ready))
+	{
+		streamDecodeTask = std::async(std::launch::async, [this, missing, window, tick = streamTick]
+		{
+			for (size_t idx : missing)
+			{
+				Path path;
+				{
+					std::unique_lock l(streamMutex);
+					auto it = streamPics.find(idx);
+					if (it == streamPics.end() || it->second.image) continue;
+					path = it->second.path;
+				}
+
+				auto image = std::make_shared<Image>(path, false);
+
+				std::unique_lock l(streamMutex);
+				auto it = streamPics.find(idx);
+				if (it != streamPics.end() && !it->second.image)
+				{
+					it->second.image = image;
+					it->second.lastUse = tick;
+					streamCacheBytes += image->getBytes();
+				}
+			}
+			trimStreamCache(window);
+		});
+	}
+}
+
+void TextureBmsBga::trimStreamCache(const std::vector<std::pair<size_t, bool>>& window)
+{
+	std::unique_lock l(streamMutex);
+	const size_t budget = streamCacheBudget();
+	if (streamCacheBytes <= budget) return;
+
+	// least recently needed first, never the ones in the window
+	std::vector<std::pair<unsigned long long, size_t>> candidates;
+	for (const auto& [idx, pic] : streamPics)
+	{
+		if (!pic.image) continue;
+		if (std::find(window.begin(), window.end(), std::make_pair(idx, false)) != window.end()) continue;
+		if (std::find(window.begin(), window.end(), std::make_pair(idx, true)) != window.end()) continue;
+		candidates.emplace_back(pic.lastUse, idx);
+	}
+	std::sort(candidates.begin(), candidates.end());
+	for (const auto& [lastUse, idx] : candidates)
+	{
+		if (streamCacheBytes <= budget) break;
+		auto& pic = streamPics[idx];
+		streamCacheBytes -= pic.image->getBytes();
+		pic.image.reset();
+	}
 }
 
 // LR2 scales bga with some weird rules:
@@ -342,7 +549,7 @@ void TextureBmsBga::draw(const Rect& sr, RectF dr,
 	const Color c, const BlendMode b, const bool f, const double a) const
 {
 	std::shared_lock l(idxLock);
-	if (inPoor && poorIdx != INDEX_INVALID && objs.at(poorIdx).type != obj::Ty::EMPTY)
+	if (inPoor && poorIdx != INDEX_INVALID && objs.at(poorIdx).type != obj::Ty::EMPTY && objs.at(poorIdx).pt)
 	{
 		Rect srcRect = objs.at(poorIdx).pt ? objs.at(poorIdx).pt->getRect() : RECT_FULL;
 		RectF dstRect = dr;
@@ -351,7 +558,7 @@ void TextureBmsBga::draw(const Rect& sr, RectF dr,
 	}
 	else
 	{
-		if (baseIdx != INDEX_INVALID && objs.at(baseIdx).type != obj::Ty::EMPTY)
+		if (baseIdx != INDEX_INVALID && objs.at(baseIdx).type != obj::Ty::EMPTY && objs.at(baseIdx).pt)
 		{
 			Rect srcRect = objs.at(baseIdx).pt ? objs.at(baseIdx).pt->getRect() : RECT_FULL;
 			RectF dstRect = dr;
@@ -361,16 +568,17 @@ void TextureBmsBga::draw(const Rect& sr, RectF dr,
 
 		if (layerIdx != INDEX_INVALID && objs.at(layerIdx).type != obj::Ty::EMPTY)
 		{
-			if (objs.at(layerIdx).type == obj::Ty::PIC && objs_layer.at(layerIdx).pt != nullptr)
+			if (objs.at(layerIdx).type == obj::Ty::PIC)
 			{
+				if (objs_layer.at(layerIdx).pt == nullptr) return;	// not uploaded yet while streaming
 				Rect srcRect = objs_layer.at(layerIdx).pt ? objs_layer.at(layerIdx).pt->getRect() : RECT_FULL;
 				RectF dstRect = dr;
 				lr2ScaleBgaRect(srcRect, dstRect);
 				objs_layer.at(layerIdx).pt->draw(srcRect, dstRect, c, b, f, a);
 			}
-			else
+			else if (objs.at(layerIdx).pt)
 			{
-				Rect srcRect = objs.at(layerIdx).pt ? objs.at(layerIdx).pt->getRect() : RECT_FULL;
+				Rect srcRect = objs.at(layerIdx).pt->getRect();
 				RectF dstRect = dr;
 				lr2ScaleBgaRect(srcRect, dstRect);
 				objs.at(layerIdx).pt->draw(srcRect, dstRect, c, b, f, a);
@@ -383,7 +591,7 @@ void TextureBmsBga::draw(const Rect& sr, RectF dr,
 	const Color c, const BlendMode b, const bool f, const double a, const Point& ct) const
 {
 	std::shared_lock l(idxLock);
-	if (inPoor && poorIdx != INDEX_INVALID && objs.at(poorIdx).type != obj::Ty::EMPTY)
+	if (inPoor && poorIdx != INDEX_INVALID && objs.at(poorIdx).type != obj::Ty::EMPTY && objs.at(poorIdx).pt)
 	{
 		Rect srcRect = objs.at(poorIdx).pt ? objs.at(poorIdx).pt->getRect() : RECT_FULL;
 		RectF dstRect = dr;
@@ -392,7 +600,7 @@ void TextureBmsBga::draw(const Rect& sr, RectF dr,
 	}
 	else
 	{
-		if (baseIdx != INDEX_INVALID && objs.at(baseIdx).type != obj::Ty::EMPTY)
+		if (baseIdx != INDEX_INVALID && objs.at(baseIdx).type != obj::Ty::EMPTY && objs.at(baseIdx).pt)
 		{
 			Rect srcRect = objs.at(baseIdx).pt ? objs.at(baseIdx).pt->getRect() : RECT_FULL;
 			RectF dstRect = dr;
@@ -402,16 +610,17 @@ void TextureBmsBga::draw(const Rect& sr, RectF dr,
 
 		if (layerIdx != INDEX_INVALID && objs.at(layerIdx).type != obj::Ty::EMPTY)
 		{
-			if (objs.at(layerIdx).type == obj::Ty::PIC && objs_layer.at(layerIdx).pt != nullptr)
+			if (objs.at(layerIdx).type == obj::Ty::PIC)
 			{
+				if (objs_layer.at(layerIdx).pt == nullptr) return;	// not uploaded yet while streaming
 				Rect srcRect = objs_layer.at(layerIdx).pt ? objs_layer.at(layerIdx).pt->getRect() : RECT_FULL;
 				RectF dstRect = dr;
 				lr2ScaleBgaRect(srcRect, dstRect);
 				objs_layer.at(layerIdx).pt->draw(srcRect, dstRect, c, b, f, a, ct);
 			}
-			else
+			else if (objs.at(layerIdx).pt)
 			{
-				Rect srcRect = objs.at(layerIdx).pt ? objs.at(layerIdx).pt->getRect() : RECT_FULL;
+				Rect srcRect = objs.at(layerIdx).pt->getRect();
 				RectF dstRect = dr;
 				lr2ScaleBgaRect(srcRect, dstRect);
 				objs.at(layerIdx).pt->draw(srcRect, dstRect, c, b, f, a, ct);
@@ -431,6 +640,8 @@ void TextureBmsBga::reset()
 		baseIdx = INDEX_INVALID;
 		layerIdx = INDEX_INVALID;
 		poorIdx = INDEX_INVALID;
+		if (streaming) updateStreamWindow();
+		else streamWindow.clear();
 	}
 
 	auto resetSub = [this](decltype(baseSlot)& slot)
@@ -458,6 +669,14 @@ void TextureBmsBga::reset()
 void TextureBmsBga::clear()
 {
 	loaded = false;
+	streaming = false;
+	if (streamDecodeTask.valid()) streamDecodeTask.wait();
+	{
+		std::unique_lock l(streamMutex);
+		streamPics.clear();
+		streamCacheBytes = 0;
+	}
+	uploadedBytes = 0;
 	textureRect = Rect();
 	baseSlot.clear();
 	layerSlot.clear();
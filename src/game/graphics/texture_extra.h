@@ -1,5 +1,9 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <future>
 #include <map>
+#include <mutex>
 #include <set>
 #include <variant>
 #include "common/asynclooper.h"
@@ -14,7 +18,7 @@ class TextureVideo : public Texture
 {
 protected:
 	std::shared_ptr<sVideo> pVideo;
-	unsigned decoded_frames = ~0;
+	unsigned presented_frames = ~0;
 	PixelFormat format;
 	bool updated = false;
 
@@ -90,6 +94,43 @@ protected:
 	decltype(layerSlot.begin()) layerIt;
 	decltype(poorSlot.begin()) poorIt;
 	bool inPoor = false;
+
+	// Streaming mode, entered while loading once the textures would exceed the memory budget.
+	//  Pictures stay decoded in their source format in a CPU cache (also within the budget; evicted ones are
+	//  decoded again on demand). Only the slots just ahead of the current base/layer/poor positions are
+	//  uploaded, into a ring of reusable textures.
+	static constexpr size_t STREAM_RING_SIZE = 40;
+	static constexpr size_t STREAM_LOOKAHEAD = 16;			// slots per base/layer channel
+	static constexpr size_t STREAM_LOOKAHEAD_POOR = 4;
+	static constexpr size_t STREAM_UPLOADS_PER_FRAME = 8;
+
+	struct StreamPic
+	{
+		Path path;
+		std::shared_ptr<Image> image;	// nullptr if evicted from the CPU cache
+		unsigned long long lastUse = 0;
+	};
+	struct StreamRingSlot
+	{
+		std::shared_ptr<Texture> texture;
+		size_t idx = INDEX_INVALID;
+		bool layer = false;
+	};
+
+	size_t memoryBudget = 256 * 1024 * 1024;		// uploaded textures and the stream cache together
+	std::atomic<size_t> uploadedBytes{ 0 };		// stops growing once streaming starts
+	std::atomic<bool> streaming{ false };
+	std::mutex streamMutex;							// streamPics, streamCacheBytes
+	std::map<size_t, StreamPic> streamPics;
+	size_t streamCacheBytes = 0;
+	std::vector<std::pair<size_t, bool>> streamWindow;	// (idx, layer), guarded by idxLock
+	std::array<StreamRingSlot, STREAM_RING_SIZE> streamRing;	// main thread
+	unsigned long long streamTick = 0;
+	std::future<void> streamDecodeTask;
+
+	size_t streamCacheBudget() const { return memoryBudget > uploadedBytes ? memoryBudget - uploadedBytes : 0; }
+	void updateStreamWindow();
+	void trimStreamCache(const std::vector<std::pair<size_t, bool>>& window);
 	
 public:
 	TextureBmsBga(int x = 256, int y = 256) : Texture(nullptr, x, y)
@@ -104,6 +145,23 @@ public:
 	}
 
 public:
+	// Decoded picture or opened video, not uploaded yet
+	struct DecodedBmp
+	{
+		size_t idx = INDEX_INVALID;
+		Path path;
+		obj::Ty type = obj::Ty::EMPTY;
+		std::shared_ptr<Image> image;			// base and poor
+		std::shared_ptr<Image> layerImage;		// black is transparent
+#ifndef VIDEO_DISABLED
+		std::shared_ptr<sVideo> video;
+#endif
+	};
+
+	// Any thread. Each picture is decoded once; the layer variant is derived from the decoded surface
+	static DecodedBmp decodeBmp(size_t idx, Path path);
+	// Creates the textures. Uploads happen on the main thread
+	bool addBmp(DecodedBmp& bmp);
 	bool addBmp(size_t idx, Path path);
 	bool setSlot(size_t idx, Time time, bool base, bool layer, bool poor);
 	void sortSlot();
@@ -123,6 +181,12 @@ public:
 	void setLoaded();
 	void stopUpdate();
 
+	// Bytes of textures and cached pictures; set before loading
+	void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+	bool isStreaming() const { return streaming; }
+	// Main thread. Uploads upcoming pictures in streaming mode
+	void updateStreaming();
+
 	void setVideoSpeed();
 };
 
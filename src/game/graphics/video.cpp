@@ -1,6 +1,7 @@
 #include "video.h"
 #ifndef VIDEO_DISABLED
 
+#include <algorithm>
 #include <thread>
 #include <chrono>
 
@@ -111,8 +112,9 @@ int sVideo::unsetVideo()
 	haveVideo = false;
 	finished = false;
 	firstFrame = true;
+	valid = false;
 	if (pPacket) av_packet_free(&pPacket);
-	if (pFrame) av_frame_free(&pFrame);
+	freeFrames();
 	if (pCodecCtx) avcodec_free_context(&pCodecCtx);
 	if (pFormatCtx) avformat_close_input(&pFormatCtx);
 	return 0;
@@ -139,8 +141,33 @@ void sVideo::startPlaying()
 {
 	if (playing) return;
 	if (finished) return;
+
+	// frame pool; the decode thread is not running here
+	freeFrames();
+	for (auto& q : frameQueue)
+	{
+		if ((q.frame = av_frame_alloc()) == nullptr)
+		{
+			LOG_WARNING << "[Video] Could not alloc frame object of " << fs::absolute(file).u8string();
+			freeFrames();
+			return;
+		}
+	}
+	if ((pFrame = av_frame_alloc()) == nullptr)
+	{
+		LOG_WARNING << "[Video] Could not alloc frame object of " << fs::absolute(file).u8string();
+		freeFrames();
+		return;
+	}
+	queueWrite = 0;
+	queueRead = 0;
+	valid = false;
+	dropped_frames = 0;
+
+	clockSpeed = speed;
+	rebaseClock(Time().hres(), clockStartPos);
+
 	playing = true;
-	startTime = std::chrono::system_clock::now();
 	decodeEnd = std::async(std::launch::async, std::bind(&sVideo::decodeLoop, this));
 }
 
@@ -149,37 +176,64 @@ void sVideo::stopPlaying()
 	if (!playing) return;
 	playing = false;
 	decodeEnd.wait();
+	if (dropped_frames > 0)
+		LOG_DEBUG << "[Video] " << file.u8string() << ": dropped " << dropped_frames << " of " << decoded_frames << " frames";
 	seek(0);
 }
 
-void sVideo::decodeLoop()
+void sVideo::freeFrames()
 {
-	if (!haveVideo) return;
-
-	valid = false;
-
+	for (auto& q : frameQueue)
+		if (q.frame) av_frame_free(&q.frame);
 	if (pFrame) av_frame_free(&pFrame);
-	if (pPacket) av_packet_free(&pPacket);
+}
 
-	if ((pFrame = av_frame_alloc()) == nullptr)
+bool sVideo::pushFrame(AVFrame* frame, double pts, unsigned serial)
+{
+	// wait for a free slot; the presenter may be paused, so keep checking for stop and seek requests
+	size_t w = queueWrite.load(std::memory_order_relaxed);
+	while (w - queueRead.load(std::memory_order_acquire) >= FRAME_QUEUE_SIZE)
 	{
-		LOG_WARNING << "[Video] Could not alloc frame object of " << fs::absolute(file).u8string();
-		return;
+		if (!playing || seekRequest.load(std::memory_order_relaxed) >= 0)
+			return false;
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
 	}
 
+	auto& q = frameQueue[w % FRAME_QUEUE_SIZE];
+	av_frame_unref(q.frame);
+	av_frame_move_ref(q.frame, frame);
+	q.pts = pts;
+	q.seekSerial = serial;
+	queueWrite.store(w + 1, std::memory_order_release);
+	return true;
+}
+
+void sVideo::decodeLoop()
+{
+	if (!haveVideo) return;
+
+	if (pPacket) av_packet_free(&pPacket);
 	if ((pPacket = av_packet_alloc()) == nullptr)
 	{
 		LOG_WARNING << "[Video] Could not alloc packet object of " << fs::absolute(file).u8string();
+		playing = false;
 		return;
 	}
 
-	if (int ret = avcodec_open2(pCodecCtx, pCodec, NULL); ret < 0)
+	if (!avcodec_is_open(pCodecCtx))
 	{
-		char buf[256];
-		av_strerror(ret, buf, 256);
-		LOG_ERROR << "[Video] Could not open codec of " << fs::absolute(file).u8string() << " (" << buf << ")";
-		unsetVideo();
-		return;
+		// frame threading adds a few frames of latency, which the frame queue hides
+		pCodecCtx->thread_count = (int)std::clamp(std::thread::hardware_concurrency() / 2, 1u, DECODE_THREADS_MAX);
+		pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+		if (int ret = avcodec_open2(pCodecCtx, pCodec, NULL); ret < 0)
+		{
+			char buf[256];
+			av_strerror(ret, buf, 256);
+			LOG_ERROR << "[Video] Could not open codec of " << fs::absolute(file).u8string() << " (" << buf << ")";
+			playing = false;
+			return;
+		}
 	}
 
 	decoding = true;
@@ -187,125 +241,207 @@ void sVideo::decodeLoop()
 	// timestamps per second
 	double tsps = pFormatCtx->streams[videoIndex]->time_base.num == 0 ?
 		AV_TIME_BASE : av_q2d(av_inv_q(pFormatCtx->streams[videoIndex]->time_base));
+	AVRational frameRate = pFormatCtx->streams[videoIndex]->avg_frame_rate;
+	double frameDuration = frameRate.num > 0 ? av_q2d(av_inv_q(frameRate)) : 1.0 / 30;
+
 	AVFrame *pFrame1 = av_frame_alloc();
+	unsigned serial = seekSerial;
+
+	// Looping continues the timeline: pts = ptsBase + (timestamp - loopStartTs)
+	double ptsBase = 0.0;
+	double loopStartTs = 0.0;
+	bool loopStartPending = false;
+	double lastPts = 0.0;
 
-	do
+	auto receiveFrames = [&]() -> int
 	{
-		while (av_read_frame(pFormatCtx, pPacket) == 0 && pPacket)
+		int ret;
+		while ((ret = avcodec_receive_frame(pCodecCtx, pFrame1)) == 0)
 		{
-			if (!playing) return;
-
-			// Ignore packets from audio streams
-			if (pPacket->stream_index != videoIndex) continue;
+			decoded_frames++;
+			if (pFrame1->best_effort_timestamp < 0 || (pFrame1->flags & AV_FRAME_FLAG_CORRUPT))
+			{
+				av_frame_unref(pFrame1);
+				continue;
+			}
 
-			avcodec_send_packet(pCodecCtx, pPacket);
+			double ts = pFrame1->best_effort_timestamp / tsps;
+			if (loopStartPending)
+			{
+				loopStartPending = false;
+				loopStartTs = ts;
+			}
+			lastPts = ptsBase + ts - loopStartTs;
+			if (!pushFrame(pFrame1, lastPts, serial))
+				av_frame_unref(pFrame1);
+		}
+		return ret;
+	};
 
-			int ret = avcodec_receive_frame(pCodecCtx, pFrame1);
-			av_packet_unref(pPacket);
+	while (playing)
+	{
+		if (int64_t req = seekRequest.exchange(-1); req >= 0)
+		{
+			serial = seekSerial;
+			doSeek(req, false);
+			ptsBase = 0.0;
+			loopStartTs = 0.0;
+			loopStartPending = false;
+		}
 
-			if (ret < 0)
+		if (av_read_frame(pFormatCtx, pPacket) == 0)
+		{
+			// Ignore packets from audio streams
+			if (pPacket->stream_index != videoIndex)
 			{
-				if (ret == AVERROR(EAGAIN))
-				{
-					continue;
-				}
-				else
-				{
-					char buf[128];
-					av_strerror(ret, buf, 128);
-					LOG_ERROR << "[Video] playback error: " << buf;
-					decoding = false;
-					return;
-				}
+				av_packet_unref(pPacket);
+				continue;
 			}
 
-			if (pFrame1->best_effort_timestamp >= 0)
+			int sendRet, ret;
+			do
+			{
+				sendRet = avcodec_send_packet(pCodecCtx, pPacket);
+				ret = receiveFrames();
+			} while (sendRet == AVERROR(EAGAIN) && ret == AVERROR(EAGAIN) && playing);
+			av_packet_unref(pPacket);
+
+			if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
 			{
-				if (!(pFrame1->flags & AV_FRAME_FLAG_CORRUPT))
-				{
-					std::unique_lock l(video_frame_mutex);
-
-					av_frame_unref(pFrame);
-					av_frame_ref(pFrame, pFrame1);
-					valid = true;
-				}
-
-				using namespace std::chrono;
-				auto frameTime_ms = long long(std::round(pFrame1->best_effort_timestamp / tsps * 1000 / speed));
-				if (firstFrame)
-				{
-					firstFrame = false;
-					startTime -= milliseconds(frameTime_ms);
-				}
-				else
-				{
-					if (duration_cast<milliseconds>(system_clock::now() - startTime).count() < frameTime_ms)
-					{
-						std::this_thread::sleep_until(startTime + milliseconds(frameTime_ms));
-					}
-				}
+				char buf[128];
+				av_strerror(ret, buf, 128);
+				LOG_ERROR << "[Video] playback error: " << buf;
+				break;
 			}
-			decoded_frames = pCodecCtx->frame_number;
+			continue;
 		}
 
-		if (loop_playback)
+		// end of file: drain frames still held by the decoder threads
+		avcodec_send_packet(pCodecCtx, NULL);
+		if (int ret = receiveFrames(); ret < 0 && ret != AVERROR_EOF)
 		{
-			using namespace std::chrono_literals;
-			//std::this_thread::sleep_for(33ms);
-			decoded_frames = 0;
-			seek(0, true);
-			startTime = std::chrono::system_clock::now();
+			char buf[128];
+			av_strerror(ret, buf, 128);
+			LOG_ERROR << "[Video] playback drain error: " << buf;
+		}
+
+		if (loop_playback && playing)
+		{
+			doSeek(0, true);
+			ptsBase = lastPts + frameDuration;
+			loopStartPending = true;
 		}
 		else
 		{
-			// drain
-			avcodec_send_packet(pCodecCtx, NULL);
-			{
-				// av_frame_unref(frame) is omitted
-				if (int ret = avcodec_receive_frame(pCodecCtx, pFrame1))
-				{
-					char buf[128];
-					av_strerror(ret, buf, 128);
-					LOG_ERROR << "[Video] playback drain error: " << buf;
-				}
-				if (pFrame1->best_effort_timestamp >= 0)
-				{
-					std::unique_lock l(video_frame_mutex);
-
-					av_frame_unref(pFrame);
-					av_frame_ref(pFrame, pFrame1);
-					valid = true;
-				}
-				decoded_frames = pCodecCtx->frame_number;
-			}
-
-			playing = false;
 			finished = true;
+			break;
 		}
+	}
 
-	} while (playing);
-
+	av_frame_free(&pFrame1);
 	decoding = false;
 }
 
+double sVideo::getClock(long long timeNs) const
+{
+	return clockStartPos + (timeNs - clockStartNs) / 1e9 * clockSpeed;
+}
+
+void sVideo::rebaseClock(long long timeNs, double pos)
+{
+	clockStartNs = timeNs;
+	clockStartPos = pos;
+}
+
+bool sVideo::present(const Time& t)
+{
+	if (!haveVideo || pFrame == nullptr) return false;
+
+	long long now = t.hres();
+	if (int64_t pos = rebaseRequest.exchange(-1); pos >= 0)
+	{
+		firstFrame = (pos == 0);
+		rebaseClock(now, (double)pos);
+	}
+	if (double s = speedRequest.exchange(-1.0); s >= 0.0)
+	{
+		rebaseClock(now, getClock(now));
+		clockSpeed = s;
+	}
+
+	unsigned serial = seekSerial.load(std::memory_order_relaxed);
+	size_t r = queueRead.load(std::memory_order_relaxed);
+	size_t w = queueWrite.load(std::memory_order_acquire);
+	unsigned popped = 0;
+	for (; r != w; ++r)
+	{
+		auto& q = frameQueue[r % FRAME_QUEUE_SIZE];
+		if (q.seekSerial != serial)
+			continue;	// decoded before the last seek
+
+		if (firstFrame)
+		{
+			firstFrame = false;
+			rebaseClock(now, q.pts);
+		}
+		if (q.pts > getClock(now))
+			break;
+
+		// the slot frame is given back to the pool and reused by the decoder
+		std::swap(pFrame, q.frame);
+		++popped;
+	}
+	queueRead.store(r, std::memory_order_release);
+
+	if (popped == 0) return false;
+	// catching up after start or seek is not a drop
+	if (popped > 1 && valid && serial == presentedSerial)
+		dropped_frames += popped - 1;
+	presentedSerial = serial;
+	++presented_frames;
+	valid = true;
+	return true;
+}
+
+void sVideo::setSpeed(double speed)
+{
+	this->speed = speed;
+	speedRequest = speed;
+}
+
 void sVideo::seek(int64_t second, bool backwards)
 {
 	if (!haveVideo) return;
-	if (second == 0) 
-		firstFrame = true;
 
+	rebaseRequest = second;
+	if (playing)
+	{
+		seekSerial++;
+		seekRequest = second;
+	}
+	else
+	{
+		doSeek(second, backwards);
+	}
+}
+
+int sVideo::doSeek(int64_t second, bool backwards)
+{
 	// timestamps per second
 	double tsps = pFormatCtx->streams[videoIndex]->time_base.num == 0 ? 
 		AV_TIME_BASE : av_q2d(av_inv_q(pFormatCtx->streams[videoIndex]->time_base));
 
-	if (int ret = av_seek_frame(pFormatCtx, videoIndex, int64_t(std::round(second / tsps)), backwards ? AVSEEK_FLAG_BACKWARD : 0); ret >= 0)
+	if (int ret = av_seek_frame(pFormatCtx, videoIndex, int64_t(std::round(second * tsps)), backwards ? AVSEEK_FLAG_BACKWARD : 0); ret >= 0)
 	{
 		finished = false;
-		avcodec_flush_buffers(pCodecCtx);
+		if (avcodec_is_open(pCodecCtx))
+			avcodec_flush_buffers(pCodecCtx);
+		return 0;
 	}
 	else
 	{
 		LOG_ERROR << "[Video] seek " << second << "s error (" << file.u8string() << ")";
+		return ret;
 	}
 }
 
@@ -1,10 +1,12 @@
 #pragma once
 #ifndef VIDEO_DISABLED
 
-#include <shared_mutex>
+#include <array>
+#include <atomic>
 #include <set>
 #include <future>
 #include "common/types.h"
+#include "common/beat.h"
 #include "graphics.h"
 
 extern "C"
@@ -21,6 +23,10 @@ class SkinBase;
 void video_init();
 
 // libav decoder wrap
+//  The decode thread runs the codec with frame/slice threading and fills a small queue of pooled frames
+//   tagged with their presentation time. It only waits when the queue is full.
+//  present() is called by the texture uploader (scene thread). It pops the frames that are due on the
+//   playback clock and keeps the latest one; frames that were due but never shown are counted as dropped.
 class sVideo
 {
 	friend class SceneBase;
@@ -29,27 +35,57 @@ public:
 	Path file;
 	bool haveVideo = false;
 
+	static constexpr size_t FRAME_QUEUE_SIZE = 6;
+	static constexpr unsigned DECODE_THREADS_MAX = 4;
+
 private:
 
 	// decoder params
 	AVFormatContext *pFormatCtx = nullptr;
 	const AVCodec *pCodec = nullptr;
 	AVCodecContext *pCodecCtx = nullptr;
-	AVFrame *pFrame = nullptr;
 	AVPacket *pPacket = nullptr;
 	int videoIndex = -1;
-	unsigned decoded_frames = 0;
-	std::chrono::time_point<std::chrono::system_clock> startTime;
 	std::future<void> decodeEnd;
 
+	// decoded frames: decode thread writes, presenting thread reads
+	struct QueuedFrame
+	{
+		AVFrame* frame = nullptr;
+		double pts = 0.0;		// seconds on the playback timeline
+		unsigned seekSerial = 0;
+	};
+	std::array<QueuedFrame, FRAME_QUEUE_SIZE> frameQueue{};
+	alignas(64) std::atomic<size_t> queueWrite{ 0 };
+	alignas(64) std::atomic<size_t> queueRead{ 0 };
+
+	// seek requests posted while the decode thread is running
+	std::atomic<unsigned> seekSerial{ 0 };
+	std::atomic<int64_t> seekRequest{ -1 };
+
+	// clock changes posted from other threads, applied by present()
+	std::atomic<int64_t> rebaseRequest{ -1 };	// seconds
+	std::atomic<double> speedRequest{ -1.0 };
+
+	std::atomic<unsigned> decoded_frames{ 0 };
+	std::atomic<unsigned> dropped_frames{ 0 };
+
+	// presenting thread only
+	AVFrame *pFrame = nullptr;		// frame on screen
+	unsigned presented_frames = 0;
+	unsigned presentedSerial = 0;
+	long long clockStartNs = 0;
+	double clockStartPos = 0.0;		// seconds
+	double clockSpeed = 1.0;
+	bool firstFrame = true;			// align the clock to the first frame after start or seek(0)
+
 	// render properties
 	Path filePath;
 	double speed = 1.0;
 	int w = -1, h = -1;		// set in setVideo()
-	bool playing = false;
-	bool finished = false;
-	bool decoding = false;
-	bool firstFrame = true;
+	std::atomic<bool> playing{ false };
+	std::atomic<bool> finished{ false };
+	std::atomic<bool> decoding{ false };
 	bool valid = false;
 	bool loop_playback = false;
 
@@ -73,14 +109,23 @@ public:
 	void stopPlaying();
 	void decodeLoop();
 
-	int getDecodedFrames() { return decoded_frames; }
+	// Presenting thread. Advances to the latest due frame at t; returns true if the frame changed
+	bool present(const Time& t);
+
+	unsigned getDecodedFrames() const { return decoded_frames; }
+	unsigned getPresentedFrames() const { return presented_frames; }
+	unsigned getDroppedFrames() const { return dropped_frames; }
 	AVFrame* getFrame() { return valid ? pFrame : NULL; }
 
-public:
-	std::shared_mutex video_frame_mutex;
+private:
+	double getClock(long long timeNs) const;
+	void rebaseClock(long long timeNs, double pos);
+	bool pushFrame(AVFrame* frame, double pts, unsigned serial);
+	void freeFrames();
+	int doSeek(int64_t second, bool backwards);
 
 public:
-	void setSpeed(double speed) { this->speed = speed; }
+	void setSpeed(double speed);
 	void seek(int64_t second, bool backwards = false);
 	
 };
@@ -0,0 +1,155 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+typedef unsigned InputCallbackHandle;
+constexpr InputCallbackHandle INVALID_INPUT_CALLBACK = 0;
+
+// Callback table read by the input polling thread without locking.
+//  Writers rebuild an immutable snapshot and publish it with an atomic pointer swap.
+//  The replaced snapshot is retired, and freed by the reader in reclaim() once it has
+//   finished dispatching; the polling thread is the only reader, so that is a grace period.
+//  remove() and clear() also wait out a dispatch in progress, so once they return no removed
+//   callback is running and its captures may be destroyed.
+//  Callbacks are kept in key order, same as the std::map they replace.
+template <typename Func>
+class InputCallbackTable
+{
+public:
+    struct Entry
+    {
+        InputCallbackHandle handle;
+        Func func;
+    };
+    typedef std::vector<Entry> Snapshot;
+
+private:
+    std::mutex _writeMutex;
+    std::map<std::string, Entry> _entries;      // writer side only
+    InputCallbackHandle _nextHandle = 1;
+
+    std::atomic<const Snapshot*> _current;
+    std::vector<const Snapshot*> _retired;
+    std::atomic<bool> _hasRetired{ false };
+
+    std::atomic<unsigned> _readEpoch{ 0 };         // odd from snapshot() to reclaim()
+    std::atomic<std::thread::id> _readerThread{};
+
+public:
+    InputCallbackTable() : _current(new Snapshot) {}
+    ~InputCallbackTable()
+    {
+        delete _current.load();
+        for (auto p : _retired) delete p;
+    }
+    InputCallbackTable(const InputCallbackTable&) = delete;
+    InputCallbackTable& operator=(const InputCallbackTable&) = delete;
+
+    // Returns INVALID_INPUT_CALLBACK if key is already registered
+    InputCallbackHandle add(const std::string& key, Func f)
+    {
+        std::unique_lock lock(_writeMutex);
+        if (_entries.find(key) != _entries.end())
+            return INVALID_INPUT_CALLBACK;
+
+        InputCallbackHandle h = _nextHandle++;
+        _entries[key] = { h, std::move(f) };
+        publish();
+        return h;
+    }
+
+    bool remove(const std::string& key)
+    {
+        std::unique_lock lock(_writeMutex);
+        auto it = _entries.find(key);
+        if (it == _entries.end())
+            return false;
+
+        _entries.erase(it);
+        publish();
+        lock.unlock();
+        waitReader();
+        return true;
+    }
+
+    bool remove(InputCallbackHandle h)
+    {
+        std::unique_lock lock(_writeMutex);
+        for (auto it = _entries.begin(); it != _entries.end(); ++it)
+        {
+            if (it->second.handle == h)
+            {
+                _entries.erase(it);
+                publish();
+                lock.unlock();
+                waitReader();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        std::unique_lock lock(_writeMutex);
+        _entries.clear();
+        publish();
+        lock.unlock();
+        waitReader();
+    }
+
+    // Reader side. The returned snapshot stays valid until the same thread calls reclaim()
+    const Snapshot& snapshot()
+    {
+        if ((_readEpoch.load(std::memory_order_relaxed) & 1) == 0)
+        {
+            _readerThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+            _readEpoch.fetch_add(1, std::memory_order_seq_cst);
+        }
+        return *_current.load(std::memory_order_seq_cst);
+    }
+
+    // Reader side. Call after dispatching; never blocks
+    void reclaim()
+    {
+        if (_readEpoch.load(std::memory_order_relaxed) & 1)
+            _readEpoch.fetch_add(1, std::memory_order_release);
+
+        if (!_hasRetired.load(std::memory_order_acquire)) return;
+
+        std::unique_lock lock(_writeMutex, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+        for (auto p : _retired) delete p;
+        _retired.clear();
+        _hasRetired.store(false, std::memory_order_release);
+    }
+
+private:
+    // call with _writeMutex held
+    void publish()
+    {
+        auto s = new Snapshot;
+        s->reserve(_entries.size());
+        for (const auto& [key, entry] : _entries)
+            s->push_back(entry);
+
+        _retired.push_back(_current.exchange(s, std::memory_order_seq_cst));
+        _hasRetired.store(true, std::memory_order_release);
+    }
+
+    // Call after publish() without _writeMutex. A reader that entered before the swap may still be
+    //  running a removed callback; wait until it leaves. Callbacks removing themselves do not wait
+    void waitReader()
+    {
+        unsigned epoch = _readEpoch.load(std::memory_order_seq_cst);
+        if ((epoch & 1) == 0 || _readerThread.load(std::memory_order_relaxed) == std::this_thread::get_id())
+            return;
+        while (_readEpoch.load(std::memory_order_acquire) == epoch)
+            std::this_thread::yield();
+    }
+};
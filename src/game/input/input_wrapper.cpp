@@ -1,6 +1,7 @@
 #include "input_wrapper.h"
 #include "game/runtime/state.h"
 #include "game/runtime/generic_info.h"
+#include "game/runtime/latency_tracer.h"
 #include "common/log.h"
 #include <cassert>
 
@@ -8,19 +9,13 @@ InputWrapper::InputWrapper(unsigned rate, bool background) :
     AsyncLooper("Input loop", std::bind(&InputWrapper::_loop, this), rate),
     _background(background)
 {
+    // input timestamps are judged; keep the dedicated timer
+    setAllowPool(false);
 }
 
 InputWrapper::~InputWrapper()
 {
     assert(!isRunning());
-    {
-        std::unique_lock _lock(_inputMutex);
-        _pCallbackMap.clear();
-        _hCallbackMap.clear();
-        _rCallbackMap.clear();
-        _aCallbackMap.clear();
-        _keyboardCallbackMap.clear();
-    }
 }
 
 void InputWrapper::setRate(unsigned rate)
@@ -32,9 +27,12 @@ void InputWrapper::_loop()
 {
     gFrameCount[FRAMECOUNT_IDX_INPUT]++;
 
+    long long loopBeginNs = LatencyTracer::now();
+
     _prev = _curr;
     _curr = InputMgr::detect();
     Time now;
+    long long detectEndNs = LatencyTracer::now();
 
     // detect key / button
     InputMask p{ 0 }, h{ 0 }, r{ 0 };
@@ -95,7 +93,7 @@ void InputWrapper::_loop()
     // key config callbacks
     if (_background || IsWindowForeground())
     {
-        if (!_keyboardCallbackMap.empty())
+        if (const auto& keyboardCallbacks = _keyboardCallbacks.snapshot(); !keyboardCallbacks.empty())
         {
             KeyboardMask mask;
             _kbprev = _kbcurr;
@@ -113,14 +111,12 @@ void InputWrapper::_loop()
             }
             if (p.any())
             {
-                std::shared_lock l(_inputMutex, std::defer_lock);
-
-                for (auto& [cbname, callback] : _keyboardCallbackMap)
+                for (auto& [handle, callback] : keyboardCallbacks)
                     callback(mask, now);
             }
         }
 
-        if (!_joystickCallbackMap.empty())
+        if (const auto& joystickCallbacks = _joystickCallbacks.snapshot(); !joystickCallbacks.empty())
         {
             _joyprev = _joycurr;
             for (int device = 0; device < InputMgr::MAX_JOYSTICK_COUNT; ++device)
@@ -178,15 +174,13 @@ void InputWrapper::_loop()
                 }
                 if (p.any())
                 {
-                    std::shared_lock l(_inputMutex, std::defer_lock);
-
-                    for (auto& [cbname, callback] : _joystickCallbackMap)
+                    for (auto& [handle, callback] : joystickCallbacks)
                         callback(mask, device, now);
                 }
             }
         }
     
-        if (!_absaxisCallbackMap.empty())
+        if (const auto& absaxisCallbacks = _absaxisCallbacks.snapshot(); !absaxisCallbacks.empty())
         {
             _joyaxisprev = _joyaxiscurr;
             for (int device = 0; device < InputMgr::MAX_JOYSTICK_COUNT; ++device)
@@ -210,9 +204,7 @@ void InputWrapper::_loop()
                 }
                 if (moved)
                 {
-                    std::shared_lock l(_inputMutex, std::defer_lock);
-
-                    for (auto& [cbname, callback] : _absaxisCallbackMap)
+                    for (auto& [handle, callback] : absaxisCallbacks)
                         callback(mask, device, now);
                 }
             }
@@ -220,150 +212,61 @@ void InputWrapper::_loop()
     }
 
     // regular callbacks
+    bool traceEvent = p != 0 || aDelta[0] != 0.0 || aDelta[1] != 0.0;
+    if (traceEvent)
     {
-        std::shared_lock l(_inputMutex, std::defer_lock);
-        if (l.try_lock())
+        LatencyTracer::beginEvent(loopBeginNs);
+        LatencyTracer::mark(LatencyStage::INPUT_CAPTURE, detectEndNs);
+    }
+    if (traceEvent)
+        LatencyTracer::mark(LatencyStage::CALLBACK_DISPATCH);
+
+    if (p != 0)
+        for (auto& [handle, callback] : _pCallbacks.snapshot())
+            callback(p, now);
+    if (h != 0)
+        for (auto& [handle, callback] : _hCallbacks.snapshot())
+            callback(h, now);
+    if (r != 0)
+        for (auto& [handle, callback] : _rCallbacks.snapshot())
+            callback(r, now);
+
+    if (aDelta[0] != 0.0 || aDelta[1] != 0.0)
+        for (auto& [handle, callback] : _aCallbacks.snapshot())
         {
-            if (p != 0)
-                for (auto& [cbname, callback] : _pCallbackMap)
-                    callback(p, now);
-            if (h != 0)
-                for (auto& [cbname, callback] : _hCallbackMap)
-                    callback(h, now);
-            if (r != 0)
-                for (auto& [cbname, callback] : _rCallbackMap)
-                    callback(r, now);
-            
-            if (aDelta[0] != 0.0 || aDelta[1] != 0.0)
-                for (auto& [cbname, callback] : _aCallbackMap)
-                {
-                    if (mergeInput)
-                        callback(aDelta[0] + aDelta[1], 0.0, now);
-                    else
-                        callback(aDelta[0], aDelta[1], now);
-                }
+            if (mergeInput)
+                callback(aDelta[0] + aDelta[1], 0.0, now);
+            else
+                callback(aDelta[0], aDelta[1], now);
         }
-    }
-}
-
-double InputWrapper::getJoystickAxis(size_t device, Input::Joystick::Type type, size_t index)
-{
-    return ::getJoystickAxis(device, type, index);
-}
-
-double InputWrapper::getScratchAxis(int player)
-{
-    assert(player == 0 || player == 1);
-    return scratchAxisCurr[player];
-}
-
-bool InputWrapper::_register(unsigned type, const std::string& key, INPUTCALLBACK f)
-{
-    if (_pCallbackMap.find(key) != _pCallbackMap.end())
-        return false;
-
-	std::unique_lock _lock(_inputMutex);
-
-    switch (type)
-    {
-    case 0: _pCallbackMap[key] = f; break;
-    case 1: _hCallbackMap[key] = f; break;
-    case 2: _rCallbackMap[key] = f; break;
-    }
-    return true;
-}
 
-bool InputWrapper::_unregister(unsigned type, const std::string& key)
-{
-    if (_pCallbackMap.find(key) == _pCallbackMap.end())
-        return false;
-
-	std::unique_lock _lock(_inputMutex);
-
-    switch (type)
+    if (traceEvent)
     {
-    case 0: _pCallbackMap.erase(key); break;
-    case 1: _hCallbackMap.erase(key); break;
-    case 2: _rCallbackMap.erase(key); break;
+        LatencyTracer::endEvent();
     }
 
-    return true;
+    // callbacks may have (un)registered callbacks; old snapshots are no longer referenced here
+    reclaimCallbackSnapshots();
 }
 
-
-bool InputWrapper::register_a(const std::string& key, AXISPLUSCALLBACK f)
+void InputWrapper::reclaimCallbackSnapshots()
 {
-    if (_aCallbackMap.find(key) != _aCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _aCallbackMap[key] = f;
-    return true;
+    _pCallbacks.reclaim();
+    _hCallbacks.reclaim();
+    _rCallbacks.reclaim();
+    _aCallbacks.reclaim();
+    _keyboardCallbacks.reclaim();
+    _joystickCallbacks.reclaim();
+    _absaxisCallbacks.reclaim();
 }
 
-bool InputWrapper::unregister_a(const std::string& key)
-{
-    if (_aCallbackMap.find(key) == _aCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _aCallbackMap.erase(key);
-    return true;
-}
-
-bool InputWrapper::register_kb(const std::string& key, KEYBOARDCALLBACK f)
-{
-    if (_keyboardCallbackMap.find(key) != _keyboardCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _keyboardCallbackMap[key] = f;
-    return true;
-}
-bool InputWrapper::unregister_kb(const std::string& key)
-{
-    if (_keyboardCallbackMap.find(key) == _keyboardCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _keyboardCallbackMap.erase(key);
-    return true;
-}
-
-bool InputWrapper::register_joy(const std::string& key, JOYSTICKCALLBACK f)
-{
-    if (_joystickCallbackMap.find(key) != _joystickCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _joystickCallbackMap[key] = f;
-    return true;
-}
-bool InputWrapper::unregister_joy(const std::string& key)
+double InputWrapper::getJoystickAxis(size_t device, Input::Joystick::Type type, size_t index)
 {
-    if (_joystickCallbackMap.find(key) == _joystickCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _joystickCallbackMap.erase(key);
-    return true;
+    return ::getJoystickAxis(device, type, index);
 }
 
-bool InputWrapper::register_aa(const std::string& key, ABSAXISCALLBACK f)
-{
-    if (_absaxisCallbackMap.find(key) != _absaxisCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _absaxisCallbackMap[key] = f;
-    return true;
-}
-bool InputWrapper::unregister_aa(const std::string& key)
+double InputWrapper::getScratchAxis(int player)
 {
-    if (_absaxisCallbackMap.find(key) == _absaxisCallbackMap.end())
-        return false;
-
-    std::unique_lock _lock(_inputMutex);
-    _absaxisCallbackMap.erase(key);
-    return true;
+    assert(player == 0 || player == 1);
+    return scratchAxisCurr[player];
 }
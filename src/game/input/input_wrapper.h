@@ -4,6 +4,7 @@
 #include <queue>
 #include <set>
 #include "input_mgr.h"
+#include "input_callback_table.h"
 #include "common/asynclooper.h"
 #include "common/beat.h"
 
@@ -61,8 +62,6 @@ class InputWrapper: public AsyncLooper
 {
 public:
     unsigned release_delay_ms = 5;
-private:
-	std::shared_mutex _inputMutex;
 
 protected:
     std::array<std::pair<long long, bool>, Input::KEY_COUNT> _inputBuffer{ {{0, false}} };
@@ -122,51 +121,66 @@ public:
     void disableCountFPS() { _countFPS = false; }
 
 private:
-    // Callback function maps
-    std::map<const std::string, INPUTCALLBACK> _pCallbackMap;
-    std::map<const std::string, INPUTCALLBACK> _hCallbackMap;
-    std::map<const std::string, INPUTCALLBACK> _rCallbackMap;
-    std::map<const std::string, AXISPLUSCALLBACK> _aCallbackMap;
-private:
-    // Callback registering
-    bool _register(unsigned type, const std::string& key, INPUTCALLBACK);
-    bool _unregister(unsigned type, const std::string& key);
+    // Callback tables. Polling thread dispatches from snapshots without locking;
+    //  registering never waits for the polling thread, unregistering waits out a dispatch in progress.
+    InputCallbackTable<INPUTCALLBACK> _pCallbacks;
+    InputCallbackTable<INPUTCALLBACK> _hCallbacks;
+    InputCallbackTable<INPUTCALLBACK> _rCallbacks;
+    InputCallbackTable<AXISPLUSCALLBACK> _aCallbacks;
+
+    // Free retired snapshots. Only the polling thread may call this, after dispatch
+    void reclaimCallbackSnapshots();
+
+    template <typename Func>
+    InputCallbackHandle _register(InputCallbackTable<Func>& table, const std::string& key, Func f) { return table.add(key, std::move(f)); }
+    template <typename Func, typename Key>
+    bool _unregister(InputCallbackTable<Func>& table, const Key& key) { return table.remove(key); }
+
+    // Callback registering. register_* returns a handle which can be used to unregister later,
+    //  or INVALID_INPUT_CALLBACK (0) if key is already taken
 public:
-    bool register_p(const std::string& key, INPUTCALLBACK f) { return _register(0, key, f); }
-    bool register_h(const std::string& key, INPUTCALLBACK f) { return _register(1, key, f); }
-    bool register_r(const std::string& key, INPUTCALLBACK f) { return _register(2, key, f); }
-    bool unregister_p(const std::string& key) { return _unregister(0, key); }
-    bool unregister_h(const std::string& key) { return _unregister(1, key); }
-    bool unregister_r(const std::string& key) { return _unregister(2, key); }
-    bool register_a(const std::string& key, AXISPLUSCALLBACK f);
-    bool unregister_a(const std::string& key);
+    InputCallbackHandle register_p(const std::string& key, INPUTCALLBACK f) { return _register(_pCallbacks, key, std::move(f)); }
+    InputCallbackHandle register_h(const std::string& key, INPUTCALLBACK f) { return _register(_hCallbacks, key, std::move(f)); }
+    InputCallbackHandle register_r(const std::string& key, INPUTCALLBACK f) { return _register(_rCallbacks, key, std::move(f)); }
+    InputCallbackHandle register_a(const std::string& key, AXISPLUSCALLBACK f) { return _register(_aCallbacks, key, std::move(f)); }
+    bool unregister_p(const std::string& key) { return _unregister(_pCallbacks, key); }
+    bool unregister_h(const std::string& key) { return _unregister(_hCallbacks, key); }
+    bool unregister_r(const std::string& key) { return _unregister(_rCallbacks, key); }
+    bool unregister_a(const std::string& key) { return _unregister(_aCallbacks, key); }
+    bool unregister_p(InputCallbackHandle h) { return _unregister(_pCallbacks, h); }
+    bool unregister_h(InputCallbackHandle h) { return _unregister(_hCallbacks, h); }
+    bool unregister_r(InputCallbackHandle h) { return _unregister(_rCallbacks, h); }
+    bool unregister_a(InputCallbackHandle h) { return _unregister(_aCallbacks, h); }
 
     // Should only used for keyconfig
 protected:
     KeyboardMask _kbprev = 0;
     KeyboardMask _kbcurr = 0;
 private:
-    std::map<const std::string, KEYBOARDCALLBACK> _keyboardCallbackMap;
+    InputCallbackTable<KEYBOARDCALLBACK> _keyboardCallbacks;
 public:
-    bool register_kb(const std::string& key, KEYBOARDCALLBACK f);
-    bool unregister_kb(const std::string& key);
+    InputCallbackHandle register_kb(const std::string& key, KEYBOARDCALLBACK f) { return _register(_keyboardCallbacks, key, std::move(f)); }
+    bool unregister_kb(const std::string& key) { return _unregister(_keyboardCallbacks, key); }
+    bool unregister_kb(InputCallbackHandle h) { return _unregister(_keyboardCallbacks, h); }
 
 protected:
     std::array<JoystickMask, InputMgr::MAX_JOYSTICK_COUNT> _joyprev = { 0 };
     std::array<JoystickMask, InputMgr::MAX_JOYSTICK_COUNT> _joycurr = { 0 };
 private:
-    std::map<const std::string, JOYSTICKCALLBACK> _joystickCallbackMap;
+    InputCallbackTable<JOYSTICKCALLBACK> _joystickCallbacks;
 public:
-    bool register_joy(const std::string& key, JOYSTICKCALLBACK f);
-    bool unregister_joy(const std::string& key);
+    InputCallbackHandle register_joy(const std::string& key, JOYSTICKCALLBACK f) { return _register(_joystickCallbacks, key, std::move(f)); }
+    bool unregister_joy(const std::string& key) { return _unregister(_joystickCallbacks, key); }
+    bool unregister_joy(InputCallbackHandle h) { return _unregister(_joystickCallbacks, h); }
 
 protected:
     std::array<JoystickAxis, InputMgr::MAX_JOYSTICK_COUNT> _joyaxisprev = { 0 };
     std::array<JoystickAxis, InputMgr::MAX_JOYSTICK_COUNT> _joyaxiscurr = { 0 };
 private:
-    std::map<const std::string, ABSAXISCALLBACK> _absaxisCallbackMap;
+    InputCallbackTable<ABSAXISCALLBACK> _absaxisCallbacks;
 public:
-    bool register_aa(const std::string& key, ABSAXISCALLBACK f);
-    bool unregister_aa(const std::string& key);
+    InputCallbackHandle register_aa(const std::string& key, ABSAXISCALLBACK f) { return _register(_absaxisCallbacks, key, std::move(f)); }
+    bool unregister_aa(const std::string& key) { return _unregister(_absaxisCallbacks, key); }
+    bool unregister_aa(InputCallbackHandle h) { return _unregister(_absaxisCallbacks, h); }
 };
 
@@ -8,6 +8,7 @@
 #include "game/chart/chart_types.h"
 #include "config/config_mgr.h"
 #include "game/arena/arena_data.h"
+#include "game/runtime/latency_tracer.h"
 
 using namespace chart;
 
@@ -377,6 +378,8 @@ RulesetBMS::RulesetBMS(std::shared_ptr<ChartFormatBase> format, std::shared_ptr<
 
     _lnJudge.fill(JudgeArea::NOTHING);
 
+    initJudgeTable();
+
     if (_chart)
     {
         for (size_t k = Input::S1L; k <= Input::K2SPDDN; ++k)
@@ -579,34 +582,88 @@ void RulesetBMS::initGaugeParams(PlayModifierGaugeType gauge)
     }
 }
 
+void RulesetBMS::initJudgeTable()
+{
+    // _judgeBoundaryNs[i] is the lowest error that passes boundary i.
+    //  error in [b(i), b(i+1)) maps to judgeBoundaryArea[i+1]
+    const auto& jt = judgeTime[(size_t)_judgeDifficulty];
+    _judgeBoundaryNs =
+    {
+        -jt.KPOOR.hres() + 1,       // error > -KPOOR
+        -jt.BAD.hres(),
+        -jt.GOOD.hres(),
+        -jt.GREAT.hres(),
+        -jt.PERFECT.hres(),
+        0,
+        1,                          // error == 0
+        jt.PERFECT.hres(),
+        jt.GREAT.hres(),
+        jt.GOOD.hres(),
+        jt.BAD.hres(),
+    };
+    _judgeBoundarySorted = std::is_sorted(_judgeBoundaryNs.begin(), _judgeBoundaryNs.end());
+
+    for (auto& lanes : _keyLane)
+        lanes.fill(NoteLaneIndex::_);
+    for (auto& cat : _laneNextExpireNs)
+        cat.fill(LLONG_MIN);
+
+    if (_chart)
+    {
+        // lanes with no notes at all stay invalid; chart never adds notes during play
+        for (size_t k = Input::S1L; k < Input::LANE_COUNT; ++k)
+        {
+            for (auto cat : { NoteLaneCategory::Note, NoteLaneCategory::Mine, NoteLaneCategory::Invs, NoteLaneCategory::LN })
+            {
+                _keyLane[k][(size_t)cat] = _chart->getLaneFromKey(cat, (Input::Pad)k);
+            }
+        }
+    }
+}
+
+void RulesetBMS::setLaneNextExpire(NoteLaneCategory cat, NoteLaneIndex idx, ChartObjectBase::NoteIterator it, long long offsetNs)
+{
+    // Nothing in the lane can expire before the first pending note is due; skip the lane until then.
+    //  Notes are only ever marked expired earlier by hits, so this stays a lower bound.
+    _laneNextExpireNs[(size_t)cat][idx] = _chart->isLastNote(cat, idx, it) ? LLONG_MAX : it->time.hres() + offsetNs;
+}
+
 RulesetBMS::JudgeRes RulesetBMS::_judge(const Note& note, Time time)
 {
+    static const JudgeArea judgeBoundaryArea[] =
+    {
+        JudgeArea::NOTHING,
+        JudgeArea::EARLY_KPOOR,
+        JudgeArea::EARLY_BAD,
+        JudgeArea::EARLY_GOOD,
+        JudgeArea::EARLY_GREAT,
+        JudgeArea::EARLY_PERFECT,
+        JudgeArea::EXACT_PERFECT,
+        JudgeArea::LATE_PERFECT,
+        JudgeArea::LATE_GREAT,
+        JudgeArea::LATE_GOOD,
+        JudgeArea::LATE_BAD,
+        JudgeArea::NOTHING,
+    };
+
     // spot judge area
-    JudgeArea a = JudgeArea::NOTHING;
 	Time error = time - note.time;
-    if (error > -judgeTime[(size_t)_judgeDifficulty].KPOOR)
+    long long e = error.hres();
+    size_t n = 0;
+    if (_judgeBoundarySorted)
+    {
+        // boundaries are ascending: the area is the count of boundaries passed. No branches
+        for (size_t i = 0; i < _judgeBoundaryNs.size(); ++i)
+            n += size_t(e >= _judgeBoundaryNs[i]);
+    }
+    else if (e >= _judgeBoundaryNs[0])
     {
-        if (error < -judgeTime[(size_t)_judgeDifficulty].BAD)
-            a = JudgeArea::EARLY_KPOOR;
-        else if (error < -judgeTime[(size_t)_judgeDifficulty].GOOD)
-            a = JudgeArea::EARLY_BAD;
-        else if (error < -judgeTime[(size_t)_judgeDifficulty].GREAT)
-            a = JudgeArea::EARLY_GOOD;
-        else if (error < -judgeTime[(size_t)_judgeDifficulty].PERFECT)
-            a = JudgeArea::EARLY_GREAT;
-        else if (error < 0)
-            a = JudgeArea::EARLY_PERFECT;
-        else if (error == 0)
-            a = JudgeArea::EXACT_PERFECT;
-        else if (error < judgeTime[(size_t)_judgeDifficulty].PERFECT)
-            a = JudgeArea::LATE_PERFECT;
-        else if (error < judgeTime[(size_t)_judgeDifficulty].GREAT)
-            a = JudgeArea::LATE_GREAT;
-        else if (error < judgeTime[(size_t)_judgeDifficulty].GOOD)
-            a = JudgeArea::LATE_GOOD;
-        else if (error < judgeTime[(size_t)_judgeDifficulty].BAD)
-            a = JudgeArea::LATE_BAD;
+        // undefined difficulty tables; stop at first boundary not passed
+        n = 1;
+        while (n < _judgeBoundaryNs.size() && e >= _judgeBoundaryNs[n])
+            ++n;
     }
+    JudgeArea a = judgeBoundaryArea[n];
 
     // log
     /*
@@ -1156,6 +1213,8 @@ void RulesetBMS::judgeNotePress(Input::Pad k, const Time& t, const Time& rt, int
     {
          judgeNotePress(k, t, rt, slot);
     }
+
+    LatencyTracer::mark(LatencyStage::JUDGE);
 }
 void RulesetBMS::judgeNoteHold(Input::Pad k, const Time& t, const Time& rt, int slot)
 {
@@ -1342,47 +1401,54 @@ void RulesetBMS::update(const Time& t)
 
             NoteLaneIndex idx;
 
-            idx = _chart->getLaneFromKey(NoteLaneCategory::Note, (Input::Pad)k);
-            if (idx != NoteLaneIndex::_)
+            idx = _keyLane[k][(size_t)NoteLaneCategory::Note];
+            if (idx != NoteLaneIndex::_ && rt.hres() >= _laneNextExpireNs[(size_t)NoteLaneCategory::Note][idx])
             {
+                Time hitTime = (!scratch || _judgeScratch) ? judgeTime[(size_t)_judgeDifficulty].BAD : 0;
                 auto itNote = _chart->incomingNote(NoteLaneCategory::Note, idx);
                 while (!_chart->isLastNote(NoteLaneCategory::Note, idx, itNote) && !itNote->expired)
                 {
-                    Time hitTime = (!scratch || _judgeScratch) ? judgeTime[(size_t)_judgeDifficulty].BAD : 0;
-                    if (rt - itNote->time >= hitTime)
+                    // notes in a lane are sorted by time, the rest are not due either
+                    if (rt - itNote->time < hitTime)
+                        break;
+
+                    itNote->expired = true;
+
+                    if (doJudge && (!scratch || _judgeScratch))
                     {
-                        itNote->expired = true;
+                        updateJudge(t, idx, JudgeArea::MISS, slot);
+                        _lastNoteJudge[slot].area = JudgeArea::MISS;
+                        _lastNoteJudge[slot].time = hitTime;
 
-                        if (doJudge && (!scratch || _judgeScratch))
+                        // push replay command
+                        if (gChartContext.started && gPlayContext.replayNew)
                         {
-                            updateJudge(t, idx, JudgeArea::MISS, slot);
-                            _lastNoteJudge[slot].area = JudgeArea::MISS;
-                            _lastNoteJudge[slot].time = hitTime;
-
-                            // push replay command
-                            if (gChartContext.started && gPlayContext.replayNew)
-                            {
-                                long long ms = t.norm() - _startTime.norm();
-                                ReplayChart::Commands cmd;
-                                cmd.ms = ms;
-                                cmd.type = slot == PLAYER_SLOT_PLAYER ? ReplayChart::Commands::Type::JUDGE_LEFT_LATE_4 : ReplayChart::Commands::Type::JUDGE_RIGHT_LATE_4;
-                                gPlayContext.replayNew->commands.push_back(cmd);
-                            }
+                            long long ms = t.norm() - _startTime.norm();
+                            ReplayChart::Commands cmd;
+                            cmd.ms = ms;
+                            cmd.type = slot == PLAYER_SLOT_PLAYER ? ReplayChart::Commands::Type::JUDGE_LEFT_LATE_4 : ReplayChart::Commands::Type::JUDGE_RIGHT_LATE_4;
+                            gPlayContext.replayNew->commands.push_back(cmd);
                         }
-
-                        notesExpired++;
-                        //LOG_DEBUG << "LATE   POOR    "; break;
                     }
+
+                    notesExpired++;
+                    //LOG_DEBUG << "LATE   POOR    "; break;
                     itNote++;
                 }
+                setLaneNextExpire(NoteLaneCategory::Note, idx, itNote, hitTime.hres());
             }
 
-            idx = _chart->getLaneFromKey(NoteLaneCategory::LN, (Input::Pad)k);
-            if (idx != NoteLaneIndex::_)
+            idx = _keyLane[k][(size_t)NoteLaneCategory::LN];
+            if (idx != NoteLaneIndex::_ && rt.hres() >= _laneNextExpireNs[(size_t)NoteLaneCategory::LN][idx])
             {
                 auto itNote = _chart->incomingNote(NoteLaneCategory::LN, idx);
+                auto itPending = itNote;
+                bool hasPending = false;
                 while (!_chart->isLastNote(NoteLaneCategory::LN, idx, itNote) && !itNote->expired)
                 {
+                    if (rt < itNote->time)
+                        break;
+
                     if (!(itNote->flags & Note::LN_TAIL))
                     {
                         if (rt >= itNote->time)
@@ -1435,12 +1501,20 @@ void RulesetBMS::update(const Time& t)
                             }
                         }
                     }
+
+                    // LN heads wait until BAD window passes, tails until the head is released
+                    if (!itNote->expired && !hasPending)
+                    {
+                        itPending = itNote;
+                        hasPending = true;
+                    }
                     itNote++;
                 }
+                setLaneNextExpire(NoteLaneCategory::LN, idx, hasPending ? itPending : itNote, 0);
             }
 
-            idx = _chart->getLaneFromKey(NoteLaneCategory::Invs, (Input::Pad)k);
-            if (idx != NoteLaneIndex::_)
+            idx = _keyLane[k][(size_t)NoteLaneCategory::Invs];
+            if (idx != NoteLaneIndex::_ && rt.hres() >= _laneNextExpireNs[(size_t)NoteLaneCategory::Invs][idx])
             {
                 const Time& hitTime = -judgeTime[(size_t)_judgeDifficulty].BAD;
                 auto itNote = _chart->incomingNote(NoteLaneCategory::Invs, idx);
@@ -1449,10 +1523,11 @@ void RulesetBMS::update(const Time& t)
                     itNote->expired = true;
                     itNote++;
                 }
+                setLaneNextExpire(NoteLaneCategory::Invs, idx, itNote, hitTime.hres());
             }
 
-            idx = _chart->getLaneFromKey(NoteLaneCategory::Mine, (Input::Pad)k);
-            if (idx != NoteLaneIndex::_)
+            idx = _keyLane[k][(size_t)NoteLaneCategory::Mine];
+            if (idx != NoteLaneIndex::_ && rt.hres() >= _laneNextExpireNs[(size_t)NoteLaneCategory::Mine][idx])
             {
                 auto itNote = _chart->incomingNote(NoteLaneCategory::Mine, idx);
                 while (!_chart->isLastNote(NoteLaneCategory::Mine, idx, itNote) && !itNote->expired && rt >= itNote->time)
@@ -1460,6 +1535,7 @@ void RulesetBMS::update(const Time& t)
                     itNote->expired = true;
                     itNote++;
                 }
+                setLaneNextExpire(NoteLaneCategory::Mine, idx, itNote, 0);
             }
         }
     };
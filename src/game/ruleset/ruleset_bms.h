@@ -193,6 +193,12 @@ protected:
 
     std::map<chart::NoteLane, ChartObjectBase::NoteIterator> _noteListIterators;
 
+    // Precomputed by initJudgeTable() on construction
+    std::array<long long, 11> _judgeBoundaryNs{};   // judge window edges of current difficulty, see _judge
+    bool _judgeBoundarySorted = true;
+    std::array<std::array<chart::NoteLaneIndex, 4>, Input::LANE_COUNT> _keyLane;    // [key][category]
+    std::array<std::array<long long, chart::NOTELANEINDEX_COUNT>, 4> _laneNextExpireNs; // [category][lane], see update
+
     std::array<AxisDir, 2>  playerScratchDirection = { 0, 0 };
     std::array<Time, 2>     playerScratchLastUpdate = { TIMER_NEVER, TIMER_NEVER };
     std::array<double, 2>   playerScratchAccumulator = { 0, 0 };
@@ -219,6 +225,8 @@ public:
 protected:
     JudgeRes _judge(const Note& note, Time time);
 private:
+    void initJudgeTable();
+    void setLaneNextExpire(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, ChartObjectBase::NoteIterator it, long long offsetNs);
     void _judgePress(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, HitableNote& note, JudgeRes judge, const Time& t, int slot);
     void _judgeHold(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, HitableNote& note, JudgeRes judge, const Time& t, int slot);
     void _judgeRelease(chart::NoteLaneCategory cat, chart::NoteLaneIndex idx, HitableNote& note, JudgeRes judge, const Time& t, int slot);
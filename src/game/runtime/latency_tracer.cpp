@@ -0,0 +1,125 @@
+#include "latency_tracer.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "common/log.h"
+
+std::array<LatencyTracer::Ring, size_t(LatencyStage::STAGE_COUNT)> LatencyTracer::_rings;
+
+static thread_local long long eventOrigin = 0;
+static thread_local unsigned eventMarkedMask = 0;
+static thread_local bool eventActive = false;
+
+void LatencyTracer::beginEvent(long long originNs)
+{
+    eventOrigin = originNs;
+    eventMarkedMask = 0;
+    eventActive = true;
+}
+
+void LatencyTracer::endEvent()
+{
+    eventActive = false;
+}
+
+bool LatencyTracer::inEvent()
+{
+    return eventActive;
+}
+
+void LatencyTracer::mark(LatencyStage stage)
+{
+    if (!eventActive) return;
+    mark(stage, now());
+}
+
+void LatencyTracer::mark(LatencyStage stage, long long timestampNs)
+{
+    if (!eventActive) return;
+
+    unsigned bit = 1u << unsigned(stage);
+    if (eventMarkedMask & bit) return;
+    eventMarkedMask |= bit;
+
+    Ring& r = _rings[size_t(stage)];
+    size_t idx = r.head.fetch_add(1, std::memory_order_relaxed) & (RING_SIZE - 1);
+    r.samples[idx].store(timestampNs - eventOrigin, std::memory_order_relaxed);
+}
+
+void LatencyTracer::reset()
+{
+    for (auto& r : _rings)
+    {
+        r.head.store(0, std::memory_order_relaxed);
+    }
+}
+
+LatencyTracer::Summary LatencyTracer::getSummary(LatencyStage stage)
+{
+    const Ring& r = _rings[size_t(stage)];
+    size_t count = std::min(r.head.load(std::memory_order_relaxed), RING_SIZE);
+    if (count == 0) return {};
+
+    std::vector<long long> values(count);
+    for (size_t i = 0; i < count; ++i)
+        values[i] = r.samples[i].load(std::memory_order_relaxed);
+
+    Summary s;
+    s.count = count;
+    s.max = *std::max_element(values.begin(), values.end());
+    auto it50 = values.begin() + (count - 1) * 50 / 100;
+    std::nth_element(values.begin(), it50, values.end());
+    s.p50 = *it50;
+    auto it99 = values.begin() + (count - 1) * 99 / 100;
+    std::nth_element(values.begin(), it99, values.end());
+    s.p99 = *it99;
+    return s;
+}
+
+const char* LatencyTracer::getStageName(LatencyStage stage)
+{
+    switch (stage)
+    {
+    case LatencyStage::INPUT_CAPTURE:     return "Input capture";
+    case LatencyStage::CALLBACK_DISPATCH: return "Callback dispatch";
+    case LatencyStage::JUDGE:             return "Judge";
+    case LatencyStage::KEYSOUND_DISPATCH: return "Keysound dispatch";
+    case LatencyStage::DSP_START:         return "DSP start";
+    default:                              return "???";
+    }
+}
+
+bool LatencyTracer::dump(const Path& path)
+{
+    std::ofstream ofs(path, std::ios::trunc);
+    if (!ofs.is_open())
+    {
+        LOG_WARNING << "[Latency] Open " << path.u8string() << " failed";
+        return false;
+    }
+
+    ofs << "# stage, count, p50(us), p99(us), max(us). Time since input poll began" << std::endl;
+    for (size_t i = 0; i < size_t(LatencyStage::STAGE_COUNT); ++i)
+    {
+        auto s = getSummary(LatencyStage(i));
+        ofs << getStageName(LatencyStage(i)) << ", " << s.count << ", "
+            << s.p50 / 1000.0 << ", " << s.p99 / 1000.0 << ", " << s.max / 1000.0 << std::endl;
+    }
+
+    // raw samples, oldest first; same unit as the summary
+    ofs << std::endl << "# raw samples (us), oldest first" << std::endl;
+    for (size_t i = 0; i < size_t(LatencyStage::STAGE_COUNT); ++i)
+    {
+        const Ring& r = _rings[i];
+        size_t head = r.head.load(std::memory_order_relaxed);
+        size_t count = std::min(head, RING_SIZE);
+        ofs << std::endl << "[" << getStageName(LatencyStage(i)) << "]" << std::endl;
+        for (size_t k = head - count; k < head; ++k)
+        {
+            ofs << r.samples[k & (RING_SIZE - 1)].load(std::memory_order_relaxed) / 1000.0 << std::endl;
+        }
+    }
+
+    LOG_INFO << "[Latency] Dumped to " << path.u8string();
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include "common/types.h"
+
+// Stages of an input event on its way to the speakers, in the order they happen.
+enum class LatencyStage
+{
+    INPUT_CAPTURE,      // InputMgr::detect returned
+    CALLBACK_DISPATCH,  // InputWrapper started calling press callbacks
+    JUDGE,              // RulesetBMS::judgeNotePress finished
+    KEYSOUND_DISPATCH,  // SoundMgr::playNoteSample called
+    DSP_START,          // sound driver accepted the channel
+
+    STAGE_COUNT
+};
+
+// Lightweight latency tracer. Always compiled in.
+//  The input thread opens an event with beginEvent() when a key is pressed, then each stage
+//  calls mark() from the same thread. Samples are (stage time - event origin) in ns and are
+//  stored into a fixed ring buffer per stage; writers never lock.
+class LatencyTracer
+{
+public:
+    static constexpr size_t RING_SIZE = 4096;   // must be power of 2
+
+    struct Summary
+    {
+        size_t count = 0;
+        long long p50 = 0;  // ns
+        long long p99 = 0;  // ns
+        long long max = 0;  // ns
+    };
+
+private:
+    struct Ring
+    {
+        std::atomic<size_t> head{ 0 };
+        std::array<std::atomic<long long>, RING_SIZE> samples{};
+    };
+    static std::array<Ring, size_t(LatencyStage::STAGE_COUNT)> _rings;
+
+public:
+    static long long now()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Event scope is thread local. Stages outside of an event are not recorded.
+    static void beginEvent(long long originNs);
+    static void endEvent();
+    static bool inEvent();
+
+    // Records each stage once per event
+    static void mark(LatencyStage stage);
+    static void mark(LatencyStage stage, long long timestampNs);
+
+    static void reset();
+    static Summary getSummary(LatencyStage stage);
+    static const char* getStageName(LatencyStage stage);
+
+    // Write histograms of all stages to a text file. Returns false if the file could not be opened
+    static bool dump(const Path& path);
+};
@@ -24,6 +24,9 @@ SceneBase::SceneBase(SkinType skinType, unsigned rate, bool backgroundInput) :
     {
         _input.setRate(inputPollingRate);
     }
+    _input.setRealtimePriority(ConfigMgr::get('E', cfg::E_LOOPER_REALTIME_PRIORITY, 0));
+    _input.setCPUAffinity(ConfigMgr::get('E', cfg::E_LOOPER_CPU_INPUT, -1));
+    setCPUAffinity(ConfigMgr::get('E', cfg::E_LOOPER_CPU_UPDATE, -1));
 
     // Disable skin caching for now. dst options are changing all the time
     SkinMgr::unload(skinType);
@@ -171,6 +174,9 @@ void SceneBase::update()
 
         // update videos
         TextureVideo::updateAll();
+
+        // upload upcoming BGA pictures when streaming
+        if (gPlayContext.bgaTexture) gPlayContext.bgaTexture->updateStreaming();
     }
 
     // ImGui
@@ -304,6 +310,20 @@ void SceneBase::updateImgui()
                     % State::get(IndexNumber::FPS)
                     % State::get(IndexNumber::INPUT_DETECT_FPS)
                     % State::get(IndexNumber::SCENE_UPDATE_FPS)).str().c_str());
+                auto inputJitter = _input.getJitterStats();
+                auto updateJitter = getJitterStats();
+                ImGui::Text("Late: Input %.3f/%.3fms | Update %.3f/%.3fms",
+                    inputJitter.meanLateNs / 1e6, inputJitter.maxLateNs / 1e6,
+                    updateJitter.meanLateNs / 1e6, updateJitter.maxLateNs / 1e6);
+                for (const auto& task : TickScheduler::getStats())
+                {
+                    ImGui::Text("%s: Run %.3f/%.3fms | Over budget %llu/%llu",
+                        task.tag.c_str(), task.meanRunNs / 1e6, task.maxRunNs / 1e6, task.overruns, task.runs);
+                }
+                auto samples = SoundMgr::getSampleMemoryStats();
+                ImGui::Text("Samples: %.1fMB (Decoded %u / Compressed %u / Streamed %u) | Sound heap %.1fMB",
+                    samples.residentBytes() / 1048576.0, samples.decoded, samples.compressed, samples.streamed,
+                    samples.driverHeapBytes >= 0 ? samples.driverHeapBytes / 1048576.0 : 0.0);
                 ImGui::PopID();
             }
 
@@ -5,6 +5,8 @@
 #include "common/entry/entry_types.h"
 #include <random>
 #include <mutex>
+#include <execution>
+#include <functional>
 #include "game/runtime/i18n.h"
 
 #include <boost/algorithm/string.hpp>
@@ -20,6 +22,7 @@ UpdateContextParams gUpdateContext;
 OverlayContextParams gOverlayContext;
 std::shared_ptr<SongDB> g_pSongDB;
 std::shared_ptr<ScoreDB> g_pScoreDB;
+std::shared_ptr<SongFolderWatcher> g_pSongFolderWatcher;
 
 std::pair<bool, Option::e_lamp_type> getSaveScoreType()
 {
@@ -131,6 +134,461 @@ void pushGraphPoints()
 }
 
 
+static std::shared_ptr<ScoreBase> loadEntryScore(const std::shared_ptr<EntryBase>& entry, std::shared_ptr<ChartFormatBase> pf)
+{
+    if (!pf)
+    {
+        switch (entry->type())
+        {
+        case eEntryType::SONG:
+        case eEntryType::RIVAL_SONG:
+            pf = std::reinterpret_pointer_cast<EntryFolderSong>(entry)->getCurrentChart();
+            break;
+        case eEntryType::CHART:
+        case eEntryType::RIVAL_CHART:
+            pf = std::reinterpret_pointer_cast<EntryChart>(entry)->_file;
+            break;
+        default: break;
+        }
+    }
+
+    if (pf)
+    {
+        // get chart score
+        switch (pf->type())
+        {
+        case eChartFormat::BMS:
+            return g_pScoreDB->getChartScoreBMS(pf->fileHash);
+        default: break;
+        }
+    }
+    else if (entry->type() == eEntryType::COURSE)
+    {
+        return g_pScoreDB->getCourseScoreBMS(entry->md5);
+    }
+    return nullptr;
+}
+
+void SelectEntryList::clear()
+{
+    items.clear();
+    cache.clear();
+    state.clear();
+    barInfos.clear();
+    view.clear();
+    invalidateSort();
+}
+
+void SelectEntryList::reserve(size_t count)
+{
+    items.reserve(count);
+    cache.reserve(count);
+    state.reserve(count);
+    barInfos.reserve(count);
+    view.reserve(count);
+}
+
+void SelectEntryList::push_back(const Entry& entry)
+{
+    view.push_back((uint32_t)items.size());
+    items.push_back({ entry.first, nullptr });
+    cache.push_back({ entry.first, nullptr });
+    state.push_back(LAZY);
+    barInfos.emplace_back();
+    invalidateSort();
+}
+
+void SelectEntryList::pushChart(const std::shared_ptr<EntryBase>& song, const std::shared_ptr<ChartFormatBase>& chart)
+{
+    view.push_back((uint32_t)items.size());
+    items.push_back({ song, chart });
+    cache.emplace_back();
+    state.push_back(LAZY);
+    barInfos.emplace_back();
+    invalidateSort();
+}
+
+Entry& SelectEntryList::materialize(size_t i) const
+{
+    auto& [entry, score] = cache[i];
+    if (entry == nullptr)
+    {
+        const auto& [source, chart] = items[i];
+        entry = std::make_shared<EntryChart>(chart, std::reinterpret_pointer_cast<EntryFolderSong>(source));
+    }
+    if (state[i] == LAZY)
+    {
+        score = loadEntryScore(entry, items[i].chart);
+        state[i] = SCORE_LOADED;
+    }
+    return cache[i];
+}
+
+Entry& SelectEntryList::operator[](size_t idx) const
+{
+    std::unique_lock l(*lazyMutex);
+    return materialize(view[idx]);
+}
+
+Entry& SelectEntryList::at(size_t idx) const
+{
+    if (idx >= view.size())
+        throw std::out_of_range("SelectEntryList::at");
+    return (*this)[idx];
+}
+
+eEntryType SelectEntryList::type(size_t idx) const
+{
+    return item(idx).chart ? eEntryType::CHART : item(idx).source->type();
+}
+
+const HashMD5& SelectEntryList::md5(size_t idx) const
+{
+    return item(idx).chart ? item(idx).chart->fileHash : item(idx).source->md5;
+}
+
+const StringContent& SelectEntryList::name(size_t idx) const
+{
+    return item(idx).chart ? item(idx).chart->title : item(idx).source->_name;
+}
+
+const StringContent& SelectEntryList::name2(size_t idx) const
+{
+    return item(idx).chart ? item(idx).chart->title2 : item(idx).source->_name2;
+}
+
+std::shared_ptr<ChartFormatBase> SelectEntryList::chart(size_t idx) const
+{
+    const auto& [source, chart] = item(idx);
+    if (chart) return chart;
+    switch (source->type())
+    {
+    case eEntryType::SONG:
+    case eEntryType::RIVAL_SONG:
+        return std::reinterpret_pointer_cast<EntryFolderSong>(source)->getChart(0);
+    case eEntryType::CHART:
+    case eEntryType::RIVAL_CHART:
+        return std::reinterpret_pointer_cast<EntryChart>(source)->_file;
+    default:
+        return nullptr;
+    }
+}
+
+const std::shared_ptr<ScoreBase>& SelectEntryList::score(size_t idx) const
+{
+    const size_t i = view[idx];
+    std::unique_lock l(*lazyMutex);
+    if (state[i] == LAZY)
+    {
+        cache[i].second = loadEntryScore(items[i].source, items[i].chart);
+        state[i] = SCORE_LOADED;
+    }
+    return cache[i].second;
+}
+
+size_t SelectEntryList::find(const HashMD5& hash) const
+{
+    for (size_t idx = 0; idx < view.size(); ++idx)
+    {
+        if (md5(idx) == hash)
+            return idx;
+    }
+    return view.size();
+}
+
+void SelectEntryList::setScore(const HashMD5& hash, const std::shared_ptr<ScoreBase>& score)
+{
+    bool changed = false;
+    for (size_t idx = 0; idx < view.size(); ++idx)
+    {
+        // lazy items read the score db when accessed
+        if (state[view[idx]] == SCORE_LOADED && md5(idx) == hash)
+        {
+            cache[view[idx]].second = score;
+            barInfos[view[idx]].reset();
+            changed = true;
+        }
+    }
+    if (changed)
+    {
+        scoreKeysValid = false;
+        sortedViews[size_t(SongListSortType::CLEAR)].clear();
+        sortedViews[size_t(SongListSortType::RATE)].clear();
+    }
+}
+
+static SelectBarInfo makeBarInfo(const std::shared_ptr<EntryBase>& entry, const std::shared_ptr<ScoreBase>& score, bool subtitle)
+{
+    SelectBarInfo info;
+    info.type = entry->type();
+    info.isNew = info.type == eEntryType::NEW_SONG_FOLDER ||
+        entry->_addTime > std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() - State::get(IndexNumber::NEW_ENTRY_SECONDS);
+    info.title = entry->_name;
+
+    std::shared_ptr<ChartFormatBase> pf = nullptr;
+    switch (info.type)
+    {
+    case eEntryType::SONG:
+    case eEntryType::RIVAL_SONG:
+        pf = std::reinterpret_pointer_cast<EntryFolderSong>(entry)->getCurrentChart();
+        break;
+    case eEntryType::CHART:
+    case eEntryType::RIVAL_CHART:
+        pf = std::reinterpret_pointer_cast<EntryChart>(entry)->_file;
+        break;
+    default:
+        break;
+    }
+
+    std::shared_ptr<ScoreBMS> scoreBMS;
+    if (pf != nullptr)
+    {
+        info.hasChart = true;
+        if (pf->type() == eChartFormat::BMS)
+        {
+            const auto bms = std::reinterpret_pointer_cast<const ChartFormatBMSMeta>(pf);
+            info.isBMS = true;
+            info.level = bms->playLevel;
+            info.difficulty = bms->difficulty;
+            if (subtitle)
+            {
+                if (!info.title.empty()) info.title += " ";
+                if (!entry->_name2.empty()) info.title += entry->_name2;
+            }
+            scoreBMS = std::reinterpret_pointer_cast<ScoreBMS>(score);
+        }
+    }
+    else if (info.type == eEntryType::COURSE)
+    {
+        scoreBMS = std::dynamic_pointer_cast<ScoreBMS>(score);
+    }
+
+    if (scoreBMS)
+    {
+        info.hasScore = true;
+        info.lamp = scoreBMS->lamp;
+        info.rivalLamp = scoreBMS->rival_lamp;
+        info.rivalWin = scoreBMS->rival_win;
+        info.rivalRate = scoreBMS->rival_rate;
+    }
+    return info;
+}
+
+const SelectBarInfo& SelectEntryList::barInfo(size_t idx) const
+{
+    const size_t i = view[idx];
+    std::unique_lock l(*lazyMutex);
+    if (barInfos[i] == nullptr)
+    {
+        const auto& [entry, score] = materialize(i);
+        barInfos[i] = std::make_shared<const SelectBarInfo>(makeBarInfo(entry, score, barSubtitle));
+    }
+    return *barInfos[i];
+}
+
+void SelectEntryList::invalidateBarInfo(size_t idx)
+{
+    barInfos[view[idx]].reset();
+}
+
+void SelectEntryList::setBarSubtitle(bool subtitle)
+{
+    if (barSubtitle == subtitle) return;
+    barSubtitle = subtitle;
+    for (auto& info : barInfos)
+        info.reset();
+}
+
+void SelectEntryList::invalidateSort()
+{
+    sortKeys.clear();
+    scoreKeysValid = false;
+    for (auto& v : sortedViews)
+        v.clear();
+}
+
+// Replace each value with its position among the distinct values, so any column compares as uint32
+template <typename T, typename Less = std::less<T>>
+static void denseRank(const std::vector<T>& values, const std::function<void(size_t, uint32_t)>& assign, Less less = Less())
+{
+    std::vector<uint32_t> order(values.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = (uint32_t)i;
+    std::sort(std::execution::par, order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return less(values[a], values[b]); });
+
+    uint32_t rank = 0;
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (i > 0 && less(values[order[i - 1]], values[order[i]]))
+            ++rank;
+        assign(order[i], rank);
+    }
+}
+
+void SelectEntryList::buildSortKeys()
+{
+    const size_t count = items.size();
+    sortKeys.assign(count, {});
+
+    std::vector<const ChartFormatBase*> charts(count, nullptr);
+    std::vector<eEntryType> types(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto& [source, chart] = items[i];
+        types[i] = chart ? eEntryType::CHART : source->type();
+        if (chart)
+            charts[i] = chart.get();
+        else if (types[i] == eEntryType::SONG || types[i] == eEntryType::RIVAL_SONG)
+            charts[i] = std::reinterpret_pointer_cast<EntryFolderSong>(source)->getChart(0).get();     // owned by the song
+        else if (types[i] == eEntryType::CHART || types[i] == eEntryType::RIVAL_CHART)
+            charts[i] = std::reinterpret_pointer_cast<EntryChart>(source)->_file.get();
+
+        sortKeys[i].type = (uint32_t)types[i];
+        sortKeys[i].hasChart = charts[i] != nullptr && (
+            types[i] == eEntryType::SONG || types[i] == eEntryType::RIVAL_SONG ||
+            types[i] == eEntryType::CHART || types[i] == eEntryType::RIVAL_CHART);
+    }
+
+    auto stringColumn = [&](auto getChartString, auto getEntryString)
+    {
+        std::vector<const StringContent*> values(count);
+        for (size_t i = 0; i < count; ++i)
+            values[i] = sortKeys[i].hasChart ? &getChartString(charts[i]) : &getEntryString(items[i].source.get());
+        return values;
+    };
+    auto lessPtr = [](const StringContent* a, const StringContent* b) { return *a < *b; };
+
+    denseRank(stringColumn([](const ChartFormatBase* c) -> const StringContent& { return c->title; },
+                           [](const EntryBase* e) -> const StringContent& { return e->_name; }),
+        [&](size_t i, uint32_t r) { sortKeys[i].title = r; }, lessPtr);
+    denseRank(stringColumn([](const ChartFormatBase* c) -> const StringContent& { return c->title2; },
+                           [](const EntryBase* e) -> const StringContent& { return e->_name2; }),
+        [&](size_t i, uint32_t r) { sortKeys[i].title2 = r; }, lessPtr);
+    denseRank(stringColumn([](const ChartFormatBase* c) -> const StringContent& { return c->version; },
+                           [](const EntryBase* e) -> const StringContent& { return e->_name2; }),
+        [&](size_t i, uint32_t r) { sortKeys[i].version = r; }, lessPtr);
+
+    std::vector<HashMD5> hashes(count);
+    std::vector<double> levels(count, 0.);
+    for (size_t i = 0; i < count; ++i)
+    {
+        hashes[i] = sortKeys[i].hasChart ? charts[i]->folderHash : HashMD5();
+        levels[i] = sortKeys[i].hasChart ? charts[i]->levelEstimated : 0.;
+    }
+    denseRank(hashes, [&](size_t i, uint32_t r) { sortKeys[i].folder = r; });
+    denseRank(levels, [&](size_t i, uint32_t r) { sortKeys[i].level = r; });
+
+    for (size_t i = 0; i < count; ++i)
+        hashes[i] = items[i].source->md5;
+    denseRank(hashes, [&](size_t i, uint32_t r) { sortKeys[i].md5 = r; });
+}
+
+void SelectEntryList::buildScoreKeys()
+{
+    const size_t count = items.size();
+    std::vector<int> lamps(count, (int)ScoreBMS::Lamp::NOPLAY);
+    std::vector<double> rates(count, 0.);
+
+    // BMS chart lamps come from the score columns in one call; records stay lazy
+    std::vector<size_t> bmsItems;
+    std::vector<HashMD5> bmsHashes;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!sortKeys[i].hasChart) continue;
+        if (state[i] == LAZY && items[i].chart && items[i].chart->type() == eChartFormat::BMS)
+        {
+            bmsItems.push_back(i);
+            bmsHashes.push_back(items[i].chart->fileHash);
+            continue;
+        }
+        if (state[i] == LAZY)
+        {
+            cache[i].second = loadEntryScore(items[i].source, items[i].chart);
+            state[i] = SCORE_LOADED;
+        }
+        if (auto pScore = std::dynamic_pointer_cast<ScoreBMS>(cache[i].second); pScore)
+        {
+            lamps[i] = (int)pScore->lamp;
+            rates[i] = pScore->rate;
+        }
+    }
+    if (!bmsItems.empty())
+    {
+        std::vector<ScoreBMS::Lamp> bmsLamps;
+        std::vector<double> bmsRates;
+        g_pScoreDB->getChartLampRateBMS(bmsHashes, bmsLamps, bmsRates);
+        for (size_t k = 0; k < bmsItems.size(); ++k)
+        {
+            lamps[bmsItems[k]] = (int)bmsLamps[k];
+            rates[bmsItems[k]] = bmsRates[k];
+        }
+    }
+
+    denseRank(lamps, [&](size_t i, uint32_t r) { sortKeys[i].lamp = r; });
+    denseRank(rates, [&](size_t i, uint32_t r) { sortKeys[i].rate = r; });
+    scoreKeysValid = true;
+}
+
+void SelectEntryList::sort(SongListSortType sortType)
+{
+    auto& sorted = sortedViews[size_t(sortType)];
+    if (sorted.size() != items.size())
+    {
+        if (sortKeys.size() != items.size())
+            buildSortKeys();
+        if ((sortType == SongListSortType::CLEAR || sortType == SongListSortType::RATE) && !scoreKeysValid)
+            buildScoreKeys();
+
+        // columns from most to least significant; the type is always first.
+        //  Entries with charts sort by chart fields, custom folders by hash, others by name
+        std::vector<uint32_t SortKey::*> chartColumns;
+        switch (sortType)
+        {
+        case SongListSortType::DEFAULT: chartColumns = { &SortKey::folder, &SortKey::level, &SortKey::title, &SortKey::title2, &SortKey::version }; break;
+        case SongListSortType::TITLE:   chartColumns = { &SortKey::title, &SortKey::title2, &SortKey::version }; break;
+        case SongListSortType::LEVEL:   chartColumns = { &SortKey::level, &SortKey::title, &SortKey::title2, &SortKey::version }; break;
+        case SongListSortType::CLEAR:   chartColumns = { &SortKey::lamp, &SortKey::title, &SortKey::title2, &SortKey::version }; break;
+        case SongListSortType::RATE:    chartColumns = { &SortKey::rate, &SortKey::title, &SortKey::title2, &SortKey::version }; break;
+        default: break;
+        }
+        const std::vector<uint32_t SortKey::*> entryColumns = { &SortKey::title, &SortKey::title2, &SortKey::md5 };
+        const std::vector<uint32_t SortKey::*> customFolderColumns = { &SortKey::md5 };
+        const size_t columnCount = std::max(chartColumns.size(), entryColumns.size());
+
+        auto column = [&](const SortKey& k, size_t c) -> uint32_t
+        {
+            const auto& columns = k.hasChart ? chartColumns :
+                k.type == (uint32_t)eEntryType::CUSTOM_FOLDER ? customFolderColumns : entryColumns;
+            return c < columns.size() ? k.*columns[c] : 0;
+        };
+
+        // LSD radix sort: one stable counting pass per column, ranks are below the item count
+        sorted.resize(items.size());
+        for (size_t i = 0; i < sorted.size(); ++i)
+            sorted[i] = (uint32_t)i;
+        std::vector<uint32_t> buffer(sorted.size());
+        std::vector<uint32_t> counts;
+        auto countingPass = [&](auto getKey)
+        {
+            uint32_t maxKey = 0;
+            for (uint32_t i : sorted)
+                maxKey = std::max(maxKey, getKey(sortKeys[i]));
+            counts.assign(size_t(maxKey) + 2, 0);
+            for (uint32_t i : sorted)
+                counts[getKey(sortKeys[i]) + 1]++;
+            for (size_t k = 1; k < counts.size(); ++k)
+                counts[k] += counts[k - 1];
+            for (uint32_t i : sorted)
+                buffer[counts[getKey(sortKeys[i])]++] = i;
+            sorted.swap(buffer);
+        };
+        for (size_t c = columnCount; c > 0; --c)
+            countingPass([&](const SortKey& k) { return column(k, c - 1); });
+        countingPass([](const SortKey& k) { return k.type; });
+    }
+    view = sorted;
+}
+
 void loadSongList()
 {
     HashMD5 currentEntryHash;
@@ -139,10 +597,10 @@ void loadSongList()
     int currentEntryDifficulty = 0;
     if (!gSelectContext.entries.empty())
     {
-        currentEntryHash = gSelectContext.entries.at(gSelectContext.selectedEntryIndex).first->md5;
+        currentEntryHash = gSelectContext.entries.md5(gSelectContext.selectedEntryIndex);
 
-        if (gSelectContext.entries[gSelectContext.selectedEntryIndex].first->type() == eEntryType::CHART ||
-            gSelectContext.entries[gSelectContext.selectedEntryIndex].first->type() == eEntryType::RIVAL_CHART)
+        if (gSelectContext.entries.type(gSelectContext.selectedEntryIndex) == eEntryType::CHART ||
+            gSelectContext.entries.type(gSelectContext.selectedEntryIndex) == eEntryType::RIVAL_CHART)
         {
             auto& en = gSelectContext.entries[gSelectContext.selectedEntryIndex].first;
             auto ps = std::reinterpret_pointer_cast<EntryChart>(en);
@@ -239,24 +697,13 @@ void loadSongList()
                     if (!checkFilterKeys(pBase->gamemode)) continue;
                 }
 
-                switch (f->getChart(idx)->type())
+                switch (pBase->type())
                 {
                 case eChartFormat::BMS:
-                {
-                    auto p = std::reinterpret_pointer_cast<ChartFormatBMSMeta>(f->getChart(idx));
-
-                    // add all charts as individual entries into list.
-                    gSelectContext.entries.push_back({ std::make_shared<EntryChart>(p, f), nullptr });
-                }
-                break;
-
                 case eChartFormat::BMSON:
-                {
-                    auto p = std::reinterpret_pointer_cast<ChartFormatBMSONMeta>(f->getChart(idx));
-                    // add all charts as individual entries into list.
-                    gSelectContext.entries.push_back({ std::make_shared<EntryChart>(p, f), nullptr });
-                }
-                break;
+                    // add all charts as individual entries into list. EntryChart is created when displayed
+                    gSelectContext.entries.pushChart(e, pBase);
+                    break;
 
                 default:
                     break;
@@ -315,12 +762,6 @@ void loadSongList()
         State::set(IndexOption::SELECT_FILTER_KEYS, keys);
     }
 
-    // load score
-    for (size_t idx = 0; idx < gSelectContext.entries.size(); ++idx)
-    {
-        updateEntryScore(idx);
-    }
-
     gSelectContext.selectedEntryIndex = 0;
 
     // look for the exact same entry
@@ -328,14 +769,8 @@ void loadSongList()
     {
         auto findChart = [&](const HashMD5& hash)
         {
-            for (size_t idx = 0; idx < gSelectContext.entries.size(); ++idx)
-            {
-                if (hash == gSelectContext.entries.at(idx).first->md5)
-                {
-                    return idx;
-                }
-            }
-            return (size_t)-1;
+            size_t idx = gSelectContext.entries.find(hash);
+            return idx < gSelectContext.entries.size() ? idx : (size_t)-1;
         };
 
         size_t i = findChart(currentEntryHash);
@@ -410,136 +845,23 @@ void loadSongList()
 void updateEntryScore(size_t idx)
 {
     auto& [entry, score] = gSelectContext.entries[idx];
-
-    std::shared_ptr<ChartFormatBase> pf;
-    switch (entry->type())
-    {
-    case eEntryType::SONG:
-    case eEntryType::RIVAL_SONG:
-        pf = std::reinterpret_pointer_cast<EntryFolderSong>(entry)->getCurrentChart();
-        break;
-    case eEntryType::CHART:
-    case eEntryType::RIVAL_CHART:
-        pf = std::reinterpret_pointer_cast<EntryChart>(entry)->_file;
-        break;
-    default: break;
-    }
-
-    if (pf)
-    {
-        // get chart score
-        switch (pf->type())
-        {
-        case eChartFormat::BMS:
-        {
-            auto pScore = g_pScoreDB->getChartScoreBMS(pf->fileHash);
-            score = pScore;
-        }
-        break;
-        default: break;
-        }
-    }
-    else if (entry->type() == eEntryType::COURSE)
-    {
-        auto ps = std::reinterpret_pointer_cast<EntryCourse>(entry);
-        auto pScore = g_pScoreDB->getCourseScoreBMS(ps->md5);
-        score = pScore;
-    }
+    score = loadEntryScore(entry, nullptr);
+    gSelectContext.entries.invalidateBarInfo(idx);
 }
 
 void sortSongList()
 {
+    auto& entries = gSelectContext.entries;
+
     HashMD5 currentEntryHash;
-    if (!gSelectContext.entries.empty())
-        currentEntryHash = gSelectContext.entries.at(gSelectContext.selectedEntryIndex).first->md5;
+    if (!entries.empty())
+        currentEntryHash = entries.md5(gSelectContext.selectedEntryIndex);
 
-    auto& entries = gSelectContext.entries;
-    std::sort(entries.begin(), entries.end(), [](const Entry& entry1, const Entry& entry2)
-        {
-            auto& lhs = entry1.first;
-            auto& rhs = entry2.first;
-            if (lhs->type() != rhs->type())
-            {
-                return lhs->type() < rhs->type();
-            }
-            else if (lhs->type() == eEntryType::CUSTOM_FOLDER)
-            {
-                return entry1.first->md5 < entry2.first->md5;
-            }
-            else
-            {
-                std::shared_ptr<ChartFormatBase> l, r;
-                if (lhs->type() == eEntryType::SONG || lhs->type() == eEntryType::RIVAL_SONG)
-                {
-                    l = std::reinterpret_pointer_cast<EntryFolderSong>(lhs)->getChart(0);
-                    r = std::reinterpret_pointer_cast<EntryFolderSong>(rhs)->getChart(0);
-                }
-                else if (lhs->type() == eEntryType::CHART || lhs->type() == eEntryType::RIVAL_CHART)
-                {
-                    l = std::reinterpret_pointer_cast<const EntryChart>(lhs)->_file;
-                    r = std::reinterpret_pointer_cast<const EntryChart>(rhs)->_file;
-                }
-                if (l && r)
-                {
-                    switch (gSelectContext.sortType)
-                    {
-                    case SongListSortType::DEFAULT:
-                        if (l->folderHash != r->folderHash) return l->folderHash < r->folderHash;
-                        if (l->levelEstimated != r->levelEstimated) return l->levelEstimated < r->levelEstimated;
-                        if (l->title != r->title) return l->title < r->title;
-                        if (l->title2 != r->title2) return l->title2 < r->title2;
-                        if (l->version != r->version) return l->version < r->version;
-                        break;
-                    case SongListSortType::TITLE:
-                        if (l->title != r->title) return l->title < r->title;
-                        if (l->title2 != r->title2) return l->title2 < r->title2;
-                        if (l->version != r->version) return l->version < r->version;
-                        break;
-                    case SongListSortType::LEVEL:
-                        if (l->levelEstimated != r->levelEstimated) return l->levelEstimated < r->levelEstimated;
-                        if (l->title != r->title) return l->title < r->title;
-                        if (l->title2 != r->title2) return l->title2 < r->title2;
-                        if (l->version != r->version) return l->version < r->version;
-                        break;
-                    case SongListSortType::CLEAR:
-                    {
-                        auto l_lamp = std::dynamic_pointer_cast<ScoreBMS>(entry1.second) ? std::reinterpret_pointer_cast<ScoreBMS>(entry1.second)->lamp : ScoreBMS::Lamp::NOPLAY;
-                        auto r_lamp = std::dynamic_pointer_cast<ScoreBMS>(entry2.second) ? std::reinterpret_pointer_cast<ScoreBMS>(entry2.second)->lamp : ScoreBMS::Lamp::NOPLAY;
-                        if (l_lamp != r_lamp) return l_lamp < r_lamp;
-                        if (l->title != r->title) return l->title < r->title;
-                        if (l->title2 != r->title2) return l->title2 < r->title2;
-                        if (l->version != r->version) return l->version < r->version;
-                        break;
-                    }
-                    case SongListSortType::RATE:
-                    {
-                        auto l_rate = std::dynamic_pointer_cast<ScoreBMS>(entry1.second) ? std::reinterpret_pointer_cast<ScoreBMS>(entry1.second)->rate : 0.;
-                        auto r_rate = std::dynamic_pointer_cast<ScoreBMS>(entry2.second) ? std::reinterpret_pointer_cast<ScoreBMS>(entry2.second)->rate : 0.;
-                        if (l_rate != r_rate) return l_rate < r_rate;
-                        if (l->title != r->title) return l->title < r->title;
-                        if (l->title2 != r->title2) return l->title2 < r->title2;
-                        if (l->version != r->version) return l->version < r->version;
-                        break;
-                    }
-                    }
-                }
-                else
-                {
-                    if (lhs->_name != rhs->_name) return lhs->_name < rhs->_name;
-                    if (lhs->_name2 != rhs->_name2) return lhs->_name2 < rhs->_name2;
-                    if (lhs->md5 != rhs->md5) return lhs->md5 < rhs->md5;
-                }
-                return false;
-            }
-        });
+    entries.sort(gSelectContext.sortType);
 
-    for (size_t idx = 0; idx < gSelectContext.entries.size(); ++idx)
+    if (size_t idx = entries.find(currentEntryHash); idx < entries.size())
     {
-        if (currentEntryHash == gSelectContext.entries.at(idx).first->md5)
-        {
-            gSelectContext.selectedEntryIndex = idx;
-            break;
-        }
+        gSelectContext.selectedEntryIndex = idx;
     }
     if (gSelectContext.selectedEntryIndex >= gSelectContext.entries.size())
     {
@@ -550,68 +872,22 @@ void sortSongList()
 
 void setBarInfo()
 {
-    const EntryList& e = gSelectContext.entries;
+    auto& e = gSelectContext.entries;
     if (e.empty()) return;
 
     const size_t idx = gSelectContext.selectedEntryIndex;
     const size_t cursor = gSelectContext.highlightBarIndex;
     const size_t count = size_t(IndexText::_SELECT_BAR_TITLE_FULL_MAX) - size_t(IndexText::_SELECT_BAR_TITLE_FULL_0) + 1;
-    const bool subtitle = !ConfigMgr::get('P', cfg::P_ONLY_DISPLAY_MAIN_TITLE_ON_BARS, false);
+    e.setBarSubtitle(!ConfigMgr::get('P', cfg::P_ONLY_DISPLAY_MAIN_TITLE_ON_BARS, false));
 
     auto setSingleBarInfo = [&](size_t list_idx, size_t bar_index)
     {
-        auto entry = e[list_idx].first;
-        std::shared_ptr<ChartFormatBase> pf = nullptr;
-        switch (entry->type())
-        {
-        case eEntryType::SONG:
-        case eEntryType::RIVAL_SONG:
-        {
-            auto ps = std::reinterpret_pointer_cast<EntryFolderSong>(entry);
-            pf = ps->getCurrentChart();
-            break;
-        }
-        case eEntryType::CHART:
-        case eEntryType::RIVAL_CHART:
-        {
-            pf = std::reinterpret_pointer_cast<EntryChart>(entry)->_file;
-            break;
-        }
-
-        default:
-            break;
-        }
-
-        if (pf != nullptr)
+        const auto& info = e.barInfo(list_idx);
+        State::set(IndexText(int(IndexText::_SELECT_BAR_TITLE_FULL_0) + bar_index), info.title);
+        if (info.hasChart)
         {
             // chart types. eg. chart, rival_chart
-            switch (pf->type())
-            {
-            case eChartFormat::BMS:
-            {
-                const auto bms = std::reinterpret_pointer_cast<const ChartFormatBMSMeta>(pf);
-                std::string name = entry->_name;
-                if (subtitle)
-                {
-                    if (!name.empty()) name += " ";
-                    if (!entry->_name2.empty()) name += entry->_name2;
-                }
-                State::set(IndexText(int(IndexText::_SELECT_BAR_TITLE_FULL_0) + bar_index), name);
-                State::set(IndexNumber(int(IndexNumber::_SELECT_BAR_LEVEL_0) + bar_index), bms->playLevel);
-
-                break;
-            }
-
-            default:
-                State::set(IndexText(int(IndexText::_SELECT_BAR_TITLE_FULL_0) + bar_index), entry->_name);
-                State::set(IndexNumber(int(IndexNumber::_SELECT_BAR_LEVEL_0) + bar_index), 0);
-                break;
-            }
-        }
-        else
-        {
-            // other types. eg. folder, course, etc
-            State::set(IndexText(int(IndexText::_SELECT_BAR_TITLE_FULL_0) + bar_index), entry->_name);
+            State::set(IndexNumber(int(IndexNumber::_SELECT_BAR_LEVEL_0) + bar_index), info.level);
         }
     };
     int list_idx, bar_index;
@@ -627,7 +903,7 @@ void setBarInfo()
 
 void setEntryInfo()
 {
-    const EntryList& e = gSelectContext.entries;
+    const auto& e = gSelectContext.entries;
     if (e.empty()) return;
 
     const size_t idx = gSelectContext.selectedEntryIndex;
@@ -1267,7 +1543,7 @@ void setPlayModeInfo()
 
 void switchVersion(int difficulty)
 {
-    const EntryList& e = gSelectContext.entries;
+    const auto& e = gSelectContext.entries;
     if (e.empty()) return;
 
     const size_t idx = gSelectContext.selectedEntryIndex;
@@ -1391,7 +1667,7 @@ void setDynamicTextures()
     gChartContext.texBackbmp.setPath("");
     gChartContext.texBanner.setPath("");
 
-    const EntryList& e = gSelectContext.entries;
+    const auto& e = gSelectContext.entries;
     if (e.empty()) return;
 
     const size_t idx = gSelectContext.selectedEntryIndex;
@@ -1,6 +1,9 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <stack>
 #include <shared_mutex>
@@ -14,6 +17,7 @@
 #include "common/entry/entry_folder.h"
 #include "db/db_song.h"
 #include "db/db_score.h"
+#include "db/db_song_watcher.h"
 #include "common/difficultytable/table_bms.h"
 
 inline SceneType gNextScene = SceneType::SELECT;
@@ -128,17 +132,6 @@ void pushGraphPoints();
 typedef std::pair<std::shared_ptr<EntryBase>, std::shared_ptr<ScoreBase>> Entry;
 typedef std::vector<Entry> EntryList;
 
-struct SongListProperties
-{
-    HashMD5 parent;
-    HashMD5 folder;
-    std::string name;       // folder path, search query+result, etc.
-    EntryList dbBrowseEntries;
-    EntryList displayEntries;
-    size_t index;
-    bool ignoreFilters = false;
-};
-
 enum class SongListSortType
 {
     DEFAULT,    // LEVEL
@@ -150,11 +143,123 @@ enum class SongListSortType
     TYPE_COUNT,
 };
 
+// What a select bar shows for one list item. Built on first use and kept until the item's score changes,
+//  so redrawing and scrolling the bars does not walk entries, charts and scores again
+struct SelectBarInfo
+{
+    eEntryType type = eEntryType::UNKNOWN;
+    bool isNew = false;
+    std::string title;          // includes the subtitle unless only main titles are shown on bars
+    bool hasChart = false;
+    bool isBMS = false;
+    int level = 0;
+    int difficulty = 0;
+    bool hasScore = false;      // BMS chart or course score
+    ScoreBMS::Lamp lamp = ScoreBMS::Lamp::NOPLAY;
+    ScoreBMS::Lamp rivalLamp = ScoreBMS::Lamp::NOPLAY;
+    unsigned rivalWin = 3;
+    double rivalRate = 0;
+};
+
+// Displayed list of the select screen.
+//  Charts expanded from song folders are kept as (song, chart) pairs. EntryChart objects and scores are created
+//  on first access, which in practice is only the bars around the cursor; filtering, sorting and lookups
+//  go through the compact accessors and never materialize entries.
+//  Sorting works on dense integer ranks built once per list, and the order of each sort type is cached,
+//  so switching sort types only swaps the index view.
+class SelectEntryList
+{
+private:
+    struct Item
+    {
+        std::shared_ptr<EntryBase> source;          // entry from dbBrowseEntries
+        std::shared_ptr<ChartFormatBase> chart;     // set if the item is one chart of a song folder
+    };
+    enum ItemState : uint8_t
+    {
+        LAZY,
+        SCORE_LOADED,
+    };
+    std::vector<Item> items;                // in insertion order
+    mutable std::vector<Entry> cache;       // entry is nullptr until accessed
+    mutable std::vector<uint8_t> state;
+    std::vector<uint32_t> view;             // display index -> item index
+    mutable std::vector<std::shared_ptr<const SelectBarInfo>> barInfos;    // nullptr until drawn; shared by list copies
+    bool barSubtitle = true;
+
+    // Const accessors fill cache, state and barInfos lazily. They are called under a shared lock of the select context
+    //  from both the scene thread and the main thread, so filling is serialized here. Copies share the mutex
+    std::shared_ptr<std::mutex> lazyMutex = std::make_shared<std::mutex>();
+
+    struct SortKey
+    {
+        uint32_t type = 0;
+        bool hasChart = false;
+        uint32_t folder = 0;
+        uint32_t level = 0;
+        uint32_t title = 0;         // name for entries without chart
+        uint32_t title2 = 0;        // name2 for entries without chart
+        uint32_t version = 0;
+        uint32_t md5 = 0;
+        uint32_t lamp = 0;
+        uint32_t rate = 0;
+    };
+    std::vector<SortKey> sortKeys;
+    bool scoreKeysValid = false;
+    std::array<std::vector<uint32_t>, size_t(SongListSortType::TYPE_COUNT)> sortedViews;
+
+    const Item& item(size_t idx) const { return items[view[idx]]; }
+    Entry& materialize(size_t i) const;     // lazyMutex must be held
+    void invalidateSort();
+    void buildSortKeys();
+    void buildScoreKeys();
+
+public:
+    size_t size() const { return view.size(); }
+    bool empty() const { return view.empty(); }
+    void clear();
+    void reserve(size_t count);
+
+    void push_back(const Entry& entry);
+    void pushChart(const std::shared_ptr<EntryBase>& song, const std::shared_ptr<ChartFormatBase>& chart);
+
+    // creates the entry and loads its score if not done yet
+    Entry& operator[](size_t idx) const;
+    Entry& at(size_t idx) const;
+
+    eEntryType type(size_t idx) const;
+    const HashMD5& md5(size_t idx) const;
+    const StringContent& name(size_t idx) const;
+    const StringContent& name2(size_t idx) const;
+    std::shared_ptr<ChartFormatBase> chart(size_t idx) const;      // chart of song / chart entries, nullptr otherwise
+    const std::shared_ptr<ScoreBase>& score(size_t idx) const;    // loads the score only
+
+    size_t find(const HashMD5& md5) const;     // index of the first match, size() if not found
+    void setScore(const HashMD5& md5, const std::shared_ptr<ScoreBase>& score);
+    void sort(SongListSortType sortType);
+
+    // bar data of the item, built on first access
+    const SelectBarInfo& barInfo(size_t idx) const;
+    void invalidateBarInfo(size_t idx);
+    void setBarSubtitle(bool subtitle);     // drops built bar data if changed
+};
+
+struct SongListProperties
+{
+    HashMD5 parent;
+    HashMD5 folder;
+    std::string name;       // folder path, search query+result, etc.
+    EntryList dbBrowseEntries;
+    SelectEntryList displayEntries;
+    size_t index;
+    bool ignoreFilters = false;
+};
+
 struct SelectContextParams
 {
     std::shared_mutex _mutex;
     std::list<SongListProperties> backtrace;
-    EntryList entries;
+    SelectEntryList entries;
     size_t selectedEntryIndex = 0;     // current selected entry index
     size_t highlightBarIndex = 0;  // highlighted bar index
     bool draggingListSlider = 0;    // is dragging slider
@@ -169,6 +274,8 @@ struct SelectContextParams
     bool optionChangePending = false;
 
     std::vector<DifficultyTableBMS> tables;
+    std::future<std::vector<DifficultyTableBMS>> tablesUpdate;     // warm start: downloaded in background, swapped in by the select scene
+    std::atomic<bool> tablesUpdateCancel{ false };                  // set at exit to abort tablesUpdate
 
     double pitchSpeed = 1.0;
 
@@ -267,5 +374,6 @@ extern UpdateContextParams gUpdateContext;
 extern OverlayContextParams gOverlayContext;
 extern std::shared_ptr<SongDB> g_pSongDB;
 extern std::shared_ptr<ScoreDB> g_pScoreDB;
+extern std::shared_ptr<SongFolderWatcher> g_pSongFolderWatcher;
 
 ////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
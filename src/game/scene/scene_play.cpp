@@ -1,5 +1,7 @@
 #include <cassert>
+#include <execution>
 #include <future>
+#include <numeric>
 #include <set>
 #include <random>
 #include "scene_play.h"
@@ -20,6 +22,7 @@
 #include "game/arena/arena_data.h"
 #include "game/arena/arena_client.h"
 #include "game/arena/arena_host.h"
+#include "game/runtime/latency_tracer.h"
 
 bool ScenePlay::isPlaymodeDP() const
 {
@@ -140,6 +143,8 @@ ScenePlay::ScenePlay(): SceneBase(gPlayContext.mode, 1000, true)
     _type = SceneType::PLAY;
     state = ePlayState::PREPARE;
 
+    LatencyTracer::reset();
+
     assert(!isPlaymodeDP() || !gPlayContext.isBattle);
 
     // 2P inputs => 1P
@@ -769,6 +774,9 @@ bool ScenePlay::createChartObj()
         if (gPlayContext.replayMybest)
             gPlayContext.chartObj[PLAYER_SLOT_MYBEST] = std::make_shared<ChartObjectBMS>(PLAYER_SLOT_MYBEST, bms);
 
+        _bgmScheduleAhead = std::max(0, ConfigMgr::get('A', cfg::A_BGM_SCHEDULE_AHEAD, 300));
+        gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->setBgmLookahead(_bgmScheduleAhead);
+
         if (gPlayContext.isReplay && (!gPlayContext.isBattle || State::get(IndexOption::PLAY_BATTLE_TYPE) == Option::BATTLE_GHOST))
             itReplayCommand = gPlayContext.replay->commands.begin();
 
@@ -1211,6 +1219,7 @@ void ScenePlay::loadChart()
             auto dtor = std::async(std::launch::async, [&]() {
                 SetDebugThreadName("Chart BGA loading thread");
                 gPlayContext.bgaTexture->clear();
+                gPlayContext.bgaTexture->setMemoryBudget((size_t)std::max(16, ConfigMgr::get('V', cfg::V_BGA_MEMORY_BUDGET, 256)) * 1024 * 1024);
 
                 auto _pChart = gChartContext.chart;
                 auto chartDir = gChartContext.chart->getDirectory();
@@ -1227,38 +1236,49 @@ void ScenePlay::loadChart()
                     return;
                 }
 
-                std::list<std::pair<size_t, Path>> mapBgaFiles;
-                auto loadBgaFiles = [&]
+                // Decode in parallel chunks off the main thread, then upload each chunk 8 textures per frame.
+                //  Chunks keep the number of decoded surfaces held in memory bounded
+                std::vector<TextureBmsBga::DecodedBmp> decoded;
+                auto loadBgaFiles = [&](size_t begin, size_t end)
                 {
-                    for (auto& [i, pBmp] : mapBgaFiles)
+                    for (size_t k = begin; k < end; ++k)
                     {
-                        if (pBmp.is_absolute())
-                            gPlayContext.bgaTexture->addBmp(i, pBmp);
-                        else
-                            gPlayContext.bgaTexture->addBmp(i, chartDir / pBmp);
+                        gPlayContext.bgaTexture->addBmp(decoded[k]);
                         ++bmpLoaded;
                     }
                 };
+
+                std::vector<std::pair<size_t, Path>> bgaFiles;
                 for (size_t i = 0; i < _pChart->bgaFiles.size(); ++i)
                 {
-                    if (sceneEnding) return;
                     const auto& bmp = _pChart->bgaFiles[i];
                     if (bmp.empty()) continue;
 
-                    mapBgaFiles.emplace_back(i, fs::u8path(bmp));
+                    Path pBmp = fs::u8path(bmp);
+                    bgaFiles.emplace_back(i, pBmp.is_absolute() ? pBmp : chartDir / pBmp);
+                }
+
+                const size_t chunkSize = 64;
+                for (size_t chunk = 0; chunk < bgaFiles.size() && !sceneEnding; chunk += chunkSize)
+                {
+                    const size_t count = std::min(chunkSize, bgaFiles.size() - chunk);
+                    decoded.assign(count, {});
+                    std::vector<size_t> order(count);
+                    std::iota(order.begin(), order.end(), 0);
+                    std::for_each(std::execution::par, order.begin(), order.end(), [&](size_t k)
+                    {
+                        if (sceneEnding) return;
+                        const auto& [i, pBmp] = bgaFiles[chunk + k];
+                        decoded[k] = TextureBmsBga::decodeBmp(i, pBmp);
+                    });
 
-                    // load 8 bmps each frame
-                    if (mapBgaFiles.size() >= 8)
+                    for (size_t k = 0; k < count && !sceneEnding; k += 8)
                     {
-                        pushAndWaitMainThreadTask<void>(loadBgaFiles);
-                        mapBgaFiles.clear();
+                        pushAndWaitMainThreadTask<void>(std::bind(loadBgaFiles, k, std::min(k + 8, count)));
                     }
                 }
-                if (!sceneEnding)
-                {
-                    loadBgaFiles();
-                    mapBgaFiles.clear();
-                }
+                decoded.clear();
+
                 if (!sceneEnding)
                 {
                     if (bmpLoaded > 0)
@@ -2415,6 +2435,8 @@ void ScenePlay::updateFadeout()
 
         removeInputJudgeCallback();
 
+        LatencyTracer::dump(Path(GAMEDATA_PATH) / "latency.log");
+
         bool cleared = false;
         if (gPlayContext.isBattle)
         {
@@ -2719,14 +2741,28 @@ void ScenePlay::updatePlayTime(const Time& rt)
 void ScenePlay::procCommonNotes()
 {
     assert(gPlayContext.chartObj[PLAYER_SLOT_PLAYER] != nullptr);
-    auto it = gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->noteBgmExpired.begin();
-    size_t max = std::min(_bgmSampleIdxBuf.size(), gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->noteBgmExpired.size());
+    size_t max = 0;
     size_t i = 0;
-    for (; i < max && it != gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->noteBgmExpired.end(); ++i, ++it)
+    if (_bgmScheduleAhead > 0)
+    {
+        // start time is taken from the chart, not from when this tick noticed the note
+        Time playStart(State::get(IndexTimer::PLAY_START));
+        for (auto& note : gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->noteBgmUpcoming)
+        {
+            size_t idx = (unsigned)note.dvalue;
+            SoundMgr::scheduleNoteSample(SoundChannelType::KEY_LEFT, 1, &idx, playStart + note.time);
+        }
+    }
+    else
     {
-        _bgmSampleIdxBuf[i] = (unsigned)it->dvalue;
+        auto it = gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->noteBgmExpired.begin();
+        max = std::min(_bgmSampleIdxBuf.size(), gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->noteBgmExpired.size());
+        for (; i < max && it != gPlayContext.chartObj[PLAYER_SLOT_PLAYER]->noteBgmExpired.end(); ++i, ++it)
+        {
+            _bgmSampleIdxBuf[i] = (unsigned)it->dvalue;
+        }
+        SoundMgr::playNoteSample(SoundChannelType::KEY_LEFT, i, (size_t*)_bgmSampleIdxBuf.data());
     }
-    SoundMgr::playNoteSample(SoundChannelType::KEY_LEFT, i, (size_t*)_bgmSampleIdxBuf.data());
 
     // also play keysound in auto
     if (gPlayContext.isAuto)
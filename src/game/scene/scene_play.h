@@ -112,6 +112,7 @@ protected:
 private:
     std::array<size_t, 128> _bgmSampleIdxBuf{};
     std::array<size_t, 128> _keySampleIdxBuf{};
+    int _bgmScheduleAhead = 0;     // ms; BGM notes are handed to the sound driver this early with their exact start time
 
 private:
 	//std::map<size_t, std::variant<std::monostate, pVideo, pTexture>> _bgaIdxBuf{};
@@ -193,4 +194,5 @@ protected:
     virtual void updateImgui() override;
     void imguiInit();
     void imguiAdjustMenu();
+    void imguiLatencyOverlay();
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "game/runtime/i18n.h"
 #include "imgui.h"
 #include "game/skin/skin_lr2.h"
+#include "game/runtime/latency_tracer.h"
 
 void ScenePlay::updateImgui()
 {
@@ -9,6 +10,11 @@ void ScenePlay::updateImgui()
     if (gNextScene != SceneType::PLAY) return;
 
     imguiAdjustMenu();
+
+    if (showFPS)
+    {
+        imguiLatencyOverlay();
+    }
 }
 
 void ScenePlay::imguiInit()
@@ -182,4 +188,40 @@ void ScenePlay::imguiAdjustMenu()
     {
         imguiShowAdjustMenu = false;
     }
-}
\ No newline at end of file
+}
+void ScenePlay::imguiLatencyOverlay()
+{
+    ImGui::SetNextWindowPos(ImVec2(0, 60), ImGuiCond_Once);
+    ImGui::PushStyleColor(ImGuiCol_WindowBg, { 0.f, 0.f, 0.f, 0.4f });
+    if (ImGui::Begin("##latencyoverlay", NULL, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        if (ImGui::BeginTable("latency", 5, ImGuiTableFlags_SizingFixedFit))
+        {
+            ImGui::TableSetupColumn("Stage");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("p50 (ms)");
+            ImGui::TableSetupColumn("p99 (ms)");
+            ImGui::TableSetupColumn("Max (ms)");
+            ImGui::TableHeadersRow();
+
+            for (size_t i = 0; i < size_t(LatencyStage::STAGE_COUNT); ++i)
+            {
+                auto s = LatencyTracer::getSummary(LatencyStage(i));
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", LatencyTracer::getStageName(LatencyStage(i)));
+                ImGui::TableNextColumn();
+                ImGui::Text("%zu", s.count);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", s.p50 / 1e6);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", s.p99 / 1e6);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", s.max / 1e6);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::End();
+    }
+    ImGui::PopStyleColor();
+}
@@ -11,6 +11,28 @@
 #include "game/runtime/i18n.h"
 #include "git_version.h"
 
+static void logTableUpdateResult(DifficultyTableBMS& t, DifficultyTable::UpdateResult result)
+{
+    const std::string& tableUrl = t.getUrl();
+    switch (result)
+    {
+    case DifficultyTable::UpdateResult::OK:                     LOG_INFO << "[List] Table file update complete: " << t.getFolderPath().u8string(); break;
+    case DifficultyTable::UpdateResult::INTERNAL_ERROR:         LOG_WARNING << "[List] Update table " << tableUrl << " failed: INTERNAL_ERROR";      break;
+    case DifficultyTable::UpdateResult::WEB_PATH_ERROR:         LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_PATH_ERROR";      break;
+    case DifficultyTable::UpdateResult::WEB_CONNECT_ERR:        LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_CONNECT_ERR";     break;
+    case DifficultyTable::UpdateResult::WEB_TIMEOUT:            LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_TIMEOUT";         break;
+    case DifficultyTable::UpdateResult::WEB_PARSE_FAILED:       LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_PARSE_FAILED";    break;
+    case DifficultyTable::UpdateResult::HEADER_PATH_ERROR:      LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_PATH_ERROR";   break;
+    case DifficultyTable::UpdateResult::HEADER_CONNECT_ERR:     LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_CONNECT_ERR";  break;
+    case DifficultyTable::UpdateResult::HEADER_TIMEOUT:         LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_TIMEOUT";      break;
+    case DifficultyTable::UpdateResult::HEADER_PARSE_FAILED:    LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_PARSE_FAILED"; break;
+    case DifficultyTable::UpdateResult::DATA_PATH_ERROR:        LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_PATH_ERROR";     break;
+    case DifficultyTable::UpdateResult::DATA_CONNECT_ERR:       LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_CONNECT_ERR";    break;
+    case DifficultyTable::UpdateResult::DATA_TIMEOUT:           LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_TIMEOUT";        break;
+    case DifficultyTable::UpdateResult::DATA_PARSE_FAILED:      LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_PARSE_FAILED";   break;
+    }
+}
+
 ScenePreSelect::ScenePreSelect(): SceneBase(SkinType::PRE_SELECT, 240)
 {
 	_updateCallback = std::bind(&ScenePreSelect::updateLoadSongs, this);
@@ -41,6 +63,7 @@ ScenePreSelect::ScenePreSelect(): SceneBase(SkinType::PRE_SELECT, 240)
         Path dbPath = Path(GAMEDATA_PATH) / "database";
         if (!fs::exists(dbPath)) fs::create_directories(dbPath);
         g_pSongDB = std::make_shared<SongDB>(dbPath / "song.db");
+        tryWarmStart = true;
 
         std::unique_lock l(gSelectContext._mutex);
         gSelectContext.entries.clear();
@@ -101,13 +124,24 @@ void ScenePreSelect::updateLoadSongs()
                 pathList.push_back(Path(f));
             }
 
-            LOG_INFO << "[List] Refreshing folders...";
-            g_pSongDB->initializeFolders(pathList);
-            LOG_INFO << "[List] Refreshing folders complete.";
+            if (tryWarmStart && g_pSongDB->loadCacheSnapshot(getCatalogSnapshotPath(), pathList))
+            {
+                warmStart = true;
+                LOG_INFO << "[List] Song list cache loaded from snapshot, folders will be checked in background.";
+            }
+            else
+            {
+                LOG_INFO << "[List] Refreshing folders...";
+                g_pSongDB->initializeFolders(pathList);
+                LOG_INFO << "[List] Refreshing folders complete.";
+
+                // before reading the cache, so the snapshot saved at exit matches the db file
+                g_pSongDB->optimize();
 
-            LOG_INFO << "[List] Building song list cache...";
-            g_pSongDB->prepareCache();
-            LOG_INFO << "[List] Building song list cache finished.";
+                LOG_INFO << "[List] Building song list cache...";
+                g_pSongDB->prepareCache();
+                LOG_INFO << "[List] Building song list cache finished.";
+            }
 
             LOG_INFO << "[List] Generating root folders...";
             auto top = g_pSongDB->browse(ROOT_FOLDER_HASH, false);
@@ -128,33 +162,17 @@ void ScenePreSelect::updateLoadSongs()
                     }
                     if (!deleted)
                     {
-                        g_pSongDB->browse(entry->md5, true);
                         rootFolderProp.dbBrowseEntries.push_back({ entry, nullptr });
                     }
                 }
             }
             LOG_INFO << "[List] Added " << rootFolderProp.dbBrowseEntries.size() << " root folders";
 
-            g_pSongDB->optimize();
-
             // NEW SONG
-            LOG_INFO << "[List] Generating NEW SONG folder...";
-            auto newSongList = g_pSongDB->findChartFromTime(ROOT_FOLDER_HASH,
-                std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() - State::get(IndexNumber::NEW_ENTRY_SECONDS));
-            if (!newSongList.empty())
+            if (auto entry = generateNewSongFolder(); entry != nullptr)
             {
-                size_t index = 0;
-                std::shared_ptr<EntryFolderNewSong> entry = std::make_shared<EntryFolderNewSong>("NEW SONGS");
-                for (auto& c : newSongList)
-                {
-                    //std::shared_ptr<EntryFolderSong> f = std::make_shared<EntryFolderSong>(HashMD5((boost::format("%032lu") % index++).str()), "", c->title, c->title2);
-                    //f->pushChart(c);
-                    //entry->pushEntry(f);
-                    entry->pushEntry(std::make_shared<EntryFolderSong>(c));
-                }
-                rootFolderProp.dbBrowseEntries.insert(rootFolderProp.dbBrowseEntries.begin(), {entry, nullptr});
+                rootFolderProp.dbBrowseEntries.insert(rootFolderProp.dbBrowseEntries.begin(), { entry, nullptr });
             }
-            LOG_INFO << "[List] NEW SONG folder has " << newSongList.size() << " entries";
 
             // ARENA
             LOG_INFO << "[List] Generating ARENA folder...";
@@ -212,6 +230,9 @@ void ScenePreSelect::updateLoadTables()
 
             // initialize table list
             auto tableList = ConfigMgr::General()->getTablesUrl();
+            gSelectContext.tables.clear();
+            gSelectContext.tables.reserve(tableList.size());
+            std::vector<DifficultyTableBMS*> tables;
             for (auto& tableUrl : tableList)
             {
                 LOG_INFO << "[List] Add table " << tableUrl;
@@ -220,88 +241,48 @@ void ScenePreSelect::updateLoadTables()
                 gSelectContext.tables.emplace_back();
                 DifficultyTableBMS& t = gSelectContext.tables.back();
                 t.setUrl(tableUrl);
+                tables.push_back(&t);
 
-                auto convertTable = [&](DifficultyTableBMS& t)
+                if (t.loadFromFile())
                 {
-                    std::shared_ptr<EntryFolderTable> tbl = std::make_shared<EntryFolderTable>(t.getName(), "");
-                    size_t index = 0;
-                    for (const auto& lv : t.getLevelList())
+                    LOG_INFO << "[List] Local table file found: " << t.getFolderPath().u8string();
+                }
+            }
+
+            if (warmStart)
+            {
+                // local files are shown first, the select scene swaps in the revalidated tables
+                gSelectContext.tablesUpdateCancel = false;
+                gSelectContext.tablesUpdate = std::async(std::launch::async, [tableList]
                     {
-                        std::string folderName = (boost::format("%s%s") % t.getSymbol() % lv).str();
-                        std::shared_ptr<EntryFolderTable> tblLevel = std::make_shared<EntryFolderTable>(folderName, "");
-                        for (const auto& r : t.getEntryList(lv))
+                        std::vector<DifficultyTableBMS> updated(tableList.size());
+                        std::vector<DifficultyTableBMS*> tables;
+                        for (size_t i = 0; i < tableList.size(); ++i)
                         {
-                            auto charts = g_pSongDB->findChartByHash(r->md5, false);
-                            bool added = false;
-                            for (auto& c : charts)
-                            {
-                                if (fs::exists(c->absolutePath))
-                                {
-                                    //std::shared_ptr<EntryFolderSong> f = std::make_shared<EntryFolderSong>(HashMD5((boost::format("%032lu") % index++).str()), "", c->title, c->title2);
-                                    //f->pushChart(c);
-                                    //tblLevel->pushEntry(f);
-                                    tblLevel->pushEntry(std::make_shared<EntryFolderSong>(c));
-                                    added = true;
-                                    break;
-                                }
-                            }
-                            /*
-                            if (!added)
-                            {
-                                std::shared_ptr<FolderSong> f = std::make_shared<FolderSong>(HashMD5(), "", r->_name, r->_name2);
-                                f->pushChart(c);
-                                tblLevel->pushEntry(f);
-                                added = true;
-                                break;
-                            }
-                            */
+                            updated[i].setUrl(tableList[i]);
+                            updated[i].loadFromFile();
+                            tables.push_back(&updated[i]);
                         }
-                        tbl->pushEntry(tblLevel);
-                    }
-                    return tbl;
-                };
-
-                textHint = (boost::format(i18n::c(i18nText::LOADING_TABLE)) % t.getUrl()).str();
+                        DifficultyTableBMS::updateFromUrl(tables, logTableUpdateResult, &gSelectContext.tablesUpdateCancel);
+                        LOG_INFO << "[List] Background table update complete.";
+                        return updated;
+                    });
+            }
+            else
+            {
+                // revalidate local files and download missing tables, all tables at once
+                textHint = i18n::s(i18nText::DOWNLOADING_TABLE);
                 textHint2 = "";
+                DifficultyTableBMS::updateFromUrl(tables, logTableUpdateResult);
+            }
 
-                if (t.loadFromFile())
-                {
-                    // TODO should re-download the table if outdated
-                    LOG_INFO << "[List] Local table file found: " << t.getFolderPath().u8string();
-                    rootFolderProp.dbBrowseEntries.push_back({ convertTable(t), nullptr });
-                }
-                else
+            // tables that failed to update still show what was loaded from file
+            for (auto pTable : tables)
+            {
+                if (!pTable->getLevelList().empty())
                 {
-                    LOG_INFO << "[List] Local file not found. Downloading... " << t.getFolderPath().u8string();
-                    textHint2 = i18n::s(i18nText::DOWNLOADING_TABLE);
-
-                    t.updateFromUrl([&](DifficultyTable::UpdateResult result)
-                        {
-                            if (result == DifficultyTable::UpdateResult::OK)
-                            {
-                                LOG_INFO << "[List] Table file download complete: " << t.getFolderPath().u8string();
-                                rootFolderProp.dbBrowseEntries.push_back({ convertTable(t), nullptr });
-                            }
-                            else
-                            {
-                                switch (result)
-                                {
-                                case DifficultyTable::UpdateResult::INTERNAL_ERROR:         LOG_WARNING << "[List] Update table " << tableUrl << " failed: INTERNAL_ERROR";      break;
-                                case DifficultyTable::UpdateResult::WEB_PATH_ERROR:         LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_PATH_ERROR";      break;
-                                case DifficultyTable::UpdateResult::WEB_CONNECT_ERR:        LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_CONNECT_ERR";     break;
-                                case DifficultyTable::UpdateResult::WEB_TIMEOUT:            LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_TIMEOUT";         break;
-                                case DifficultyTable::UpdateResult::WEB_PARSE_FAILED:       LOG_WARNING << "[List] Update table " << tableUrl << " failed: WEB_PARSE_FAILED";    break;
-                                case DifficultyTable::UpdateResult::HEADER_PATH_ERROR:      LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_PATH_ERROR";   break;
-                                case DifficultyTable::UpdateResult::HEADER_CONNECT_ERR:     LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_CONNECT_ERR";  break;
-                                case DifficultyTable::UpdateResult::HEADER_TIMEOUT:         LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_TIMEOUT";      break;
-                                case DifficultyTable::UpdateResult::HEADER_PARSE_FAILED:    LOG_WARNING << "[List] Update table " << tableUrl << " failed: HEADER_PARSE_FAILED"; break;
-                                case DifficultyTable::UpdateResult::DATA_PATH_ERROR:        LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_PATH_ERROR";     break;
-                                case DifficultyTable::UpdateResult::DATA_CONNECT_ERR:       LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_CONNECT_ERR";    break;
-                                case DifficultyTable::UpdateResult::DATA_TIMEOUT:           LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_TIMEOUT";        break;
-                                case DifficultyTable::UpdateResult::DATA_PARSE_FAILED:      LOG_WARNING << "[List] Update table " << tableUrl << " failed: DATA_PARSE_FAILED1";  break;
-                                }
-                            }
-                        });
+                    textHint = (boost::format(i18n::c(i18nText::LOADING_TABLE)) % pTable->getUrl()).str();
+                    rootFolderProp.dbBrowseEntries.push_back({ convertTable(*pTable), nullptr });
                 }
             }
 
@@ -432,11 +413,107 @@ void ScenePreSelect::loadFinished()
             maxFPS = 30;
         graphics_set_maxfps(maxFPS);
 
+        if (g_pSongFolderWatcher == nullptr)
+        {
+            // pick up library changes from now on
+            std::vector<Path> pathList;
+            for (auto& f : ConfigMgr::General()->getFoldersPath())
+                pathList.push_back(Path(f));
+            g_pSongFolderWatcher = std::make_shared<SongFolderWatcher>(g_pSongDB, pathList, [] { return gNextScene == SceneType::SELECT; });
+        }
+        if (warmStart)
+        {
+            // the snapshot may miss changes made while the game was closed
+            g_pSongFolderWatcher->rescan();
+        }
+
         gNextScene = SceneType::SELECT;
         loadingFinished = true;
     }
 }
 
+std::shared_ptr<EntryFolderNewSong> ScenePreSelect::generateNewSongFolder()
+{
+    LOG_INFO << "[List] Generating NEW SONG folder...";
+    auto newSongList = g_pSongDB->findChartFromTime(ROOT_FOLDER_HASH,
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count() - State::get(IndexNumber::NEW_ENTRY_SECONDS));
+    LOG_INFO << "[List] NEW SONG folder has " << newSongList.size() << " entries";
+    if (newSongList.empty())
+        return nullptr;
+
+    std::shared_ptr<EntryFolderNewSong> entry = std::make_shared<EntryFolderNewSong>("NEW SONGS");
+    for (auto& c : newSongList)
+    {
+        entry->pushEntry(std::make_shared<EntryFolderSong>(c));
+    }
+    return entry;
+}
+
+std::shared_ptr<EntryFolderTable> ScenePreSelect::convertTable(DifficultyTableBMS& t)
+{
+    // resolve every chart of the table in one pass over the song catalog
+    auto levels = t.getLevelList();
+    std::vector<std::vector<std::shared_ptr<EntryBase>>> levelEntries;
+    std::vector<HashMD5> hashes;
+    for (const auto& lv : levels)
+    {
+        levelEntries.push_back(t.getEntryList(lv));
+        for (const auto& r : levelEntries.back())
+            hashes.push_back(r->md5);
+    }
+    auto charts = g_pSongDB->findFirstChartByHash(hashes);
+
+    std::shared_ptr<EntryFolderTable> tbl = std::make_shared<EntryFolderTable>(t.getName(), "");
+    size_t index = 0;
+    for (size_t l = 0; l < levels.size(); ++l)
+    {
+        std::string folderName = (boost::format("%s%s") % t.getSymbol() % levels[l]).str();
+        std::shared_ptr<EntryFolderTable> tblLevel = std::make_shared<EntryFolderTable>(folderName, "");
+        for (size_t i = 0; i < levelEntries[l].size(); ++i, ++index)
+        {
+            if (charts[index] != nullptr)
+            {
+                tblLevel->pushEntry(std::make_shared<EntryFolderSong>(charts[index]));
+            }
+        }
+        tbl->pushEntry(tblLevel);
+    }
+    return tbl;
+}
+
+Path ScenePreSelect::getCatalogSnapshotPath()
+{
+    return Path(GAMEDATA_PATH) / "database" / "song.snapshot";
+}
+
+void ScenePreSelect::shutdownLibrary()
+{
+    // do not sit out the curl timeouts at exit; a cancelled update is simply dropped
+    if (gSelectContext.tablesUpdate.valid())
+    {
+        gSelectContext.tablesUpdateCancel = true;
+        gSelectContext.tablesUpdate.wait();
+    }
+
+    if (g_pSongDB == nullptr) return;
+
+    if (g_pSongFolderWatcher != nullptr)
+    {
+        // a finished import is kept, an interrupted one leaves the catalog older than the db.
+        //  The watcher owns the loading pool while importing; stop it before touching the pool here
+        g_pSongFolderWatcher->stop();
+        g_pSongDB->stopLoading();
+        SongFolderWatcher::Summary summary;
+        g_pSongFolderWatcher->applyUpdate(summary);
+        g_pSongFolderWatcher.reset();
+    }
+
+    std::vector<Path> pathList;
+    for (auto& f : ConfigMgr::General()->getFoldersPath())
+        pathList.push_back(Path(f));
+    g_pSongDB->saveCacheSnapshot(getCatalogSnapshotPath(), pathList);
+}
+
 
 void ScenePreSelect::updateImgui()
 {
@@ -2,6 +2,8 @@
 #include "scene.h"
 #include "scene_context.h"
 
+class EntryFolderTable;
+
 class ScenePreSelect: public SceneBase
 {
 public:
@@ -35,6 +37,20 @@ protected:
     std::string textHint2;
     bool loadingFinished = false;
 
+    // warm start: the song catalog comes from the snapshot saved at last exit and tables from local files.
+    //  Folders and tables are checked in background after the select scene is shown
+    bool tryWarmStart = false;
+    bool warmStart = false;
+
 public:
     bool isLoadingFinished() const;
+
+public:
+    // root list parts, also rebuilt by the select scene after a background update
+    static std::shared_ptr<EntryFolderNewSong> generateNewSongFolder();
+    static std::shared_ptr<EntryFolderTable> convertTable(DifficultyTableBMS& t);
+
+    static Path getCatalogSnapshotPath();
+    // stops background library work and saves the catalog snapshot for the next launch
+    static void shutdownLibrary();
 };
\ No newline at end of file
@@ -390,13 +390,7 @@ void SceneResult::updateFadeout()
             // update entry list score
             for (auto& frame : gSelectContext.backtrace)
             {
-                for (auto& [entry, scoreOld] : frame.displayEntries)
-                {
-                    if (entry->md5 == gChartContext.hash)
-                    {
-                        scoreOld = pScore;
-                    }
-                }
+                frame.displayEntries.setScore(gChartContext.hash, pScore);
             }
         }
         
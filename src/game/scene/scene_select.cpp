@@ -12,6 +12,7 @@
 
 #include "game/sound/sound_mgr.h"
 #include "game/sound/sound_sample.h"
+#include "game/sound/sound_preview.h"
 
 #include "config/config_mgr.h"
 
@@ -339,6 +340,18 @@ void config_fx()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Holds background imports back during a manual refresh. Waiting for a running one may take a while
+static std::unique_lock<std::mutex> pauseSongFolderWatcher()
+{
+    if (!g_pSongFolderWatcher) return {};
+    if (g_pSongFolderWatcher->isImporting())
+    {
+        LOG_INFO << "[List] Waiting for background import to finish";
+        State::set(IndexText::_OVERLAY_TOPLEFT2, i18n::s(i18nText::PLEASE_WAIT));
+    }
+    return g_pSongFolderWatcher->pause();
+}
+
 std::shared_ptr<SceneCustomize> SceneSelect::_virtualSceneCustomize = nullptr;
 
 SceneSelect::SceneSelect() : SceneBase(SkinType::MUSIC_SELECT, 250)
@@ -525,6 +538,11 @@ void SceneSelect::_updateAsync()
 
     _updateCallback();
 
+    if (g_pSongFolderWatcher && !refreshingSongList)
+    {
+        updateLibraryChanges();
+    }
+
     if (gSelectContext.optionChangePending)
     {
         gSelectContext.optionChangePending = false;
@@ -1360,6 +1378,7 @@ void SceneSelect::inputGamePressSelect(InputMask& input, const Time& t)
                 LOG_INFO << "[List] Refreshing folder " << path.u8string();
                 State::set(IndexText::_OVERLAY_TOPLEFT, (boost::format(i18n::c(i18nText::REFRESH_FOLDER)) % path.u8string()).str());
 
+                auto pauseWatcher = pauseSongFolderWatcher();
                 g_pSongDB->resetAddSummary();
                 int count = g_pSongDB->addSubFolder(path, gSelectContext.backtrace.front().parent);
                 g_pSongDB->waitLoadingFinish();
@@ -1435,6 +1454,7 @@ void SceneSelect::inputGamePressSelect(InputMask& input, const Time& t)
             assert(_virtualSceneLoadSongs == nullptr);
             if (_virtualSceneLoadSongs == nullptr)
             {
+                auto pauseWatcher = pauseSongFolderWatcher();
                 _virtualSceneLoadSongs = std::make_shared<ScenePreSelect>();
                 _virtualSceneLoadSongs->loopStart();
                 while (!_virtualSceneLoadSongs->isLoadingFinished())
@@ -2707,6 +2727,99 @@ void SceneSelect::resetJukeboxText()
         State::set(IndexText::EDIT_JUKEBOX_NAME, gSelectContext.backtrace.front().name);
 }
 
+void SceneSelect::updateLibraryChanges()
+{
+    // the main thread skips bar updates while the list is locked, only lock if there is something to apply
+    bool tablesReady = gSelectContext.tablesUpdate.valid() && gSelectContext.tablesUpdate.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    if (!tablesReady && !g_pSongFolderWatcher->hasUpdate())
+        return;
+
+    std::unique_lock<std::shared_mutex> u(gSelectContext._mutex);
+
+    // warm start: tables revalidated in background
+    bool rootChanged = false;
+    if (tablesReady)
+    {
+        gSelectContext.tables = gSelectContext.tablesUpdate.get();
+        rootChanged = true;
+    }
+
+    SongFolderWatcher::Summary summary;
+    bool catalogChanged = g_pSongFolderWatcher->applyUpdate(summary);
+    if (!catalogChanged && !rootChanged)
+        return;
+
+    if (summary.added || summary.updated || summary.deleted)
+    {
+        std::string path = summary.folders.front().u8string();
+        if (summary.folders.size() > 1)
+            path += (boost::format(" (+%d)") % (summary.folders.size() - 1)).str();
+        createNotification((boost::format(i18n::c(i18nText::REFRESH_FOLDER_DETAIL)) % path % summary.added % summary.updated % summary.deleted).str());
+    }
+
+    bool frontChanged = false;
+    if ((rootChanged || summary.rescanned) && !gSelectContext.backtrace.empty())
+    {
+        // NEW SONG and tables are resolved against the catalog again; folders, ARENA and courses are kept
+        auto& root = gSelectContext.backtrace.back();
+        EntryList entries;
+        if (auto newSong = ScenePreSelect::generateNewSongFolder(); newSong != nullptr)
+            entries.push_back({ newSong, nullptr });
+        for (auto& e : root.dbBrowseEntries)
+        {
+            if (e.first->type() == eEntryType::NEW_SONG_FOLDER || e.first->type() == eEntryType::COURSE_FOLDER ||
+                std::dynamic_pointer_cast<EntryFolderTable>(e.first) != nullptr)
+                continue;
+            entries.push_back(e);
+        }
+        for (auto& t : gSelectContext.tables)
+        {
+            if (!t.getLevelList().empty())
+                entries.push_back({ ScenePreSelect::convertTable(t), nullptr });
+        }
+        for (auto& e : root.dbBrowseEntries)
+        {
+            if (e.first->type() == eEntryType::COURSE_FOLDER)
+                entries.push_back(e);
+        }
+        root.dbBrowseEntries = std::move(entries);
+
+        if (&root == &gSelectContext.backtrace.front())
+            frontChanged = true;
+    }
+
+    // re-browse the folders on the way; song entries are rebuilt from the new catalog.
+    //  Searches and custom folders are not db folders and keep their entries
+    for (auto& prop : gSelectContext.backtrace)
+    {
+        if (!catalogChanged || prop.folder == ROOT_FOLDER_HASH) continue;
+
+        auto top = g_pSongDB->browse(prop.folder, false);
+        if (!top || top->empty()) continue;
+
+        prop.dbBrowseEntries.clear();
+        for (size_t i = 0; i < top->getContentsCount(); ++i)
+            prop.dbBrowseEntries.push_back({ top->getEntry(i), nullptr });
+
+        if (&prop == &gSelectContext.backtrace.front())
+            frontChanged = true;
+    }
+    if (!frontChanged)
+        return;
+
+    // keeps the selected entry if it is still there
+    loadSongList();
+    sortSongList();
+    if (gSelectContext.entries.empty())
+        gSelectContext.selectedEntryIndex = 0;
+    else if (gSelectContext.selectedEntryIndex >= gSelectContext.entries.size())
+        gSelectContext.selectedEntryIndex = gSelectContext.entries.size() - 1;
+
+    setBarInfo();
+    setEntryInfo();
+    setDynamicTextures();
+}
+
 void SceneSelect::searchSong(const std::string& text)
 {
     LOG_DEBUG << "Search: " << text;
@@ -2766,7 +2879,7 @@ void SceneSelect::searchSong(const std::string& text)
 
 void SceneSelect::updatePreview()
 {
-    const EntryList& e = gSelectContext.entries;
+    const auto& e = gSelectContext.entries;
     if (e.empty()) return;
 
     bool previewDedicated = ConfigMgr::get('P', cfg::P_PREVIEW_DEDICATED, false);
@@ -2856,9 +2969,6 @@ void SceneSelect::updatePreview()
             previewChartTmp = previewChart;
         }
 
-        previewStandalone = false;
-        previewStandaloneLength = 0;
-
         // load chart object from Chart object
         switch (previewChartTmp->type())
         {
@@ -2866,45 +2976,45 @@ void SceneSelect::updatePreview()
         {
             auto bms = std::reinterpret_pointer_cast<ChartFormatBMS>(previewChartTmp);
 
+            SoftwareMixer::PCMPtr pcm;
             if (previewDedicated)
             {
+                pcm = SoundPreview::findCached(bms->fileHash, true);
+
                 // check if #PREVIEW is valid
                 for (auto& [key, val] : bms->extraCommands)
                 {
+                    if (pcm != nullptr) break;
                     if (strEqual(key, "PREVIEW", true) && !val.empty())
                     {
                         Path pWav = fs::u8path(val);
                         if (!pWav.is_absolute())
                             pWav = bms->getDirectory() / pWav;
-                        if (SoundMgr::loadNoteSample(pWav, 0) == 0)
-                            previewStandalone = true;
-
+                        pcm = SoundPreview::loadFile(bms->fileHash, pWav);
                         break;
                     }
                 }
                 // check if preview(*).ogg is valid
-                if (!previewStandalone)
+                if (pcm == nullptr)
                 {
                     for (auto& f : fs::directory_iterator(bms->getDirectory()))
                     {
                         if (strEqual(f.path().filename().u8string().substr(0, 7), "preview", true))
                         {
-                            Path pWav = f.path();
-                            if (SoundMgr::loadNoteSample(pWav, 0) == 0)
-                            {
-                                previewStandalone = true;
+                            pcm = SoundPreview::loadFile(bms->fileHash, f.path());
+                            if (pcm != nullptr)
                                 break;
-                            }
                         }
                     }
                 }
             }
 
-            if (previewStandalone)
+            if (pcm != nullptr)
             {
                 LOG_DEBUG << "[Select] Preview dedicated";
 
                 std::unique_lock l(previewMutex);
+                previewPCM = pcm;
                 previewState = PREVIEW_LOADED;
             }
             else if (previewDirect)
@@ -2914,63 +3024,38 @@ void SceneSelect::updatePreview()
                 {
                     std::unique_lock l(previewMutex);
                     previewState = PREVIEW_LOAD;
+                    previewPCM = SoundPreview::findCached(bms->fileHash, false);
+                    if (previewPCM != nullptr)
+                    {
+                        previewState = PREVIEW_LOADED;
+                        break;
+                    }
                 }
 
-                gChartContext.isSampleLoaded = false;
-
+                // render the opening of the chart into one buffer; the note sample slots are left alone
                 std::thread([&, bms] {
-                    unsigned bars = bms->lastBarIdx;
-                    auto previewChartObjTmp = std::make_shared<ChartObjectBMS>(PLAYER_SLOT_PLAYER, bms);
-                    auto previewRulesetTmp = std::make_shared<RulesetBMSAuto>(bms, previewChartObjTmp,
-                        PlayModifierGaugeType::NORMAL, bms->gamemode, RulesetBMS::JudgeDifficulty::VERYHARD, 0.2, RulesetBMS::PlaySide::RIVAL);
-
-                    // load samples
-                    SoundMgr::freeNoteSamples();
-                    auto chartDir = bms->getDirectory();
+                    auto isCancelled = [&]
+                    {
+                        std::shared_lock l(previewMutex);
+                        return sceneEnding || previewState != PREVIEW_LOAD || bms != previewChart;
+                    };
+                    auto pcmTmp = SoundPreview::renderChart(bms, isCancelled);
 
-                    int wavTotal = 0;
-                    for (const auto& it : bms->wavFiles)
+                    std::unique_lock l(previewMutex);
+                    if (sceneEnding || previewState != PREVIEW_LOAD)
                     {
-                        if (!it.empty()) ++wavTotal;
+                        LOG_DEBUG << "[Select] Preview loading interrupted";
                     }
-                    if (wavTotal != 0)
+                    else if (bms == previewChart && pcmTmp != nullptr)
                     {
-                        for (size_t i = 0; i < bms->wavFiles.size(); ++i)
-                        {
-                            const auto& wav = bms->wavFiles[i];
-                            if (wav.empty()) continue;
-
-                            Path pWav = fs::u8path(wav);
-                            if (pWav.is_absolute())
-                                SoundMgr::loadNoteSample(pWav, i);
-                            else
-                                SoundMgr::loadNoteSample((chartDir / pWav), i);
-
-                            std::shared_lock l(previewMutex);
-                            if (sceneEnding || previewState != PREVIEW_LOAD)
-                            {
-                                LOG_DEBUG << "[Select] Preview loading interrupted";
-                                return;
-                            }
-                        }
-
-                        gChartContext.isSampleLoaded = true;
-
-                        {
-                            std::unique_lock l(previewMutex);
-                            if (bms == previewChart)
-                            {
-                                LOG_DEBUG << "[Select] Preview loading finished";
-                                previewChartObj = previewChartObjTmp;
-                                previewRuleset = previewRulesetTmp;
-                                previewState = PREVIEW_LOADED;
-                            }
-                            else
-                            {
-                                LOG_DEBUG << "[Select] Preview chart has changed, stop";
-                                previewState = PREVIEW_FINISH;
-                            }
-                        }
+                        LOG_DEBUG << "[Select] Preview loading finished";
+                        previewPCM = pcmTmp;
+                        previewState = PREVIEW_LOADED;
+                    }
+                    else
+                    {
+                        LOG_DEBUG << "[Select] Preview chart has changed, stop";
+                        previewState = PREVIEW_FINISH;
                     }
                     }).detach();
             }
@@ -2994,109 +3079,33 @@ void SceneSelect::updatePreview()
 
     case PREVIEW_LOADED:
     {
-        if (previewStandalone)
-        {
-            std::unique_lock l(previewMutex);
-
-            LOG_DEBUG << "[Select] Preview start";
-
-            previewStartTime = 0;
-            previewStandaloneLength = SoundMgr::getNoteSampleLength(0);
-
-            SoundMgr::setSysVolume(0.1, 200);
-            previewState = PREVIEW_PLAY;
-        }
-        else if (gChartContext.isSampleLoaded)
+        std::unique_lock l(previewMutex);
+        if (previewPCM != nullptr && SoundMgr::playPreview(previewPCM, SoundPreview::SAMPLE_RATE) == 0)
         {
-            std::unique_lock l(previewMutex);
-
             LOG_DEBUG << "[Select] Preview start";
 
-            // start from beginning. It's difficult to seek a chart for playback due to lengthy BGM samples...
-            previewStartTime = Time() - previewChartObj->getLeadInTime();
-            previewEndTime = 0;
-            previewRuleset->setStartTime(previewStartTime);
+            previewStartTime = Time();
+            previewLength = SoundPreview::getLength(previewPCM);
 
             SoundMgr::setSysVolume(0.1, 200);
             previewState = PREVIEW_PLAY;
         }
         else
         {
-            std::unique_lock l(previewMutex);
             previewState = PREVIEW_FINISH;
         }
-
         break;
     }
 
     case PREVIEW_PLAY:
     {
         std::unique_lock l(previewMutex);
-
-        if (previewStandalone)
-        {
-            if (previewStartTime == 0)
-            {
-                previewStartTime = Time();
-
-                size_t idx = 0;
-                SoundMgr::playNoteSample(SoundChannelType::KEY_LEFT, 1, &idx);
-            }
-            else if ((Time() - previewStartTime).norm() > previewStandaloneLength)
-            {
-                LOG_DEBUG << "[Select] Preview finished";
-
-                previewState = PREVIEW_FINISH;
-                SoundMgr::setSysVolume(1.0, 400);
-            }
-        }
-        else
+        if ((Time() - previewStartTime).norm() > previewLength)
         {
-            auto t = Time();
-            auto rt = t - previewStartTime;
-            previewChartObj->update(rt);
-            previewRuleset->update(t);
-
-            // play BGM samples
-            auto it = previewChartObj->noteBgmExpired.begin();
-            size_t max = std::min(_bgmSampleIdxBuf.size(), previewChartObj->noteBgmExpired.size());
-            size_t i = 0;
-            for (; i < max && it != previewChartObj->noteBgmExpired.end(); ++i, ++it)
-            {
-                // BGM
-                _bgmSampleIdxBuf[i] = (unsigned)it->dvalue;
-            }
-            SoundMgr::playNoteSample(SoundChannelType::KEY_LEFT, i, (size_t*)_bgmSampleIdxBuf.data());
+            LOG_DEBUG << "[Select] Preview finished";
 
-            // play KEY samples
-            i = 0;
-            auto it2 = previewChartObj->noteExpired.begin();
-            size_t max2 = std::min(_keySampleIdxBuf.size(), max + previewChartObj->noteExpired.size());
-            while (i < max2 && it2 != previewChartObj->noteExpired.end())
-            {
-                if ((it2->flags & ~(Note::SCRATCH | Note::KEY_6_7)) == 0)
-                {
-                    _keySampleIdxBuf[i] = (unsigned)it2->dvalue;
-                    ++i;
-                }
-                ++it2;
-            }
-            SoundMgr::playNoteSample(SoundChannelType::KEY_LEFT, i, (size_t*)_keySampleIdxBuf.data());
-
-            if (previewRuleset->isFinished())
-            {
-                if (previewEndTime == 0)
-                {
-                    previewEndTime = t;
-                }
-                else if ((t - previewEndTime).norm() > 1000)
-                {
-                    LOG_DEBUG << "[Select] Preview finished";
-
-                    previewState = PREVIEW_FINISH;
-                    SoundMgr::setSysVolume(1.0, 400);
-                }
-            }
+            previewState = PREVIEW_FINISH;
+            SoundMgr::setSysVolume(1.0, 400);
         }
         break;
     }
@@ -3115,8 +3124,9 @@ void SceneSelect::postStopPreview()
         LOG_DEBUG << "[Select] Preview stop";
     }
 
-    SoundMgr::stopNoteSamples();
+    SoundMgr::stopPreview();
     SoundMgr::setSysVolume(1.0, 400);
+    previewPCM.reset();
     previewState = PREVIEW_NONE;
 }
 
@@ -8,6 +8,7 @@
 #include "scene.h"
 #include "scene_context.h"
 #include "scene_pre_select.h"
+#include "game/sound/sound_mixer.h"
 
 enum class eSelectState
 {
@@ -48,15 +49,10 @@ private:
         PREVIEW_PLAY,
         PREVIEW_FINISH,
     } previewState = PREVIEW_NONE;
-    bool previewStandalone = false; // true if chart has a preview sound track
-    long long previewStandaloneLength = 0;
     std::shared_ptr<ChartFormatBase> previewChart = nullptr;
-    std::shared_ptr<ChartObjectBase> previewChartObj = nullptr;
-    std::shared_ptr<RulesetBase> previewRuleset = nullptr;
+    SoftwareMixer::PCMPtr previewPCM = nullptr;   // dedicated preview track or rendered chart opening
+    long long previewLength = 0;
     Time previewStartTime;
-    Time previewEndTime;
-    std::array<size_t, 128> _bgmSampleIdxBuf{};
-    std::array<size_t, 128> _keySampleIdxBuf{};
 
     // virtual Customize scene, customize option toggle in select scene support
     static std::shared_ptr<SceneCustomize> _virtualSceneCustomize;
@@ -136,6 +132,7 @@ protected:
     virtual void stopTextEdit(bool modify) override;
     void resetJukeboxText();
     void searchSong(const std::string& text);
+    void updateLibraryChanges();
 
 protected:
     void updatePreview();
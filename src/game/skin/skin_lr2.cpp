@@ -727,6 +727,8 @@ Path SkinLR2::getCustomizePath(StringContentView input)
 
         // Or, randomly choose a file
         auto ls = findFiles(path);
+        if (ls.empty())
+            ls = findDxaFiles(path);
         if (ls.empty())
         {
             return Path();
@@ -866,27 +868,34 @@ int SkinLR2::LR2FONT()
 
         findAndExtractDXA(path);
 
-        if (!fs::is_regular_file(path))
+        // copy the whole file into ram, once for all
+        std::stringstream lr2font;
+        DXArchiveSegment dxaEntry;
+        if (fs::is_regular_file(path))
         {
-            LR2FontNameMap[fontNameKey] = nullptr;
-            LOG_DEBUG << "[Skin] " << csvLineNumber << ": LR2FONT file not found: " << path.u8string();
-            return 1;
+            std::ifstream ifsFile(path, std::ios::binary);
+            if (ifsFile.fail())
+            {
+                LOG_DEBUG << "[Skin] " << csvLineNumber << ": LR2FONT file open failed: " << path.u8string();
+                return 1;
+            }
+            lr2font << ifsFile.rdbuf();
+            lr2font.sync();
+            ifsFile.close();
         }
-
-        std::ifstream ifsFile(path, std::ios::binary);
-        if (ifsFile.fail())
+        else if (findDxaEntry(path, dxaEntry))
+        {
+            if (dxaEntry.data)
+                lr2font.write((const char*)&*dxaEntry.data, dxaEntry.size);
+        }
+        else
         {
-            LOG_DEBUG << "[Skin] " << csvLineNumber << ": LR2FONT file open failed: " << path.u8string();
+            LR2FontNameMap[fontNameKey] = nullptr;
+            LOG_DEBUG << "[Skin] " << csvLineNumber << ": LR2FONT file not found: " << path.u8string();
             return 1;
         }
 
-        // copy the whole file into ram, once for all
-        std::stringstream lr2font;
-        lr2font << ifsFile.rdbuf();
-        lr2font.sync();
-        ifsFile.close();
-
-        auto encoding = getFileEncoding(path);
+        auto encoding = getFileEncoding(lr2font);
 
         auto pf = std::make_shared<LR2Font>();
 
@@ -3661,6 +3670,9 @@ SkinLR2::~SkinLR2()
 {
     stopSpriteVideoPlayback();
 
+    for (auto& dxa : mountedDxa)
+        unmountDxa(dxa);
+
     switch (info.mode)
     {
     case SkinType::PLAY5:
@@ -4283,11 +4295,15 @@ void SkinLR2::findAndExtractDXA(const Path& path)
             // find dxa file
             Path dxa = folder / PathFromUTF8(archiveName);
 
-            // extract dxa
+            // mount dxa; its files are served from memory instead of being written next to the skin
             if (std::filesystem::is_regular_file(dxa))
             {
-                LOG_DEBUG << "[Skin] Extract dxa file: " << fs::absolute(dxa).u8string();
-                extractDxaToFile(dxa);
+                if (mountedDxa.count(dxa) == 0)
+                {
+                    LOG_DEBUG << "[Skin] Mount dxa file: " << fs::absolute(dxa).u8string();
+                    if (mountDxa(dxa))
+                        mountedDxa.insert(dxa);
+                }
                 break;
             }
         } while (folderStr.length() >= lr2skinFolderStr.length() && folderStr.substr(0, lr2skinFolderStr.length()) == lr2skinFolderStr);
@@ -4,6 +4,7 @@
 #include <filesystem>
 #include <bitset>
 #include <map>
+#include <set>
 #include <functional>
 #include <stack>
 #include "common/types.h"
@@ -1412,6 +1413,7 @@ protected:
     bool loadCSV(Path p);
     void postLoad();
     void findAndExtractDXA(const Path& path);
+    std::set<Path> mountedDxa;      // unmounted in destructor
 
 protected:
     static constexpr size_t BAR_ENTRY_SPRITE_COUNT = 32;
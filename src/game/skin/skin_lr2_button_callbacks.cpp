@@ -307,8 +307,8 @@ void select_sort_type(int plus)
     }
 
     {
+        // list contents do not depend on the sort type; reuse the list and its cached orders
         std::unique_lock l(gSelectContext._mutex);
-        loadSongList();
         sortSongList();
         setBarInfo();
         setEntryInfo();
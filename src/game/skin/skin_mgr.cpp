@@ -2,6 +2,7 @@
 #include "game/skin/skin_lr2.h"
 #include "config/config_mgr.h"
 #include "common/utils.h"
+#include "game/graphics/dxa.h"
 
 SkinMgr SkinMgr::_inst;
 
@@ -130,4 +131,5 @@ void SkinMgr::clean()
 	{
 		unload(e);
 	}
+	unmountAllDxa();
 }
\ No newline at end of file
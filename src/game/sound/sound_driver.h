@@ -1,8 +1,11 @@
 #pragma once
 #include <array>
+#include <atomic>
 #include <string>
 #include "common/asynclooper.h"
+#include "common/beat.h"
 #include "fmod.hpp"
+#include "sound_mixer.h"
 
 typedef std::size_t size_t;
 
@@ -48,12 +51,72 @@ enum class SoundChannelType
 
 constexpr int DriverIDUnknownASIO = -10;
 
+enum class SampleStorage
+{
+    DECODED,        // PCM in memory
+    COMPRESSED,     // encoded data in memory, decoded while playing
+    STREAM,         // read from file while playing
+};
+
+struct SampleMemoryStats
+{
+    size_t decodedBytes = 0;
+    size_t compressedBytes = 0;
+    size_t streamBytes = 0;         // stream buffers only
+    unsigned decoded = 0;
+    unsigned compressed = 0;
+    unsigned streamed = 0;
+    long long driverHeapBytes = -1;   // everything the sound library allocated, if it reports it
+
+    size_t residentBytes() const { return decodedBytes + compressedBytes + streamBytes; }
+};
+
+// Maps wall clock time onto a mixer clock (sample frames), which is only observed in whole mixer blocks.
+//  Keeps the upper envelope of (clock - rate * time): jumps up right away, drifts down slowly, so
+//  the estimate sits at block starts and still follows device clock drift.
+class SoundClockEstimator
+{
+private:
+    // sampled by the sound thread, read by whoever schedules
+    std::atomic<double> _rate{ 0.0 };     // clock ticks per second
+    std::atomic<double> _offset{ 0.0 };
+    std::atomic<bool> _valid{ false };
+
+public:
+    void reset(double rate)
+    {
+        _rate.store(rate, std::memory_order_relaxed);
+        _valid.store(false, std::memory_order_release);
+    }
+    bool isValid() const { return _valid.load(std::memory_order_acquire); }
+
+    void sample(long long timeNs, unsigned long long clock)
+    {
+        double s = double(clock) - _rate.load(std::memory_order_relaxed) * (timeNs * 1e-9);
+        double offset = _offset.load(std::memory_order_relaxed);
+        if (!isValid() || s > offset)
+        {
+            _offset.store(s, std::memory_order_relaxed);
+            _valid.store(true, std::memory_order_release);
+        }
+        else
+        {
+            _offset.store(offset + (s - offset) * 0.001, std::memory_order_relaxed);
+        }
+    }
+
+    long long toClock(long long timeNs) const
+    {
+        return (long long)(_offset.load(std::memory_order_relaxed) + _rate.load(std::memory_order_relaxed) * (timeNs * 1e-9));
+    }
+};
+
 class SoundDriver: public AsyncLooper
 {
     friend class SoundMgr;
 
 public:
-    SoundDriver(std::function<void()> update) : AsyncLooper("Sound Driver", update, 1000, true) {}
+    SoundDriver(std::function<void()> update) : AsyncLooper("Sound Driver", update, 1000, true) { setAllowPool(false); }
     virtual ~SoundDriver() = default;
 
 public:
@@ -64,6 +127,9 @@ public:
 public:
     virtual int loadNoteSample(const Path& path, size_t index) = 0;
     virtual void playNoteSample(SoundChannelType ch, size_t count, size_t index[]) = 0;
+    // Start at wall clock time t (same clock as Time()). Past times start immediately.
+    //  The time is converted to the mixer clock, so the start does not depend on when this is called
+    virtual void scheduleNoteSample(SoundChannelType ch, size_t count, size_t index[], const Time& t) = 0;
     virtual void stopNoteSamples() = 0;
     virtual void freeNoteSamples() = 0;
     virtual long long getNoteSampleLength(size_t index) = 0;  // in ms
@@ -71,6 +137,15 @@ public:
     virtual void playSysSample(SoundChannelType ch, size_t index) = 0;
     virtual void stopSysSamples() = 0;
     virtual void freeSysSamples() = 0;
+    // Note and system samples currently loaded
+    virtual SampleMemoryStats getSampleMemoryStats() = 0;
+
+public:
+    // Decode a file into stereo float PCM at sampleRate, at most maxFrames if nonzero. Does not touch the sample slots
+    virtual int decodeSample(const Path& path, unsigned sampleRate, SoftwareMixer::PCMPtr& out, size_t maxFrames = 0) = 0;
+    // Play a pre-rendered buffer on the note channels, replacing the previous one
+    virtual int playPreview(SoftwareMixer::PCMPtr pcm, unsigned sampleRate) = 0;
+    virtual void stopPreview() = 0;
 
 public:
     virtual void setSysVolume(float v, int gradientTime = 0) = 0;
@@ -3,9 +3,13 @@
 #include "sound_fmod.h"
 #include "fmod_errors.h"
 #include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 #include "common/utils.h"
 #include "config/config_mgr.h"
+#include "game/runtime/latency_tracer.h"
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -14,6 +18,14 @@
 
 SoundDriverFMOD::SoundDriverFMOD(): SoundDriver(std::bind(&SoundDriverFMOD::update, this))
 {
+    paramCommands = std::make_unique<ParamSlot[]>(PARAM_QUEUE_SIZE);
+    for (size_t i = 0; i < PARAM_QUEUE_SIZE; ++i)
+        paramCommands[i].seq.store(i, std::memory_order_relaxed);
+
+    setRealtimePriority(ConfigMgr::get('E', cfg::E_LOOPER_REALTIME_PRIORITY, 0));
+    setCPUAffinity(ConfigMgr::get('E', cfg::E_LOOPER_CPU_SOUND, -1));
+    sampleMemoryBudget = (size_t)std::max(0, ConfigMgr::get('A', cfg::A_SAMPLE_MEMORY_BUDGET, 512)) * 1024 * 1024;
+
     // load device
     int driver = -1;
     FMOD_OUTPUTTYPE outputType = FMOD_OUTPUTTYPE_AUTODETECT;
@@ -171,7 +183,7 @@ SoundDriverFMOD::SoundDriverFMOD(): SoundDriver(std::bind(&SoundDriverFMOD::upda
         ConfigMgr::set('A', cfg::A_BUFLEN, int(bufferLen));
         ConfigMgr::set('A', cfg::A_BUFCOUNT, buffers);
 
-        //setAsyncIO();
+        setAsyncIO(ConfigMgr::get('A', cfg::A_ASYNC_IO, false));
     }
 
     volume[SampleChannel::MASTER] = 1.0f;
@@ -179,6 +191,7 @@ SoundDriverFMOD::SoundDriverFMOD(): SoundDriver(std::bind(&SoundDriverFMOD::upda
     volume[SampleChannel::BGM] = 1.0f;
 
     createChannelGroups();
+    resetDSPClock();
 }
 
 void SoundDriverFMOD::createChannelGroups()
@@ -262,103 +275,22 @@ void SoundDriverFMOD::createChannelGroups()
         channelGroup[e]->addDSP(7, EQFilter[0][e]);
         channelGroup[e]->addDSP(8, EQFilter[1][e]);
     }
-
-    for (SoundChannelType e = SoundChannelType::BGM_SYS; e != SoundChannelType::TYPE_COUNT; ++(*(int*)(&e)))
-    {
-        FMOD::ChannelGroup* pcg = nullptr;
-        char name[16];
-        sprintf(name, "CHG_%d", (int)e);
-        initRet = fmodSystem->createChannelGroup(name, &pcg);
-        if (initRet != FMOD_OK)
-        {
-            LOG_ERROR << "Create channel group " << (int)e << " Failed: " << FMOD_ErrorString((FMOD_RESULT)initRet);
-            return;
-        }
-        channelGroup[e] = std::shared_ptr<FMOD::ChannelGroup>(pcg, [](FMOD::ChannelGroup* p) { p->release(); });
-    }
-
-    for (int c = 0; c < 3; ++c)
-    {
-        // create dummy dsp
-        for (SoundChannelType e = SoundChannelType::BGM_SYS; e != SoundChannelType::TYPE_COUNT; ++(*(int*)(&e)))
-        {
-            fmodSystem->createDSPByType(FMOD_DSP_TYPE_MIXER, &DSPMaster[c][e]);
-            DSPMaster[c][e]->setBypass(true);
-        }
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_MIXER, &DSPBgm[c][SoundChannelType::BGM_NOTE]);
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_MIXER, &DSPBgm[c][SoundChannelType::BGM_SYS]);
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_MIXER, &DSPKey[c][SoundChannelType::KEY_SYS]);
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_MIXER, &DSPKey[c][SoundChannelType::KEY_LEFT]);
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_MIXER, &DSPKey[c][SoundChannelType::KEY_RIGHT]);
-        DSPBgm[c][SoundChannelType::BGM_NOTE]->setBypass(true);
-        DSPBgm[c][SoundChannelType::BGM_SYS]->setBypass(true);
-        DSPKey[c][SoundChannelType::KEY_SYS]->setBypass(true);
-        DSPKey[c][SoundChannelType::KEY_LEFT]->setBypass(true);
-        DSPKey[c][SoundChannelType::KEY_RIGHT]->setBypass(true);
-
-        channelGroup[SoundChannelType::BGM_NOTE]->addDSP(c * 2 + 0, DSPMaster[c][SoundChannelType::BGM_NOTE]);
-        channelGroup[SoundChannelType::BGM_NOTE]->addDSP(c * 2 + 1, DSPBgm[c][SoundChannelType::BGM_NOTE]);
-        channelGroup[SoundChannelType::BGM_SYS]->addDSP(c * 2 + 0, DSPMaster[c][SoundChannelType::BGM_SYS]);
-        channelGroup[SoundChannelType::BGM_SYS]->addDSP(c * 2 + 1, DSPBgm[c][SoundChannelType::BGM_SYS]);
-        channelGroup[SoundChannelType::KEY_SYS]->addDSP(c * 2 + 0, DSPMaster[c][SoundChannelType::KEY_SYS]);
-        channelGroup[SoundChannelType::KEY_SYS]->addDSP(c * 2 + 1, DSPKey[c][SoundChannelType::KEY_SYS]);
-        channelGroup[SoundChannelType::KEY_LEFT]->addDSP(c * 2 + 0, DSPMaster[c][SoundChannelType::KEY_LEFT]);
-        channelGroup[SoundChannelType::KEY_LEFT]->addDSP(c * 2 + 1, DSPKey[c][SoundChannelType::KEY_LEFT]);
-        channelGroup[SoundChannelType::KEY_RIGHT]->addDSP(c * 2 + 0, DSPMaster[c][SoundChannelType::KEY_RIGHT]);
-        channelGroup[SoundChannelType::KEY_RIGHT]->addDSP(c * 2 + 1, DSPKey[c][SoundChannelType::KEY_RIGHT]);
-    }
-
-    // create PITCHSHIFT dsp
-    for (SoundChannelType e = SoundChannelType::BGM_SYS; e != SoundChannelType::TYPE_COUNT; ++(*(int*)(&e)))
-    {
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_PITCHSHIFT, &PitchShiftFilter[e]);
-        PitchShiftFilter[e]->setParameterFloat(FMOD_DSP_PITCHSHIFT_FFTSIZE, 512.f);
-        channelGroup[e]->addDSP(6, PitchShiftFilter[e]);
-    }
-
-    // create MULTIBAND_EQ dsp
-    for (SoundChannelType e = SoundChannelType::BGM_SYS; e != SoundChannelType::TYPE_COUNT; ++(*(int*)(&e)))
-    {
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_MULTIBAND_EQ, &EQFilter[0][e]);
-        fmodSystem->createDSPByType(FMOD_DSP_TYPE_MULTIBAND_EQ, &EQFilter[1][e]);
-        EQFilter[0][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_A_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[0][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_B_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[0][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_C_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[0][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_D_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[0][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_E_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[0][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_A_FREQUENCY, 62.5f);
-        EQFilter[0][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_B_FREQUENCY, 160.f);
-        EQFilter[0][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_C_FREQUENCY, 400.f);
-        EQFilter[0][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_D_FREQUENCY, 1000.f);
-        EQFilter[0][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_E_FREQUENCY, 2500.f);
-        EQFilter[1][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_A_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[1][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_B_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[1][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_C_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[1][e]->setParameterInt(FMOD_DSP_MULTIBAND_EQ_D_FILTER, FMOD_DSP_MULTIBAND_EQ_FILTER_PEAKING);
-        EQFilter[1][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_A_FREQUENCY, 1000.f);
-        EQFilter[1][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_B_FREQUENCY, 2500.f);
-        EQFilter[1][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_C_FREQUENCY, 6250.f);
-        EQFilter[1][e]->setParameterFloat(FMOD_DSP_MULTIBAND_EQ_D_FREQUENCY, 16000.f);
-        channelGroup[e]->addDSP(7, EQFilter[0][e]);
-        channelGroup[e]->addDSP(8, EQFilter[1][e]);
-    }
-
 }
 
 SoundDriverFMOD::~SoundDriverFMOD()
 {
-    bLoading = false;
-    if (tLoadSampleThread.joinable())
-        tLoadSampleThread.join();
-
     // release before system release
+    stopPreview();
     freeNoteSamples();
     freeSysSamples();
-    channelGroup.clear();
+    channelGroup.fill(nullptr);
 
     if (initRet == FMOD_OK && fmodSystem != nullptr)
         fmodSystem->release();
 
+    // files are closed by now
+    FmodAsyncIO::stop();
+
     LOG_DEBUG << "FMOD System released.";
 }
 
@@ -517,13 +449,10 @@ int SoundDriverFMOD::setDevice(size_t index)
     fmodSystem = nullptr;
 
     // release old system
-    bLoading = false;
-    if (tLoadSampleThread.joinable())
-        tLoadSampleThread.join();
-
+    stopPreview();
     freeNoteSamples();
     freeSysSamples();
-    channelGroup.clear();
+    channelGroup.fill(nullptr);
 
     if (pOldSystem != nullptr)
     {
@@ -580,19 +509,33 @@ int SoundDriverFMOD::setDevice(size_t index)
         return 1;
     }
 
+    if (asyncIO)
+    {
+        applyFileSystem(pSystem);
+    }
+
     // Recreate samples
     for (auto& s : sysSamples)
     {
         if (!s.path.empty())
         {
-            pSystem->createSound(s.path.c_str(), s.flags, 0, &s.objptr);
+            if (pSystem->createSound(s.path.c_str(), s.flags, 0, &s.objptr) == FMOD_OK)
+            {
+                s.bytes = measureSample(s.path, s.objptr, s.storage);
+                addResident(s);
+            }
         }
     }
     for (auto& s : noteSamples)
     {
         if (!s.path.empty())
         {
-            pSystem->createSound(s.path.c_str(), s.flags, 0, &s.objptr);
+            if (pSystem->createSound(s.path.c_str(), s.flags, 0, &s.objptr) == FMOD_OK)
+            {
+                s.bytes = measureSample(s.path, s.objptr, s.storage);
+                noteSampleBytes += s.bytes;
+                addResident(s);
+            }
         }
     }
 
@@ -644,10 +587,9 @@ int SoundDriverFMOD::setDevice(size_t index)
     }
 
     createChannelGroups();
+    resetDSPClock();
 
-    setVolume(SampleChannel::MASTER, volume[SampleChannel::MASTER]);
-    setVolume(SampleChannel::KEY, volume[SampleChannel::KEY]);
-    setVolume(SampleChannel::BGM, volume[SampleChannel::BGM]);
+    applyGroupVolumes();
 
     return 0;
 }
@@ -663,9 +605,22 @@ std::pair<int, int> SoundDriverFMOD::getDSPBufferSize()
 
 int SoundDriverFMOD::setAsyncIO(bool async)
 {
+    asyncIO = async;
     if (async)
     {
-        fmodSystem->setFileSystem(
+        FmodAsyncIO::start();
+    }
+    // when turning off, files already opened through the callbacks may still be read.
+    //  Workers are kept until the driver is destroyed
+    return fmodSystem ? applyFileSystem(fmodSystem) : 0;
+}
+
+int SoundDriverFMOD::applyFileSystem(FMOD::System* pSystem)
+{
+    FMOD_RESULT res;
+    if (asyncIO)
+    {
+        res = pSystem->setFileSystem(
             FmodCallbackFileOpen,
             FmodCallbackFileClose,
             nullptr,
@@ -678,74 +633,177 @@ int SoundDriverFMOD::setAsyncIO(bool async)
     else
     {
         // Fallback
-        fmodSystem->setFileSystem(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, -1);
+        res = pSystem->setFileSystem(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, -1);
+    }
+    if (res != FMOD_OK)
+    {
+        LOG_WARNING << "[FMOD] Set file system failed: " << FMOD_ErrorString(res);
+        return 1;
     }
     return 0;
 }
 
-/*
-FMOD_ASYNCREADINFO parameters: 
-    void *      handle;     R
-    unsigned    offset;     R
-    unsigned    sizebytes;  R
-    int         priority;   R
-    void *      buffer;     RW
-    unsigned    bytesread;  RW
-    FMOD_RESULT result;     RW
-    void *      userdata;
-*/
-void SoundDriverFMOD::loadSampleThread()
+static const std::list<std::string> wavExtensionList =
+{
+    ".wav",
+    ".ogg",
+    ".flac",    // lmao
+};
+
+FMOD_RESULT SoundDriverFMOD::createNoteSound(const std::string& path, SoundSample& sample)
 {
-    while (bLoading)
+    int flags = FMOD_LOOP_OFF | FMOD_UNIQUE;
+    SampleStorage storage = SampleStorage::DECODED;
+
+    std::error_code ec;
+    Path filePath = fs::u8path(path);
+    size_t fileBytes = (size_t)fs::file_size(filePath, ec);
+
+    // small files skip the probe, but still count against the budget with a size estimate
+    size_t estimatedBytes = fileBytes;
+    if (!ec && toLower(filePath.extension().u8string()) != ".wav")
+        estimatedBytes = fileBytes * SAMPLE_COMPRESSED_RATIO_ESTIMATE;
+    if (!ec && (fileBytes >= SAMPLE_PROBE_MIN_FILE_BYTES || noteSampleBytes.load() + estimatedBytes > sampleMemoryBudget))
     {
-        if (!asyncSampleLoadQueue.empty())
+        // Open the header only to get length and codec, then pick how to keep the sample
+        FMOD::Sound* probe = nullptr;
+        if (fmodSystem->createSound(path.c_str(), FMOD_OPENONLY | FMOD_LOOP_OFF, 0, &probe) == FMOD_OK)
         {
-            LOCK_QUEUE;
-            auto& info = asyncSampleLoadQueue.front();
-            asyncSampleLoadQueue.pop();
-
-            FILE* pFile = (FILE*)info->handle;
-            info->buffer = std::malloc(info->bytesread * sizeof(char));
-            if (info->buffer == NULL) return;
-            size_t sizeread = fread((void*)info->buffer, sizeof(char), (unsigned)info->bytesread, pFile);
-            if (sizeread < info->bytesread)
+            FMOD_SOUND_TYPE type = FMOD_SOUND_TYPE_UNKNOWN;
+            unsigned lengthMs = 0;
+            unsigned pcmBytes = 0;
+            probe->getFormat(&type, nullptr, nullptr, nullptr);
+            probe->getLength(&lengthMs, FMOD_TIMEUNIT_MS);
+            probe->getLength(&pcmBytes, FMOD_TIMEUNIT_PCMBYTES);
+            probe->release();
+
+            double seconds = lengthMs / 1000.0;
+            bool fits = noteSampleBytes.load() + pcmBytes <= sampleMemoryBudget;
+            bool compressible = false;
+            switch (type)
             {
-                info->bytesread = (unsigned)sizeread;
-                info->done(info, FMOD_ERR_FILE_EOF);
+            case FMOD_SOUND_TYPE_OGGVORBIS:
+            case FMOD_SOUND_TYPE_MPEG:
+            case FMOD_SOUND_TYPE_FADPCM:
+            case FMOD_SOUND_TYPE_OPUS:
+                compressible = true;
+                break;
+            default:
+                break;
             }
+
+            if (seconds <= SAMPLE_DECODE_MAX_SECONDS && fits)
+                storage = SampleStorage::DECODED;
+            else if (compressible)
+                storage = SampleStorage::COMPRESSED;
+            else if (seconds < SAMPLE_STREAM_MIN_SECONDS && fits)
+                storage = SampleStorage::DECODED;
             else
-            {
-                info->done(info, FMOD_OK);
-            }
+                storage = SampleStorage::STREAM;
+        }
+    }
+
+    FMOD_RESULT r = FMOD_ERR_FILE_NOTFOUND;
+    switch (storage)
+    {
+    case SampleStorage::COMPRESSED:
+        r = fmodSystem->createSound(path.c_str(), flags | FMOD_CREATECOMPRESSEDSAMPLE, 0, &sample.objptr);
+        if (r == FMOD_OK)
+        {
+            flags |= FMOD_CREATECOMPRESSEDSAMPLE;
+            break;
         }
+        // codec not supported in this build; decode instead
+        storage = SampleStorage::DECODED;
+        [[fallthrough]];
+
+    case SampleStorage::DECODED:
+        flags |= FMOD_CREATESAMPLE;
+        r = fmodSystem->createSound(path.c_str(), flags, 0, &sample.objptr);
+        break;
+
+    case SampleStorage::STREAM:
+        flags |= FMOD_CREATESTREAM;
+        r = fmodSystem->createSound(path.c_str(), flags, 0, &sample.objptr);
+        break;
+    }
+
+    if (r == FMOD_OK)
+    {
+        sample.flags = flags;
+        sample.storage = storage;
+        sample.bytes = measureSample(path, sample.objptr, storage);
+        noteSampleBytes += sample.bytes;
+        addResident(sample);
+        if (storage != SampleStorage::DECODED)
+            LOG_DEBUG << "[FMOD] Sample (" << path << ") kept " << (storage == SampleStorage::COMPRESSED ? "compressed" : "streamed");
     }
+    return r;
 }
 
-static const std::list<std::string> wavExtensionList =
+size_t SoundDriverFMOD::measureSample(const std::string& path, FMOD::Sound* sound, SampleStorage storage)
 {
-    ".wav",
-    ".ogg",
-    ".flac",    // lmao
-};
+    if (sound == nullptr) return 0;
+    switch (storage)
+    {
+    case SampleStorage::DECODED:
+    {
+        unsigned pcmBytes = 0;
+        sound->getLength(&pcmBytes, FMOD_TIMEUNIT_PCMBYTES);
+        return pcmBytes;
+    }
+    case SampleStorage::COMPRESSED:
+    {
+        std::error_code ec;
+        size_t fileBytes = (size_t)fs::file_size(fs::u8path(path), ec);
+        return ec ? 0 : fileBytes;
+    }
+    case SampleStorage::STREAM:
+    {
+        // decode buffer, 400ms by default
+        int channels = 0;
+        int bits = 0;
+        float freq = 0.f;
+        sound->getFormat(nullptr, nullptr, &channels, &bits);
+        sound->getDefaults(&freq, nullptr);
+        return size_t(freq * 0.4f) * channels * (bits > 0 ? bits / 8 : 2);
+    }
+    }
+    return 0;
+}
+
+void SoundDriverFMOD::addResident(const SoundSample& s)
+{
+    residentBytes[(size_t)s.storage] += s.bytes;
+    ++residentCount[(size_t)s.storage];
+}
+
+void SoundDriverFMOD::removeResident(const SoundSample& s)
+{
+    residentBytes[(size_t)s.storage] -= s.bytes;
+    --residentCount[(size_t)s.storage];
+}
 
 int SoundDriverFMOD::loadNoteSample(const Path& spath, size_t index)
 {
     if (spath.empty()) return -1;
 
-    if (noteSamples[index].objptr != nullptr)
+    auto& sample = noteSamples[index];
+    if (sample.objptr != nullptr)
     {
-        noteSamples[index].objptr->release();
-        noteSamples[index].objptr = nullptr;
+        sample.objptr->release();
+        sample.objptr = nullptr;
+        noteSampleBytes -= sample.bytes;
+        removeResident(sample);
+        sample.bytes = 0;
     }
-    
-    int flags = FMOD_LOOP_OFF | FMOD_UNIQUE | FMOD_CREATESAMPLE;
 
     std::string path;
 	FMOD_RESULT r = FMOD_ERR_FILE_NOTFOUND;
     if (fs::exists(spath) && fs::is_regular_file(spath))
     {
         path = spath.u8string();
-        r = fmodSystem->createSound(path.c_str(), flags, 0, &noteSamples[index].objptr);
+        r = createNoteSound(path, sample);
     }
 
     if (r == FMOD_ERR_FILE_NOTFOUND)
@@ -758,7 +816,7 @@ int SoundDriverFMOD::loadNoteSample(const Path& spath, size_t index)
             if (fs::exists(filePath) && fs::is_regular_file(filePath))
             {
                 path = filePath.u8string();
-                r = fmodSystem->createSound(path.c_str(), flags, 0, &noteSamples[index].objptr);
+                r = createNoteSound(path, sample);
                 if (r == FMOD_OK) break;
             }
         }
@@ -766,8 +824,7 @@ int SoundDriverFMOD::loadNoteSample(const Path& spath, size_t index)
 
     if (r == FMOD_OK)
     {
-        noteSamples[index].path = path;
-        noteSamples[index].flags = flags;
+        sample.path = path;
     }
     else
     {
@@ -779,16 +836,205 @@ int SoundDriverFMOD::loadNoteSample(const Path& spath, size_t index)
 
 void SoundDriverFMOD::playNoteSample(SoundChannelType ch, size_t count, size_t index[])
 {
+    wakeUp.store(true, std::memory_order_relaxed);
     for (size_t i = 0; i < count; i++)
     {
         FMOD_RESULT r = FMOD_OK;
         if (noteSamples[index[i]].objptr != nullptr)
+        {
             r = fmodSystem->playSound(noteSamples[index[i]].objptr, &*channelGroup[ch], false, 0);
+            if (r == FMOD_OK)
+                LatencyTracer::mark(LatencyStage::DSP_START);
+        }
         if (r != FMOD_OK)
             LOG_WARNING << "[FMOD] Playing Sample Error: " << r << ", " << FMOD_ErrorString(r);
     }
 }
 
+void SoundDriverFMOD::scheduleNoteSample(SoundChannelType ch, size_t count, size_t index[], const Time& t)
+{
+    wakeUp.store(true, std::memory_order_relaxed);
+    auto& clock = dspClock[(size_t)ch];
+    if (!clock.isValid())
+    {
+        playNoteSample(ch, count, index);
+        return;
+    }
+
+    // setDelay takes the clock of the parent channel group
+    long long start = clock.toClock(t.hres());
+    for (size_t i = 0; i < count; i++)
+    {
+        if (noteSamples[index[i]].objptr == nullptr) continue;
+
+        FMOD::Channel* channel = nullptr;
+        FMOD_RESULT r = fmodSystem->playSound(noteSamples[index[i]].objptr, &*channelGroup[ch], true, &channel);
+        if (r == FMOD_OK)
+            r = channel->setDelay(start > 0 ? (unsigned long long)start : 0, 0, false);
+        if (r == FMOD_OK)
+            r = channel->setPaused(false);
+        if (r != FMOD_OK)
+            LOG_WARNING << "[FMOD] Scheduling Sample Error: " << r << ", " << FMOD_ErrorString(r);
+    }
+}
+
+// Decode the file with FMOD and convert to mixer PCM. With maxFrames (at dstRate) set, the file is opened
+//  without decoding and only the head is read, so long files never decode as a whole
+static FMOD_RESULT decodePCM(FMOD::System* sys, const std::string& path, unsigned dstRate, size_t maxFrames, SoftwareMixer::PCMPtr& out)
+{
+    FMOD::Sound* sound = nullptr;
+    FMOD_MODE mode = FMOD_LOOP_OFF | FMOD_UNIQUE | (maxFrames != 0 ? FMOD_OPENONLY : FMOD_CREATESAMPLE);
+    FMOD_RESULT r = sys->createSound(path.c_str(), mode, 0, &sound);
+    if (r != FMOD_OK) return r;
+
+    FMOD_SOUND_FORMAT format = FMOD_SOUND_FORMAT_NONE;
+    int channels = 0;
+    int bits = 0;
+    float freq = 0.f;
+    unsigned bytes = 0;
+    sound->getFormat(nullptr, &format, &channels, &bits);
+    sound->getDefaults(&freq, nullptr);
+    sound->getLength(&bytes, FMOD_TIMEUNIT_PCMBYTES);
+
+    void* p1 = nullptr;
+    void* p2 = nullptr;
+    unsigned l1 = 0, l2 = 0;
+    std::vector<char> head;
+    if (channels <= 0 || bits <= 0 || bytes == 0 || freq <= 0.f)
+        r = FMOD_ERR_FORMAT;
+    else if (maxFrames != 0)
+    {
+        size_t frameBytes = size_t(channels) * (bits / 8);
+        size_t srcFrames = std::max(size_t(1), size_t(double(maxFrames) * freq / dstRate));
+        head.resize(std::min(size_t(bytes), srcFrames * frameBytes));
+        unsigned read = 0;
+        r = sound->readData(head.data(), unsigned(head.size()), &read);
+        if (r == FMOD_ERR_FILE_EOF && read > 0) r = FMOD_OK;
+        p1 = head.data();
+        l1 = read;
+    }
+    else
+        r = sound->lock(0, bytes, &p1, &p2, &l1, &l2);
+
+    if (r == FMOD_OK)
+    {
+        size_t count = l1 / (bits / 8);
+        std::vector<float> buf(count);
+        switch (format)
+        {
+        case FMOD_SOUND_FORMAT_PCM8:
+            for (size_t i = 0; i < count; ++i)
+                buf[i] = ((const int8_t*)p1)[i] / 128.f;
+            break;
+        case FMOD_SOUND_FORMAT_PCM16:
+            for (size_t i = 0; i < count; ++i)
+                buf[i] = ((const int16_t*)p1)[i] / 32768.f;
+            break;
+        case FMOD_SOUND_FORMAT_PCM24:
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto b = (const uint8_t*)p1 + i * 3;
+                int32_t v = int32_t(uint32_t(b[0]) << 8 | uint32_t(b[1]) << 16 | uint32_t(b[2]) << 24) >> 8;
+                buf[i] = v / 8388608.f;
+            }
+            break;
+        case FMOD_SOUND_FORMAT_PCM32:
+            for (size_t i = 0; i < count; ++i)
+                buf[i] = float(((const int32_t*)p1)[i] / 2147483648.0);
+            break;
+        case FMOD_SOUND_FORMAT_PCMFLOAT:
+            std::memcpy(buf.data(), p1, count * sizeof(float));
+            break;
+        default:
+            r = FMOD_ERR_FORMAT;
+            break;
+        }
+        if (maxFrames == 0)
+            sound->unlock(p1, p2, l1, l2);
+
+        if (r == FMOD_OK)
+            out = SoftwareMixer::makePCM(buf.data(), count / channels, unsigned(channels), unsigned(freq), dstRate);
+    }
+
+    sound->release();
+    return r;
+}
+
+int SoundDriverFMOD::decodeSample(const Path& spath, unsigned sampleRate, SoftwareMixer::PCMPtr& out, size_t maxFrames)
+{
+    if (spath.empty() || fmodSystem == nullptr) return -1;
+
+    std::vector<Path> candidates;
+    if (fs::exists(spath) && fs::is_regular_file(spath))
+    {
+        candidates.push_back(spath);
+    }
+    else
+    {
+        // Also find ogg with the same filename
+        Path dir = spath.parent_path();
+        for (auto& ext : wavExtensionList)
+        {
+            Path filePath = dir / (spath.stem().u8string() + ext);
+            if (fs::exists(filePath) && fs::is_regular_file(filePath))
+                candidates.push_back(filePath);
+        }
+    }
+
+    FMOD_RESULT r = FMOD_ERR_FILE_NOTFOUND;
+    for (auto& p : candidates)
+    {
+        r = decodePCM(fmodSystem, p.u8string(), sampleRate, maxFrames, out);
+        if (r == FMOD_OK) return 0;
+    }
+    LOG_DEBUG << "[FMOD] Decoding Sample (" << spath.u8string() << ") Error: " << r << ", " << FMOD_ErrorString(r);
+    return 1;
+}
+
+int SoundDriverFMOD::playPreview(SoftwareMixer::PCMPtr pcm, unsigned sampleRate)
+{
+    stopPreview();
+    if (pcm == nullptr || pcm->frames == 0 || fmodSystem == nullptr) return -1;
+
+    // points at the buffer; previewPCM keeps it alive until the sound is released
+    FMOD_CREATESOUNDEXINFO exinfo{};
+    exinfo.cbsize = sizeof(exinfo);
+    exinfo.length = unsigned(pcm->frames * SoftwareMixer::CHANNELS * sizeof(float));
+    exinfo.numchannels = int(SoftwareMixer::CHANNELS);
+    exinfo.defaultfrequency = int(sampleRate);
+    exinfo.format = FMOD_SOUND_FORMAT_PCMFLOAT;
+
+    FMOD::Sound* sound = nullptr;
+    FMOD_RESULT r = fmodSystem->createSound((const char*)pcm->data, FMOD_OPENMEMORY_POINT | FMOD_OPENRAW | FMOD_LOOP_OFF, &exinfo, &sound);
+    if (r == FMOD_OK)
+    {
+        r = fmodSystem->playSound(sound, &*channelGroup[SoundChannelType::KEY_LEFT], false, 0);
+        if (r != FMOD_OK)
+            sound->release();
+    }
+    if (r != FMOD_OK)
+    {
+        LOG_WARNING << "[FMOD] Playing Preview Error: " << r << ", " << FMOD_ErrorString(r);
+        return 1;
+    }
+
+    previewSound = sound;
+    previewPCM = std::move(pcm);
+    wakeUp.store(true, std::memory_order_relaxed);
+    return 0;
+}
+
+void SoundDriverFMOD::stopPreview()
+{
+    if (previewSound != nullptr)
+    {
+        // also stops the channel
+        previewSound->release();
+        previewSound = nullptr;
+    }
+    previewPCM.reset();
+}
+
 void SoundDriverFMOD::stopNoteSamples()
 {
     channelGroup[SoundChannelType::BGM_NOTE]->stop();
@@ -804,8 +1050,11 @@ void SoundDriverFMOD::freeNoteSamples()
         {
             s.objptr->release();
             s.objptr = nullptr;
+            removeResident(s);
         }
+        s.bytes = 0;
     }
+    noteSampleBytes = 0;
 }
 
 long long SoundDriverFMOD::getNoteSampleLength(size_t index)
@@ -826,6 +1075,8 @@ int SoundDriverFMOD::loadSysSample(const Path& spath, size_t index, bool isStrea
     {
         sysSamples[index].objptr->release();
         sysSamples[index].objptr = nullptr;
+        removeResident(sysSamples[index]);
+        sysSamples[index].bytes = 0;
     }
 
     int flags = FMOD_DEFAULT | FMOD_UNIQUE;
@@ -860,6 +1111,9 @@ int SoundDriverFMOD::loadSysSample(const Path& spath, size_t index, bool isStrea
     {
         sysSamples[index].path = path;
         sysSamples[index].flags = flags;
+        sysSamples[index].storage = isStream ? SampleStorage::STREAM : SampleStorage::DECODED;
+        sysSamples[index].bytes = measureSample(path, sysSamples[index].objptr, sysSamples[index].storage);
+        addResident(sysSamples[index]);
     }
     else
     {
@@ -871,6 +1125,7 @@ int SoundDriverFMOD::loadSysSample(const Path& spath, size_t index, bool isStrea
 
 void SoundDriverFMOD::playSysSample(SoundChannelType ch, size_t index)
 {
+    wakeUp.store(true, std::memory_order_relaxed);
     FMOD_RESULT r = FMOD_OK;
     if (sysSamples[index].objptr != nullptr)
         r = fmodSystem->playSound(sysSamples[index].objptr, &*channelGroup[ch], false, 0);
@@ -892,59 +1147,167 @@ void SoundDriverFMOD::freeSysSamples()
         {
             s.objptr->release();
             s.objptr = nullptr;
+            removeResident(s);
         }
+        s.bytes = 0;
     }
 }
 
-void SoundDriverFMOD::update()
+SampleMemoryStats SoundDriverFMOD::getSampleMemoryStats()
 {
-    if (!fmodSystem) return;
+    // counters only; the sample arrays are written by loader threads
+    SampleMemoryStats stats;
+    stats.decodedBytes = residentBytes[(size_t)SampleStorage::DECODED];
+    stats.compressedBytes = residentBytes[(size_t)SampleStorage::COMPRESSED];
+    stats.streamBytes = residentBytes[(size_t)SampleStorage::STREAM];
+    stats.decoded = residentCount[(size_t)SampleStorage::DECODED];
+    stats.compressed = residentCount[(size_t)SampleStorage::COMPRESSED];
+    stats.streamed = residentCount[(size_t)SampleStorage::STREAM];
+
+    int current = 0, peak = 0;
+    if (FMOD::Memory_GetStats(&current, &peak, false) == FMOD_OK)
+        stats.driverHeapBytes = current;
+    return stats;
+}
 
-    if (sysVolume != sysVolumeGradientEnd)
+bool SoundDriverFMOD::postParam(const ParamCommand& cmd)
+{
+    size_t pos = paramHead.load(std::memory_order_relaxed);
+    while (true)
     {
-        if (sysVolumeGradientLength == 0)
+        ParamSlot* slot = &paramCommands[pos & (PARAM_QUEUE_SIZE - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        auto diff = (long long)seq - (long long)pos;
+        if (diff == 0)
         {
-            sysVolume = sysVolumeGradientEnd;
+            if (paramHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot->cmd = cmd;
+                slot->seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            LOG_WARNING << "[FMOD] Parameter queue full, dropped";
+            return false;
         }
         else
         {
-            double progress = double((Time() - sysVolumeGradientBeginTime).norm()) / sysVolumeGradientLength;
-            if (progress >= 1.0)
-            {
-                sysVolume = sysVolumeGradientEnd;
-            }
-            else
-            {
-                sysVolume = sysVolumeGradientBegin + (sysVolumeGradientEnd - sysVolumeGradientBegin) * progress;
-            }
+            pos = paramHead.load(std::memory_order_relaxed);
         }
-        setVolume(SampleChannel::BGM, volume[SampleChannel::BGM]);
     }
+}
 
-    if (noteVolume != noteVolumeGradientEnd)
+bool SoundDriverFMOD::processParamCommands()
+{
+    bool applied = false;
+    while (true)
     {
-        if (noteVolumeGradientLength == 0)
-        {
-            noteVolume = noteVolumeGradientEnd;
-        }
-        else
+        ParamSlot& slot = paramCommands[paramTail & (PARAM_QUEUE_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != paramTail + 1)
+            break;
+
+        const ParamCommand& cmd = slot.cmd;
+        switch (cmd.type)
         {
-            double progress = double((Time() - noteVolumeGradientBeginTime).norm()) / noteVolumeGradientLength;
-            if (progress >= 1.0)
-            {
-                noteVolume = noteVolumeGradientEnd;
-            }
-            else
-            {
-                noteVolume = noteVolumeGradientBegin + (noteVolumeGradientEnd - noteVolumeGradientBegin) * progress;
-            }
+        case ParamCommand::Type::SYS_VOLUME:
+            sysVolumeGradientBegin = sysVolume;
+            sysVolumeGradientEnd = cmd.p1;
+            sysVolumeGradientBeginTime = Time(cmd.timeNs, true);
+            sysVolumeGradientLength = cmd.index;
+            break;
+        case ParamCommand::Type::NOTE_VOLUME:
+            noteVolumeGradientBegin = noteVolume;
+            noteVolumeGradientEnd = cmd.p1;
+            noteVolumeGradientBeginTime = Time(cmd.timeNs, true);
+            noteVolumeGradientLength = cmd.index;
+            break;
+        case ParamCommand::Type::VOLUME:
+            volume[cmd.channel] = cmd.p1;
+            applyGroupVolumes();
+            break;
+        case ParamCommand::Type::DSP:
+            applyDSP(cmd.dspType, cmd.index, cmd.channel, cmd.p1, cmd.p2);
+            break;
+        case ParamCommand::Type::FREQ_FACTOR:
+            applyFreqFactor(cmd.rate);
+            break;
+        case ParamCommand::Type::SPEED:
+            applySpeed(cmd.rate);
+            break;
+        case ParamCommand::Type::PITCH:
+            applyPitch(cmd.rate);
+            break;
+        case ParamCommand::Type::EQ:
+            applyEQ(cmd.eqFreq, cmd.index);
+            break;
         }
-        setVolume(SampleChannel::MASTER, volume[SampleChannel::MASTER]);
+
+        slot.seq.store(paramTail + PARAM_QUEUE_SIZE, std::memory_order_release);
+        ++paramTail;
+        applied = true;
     }
+    return applied;
+}
+
+bool SoundDriverFMOD::updateVolumeGradients()
+{
+    if (sysVolume == sysVolumeGradientEnd && noteVolume == noteVolumeGradientEnd)
+        return false;
+
+    Time now;
+    auto step = [&now](float& v, float begin, float end, const Time& beginTime, int length)
+    {
+        double progress = length == 0 ? 1.0 : double((now - beginTime).norm()) / length;
+        v = progress >= 1.0 ? end : float(begin + (end - begin) * progress);
+    };
+    step(sysVolume, sysVolumeGradientBegin, sysVolumeGradientEnd, sysVolumeGradientBeginTime, sysVolumeGradientLength);
+    step(noteVolume, noteVolumeGradientBegin, noteVolumeGradientEnd, noteVolumeGradientBeginTime, noteVolumeGradientLength);
+    applyGroupVolumes();
+    return true;
+}
+
+void SoundDriverFMOD::update()
+{
+    if (!fmodSystem) return;
+
+    bool busy = processParamCommands();
+    busy |= updateVolumeGradients();
+    if (wakeUp.load(std::memory_order_relaxed))
+    {
+        wakeUp.store(false, std::memory_order_relaxed);
+        busy = true;
+    }
+
+    // nothing playing and nothing changing: housekeeping at a fraction of the looper rate
+    if (idle && !busy && ++idleTicks < IDLE_TICK_DIVIDER)
+        return;
+    idleTicks = 0;
 
     FMOD_RESULT r = fmodSystem->update();
     if (r != FMOD_OK)
         LOG_ERROR << "[FMOD] SoundDriverFMOD System Update Error: " << r << ", " << FMOD_ErrorString(r);
+
+    long long now = Time().hres();
+    for (size_t i = 0; i < dspClock.size(); ++i)
+    {
+        unsigned long long clock = 0;
+        if (channelGroup[i] != nullptr && channelGroup[i]->getDSPClock(&clock, nullptr) == FMOD_OK)
+            dspClock[i].sample(now, clock);
+    }
+
+    int playing = 0;
+    fmodSystem->getChannelsPlaying(&playing);
+    idle = !busy && playing == 0;
+}
+
+void SoundDriverFMOD::resetDSPClock()
+{
+    if (fmodSystem)
+        fmodSystem->getSoftwareFormat(&dspClockRate, nullptr, nullptr);
+    for (auto& c : dspClock)
+        c.reset(dspClockRate * channelGroupPitch);
 }
 
 int SoundDriverFMOD::getChannelsPlaying()
@@ -956,46 +1319,91 @@ int SoundDriverFMOD::getChannelsPlaying()
 
 void SoundDriverFMOD::setSysVolume(float v, int gradientTime)
 {
-    sysVolumeGradientBegin = sysVolume;
-    sysVolumeGradientEnd = v;
-    sysVolumeGradientBeginTime = Time();
-    sysVolumeGradientLength = gradientTime;
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::SYS_VOLUME;
+    cmd.p1 = v;
+    cmd.index = gradientTime;
+    cmd.timeNs = Time().hres();
+    postParam(cmd);
 }
 
 void SoundDriverFMOD::setNoteVolume(float v, int gradientTime)
 {
-    noteVolumeGradientBegin = noteVolume;
-    noteVolumeGradientEnd = v;
-    noteVolumeGradientBeginTime = Time();
-    noteVolumeGradientLength = gradientTime;
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::NOTE_VOLUME;
+    cmd.p1 = v;
+    cmd.index = gradientTime;
+    cmd.timeNs = Time().hres();
+    postParam(cmd);
 }
 
 void SoundDriverFMOD::setVolume(SampleChannel ch, float v)
 {
-    volume[ch] = v;
-
-    switch (ch)
-    {
-    case SampleChannel::MASTER:
-        channelGroup[SoundChannelType::BGM_SYS]->setVolume(sysVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::BGM]);
-        channelGroup[SoundChannelType::BGM_NOTE]->setVolume(noteVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::BGM]);
-        channelGroup[SoundChannelType::KEY_SYS]->setVolume(sysVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::KEY]);
-        channelGroup[SoundChannelType::KEY_LEFT]->setVolume(noteVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::KEY]);
-        channelGroup[SoundChannelType::KEY_RIGHT]->setVolume(noteVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::KEY]);
-        break;
-    case SampleChannel::KEY:
-        channelGroup[SoundChannelType::KEY_SYS]->setVolume(sysVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::KEY]);
-        channelGroup[SoundChannelType::KEY_LEFT]->setVolume(noteVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::KEY]);
-        channelGroup[SoundChannelType::KEY_RIGHT]->setVolume(noteVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::KEY]);
-        break;
-    case SampleChannel::BGM:
-        channelGroup[SoundChannelType::BGM_SYS]->setVolume(sysVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::BGM]);
-        channelGroup[SoundChannelType::BGM_NOTE]->setVolume(noteVolume * volume[SampleChannel::MASTER] * volume[SampleChannel::BGM]);
-        break;
-    }
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::VOLUME;
+    cmd.channel = ch;
+    cmd.p1 = v;
+    postParam(cmd);
 }
 
 void SoundDriverFMOD::setDSP(DSPType type, int dspIndex, SampleChannel ch, float p1, float p2)
+{
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::DSP;
+    cmd.dspType = type;
+    cmd.index = dspIndex;
+    cmd.channel = ch;
+    cmd.p1 = p1;
+    cmd.p2 = p2;
+    postParam(cmd);
+}
+
+void SoundDriverFMOD::setFreqFactor(double f)
+{
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::FREQ_FACTOR;
+    cmd.rate = f;
+    postParam(cmd);
+}
+
+void SoundDriverFMOD::setSpeed(double speed)
+{
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::SPEED;
+    cmd.rate = speed;
+    postParam(cmd);
+}
+
+void SoundDriverFMOD::setPitch(double pitch)
+{
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::PITCH;
+    cmd.rate = pitch;
+    postParam(cmd);
+}
+
+void SoundDriverFMOD::setEQ(EQFreq freq, int gain)
+{
+    ParamCommand cmd;
+    cmd.type = ParamCommand::Type::EQ;
+    cmd.eqFreq = freq;
+    cmd.index = gain;
+    postParam(cmd);
+}
+
+void SoundDriverFMOD::applyGroupVolumes()
+{
+    float master = volume[SampleChannel::MASTER];
+    float key = volume[SampleChannel::KEY];
+    float bgm = volume[SampleChannel::BGM];
+    channelGroup[SoundChannelType::BGM_SYS]->setVolume(sysVolume * master * bgm);
+    channelGroup[SoundChannelType::BGM_NOTE]->setVolume(noteVolume * master * bgm);
+    channelGroup[SoundChannelType::KEY_SYS]->setVolume(sysVolume * master * key);
+    channelGroup[SoundChannelType::KEY_LEFT]->setVolume(noteVolume * master * key);
+    channelGroup[SoundChannelType::KEY_RIGHT]->setVolume(noteVolume * master * key);
+}
+
+void SoundDriverFMOD::applyDSP(DSPType type, int dspIndex, SampleChannel ch, float p1, float p2)
 {
     FMOD_DSP_TYPE fmodType = FMOD_DSP_TYPE_UNKNOWN;
     switch (type)
@@ -1120,8 +1528,10 @@ void SoundDriverFMOD::setDSP(DSPType type, int dspIndex, SampleChannel ch, float
     }
 }
 
-void SoundDriverFMOD::setFreqFactor(double f)
+void SoundDriverFMOD::applyFreqFactor(double f)
 {
+    channelGroupPitch = f;
+    resetDSPClock();
     for (SoundChannelType e = SoundChannelType::BGM_SYS; e != SoundChannelType::TYPE_COUNT; ++(*(int*)(&e)))
     {
         channelGroup[e]->setPitch(f);
@@ -1130,9 +1540,11 @@ void SoundDriverFMOD::setFreqFactor(double f)
     }
 }
 
-void SoundDriverFMOD::setSpeed(double speed)
+void SoundDriverFMOD::applySpeed(double speed)
 {
     double pitch = 1.0 / speed;
+    channelGroupPitch = speed;
+    resetDSPClock();
     for (SoundChannelType e = SoundChannelType::BGM_SYS; e != SoundChannelType::TYPE_COUNT; ++(*(int*)(&e)))
     {
         channelGroup[e]->setPitch(speed);
@@ -1141,8 +1553,10 @@ void SoundDriverFMOD::setSpeed(double speed)
     }
 }
 
-void SoundDriverFMOD::setPitch(double pitch)
+void SoundDriverFMOD::applyPitch(double pitch)
 {
+    channelGroupPitch = 1.0;
+    resetDSPClock();
     for (SoundChannelType e = SoundChannelType::BGM_SYS; e != SoundChannelType::TYPE_COUNT; ++(*(int*)(&e)))
     {
         channelGroup[e]->setPitch(1.0);
@@ -1151,7 +1565,7 @@ void SoundDriverFMOD::setPitch(double pitch)
     }
 }
 
-void SoundDriverFMOD::setEQ(EQFreq freq, int gain)
+void SoundDriverFMOD::applyEQ(EQFreq freq, int gain)
 {
     int i = 0, ch = 0;
     switch (freq)
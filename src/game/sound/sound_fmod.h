@@ -1,6 +1,8 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <memory>
 #include <string>
 #include <thread>
 #include "sound_driver.h"
@@ -9,17 +11,31 @@
 
 // This game uses FMOD Low Level API to play sounds as we don't use FMOD Studio,
 
+// std::array indexed by an enum class
+template <typename E, typename T, size_t N>
+struct EnumArray : public std::array<T, N>
+{
+	using std::array<T, N>::operator[];
+	T& operator[](E e) { return std::array<T, N>::operator[](size_t(e)); }
+	const T& operator[](E e) const { return std::array<T, N>::operator[](size_t(e)); }
+};
+
+// Volume / DSP / EQ / rate setters may be called from any thread. They post commands into a lock-free
+//  MPSC queue which the driver thread applies in update(), so FMOD objects are only touched there.
 class SoundDriverFMOD: public SoundDriver
 {
     friend class SoundMgr;
 
-private:
+protected:
+	static constexpr size_t CHANNEL_TYPES = (size_t)SoundChannelType::TYPE_COUNT;
+
 	FMOD::System *fmodSystem = nullptr;
 	int initRet;
 
-protected:
-	std::map<SoundChannelType, std::shared_ptr<FMOD::ChannelGroup>> channelGroup;
-	std::map<SampleChannel, float> volume;
+	EnumArray<SoundChannelType, std::shared_ptr<FMOD::ChannelGroup>, CHANNEL_TYPES> channelGroup{};
+	EnumArray<SampleChannel, float, 3> volume{};
+
+	// driver thread only
 	float sysVolume = 1.0;
 	float noteVolume = 1.0;
 
@@ -32,11 +48,60 @@ protected:
 	Time noteVolumeGradientBeginTime;
 	int noteVolumeGradientLength = 0;
 
-	std::map<SoundChannelType, FMOD::DSP*> DSPMaster[3];
-	std::map<SoundChannelType, FMOD::DSP*> DSPKey[3];
-	std::map<SoundChannelType, FMOD::DSP*> DSPBgm[3];
-	std::map<SoundChannelType, FMOD::DSP*> PitchShiftFilter;
-	std::map<SoundChannelType, FMOD::DSP*> EQFilter[2];
+	EnumArray<SoundChannelType, FMOD::DSP*, CHANNEL_TYPES> DSPMaster[3]{};
+	EnumArray<SoundChannelType, FMOD::DSP*, CHANNEL_TYPES> DSPKey[3]{};
+	EnumArray<SoundChannelType, FMOD::DSP*, CHANNEL_TYPES> DSPBgm[3]{};
+	EnumArray<SoundChannelType, FMOD::DSP*, CHANNEL_TYPES> PitchShiftFilter{};
+	EnumArray<SoundChannelType, FMOD::DSP*, CHANNEL_TYPES> EQFilter[2]{};
+
+	struct ParamCommand
+	{
+		enum class Type
+		{
+			SYS_VOLUME,
+			NOTE_VOLUME,
+			VOLUME,
+			DSP,
+			FREQ_FACTOR,
+			SPEED,
+			PITCH,
+			EQ,
+		} type = Type::VOLUME;
+		SampleChannel channel = SampleChannel::MASTER;
+		DSPType dspType = DSPType::OFF;
+		EQFreq eqFreq = EQFreq::_62_5;
+		int index = 0;			// DSP slot, EQ gain, or gradient length in ms
+		float p1 = 0.f;			// volume, DSP parameters
+		float p2 = 0.f;
+		double rate = 1.0;		// freq factor, speed, pitch
+		long long timeNs = 0;	// gradient start
+	};
+	struct ParamSlot
+	{
+		std::atomic<size_t> seq;
+		ParamCommand cmd;
+	};
+	static constexpr size_t PARAM_QUEUE_SIZE = 256;     // power of 2
+	std::unique_ptr<ParamSlot[]> paramCommands;
+	alignas(64) std::atomic<size_t> paramHead{ 0 };    // producers
+	alignas(64) size_t paramTail = 0;                    // driver thread
+
+	bool postParam(const ParamCommand& cmd);
+	bool processParamCommands();
+	bool updateVolumeGradients();
+
+	// The looper keeps its rate; while nothing plays and no parameter changes, housekeeping
+	//  (FMOD update, DSP clock sampling) only runs every IDLE_TICK_DIVIDER ticks
+	static constexpr unsigned IDLE_TICK_DIVIDER = 10;
+	std::atomic<bool> wakeUp{ false };		// set by play calls
+	bool idle = false;
+	unsigned idleTicks = 0;
+
+	// per channel group; group clocks run at output rate * group pitch
+	std::array<SoundClockEstimator, (size_t)SoundChannelType::TYPE_COUNT> dspClock;
+	int dspClockRate = 48000;
+	double channelGroupPitch = 1.0;
+	void resetDSPClock();
 
 public:
 	static constexpr size_t NOTESAMPLES = 36 * 36 + 1;
@@ -46,12 +111,37 @@ public:
 		FMOD::Sound* objptr = nullptr;
 		std::string path;
 		int flags = 0;
+		SampleStorage storage = SampleStorage::DECODED;
+		size_t bytes = 0;
 	};
 
+	// Note sample storage policy. Short samples are decoded while they fit in the budget;
+	//  long ones stay compressed if the codec allows it (Vorbis, MPEG, FADPCM, Opus), otherwise they are streamed.
+	//  A streamed sound plays on one channel at a time, which is fine for the long BGM-like samples it is used for.
+	static constexpr double SAMPLE_DECODE_MAX_SECONDS = 10.0;
+	static constexpr double SAMPLE_STREAM_MIN_SECONDS = 30.0;
+	static constexpr size_t SAMPLE_PROBE_MIN_FILE_BYTES = 128 * 1024;	// smaller files are decoded without probing while they fit
+	static constexpr size_t SAMPLE_COMPRESSED_RATIO_ESTIMATE = 10;		// decoded / file size of an unprobed compressed file
+
 protected:
 	std::array<SoundSample, NOTESAMPLES> noteSamples{};  // Sound samples of key sound
 	std::array<SoundSample, SYSSAMPLES> sysSamples{};  // Sound samples of BGM, effect, etc
 
+	size_t sampleMemoryBudget = 0;
+	std::atomic<size_t> noteSampleBytes{ 0 };	// resident, all storage types
+
+	// note and system samples by storage type; kept by the loaders so stats can be read from any thread
+	std::array<std::atomic<size_t>, 3> residentBytes{};
+	std::array<std::atomic<unsigned>, 3> residentCount{};
+	void addResident(const SoundSample& s);
+	void removeResident(const SoundSample& s);
+
+	FMOD::Sound* previewSound = nullptr;
+	SoftwareMixer::PCMPtr previewPCM;
+
+	FMOD_RESULT createNoteSound(const std::string& path, SoundSample& sample);
+	static size_t measureSample(const std::string& path, FMOD::Sound* sound, SampleStorage storage);
+
 public:
 	SoundDriverFMOD();
 	virtual ~SoundDriverFMOD();
@@ -65,16 +155,17 @@ private:
 	int findDriver(const std::string& name, int driverIDUnknown);
 
 private:
-    bool bLoading = false;
-    std::thread tLoadSampleThread;
-    void loadSampleThread();
+    bool asyncIO = false;
+    int applyFileSystem(FMOD::System* pSystem);
 
 public:
+    // Read sample files with FmodAsyncIO workers instead of FMOD's own file thread
     int setAsyncIO(bool async = true);
 
 public:
 	virtual int loadNoteSample(const Path& path, size_t index);
 	virtual void playNoteSample(SoundChannelType ch, size_t count, size_t index[]);
+	virtual void scheduleNoteSample(SoundChannelType ch, size_t count, size_t index[], const Time& t);
 	virtual void stopNoteSamples();
 	virtual void freeNoteSamples();
 	virtual long long getNoteSampleLength(size_t index);
@@ -85,8 +176,14 @@ public:
 	virtual void playSysSample(SoundChannelType ch, size_t index);
 	virtual void stopSysSamples();
 	virtual void freeSysSamples();
+	virtual SampleMemoryStats getSampleMemoryStats();
 	int getChannelsPlaying();
 
+public:
+	virtual int decodeSample(const Path& path, unsigned sampleRate, SoftwareMixer::PCMPtr& out, size_t maxFrames = 0);
+	virtual int playPreview(SoftwareMixer::PCMPtr pcm, unsigned sampleRate);
+	virtual void stopPreview();
+
 public:
 	virtual void setSysVolume(float v, int gradientTime = 0);
 	virtual void setNoteVolume(float v, int gradientTime = 0);
@@ -97,4 +194,12 @@ public:
 	virtual void setPitch(double pitch);
 	virtual void setEQ(EQFreq freq, int gain);
 
+protected:
+	// driver thread
+	virtual void applyGroupVolumes();
+	virtual void applyDSP(DSPType type, int index, SampleChannel ch, float p1, float p2);
+	virtual void applyFreqFactor(double f);
+	virtual void applySpeed(double speed);
+	virtual void applyPitch(double pitch);
+	virtual void applyEQ(EQFreq freq, int gain);
 };
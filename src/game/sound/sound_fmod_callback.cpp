@@ -1,6 +1,42 @@
 #include "sound_fmod_callback.h"
-#include <queue>
-#include <mutex>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "common/log.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// File handle passed to FMOD. Workers read with explicit offsets, so several requests
+//  on the same file do not fight over the FILE position.
+struct FmodAsyncFile
+{
+    FILE* fp = nullptr;
+    unsigned size = 0;
+#ifdef _WIN32
+    std::mutex mutex;   // no pread
+#endif
+};
+
+static size_t readAt(FmodAsyncFile* f, unsigned offset, char* buf, size_t size)
+{
+#ifdef _WIN32
+    std::lock_guard lock(f->mutex);
+    if (_fseeki64(f->fp, offset, SEEK_SET) != 0) return 0;
+    return fread(buf, 1, size, f->fp);
+#else
+    int fd = fileno(f->fp);
+    size_t total = 0;
+    while (total < size)
+    {
+        ssize_t n = pread(fd, buf + total, size - total, off_t(offset) + total);
+        if (n <= 0) break;
+        total += size_t(n);
+    }
+    return total;
+#endif
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // Open file
@@ -21,7 +57,10 @@ FMOD_RESULT F_CALLBACK FmodCallbackFileOpen(const char* file, unsigned int* pSiz
         *pSize = ftell(pFile);
         fseek(pFile, 0, SEEK_SET);
 
-        *pHandle = pFile;
+        auto f = new FmodAsyncFile;
+        f->fp = pFile;
+        f->size = *pSize;
+        *pHandle = f;
     }
     return FMOD_OK;
 }
@@ -34,49 +73,258 @@ FMOD_RESULT F_CALLBACK FmodCallbackFileClose(void *handle, void *userData)
 {
     if (!handle)
         return FMOD_ERR_INVALID_HANDLE;
-    fclose((FILE*)handle);
+
+    // FMOD cancels before closing, but make sure no worker still touches the file
+    FmodAsyncIO::cancelFile(handle);
+
+    auto f = (FmodAsyncFile*)handle;
+    fclose(f->fp);
+    delete f;
     return FMOD_OK;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Async Read: Push file to queue
-
-std::mutex queueMutex;
-SampleQueue asyncSampleLoadQueue;
+// Async Read: Push request to queue
 
 FMOD_RESULT F_CALLBACK FmodCallbackAsyncRead(FMOD_ASYNCREADINFO *info, void *userData)
+{
+    return FmodAsyncIO::push(info);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Cancel Async Read: pop the request from queue, or wait for it if being read
+
+FMOD_RESULT F_CALLBACK FmodCallbackAsyncReadCancel(FMOD_ASYNCREADINFO *info, void *userData)
+{
+    FmodAsyncIO::cancel(info);
+    return FMOD_OK;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// FmodAsyncIO
+
+FmodAsyncIO FmodAsyncIO::_inst;
+
+FmodAsyncIO::~FmodAsyncIO()
+{
+    {
+        std::unique_lock lock(_mutex);
+        _running = false;
+    }
+    _cvRequest.notify_all();
+    for (auto& t : _workers)
+    {
+        if (t.joinable())
+            t.join();
+    }
+}
+
+void FmodAsyncIO::start(unsigned workers)
+{
+    std::unique_lock lock(_inst._mutex);
+    if (_inst._running) return;
+    if (workers == 0) workers = 1;
+
+    _inst._running = true;
+    for (unsigned i = 0; i < workers; ++i)
+        _inst._workers.emplace_back(&FmodAsyncIO::workerLoop, &_inst);
+
+    LOG_DEBUG << "[FMOD] Async IO started with " << workers << " workers";
+}
+
+void FmodAsyncIO::stop()
+{
+    {
+        std::unique_lock lock(_inst._mutex);
+        if (!_inst._running) return;
+        _inst._running = false;
+    }
+    _inst._cvRequest.notify_all();
+    for (auto& t : _inst._workers)
+    {
+        if (t.joinable())
+            t.join();
+    }
+    _inst._workers.clear();
+
+    std::vector<Request> pending;
+    {
+        std::unique_lock lock(_inst._mutex);
+        pending.swap(_inst._queue);
+    }
+    for (auto& r : pending)
+    {
+        r.info->bytesread = 0;
+        r.info->done(r.info, FMOD_ERR_FILE_BAD);
+    }
+
+    std::unique_lock lock(_inst._poolMutex);
+    _inst._bufferPool.clear();
+
+    LOG_DEBUG << "[FMOD] Async IO stopped";
+}
+
+bool FmodAsyncIO::isRunning()
+{
+    std::unique_lock lock(_inst._mutex);
+    return _inst._running;
+}
+
+FMOD_RESULT FmodAsyncIO::push(FMOD_ASYNCREADINFO* info)
 {
     try
     {
-        LOCK_QUEUE;
-        asyncSampleLoadQueue.push(info);
+        std::unique_lock lock(_inst._mutex);
+        if (!_inst._running)
+            return FMOD_ERR_FILE_BAD;
+        _inst._queue.push_back({ info, _inst._seq++ });
     }
     catch (std::exception&)
     {
         return FMOD_ERR_MEMORY;
     }
+    _inst._cvRequest.notify_one();
     return FMOD_OK;
-};
+}
 
+void FmodAsyncIO::cancel(FMOD_ASYNCREADINFO* info)
+{
+    std::vector<Request> dropped;
+    {
+        std::unique_lock lock(_inst._mutex);
+        auto& q = _inst._queue;
+        auto it = std::stable_partition(q.begin(), q.end(), [info](const Request& r) { return r.info != info; });
+        dropped.assign(it, q.end());
+        q.erase(it, q.end());
+        _inst._cvInflight.wait(lock, [info]
+            {
+                return std::none_of(_inst._inflight.begin(), _inst._inflight.end(), [info](const auto& r) { return r.first == info; });
+            });
+    }
 
-////////////////////////////////////////////////////////////////////////////////
-// Cancel Async Read: cancel reading(TODO) and pop file from queue
+    // same as cancelFile; the request must be completed before FMOD reuses it
+    for (auto& r : dropped)
+    {
+        r.info->bytesread = 0;
+        r.info->done(r.info, FMOD_ERR_FILE_DISKEJECTED);
+    }
+}
 
-FMOD_RESULT F_CALLBACK FmodCallbackAsyncReadCancel(FMOD_ASYNCREADINFO *handle, void *userData)
+void FmodAsyncIO::cancelFile(void* handle)
 {
-    try
+    std::vector<Request> dropped;
     {
-        LOCK_QUEUE;
-        if (!asyncSampleLoadQueue.empty())
+        std::unique_lock lock(_inst._mutex);
+        auto& q = _inst._queue;
+        auto it = std::stable_partition(q.begin(), q.end(), [handle](const Request& r) { return r.info->handle != handle; });
+        dropped.assign(it, q.end());
+        q.erase(it, q.end());
+        _inst._cvInflight.wait(lock, [handle]
+            {
+                return std::none_of(_inst._inflight.begin(), _inst._inflight.end(), [handle](const auto& r) { return r.second == handle; });
+            });
+    }
+
+    // FMOD waits for every request it issued
+    for (auto& r : dropped)
+    {
+        r.info->bytesread = 0;
+        r.info->done(r.info, FMOD_ERR_FILE_DISKEJECTED);
+    }
+}
+
+std::vector<char> FmodAsyncIO::acquireBuffer(size_t size)
+{
+    {
+        std::unique_lock lock(_poolMutex);
+        for (auto it = _bufferPool.begin(); it != _bufferPool.end(); ++it)
         {
-            auto &s = asyncSampleLoadQueue.front();
-            if (s->handle == handle->handle)
-                asyncSampleLoadQueue.pop();
+            if (it->capacity() >= size)
+            {
+                std::vector<char> buf = std::move(*it);
+                _bufferPool.erase(it);
+                buf.resize(size);
+                return buf;
+            }
         }
     }
-    catch (std::exception&)
+    return std::vector<char>(size);
+}
+
+void FmodAsyncIO::releaseBuffer(std::vector<char>&& buf)
+{
+    std::unique_lock lock(_poolMutex);
+    if (_bufferPool.size() < MAX_POOLED_BUFFERS)
+        _bufferPool.push_back(std::move(buf));
+}
+
+void FmodAsyncIO::workerLoop()
+{
+    std::vector<Request> batch;
+
+    std::unique_lock lock(_mutex);
+    while (true)
     {
-        return FMOD_ERR_MEMORY;
+        _cvRequest.wait(lock, [this] { return !_running || !_queue.empty(); });
+        if (!_running) break;
+
+        // highest priority, then oldest
+        auto itFirst = std::min_element(_queue.begin(), _queue.end(), [](const Request& a, const Request& b)
+            {
+                if (a.info->priority != b.info->priority) return a.info->priority > b.info->priority;
+                return a.seq < b.seq;
+            });
+        void* handle = itFirst->info->handle;
+        unsigned begin = itFirst->info->offset;
+
+        // take every queued request of the same file that fits in one read starting at begin
+        batch.clear();
+        batch.push_back(*itFirst);
+        _queue.erase(itFirst);
+        unsigned end = begin + batch[0].info->sizebytes;
+        for (auto it = _queue.begin(); it != _queue.end();)
+        {
+            auto info = it->info;
+            if (info->handle == handle && info->offset >= begin && info->offset + info->sizebytes - begin <= MAX_BATCH_BYTES)
+            {
+                end = std::max(end, info->offset + info->sizebytes);
+                batch.push_back(*it);
+                it = _queue.erase(it);
+            }
+            else
+                ++it;
+        }
+        for (auto& r : batch)
+            _inflight.push_back({ r.info, handle });
+        lock.unlock();
+
+        auto f = (FmodAsyncFile*)handle;
+        if (batch.size() == 1)
+        {
+            // read straight into FMOD's buffer
+            auto info = batch[0].info;
+            info->bytesread = (unsigned)readAt(f, info->offset, (char*)info->buffer, info->sizebytes);
+            info->done(info, info->bytesread < info->sizebytes ? FMOD_ERR_FILE_EOF : FMOD_OK);
+        }
+        else
+        {
+            auto buf = acquireBuffer(end - begin);
+            size_t got = readAt(f, begin, buf.data(), end - begin);
+            for (auto& r : batch)
+            {
+                auto info = r.info;
+                size_t rel = info->offset - begin;
+                size_t n = got > rel ? std::min<size_t>(info->sizebytes, got - rel) : 0;
+                if (n > 0) std::memcpy(info->buffer, buf.data() + rel, n);
+                info->bytesread = (unsigned)n;
+                info->done(info, n < info->sizebytes ? FMOD_ERR_FILE_EOF : FMOD_OK);
+            }
+            releaseBuffer(std::move(buf));
+        }
+
+        lock.lock();
+        for (auto& r : batch)
+            _inflight.erase(std::find(_inflight.begin(), _inflight.end(), std::make_pair(r.info, handle)));
+        _cvInflight.notify_all();
     }
-    return FMOD_OK;
 }
@@ -1,14 +1,60 @@
 #pragma once
 #include "fmod.hpp"
-#include <queue>
+#include <vector>
+#include <thread>
 #include <mutex>
+#include <condition_variable>
 
-typedef std::lock_guard<std::mutex> guard;
-typedef std::queue<FMOD_ASYNCREADINFO*> SampleQueue;
-extern std::mutex queueMutex;
-extern SampleQueue asyncSampleLoadQueue;
+// Async file reading for FMOD (System::setFileSystem async callbacks).
+//  Requests are served by a small worker pool which sleeps on a condition variable while idle.
+//  Highest FMOD priority goes first. Pending requests on the same file are merged into a single
+//  read through a recycled staging buffer, then copied into the buffers FMOD provided.
+class FmodAsyncIO
+{
+public:
+    static constexpr unsigned MAX_BATCH_BYTES = 256 * 1024;
+    static constexpr size_t MAX_POOLED_BUFFERS = 8;
 
-#define LOCK_QUEUE guard _queueLock_(queueMutex)
+private:
+    struct Request
+    {
+        FMOD_ASYNCREADINFO* info;
+        unsigned long long seq;     // FIFO among same priority
+    };
+
+    std::mutex _mutex;
+    std::condition_variable _cvRequest;
+    std::condition_variable _cvInflight;
+    std::vector<Request> _queue;
+    std::vector<std::pair<FMOD_ASYNCREADINFO*, void*>> _inflight;    // requests being read, with their file handle
+    unsigned long long _seq = 0;
+    std::vector<std::thread> _workers;
+    bool _running = false;
+
+    std::mutex _poolMutex;
+    std::vector<std::vector<char>> _bufferPool;
+
+    static FmodAsyncIO _inst;
+    FmodAsyncIO() = default;
+    ~FmodAsyncIO();
+
+public:
+    static void start(unsigned workers = 2);
+    // Pending requests are failed so FMOD does not wait for them forever
+    static void stop();
+    static bool isRunning();
+
+    static FMOD_RESULT push(FMOD_ASYNCREADINFO* info);
+    // Drop the request if queued, or wait for it to finish if being read
+    static void cancel(FMOD_ASYNCREADINFO* info);
+    // Fail queued requests of the file and wait for in-flight ones to finish. Used before closing
+    static void cancelFile(void* handle);
+
+private:
+    void workerLoop();
+    std::vector<char> acquireBuffer(size_t size);
+    void releaseBuffer(std::vector<char>&& buf);
+};
 
 FMOD_RESULT F_CALLBACK FmodCallbackFileOpen(const char* file, unsigned int* pSize, void **pHandle, void *pUserData);
 FMOD_RESULT F_CALLBACK FmodCallbackFileClose(void *handle, void *userData);
@@ -1,6 +1,9 @@
 #include "sound_mgr.h"
 #include "sound_fmod.h"
+#include "sound_native.h"
 #include "sound_sample.h"
+#include "game/runtime/latency_tracer.h"
+#include "config/config_mgr.h"
 
 SoundMgr SoundMgr::_inst;
 
@@ -9,7 +12,10 @@ int SoundMgr::initFMOD()
     if (!_inst._initialized)
     {
         LOG_INFO << "[Sound] Initializing sound driver...";
-        _inst.driver = std::make_unique<SoundDriverFMOD>();
+        if (ConfigMgr::get('A', cfg::A_MIXER, cfg::A_MIXER_FMOD) == cfg::A_MIXER_NATIVE)
+            _inst.driver = std::make_unique<SoundDriverNative>();
+        else
+            _inst.driver = std::make_unique<SoundDriverFMOD>();
         auto ret = ((SoundDriverFMOD*)_inst.driver.get())->initRet;
         if (ret == FMOD_OK)
         {
@@ -55,8 +61,14 @@ int SoundMgr::loadNoteSample(const Path& path, size_t sample)
 void SoundMgr::playNoteSample(SoundChannelType ch, size_t count, size_t* samples)
 {
     if (!_inst._initialized) return;
+    if (count > 0) LatencyTracer::mark(LatencyStage::KEYSOUND_DISPATCH);
     return _inst.driver->playNoteSample(ch, count, samples);
 }
+void SoundMgr::scheduleNoteSample(SoundChannelType ch, size_t count, size_t* samples, const Time& t)
+{
+    if (!_inst._initialized) return;
+    return _inst.driver->scheduleNoteSample(ch, count, samples, t);
+}
 void SoundMgr::stopNoteSamples()
 {
     if (!_inst._initialized) return;
@@ -93,6 +105,28 @@ void SoundMgr::freeSysSamples()
     return _inst.driver->freeSysSamples();
 }
 
+SampleMemoryStats SoundMgr::getSampleMemoryStats()
+{
+    if (!_inst._initialized) return {};
+    return _inst.driver->getSampleMemoryStats();
+}
+
+int SoundMgr::decodeSample(const Path& path, unsigned sampleRate, SoftwareMixer::PCMPtr& out, size_t maxFrames)
+{
+    if (!_inst._initialized) return -255;
+    return _inst.driver->decodeSample(path, sampleRate, out, maxFrames);
+}
+int SoundMgr::playPreview(SoftwareMixer::PCMPtr pcm, unsigned sampleRate)
+{
+    if (!_inst._initialized) return -255;
+    return _inst.driver->playPreview(std::move(pcm), sampleRate);
+}
+void SoundMgr::stopPreview()
+{
+    if (!_inst._initialized) return;
+    _inst.driver->stopPreview();
+}
+
 void SoundMgr::startUpdate()
 {
     if (!_inst._initialized) return;
@@ -23,6 +23,7 @@ public:
 public:
     static int loadNoteSample(const Path& path, size_t sample);
     static void playNoteSample(SoundChannelType ch, size_t count, size_t* samples);
+    static void scheduleNoteSample(SoundChannelType ch, size_t count, size_t* samples, const Time& t);
     static void stopNoteSamples();
     static void freeNoteSamples();
     static long long getNoteSampleLength(size_t sample); // in ms
@@ -30,6 +31,10 @@ public:
     static void playSysSample(SoundChannelType ch, eSoundSample sample);
     static void stopSysSamples();
     static void freeSysSamples();
+    static SampleMemoryStats getSampleMemoryStats();
+    static int decodeSample(const Path& path, unsigned sampleRate, SoftwareMixer::PCMPtr& out, size_t maxFrames = 0);
+    static int playPreview(SoftwareMixer::PCMPtr pcm, unsigned sampleRate);
+    static void stopPreview();
     static void startUpdate();
     static void stopUpdate();
 
@@ -0,0 +1,533 @@
+#include "sound_mixer.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include "common/log.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MIXER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIXER_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MIXER_NEON
+#endif
+
+static constexpr size_t PCM_ALIGN = 32;
+
+static float* allocAligned(size_t floats)
+{
+    return static_cast<float*>(::operator new(floats * sizeof(float), std::align_val_t(PCM_ALIGN)));
+}
+
+static void freeAligned(float* p)
+{
+    ::operator delete(p, std::align_val_t(PCM_ALIGN));
+}
+
+SoftwareMixer::PCM::~PCM()
+{
+    if (data) freeAligned(data);
+}
+
+SoftwareMixer::PCMPtr SoftwareMixer::makePCM(const float* interleaved, size_t frames, unsigned channels, unsigned srcRate, unsigned dstRate)
+{
+    if (channels == 0 || srcRate == 0 || dstRate == 0) return nullptr;
+
+    auto pcm = std::make_shared<PCM>();
+    size_t outFrames = (srcRate == dstRate) ? frames : size_t((unsigned long long)frames * dstRate / srcRate);
+    if (outFrames == 0) return pcm;
+
+    pcm->data = allocAligned(outFrames * CHANNELS);
+    pcm->frames = outFrames;
+
+    auto sampleAt = [&](size_t frame, unsigned c) -> float
+    {
+        return interleaved[frame * channels + (channels == 1 ? 0 : c)];
+    };
+
+    if (srcRate == dstRate)
+    {
+        for (size_t i = 0; i < outFrames; ++i)
+        {
+            pcm->data[i * 2] = sampleAt(i, 0);
+            pcm->data[i * 2 + 1] = sampleAt(i, 1);
+        }
+    }
+    else
+    {
+        double step = double(srcRate) / dstRate;
+        for (size_t i = 0; i < outFrames; ++i)
+        {
+            double p = i * step;
+            size_t i0 = std::min(size_t(p), frames - 1);
+            size_t i1 = std::min(i0 + 1, frames - 1);
+            float t = float(p - double(i0));
+            for (unsigned c = 0; c < 2; ++c)
+            {
+                float s0 = sampleAt(i0, c);
+                float s1 = sampleAt(i1, c);
+                pcm->data[i * 2 + c] = s0 + (s1 - s0) * t;
+            }
+        }
+    }
+    return pcm;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SIMD kernels
+
+void SoftwareMixer::mixAddScalar(float* dst, const float* src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        dst[i] += src[i];
+}
+
+void SoftwareMixer::mixAddRampScalar(float* dst, const float* src, size_t n, float g0, float g1)
+{
+    size_t frames = n / CHANNELS;
+    float step = frames ? (g1 - g0) / frames : 0.f;
+    for (size_t f = 0; f < frames; ++f)
+    {
+        float g = g0 + step * f;
+        dst[f * 2] += src[f * 2] * g;
+        dst[f * 2 + 1] += src[f * 2 + 1] * g;
+    }
+}
+
+const char* SoftwareMixer::simdName()
+{
+#if defined(MIXER_AVX)
+    return "AVX";
+#elif defined(MIXER_SSE)
+    return "SSE2";
+#elif defined(MIXER_NEON)
+    return "NEON";
+#else
+    return "None";
+#endif
+}
+
+void SoftwareMixer::mixAdd(float* dst, const float* src, size_t n)
+{
+    size_t i = 0;
+#if defined(MIXER_AVX)
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+#elif defined(MIXER_SSE)
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+#elif defined(MIXER_NEON)
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+#endif
+    mixAddScalar(dst + i, src + i, n - i);
+}
+
+void SoftwareMixer::mixAddRamp(float* dst, const float* src, size_t n, float g0, float g1)
+{
+    size_t frames = n / CHANNELS;
+    float step = frames ? (g1 - g0) / frames : 0.f;
+    size_t f = 0;
+#if defined(MIXER_AVX)
+    // 4 stereo frames per vector
+    __m256 g = _mm256_set_ps(g0 + step * 3, g0 + step * 3, g0 + step * 2, g0 + step * 2, g0 + step, g0 + step, g0, g0);
+    __m256 gStep = _mm256_set1_ps(step * 4);
+    for (; f + 4 <= frames; f += 4)
+    {
+        __m256 d = _mm256_loadu_ps(dst + f * 2);
+        __m256 s = _mm256_loadu_ps(src + f * 2);
+        _mm256_storeu_ps(dst + f * 2, _mm256_add_ps(d, _mm256_mul_ps(s, g)));
+        g = _mm256_add_ps(g, gStep);
+    }
+#elif defined(MIXER_SSE)
+    // 2 stereo frames per vector
+    __m128 g = _mm_set_ps(g0 + step, g0 + step, g0, g0);
+    __m128 gStep = _mm_set1_ps(step * 2);
+    for (; f + 2 <= frames; f += 2)
+    {
+        __m128 d = _mm_loadu_ps(dst + f * 2);
+        __m128 s = _mm_loadu_ps(src + f * 2);
+        _mm_storeu_ps(dst + f * 2, _mm_add_ps(d, _mm_mul_ps(s, g)));
+        g = _mm_add_ps(g, gStep);
+    }
+#elif defined(MIXER_NEON)
+    float gInit[4] = { g0, g0, g0 + step, g0 + step };
+    float32x4_t g = vld1q_f32(gInit);
+    float32x4_t gStep = vdupq_n_f32(step * 2);
+    for (; f + 2 <= frames; f += 2)
+    {
+        vst1q_f32(dst + f * 2, vmlaq_f32(vld1q_f32(dst + f * 2), vld1q_f32(src + f * 2), g));
+        g = vaddq_f32(g, gStep);
+    }
+#endif
+    // tail continues the same ramp
+    for (; f < frames; ++f)
+    {
+        float gf = g0 + step * f;
+        dst[f * 2] += src[f * 2] * gf;
+        dst[f * 2 + 1] += src[f * 2 + 1] * gf;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SoftwareMixer
+
+SoftwareMixer::SoftwareMixer(unsigned sampleRate) : _sampleRate(sampleRate)
+{
+    _commands = std::make_unique<CommandSlot[]>(COMMAND_QUEUE_SIZE);
+    for (size_t i = 0; i < COMMAND_QUEUE_SIZE; ++i)
+        _commands[i].seq.store(i, std::memory_order_relaxed);
+
+    _voices.reserve(MAX_VOICES);
+    _busBuffer = allocAligned(MAX_BUSES * BLOCK_FRAMES * CHANNELS);
+    for (auto& g : _busGain) g.store(1.0f, std::memory_order_relaxed);
+    _busGainCurrent.fill(1.0f);
+
+    _ring = std::make_unique<float[]>(RING_FRAMES * CHANNELS);
+}
+
+SoftwareMixer::~SoftwareMixer()
+{
+    freeAligned(_busBuffer);
+}
+
+SoftwareMixer::CommandSlot* SoftwareMixer::claimCommand(size_t& pos)
+{
+    pos = _commandHead.load(std::memory_order_relaxed);
+    while (true)
+    {
+        CommandSlot* slot = &_commands[pos & (COMMAND_QUEUE_SIZE - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        auto diff = (long long)seq - (long long)pos;
+        if (diff == 0)
+        {
+            if (_commandHead.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return slot;
+        }
+        else if (diff < 0)
+        {
+            // full
+            return nullptr;
+        }
+        else
+        {
+            pos = _commandHead.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void SoftwareMixer::publishCommand(CommandSlot* slot, size_t pos)
+{
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+bool SoftwareMixer::play(unsigned bus, PCMPtr pcm, long long startFrame, bool loop)
+{
+    if (!pcm || pcm->frames == 0 || bus >= MAX_BUSES) return false;
+
+    size_t pos;
+    CommandSlot* slot = claimCommand(pos);
+    if (!slot) return false;
+
+    slot->cmd.type = Command::Type::PLAY;
+    slot->cmd.pcm = std::move(pcm);
+    slot->cmd.startFrame = startFrame;
+    slot->cmd.bus = bus;
+    slot->cmd.loop = loop;
+    publishCommand(slot, pos);
+    return true;
+}
+
+bool SoftwareMixer::stopBus(unsigned bus)
+{
+    size_t pos;
+    CommandSlot* slot = claimCommand(pos);
+    if (!slot) return false;
+
+    slot->cmd.type = bus < MAX_BUSES ? Command::Type::STOP_BUS : Command::Type::STOP_ALL;
+    slot->cmd.pcm.reset();
+    slot->cmd.bus = bus;
+    publishCommand(slot, pos);
+    return true;
+}
+
+bool SoftwareMixer::stopAll()
+{
+    return stopBus(unsigned(MAX_BUSES));
+}
+
+void SoftwareMixer::setBusGain(unsigned bus, float gain)
+{
+    if (bus < MAX_BUSES)
+        _busGain[bus].store(gain, std::memory_order_relaxed);
+}
+
+void SoftwareMixer::setRate(double rate)
+{
+    _rate.store(rate > 0.0 ? rate : 1.0, std::memory_order_relaxed);
+}
+
+void SoftwareMixer::processCommands()
+{
+    while (true)
+    {
+        CommandSlot& slot = _commands[_commandTail & (COMMAND_QUEUE_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != _commandTail + 1)
+            break;
+
+        Command& cmd = slot.cmd;
+        switch (cmd.type)
+        {
+        case Command::Type::PLAY:
+            startVoice(cmd);
+            break;
+        case Command::Type::STOP_BUS:
+            _voices.erase(std::remove_if(_voices.begin(), _voices.end(), [&](const Voice& v) { return v.bus == cmd.bus; }), _voices.end());
+            break;
+        case Command::Type::STOP_ALL:
+            _voices.clear();
+            break;
+        }
+        cmd.pcm.reset();
+
+        slot.seq.store(_commandTail + COMMAND_QUEUE_SIZE, std::memory_order_release);
+        ++_commandTail;
+    }
+}
+
+void SoftwareMixer::startVoice(Command& cmd)
+{
+    if (_voices.size() >= MAX_VOICES)
+    {
+        _droppedVoices.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Voice v;
+    v.pcm = std::move(cmd.pcm);
+    // late requests start right away instead of being dropped
+    v.startFrame = (cmd.startFrame == START_ASAP || cmd.startFrame < _frame) ? _frame : cmd.startFrame;
+    v.bus = cmd.bus;
+    v.loop = cmd.loop;
+    _voices.push_back(std::move(v));
+}
+
+void SoftwareMixer::mixVoice(Voice& v, float* bus, size_t offset, size_t frames, double rate, bool& finished)
+{
+    const PCM& pcm = *v.pcm;
+    finished = false;
+
+    if (rate == 1.0)
+    {
+        while (offset < frames)
+        {
+            size_t n = std::min(frames - offset, pcm.frames - v.pos);
+            mixAdd(bus + offset * CHANNELS, pcm.data + v.pos * CHANNELS, n * CHANNELS);
+            offset += n;
+            v.pos += n;
+            if (v.pos >= pcm.frames)
+            {
+                if (!v.loop)
+                {
+                    finished = true;
+                    return;
+                }
+                v.pos = 0;
+            }
+        }
+        return;
+    }
+
+    // resampling path
+    for (; offset < frames; ++offset)
+    {
+        size_t i1 = v.pos + 1;
+        if (i1 >= pcm.frames) i1 = v.loop ? 0 : v.pos;
+        float t = float(v.posFrac);
+        const float* s0 = pcm.data + v.pos * CHANNELS;
+        const float* s1 = pcm.data + i1 * CHANNELS;
+        bus[offset * 2] += s0[0] + (s1[0] - s0[0]) * t;
+        bus[offset * 2 + 1] += s0[1] + (s1[1] - s0[1]) * t;
+
+        v.posFrac += rate;
+        size_t adv = size_t(v.posFrac);
+        v.posFrac -= double(adv);
+        v.pos += adv;
+        if (v.pos >= pcm.frames)
+        {
+            if (!v.loop)
+            {
+                finished = true;
+                return;
+            }
+            v.pos %= pcm.frames;
+        }
+    }
+}
+
+void SoftwareMixer::render(float* out, size_t frames)
+{
+    processCommands();
+    double rate = _rate.load(std::memory_order_relaxed);
+
+    while (frames > 0)
+    {
+        size_t n = std::min(frames, BLOCK_FRAMES);
+        long long blockEnd = _frame + (long long)n;
+
+        unsigned busUsed = 0;
+        for (size_t i = 0; i < _voices.size();)
+        {
+            Voice& v = _voices[i];
+            if (v.startFrame >= blockEnd)
+            {
+                ++i;
+                continue;
+            }
+
+            float* bus = _busBuffer + v.bus * BLOCK_FRAMES * CHANNELS;
+            if (!(busUsed & (1u << v.bus)))
+            {
+                std::memset(bus, 0, n * CHANNELS * sizeof(float));
+                busUsed |= 1u << v.bus;
+            }
+
+            size_t offset = v.startFrame > _frame ? size_t(v.startFrame - _frame) : 0;
+            bool finished;
+            mixVoice(v, bus, offset, n, rate, finished);
+            if (finished)
+            {
+                // order does not matter; swap-remove keeps this O(1)
+                if (i + 1 != _voices.size())
+                    v = std::move(_voices.back());
+                _voices.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        std::memset(out, 0, n * CHANNELS * sizeof(float));
+        for (unsigned b = 0; b < MAX_BUSES; ++b)
+        {
+            float g1 = _busGain[b].load(std::memory_order_relaxed);
+            if (busUsed & (1u << b))
+            {
+                mixAddRamp(out, _busBuffer + b * BLOCK_FRAMES * CHANNELS, n * CHANNELS, _busGainCurrent[b], g1);
+            }
+            _busGainCurrent[b] = g1;
+        }
+
+        out += n * CHANNELS;
+        frames -= n;
+        _frame = blockEnd;
+    }
+
+    _renderedFrame.store(_frame, std::memory_order_release);
+    _activeVoices.store((unsigned)_voices.size(), std::memory_order_relaxed);
+}
+
+size_t SoftwareMixer::getRingFill() const
+{
+    return _ringWrite.load(std::memory_order_acquire) - _ringRead.load(std::memory_order_acquire);
+}
+
+void SoftwareMixer::pump(size_t targetFrames)
+{
+    targetFrames = std::min(targetFrames, RING_FRAMES);
+
+    // write index stays a multiple of BLOCK_FRAMES, so a block never wraps
+    size_t w = _ringWrite.load(std::memory_order_relaxed);
+    while (w - _ringRead.load(std::memory_order_acquire) < targetFrames)
+    {
+        if (RING_FRAMES - (w - _ringRead.load(std::memory_order_acquire)) < BLOCK_FRAMES)
+            break;
+
+        render(&_ring[(w & (RING_FRAMES - 1)) * CHANNELS], BLOCK_FRAMES);
+        w += BLOCK_FRAMES;
+        _ringWrite.store(w, std::memory_order_release);
+    }
+}
+
+void SoftwareMixer::pull(float* out, size_t frames, int outChannels, bool add)
+{
+    size_t r = _ringRead.load(std::memory_order_relaxed);
+    size_t avail = _ringWrite.load(std::memory_order_acquire) - r;
+    size_t n = std::min(frames, avail);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const float* s = &_ring[((r + i) & (RING_FRAMES - 1)) * CHANNELS];
+        float* d = out + i * outChannels;
+        if (outChannels == 1)
+        {
+            float m = (s[0] + s[1]) * 0.5f;
+            d[0] = add ? d[0] + m : m;
+        }
+        else
+        {
+            d[0] = add ? d[0] + s[0] : s[0];
+            d[1] = add ? d[1] + s[1] : s[1];
+            if (!add)
+            {
+                for (int c = 2; c < outChannels; ++c)
+                    d[c] = 0.f;
+            }
+        }
+    }
+    if (n < frames)
+    {
+        if (!add)
+            std::memset(out + n * outChannels, 0, (frames - n) * outChannels * sizeof(float));
+        _underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    _ringRead.store(r + n, std::memory_order_release);
+}
+
+template <typename T>
+static void writeLE(std::ofstream& ofs, T v)
+{
+    // WAV is little endian, so are all platforms this builds for
+    ofs.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+bool SoftwareMixer::renderToWav(const std::string& path, size_t frames)
+{
+    std::ofstream ofs(path, std::ios::binary);
+    if (!ofs)
+    {
+        LOG_WARNING << "[Mixer] Open " << path << " for writing failed";
+        return false;
+    }
+
+    const uint32_t dataBytes = uint32_t(frames * CHANNELS * sizeof(float));
+    ofs.write("RIFF", 4);
+    writeLE<uint32_t>(ofs, 36 + dataBytes);
+    ofs.write("WAVE", 4);
+    ofs.write("fmt ", 4);
+    writeLE<uint32_t>(ofs, 16);
+    writeLE<uint16_t>(ofs, 3);     // IEEE float
+    writeLE<uint16_t>(ofs, uint16_t(CHANNELS));
+    writeLE<uint32_t>(ofs, getSampleRate());
+    writeLE<uint32_t>(ofs, uint32_t(getSampleRate() * CHANNELS * sizeof(float)));
+    writeLE<uint16_t>(ofs, uint16_t(CHANNELS * sizeof(float)));
+    writeLE<uint16_t>(ofs, 32);
+    ofs.write("data", 4);
+    writeLE<uint32_t>(ofs, dataBytes);
+
+    std::vector<float> buf(BLOCK_FRAMES * 16 * CHANNELS);
+    while (frames > 0)
+    {
+        size_t n = std::min(frames, buf.size() / CHANNELS);
+        render(buf.data(), n);
+        ofs.write(reinterpret_cast<const char*>(buf.data()), n * CHANNELS * sizeof(float));
+        frames -= n;
+    }
+    return bool(ofs);
+}
@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Software mixer used by SoundDriverNative.
+//  Samples are decoded once into 32-byte aligned interleaved stereo float PCM at the mixer rate.
+//  Producers (game, input, loader threads) post commands into a lock-free MPSC queue. The render
+//   thread drains it, mixes active voices per bus with SIMD, applies ramped bus gains and writes
+//   the result into a lock-free SPSC ring. The audio device callback consumes the ring.
+//  Every voice starts on an exact frame of the mixer timeline, either as soon as possible or at a
+//   scheduled frame. render() is also usable offline, see renderToWav.
+class SoftwareMixer
+{
+public:
+    static constexpr size_t CHANNELS = 2;
+    static constexpr size_t BLOCK_FRAMES = 128;
+    static constexpr size_t MAX_VOICES = 512;
+    static constexpr size_t MAX_BUSES = 8;
+    static constexpr size_t COMMAND_QUEUE_SIZE = 1024;     // power of 2
+    static constexpr size_t RING_FRAMES = 16384;           // power of 2
+
+    static constexpr long long START_ASAP = -1;
+
+    struct PCM
+    {
+        float* data = nullptr;      // interleaved stereo
+        size_t frames = 0;
+
+        PCM() = default;
+        ~PCM();
+        PCM(const PCM&) = delete;
+        PCM& operator=(const PCM&) = delete;
+    };
+    typedef std::shared_ptr<const PCM> PCMPtr;
+
+    // Mono or stereo input, extra channels are ignored. Resampled linearly if srcRate differs from dstRate
+    static PCMPtr makePCM(const float* interleaved, size_t frames, unsigned channels, unsigned srcRate, unsigned dstRate);
+
+    // dst[i] += src[i] for n floats; SIMD if available
+    static void mixAdd(float* dst, const float* src, size_t n);
+    // dst[i] += src[i] * gain, gain moves linearly from g0 to g1 over the n / CHANNELS frames
+    static void mixAddRamp(float* dst, const float* src, size_t n, float g0, float g1);
+    static void mixAddScalar(float* dst, const float* src, size_t n);
+    static void mixAddRampScalar(float* dst, const float* src, size_t n, float g0, float g1);
+    static const char* simdName();
+
+private:
+    struct Command
+    {
+        enum class Type
+        {
+            PLAY,
+            STOP_BUS,
+            STOP_ALL,
+        } type = Type::PLAY;
+        PCMPtr pcm;
+        long long startFrame = START_ASAP;
+        unsigned bus = 0;
+        bool loop = false;
+    };
+
+    // bounded MPSC queue, sequence numbered slots
+    struct CommandSlot
+    {
+        std::atomic<size_t> seq;
+        Command cmd;
+    };
+    std::unique_ptr<CommandSlot[]> _commands;
+    alignas(64) std::atomic<size_t> _commandHead{ 0 };    // producers
+    alignas(64) size_t _commandTail = 0;                    // render thread
+
+    struct Voice
+    {
+        PCMPtr pcm;
+        long long startFrame = 0;
+        size_t pos = 0;
+        double posFrac = 0.0;
+        unsigned bus = 0;
+        bool loop = false;
+    };
+
+    // render thread only
+    std::vector<Voice> _voices;
+    long long _frame = 0;
+    float* _busBuffer = nullptr;    // [MAX_BUSES][BLOCK_FRAMES * CHANNELS], aligned
+    std::array<float, MAX_BUSES> _busGainCurrent{};
+
+    std::array<std::atomic<float>, MAX_BUSES> _busGain;
+    std::atomic<double> _rate{ 1.0 };
+    std::atomic<unsigned> _sampleRate;
+
+    // output ring: render thread writes, device callback reads
+    std::unique_ptr<float[]> _ring;
+    alignas(64) std::atomic<size_t> _ringWrite{ 0 };       // frames
+    alignas(64) std::atomic<size_t> _ringRead{ 0 };        // frames
+
+    std::atomic<long long> _renderedFrame{ 0 };
+    std::atomic<unsigned> _activeVoices{ 0 };
+    std::atomic<unsigned long long> _droppedVoices{ 0 };
+    std::atomic<unsigned long long> _underruns{ 0 };
+
+public:
+    explicit SoftwareMixer(unsigned sampleRate);
+    ~SoftwareMixer();
+    SoftwareMixer(const SoftwareMixer&) = delete;
+    SoftwareMixer& operator=(const SoftwareMixer&) = delete;
+
+    unsigned getSampleRate() const { return _sampleRate.load(std::memory_order_relaxed); }
+    // Only labels the timeline; PCM is expected to be converted by the caller already
+    void setSampleRate(unsigned rate) { _sampleRate.store(rate, std::memory_order_relaxed); }
+
+public:
+    // Any thread. Returns false if the command queue is full
+    bool play(unsigned bus, PCMPtr pcm, long long startFrame = START_ASAP, bool loop = false);
+    bool stopBus(unsigned bus);
+    bool stopAll();
+    void setBusGain(unsigned bus, float gain);
+    // Playback rate of all voices; 1.0 takes the SIMD path, other rates are resampled linearly
+    void setRate(double rate);
+
+    // Next frame the render thread will produce. Frames before this are already committed
+    long long getRenderedFrame() const { return _renderedFrame.load(std::memory_order_acquire); }
+    // Frames handed to the device so far
+    long long getPlayedFrame() const { return (long long)_ringRead.load(std::memory_order_acquire); }
+    unsigned getActiveVoices() const { return _activeVoices.load(std::memory_order_relaxed); }
+    unsigned long long getDroppedVoices() const { return _droppedVoices.load(std::memory_order_relaxed); }
+    unsigned long long getUnderruns() const { return _underruns.load(std::memory_order_relaxed); }
+
+public:
+    // Render thread. Mixes the next frames of the timeline into out (interleaved stereo)
+    void render(float* out, size_t frames);
+    // Render thread. Renders until the ring holds at least targetFrames unread frames
+    void pump(size_t targetFrames);
+    size_t getRingFill() const;
+
+    // Device callback. Copies frames out of the ring into an interleaved buffer of outChannels channels,
+    //  adding to the existing content if add is set. Missing frames are left silent and counted as underrun
+    void pull(float* out, size_t frames, int outChannels, bool add);
+
+    // Offline. Renders frames from the current timeline position into a 32-bit float WAV file
+    bool renderToWav(const std::string& path, size_t frames);
+
+private:
+    CommandSlot* claimCommand(size_t& pos);
+    void publishCommand(CommandSlot* slot, size_t pos);
+    void processCommands();
+    void startVoice(Command& cmd);
+    void mixVoice(Voice& v, float* bus, size_t offset, size_t frames, double rate, bool& finished);
+};
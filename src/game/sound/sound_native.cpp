@@ -0,0 +1,320 @@
+#include "common/log.h"
+#include "sound_native.h"
+#include "fmod_errors.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "game/runtime/latency_tracer.h"
+
+static_assert((size_t)SoundChannelType::TYPE_COUNT <= SoftwareMixer::MAX_BUSES);
+
+// Runs in the FMOD mixer thread. The master group carries no FMOD channels, so this is the device feed
+static FMOD_RESULT F_CALLBACK mixerOutputRead(FMOD_DSP_STATE* state, float* inbuffer, float* outbuffer, unsigned int length, int inchannels, int* outchannels)
+{
+    void* userdata = nullptr;
+    FMOD_DSP_GETUSERDATA(state, &userdata);
+
+    int channels = *outchannels;
+    if (channels == inchannels)
+        std::memcpy(outbuffer, inbuffer, length * channels * sizeof(float));
+    else
+        std::memset(outbuffer, 0, length * channels * sizeof(float));
+
+    if (userdata)
+        static_cast<SoftwareMixer*>(userdata)->pull(outbuffer, length, channels, true);
+    return FMOD_OK;
+}
+
+static FMOD_RESULT F_CALLBACK mixerOutputShouldProcess(FMOD_DSP_STATE* state, FMOD_BOOL inputsidle, unsigned int length, FMOD_CHANNELMASK inmask, int inchannels, FMOD_SPEAKERMODE speakermode)
+{
+    // inputs are always idle; keep pulling
+    return FMOD_OK;
+}
+
+SoundDriverNative::SoundDriverNative() : SoundDriverFMOD()
+{
+    mixer = std::make_unique<SoftwareMixer>(sampleRate);
+    if (initRet != FMOD_OK) return;
+
+    if (attachOutput() != 0)
+    {
+        initRet = FMOD_ERR_PLUGIN;
+        return;
+    }
+    applyGroupVolumes();
+}
+
+SoundDriverNative::~SoundDriverNative()
+{
+    detachOutput();
+    freeNoteSamples();
+    freeSysSamples();
+}
+
+int SoundDriverNative::attachOutput()
+{
+    int rate = 0;
+    fmodSystem->getSoftwareFormat(&rate, nullptr, nullptr);
+    if (rate > 0) sampleRate = unsigned(rate);
+    mixer->setSampleRate(sampleRate);
+
+    // one device buffer plus headroom for update jitter
+    unsigned bufferLen = 0;
+    int buffers = 0;
+    fmodSystem->getDSPBufferSize(&bufferLen, &buffers);
+    ringTarget = bufferLen + SoftwareMixer::BLOCK_FRAMES * 2;
+    playedClock.reset(sampleRate);
+
+    FMOD_DSP_DESCRIPTION desc{};
+    desc.pluginsdkversion = FMOD_PLUGIN_SDK_VERSION;
+    strncpy(desc.name, "Native Mixer Output", sizeof(desc.name) - 1);
+    desc.numinputbuffers = 1;
+    desc.numoutputbuffers = 1;
+    desc.read = &mixerOutputRead;
+    desc.shouldiprocess = &mixerOutputShouldProcess;
+    desc.userdata = mixer.get();
+
+    FMOD_RESULT r = fmodSystem->createDSP(&desc, &outputDSP);
+    if (r == FMOD_OK)
+    {
+        FMOD::ChannelGroup* master = nullptr;
+        r = fmodSystem->getMasterChannelGroup(&master);
+        if (r == FMOD_OK)
+            r = master->addDSP(FMOD_CHANNELCONTROL_DSP_HEAD, outputDSP);
+    }
+    if (r != FMOD_OK)
+    {
+        LOG_ERROR << "[Mixer] Attach mixer output failed: " << FMOD_ErrorString(r);
+        if (outputDSP)
+        {
+            outputDSP->release();
+            outputDSP = nullptr;
+        }
+        return 1;
+    }
+
+    LOG_INFO << "[Mixer] Native mixer output: " << sampleRate << "Hz, " << ringTarget << " frames ahead, SIMD: " << SoftwareMixer::simdName();
+    return 0;
+}
+
+void SoundDriverNative::detachOutput()
+{
+    if (outputDSP == nullptr) return;
+
+    FMOD::ChannelGroup* master = nullptr;
+    if (fmodSystem && fmodSystem->getMasterChannelGroup(&master) == FMOD_OK)
+        master->removeDSP(outputDSP);
+    outputDSP->release();
+    outputDSP = nullptr;
+}
+
+int SoundDriverNative::setDevice(size_t index)
+{
+    // the DSP belongs to the system being released
+    detachOutput();
+    mixer->stopAll();
+
+    int ret = SoundDriverFMOD::setDevice(index);
+    if (ret == 0)
+        ret = attachOutput();
+    return ret;
+}
+
+// Sample slots are replaced by loader threads while the game thread plays them, hence atomic_load/store
+
+int SoundDriverNative::loadNoteSample(const Path& spath, size_t index)
+{
+    if (spath.empty()) return -1;
+
+    SoftwareMixer::PCMPtr pcm;
+    int ret = decodeSample(spath, sampleRate, pcm);
+    size_t bytes = pcm ? pcm->frames * SoftwareMixer::CHANNELS * sizeof(float) : 0;
+    auto old = std::atomic_exchange(&notePCM[index], pcm);
+    if (old)
+        noteSampleBytes -= old->frames * SoftwareMixer::CHANNELS * sizeof(float);
+    if ((noteSampleBytes += bytes) > sampleMemoryBudget && !overBudgetWarned.exchange(true))
+    {
+        LOG_WARNING << "[Mixer] Decoded keysounds exceed the sample memory budget ("
+            << sampleMemoryBudget / 1048576 << "MB). Use the FMOD mixer to keep long samples compressed";
+    }
+    return ret;
+}
+
+void SoundDriverNative::playNoteSample(SoundChannelType ch, size_t count, size_t index[])
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        auto pcm = std::atomic_load(&notePCM[index[i]]);
+        if (pcm == nullptr) continue;
+
+        if (mixer->play((unsigned)ch, std::move(pcm)))
+            LatencyTracer::mark(LatencyStage::DSP_START);
+        else
+            LOG_WARNING << "[Mixer] Playing Sample Error: command queue full";
+    }
+}
+
+void SoundDriverNative::scheduleNoteSample(SoundChannelType ch, size_t count, size_t index[], const Time& t)
+{
+    if (!playedClock.isValid())
+    {
+        playNoteSample(ch, count, index);
+        return;
+    }
+
+    // immediate plays are heard about ringTarget frames after the device position; match that latency
+    long long start = playedClock.toClock(t.hres()) + (long long)ringTarget;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto pcm = std::atomic_load(&notePCM[index[i]]);
+        if (pcm == nullptr) continue;
+
+        if (!mixer->play((unsigned)ch, std::move(pcm), start))
+            LOG_WARNING << "[Mixer] Scheduling Sample Error: command queue full";
+    }
+}
+
+void SoundDriverNative::stopNoteSamples()
+{
+    mixer->stopBus((unsigned)SoundChannelType::BGM_NOTE);
+    mixer->stopBus((unsigned)SoundChannelType::KEY_LEFT);
+    mixer->stopBus((unsigned)SoundChannelType::KEY_RIGHT);
+}
+
+void SoundDriverNative::freeNoteSamples()
+{
+    // playing voices keep their own reference
+    for (auto& s : notePCM)
+        std::atomic_store(&s, SoftwareMixer::PCMPtr());
+    noteSampleBytes = 0;
+    overBudgetWarned = false;
+}
+
+long long SoundDriverNative::getNoteSampleLength(size_t index)
+{
+    auto pcm = std::atomic_load(&notePCM[index]);
+    if (pcm == nullptr || sampleRate == 0) return 0;
+    return (long long)pcm->frames * 1000 / sampleRate;
+}
+
+void SoundDriverNative::update()
+{
+    // volume gradients and FMOD housekeeping
+    SoundDriverFMOD::update();
+
+    mixer->pump(ringTarget);
+    playedClock.sample(Time().hres(), (unsigned long long)mixer->getPlayedFrame());
+}
+
+int SoundDriverNative::loadSysSample(const Path& spath, size_t index, bool isStream, bool loop)
+{
+    if (spath.empty()) return -1;
+
+    // streams are decoded fully as well; system BGMs are short enough
+    SoftwareMixer::PCMPtr pcm;
+    int ret = decodeSample(spath, sampleRate, pcm);
+    std::atomic_store(&sysPCM[index], pcm);
+    sysLoop[index] = loop;
+    return ret;
+}
+
+void SoundDriverNative::playSysSample(SoundChannelType ch, size_t index)
+{
+    auto pcm = std::atomic_load(&sysPCM[index]);
+    if (pcm == nullptr) return;
+
+    if (!mixer->play((unsigned)ch, std::move(pcm), SoftwareMixer::START_ASAP, sysLoop[index]))
+        LOG_WARNING << "[Mixer] Playing Sample Error: command queue full";
+}
+
+void SoundDriverNative::stopSysSamples()
+{
+    mixer->stopBus((unsigned)SoundChannelType::BGM_SYS);
+    mixer->stopBus((unsigned)SoundChannelType::KEY_SYS);
+}
+
+void SoundDriverNative::freeSysSamples()
+{
+    for (auto& s : sysPCM)
+        std::atomic_store(&s, SoftwareMixer::PCMPtr());
+}
+
+SampleMemoryStats SoundDriverNative::getSampleMemoryStats()
+{
+    SampleMemoryStats stats;
+    auto count = [&stats](const SoftwareMixer::PCMPtr& pcm)
+    {
+        if (pcm == nullptr) return;
+        stats.decodedBytes += pcm->frames * SoftwareMixer::CHANNELS * sizeof(float);
+        ++stats.decoded;
+    };
+    for (const auto& s : notePCM) count(std::atomic_load(&s));
+    for (const auto& s : sysPCM) count(std::atomic_load(&s));
+
+    int current = 0, peak = 0;
+    if (FMOD::Memory_GetStats(&current, &peak, false) == FMOD_OK)
+        stats.driverHeapBytes = current;
+    return stats;
+}
+
+int SoundDriverNative::playPreview(SoftwareMixer::PCMPtr pcm, unsigned rate)
+{
+    stopPreview();
+    if (pcm == nullptr || pcm->frames == 0) return -1;
+
+    if (rate != sampleRate)
+        pcm = SoftwareMixer::makePCM(pcm->data, pcm->frames, SoftwareMixer::CHANNELS, rate, sampleRate);
+    if (!mixer->play((unsigned)SoundChannelType::KEY_LEFT, std::move(pcm)))
+    {
+        LOG_WARNING << "[Mixer] Playing Preview Error: command queue full";
+        return 1;
+    }
+    return 0;
+}
+
+void SoundDriverNative::stopPreview()
+{
+    // the select screen plays nothing else on this bus
+    mixer->stopBus((unsigned)SoundChannelType::KEY_LEFT);
+}
+
+void SoundDriverNative::applyGroupVolumes()
+{
+    // same gain formula as the FMOD channel groups, applied as ramped bus gains
+    float master = volume[SampleChannel::MASTER];
+    float key = volume[SampleChannel::KEY];
+    float bgm = volume[SampleChannel::BGM];
+    mixer->setBusGain((unsigned)SoundChannelType::BGM_SYS, sysVolume * master * bgm);
+    mixer->setBusGain((unsigned)SoundChannelType::BGM_NOTE, noteVolume * master * bgm);
+    mixer->setBusGain((unsigned)SoundChannelType::KEY_SYS, sysVolume * master * key);
+    mixer->setBusGain((unsigned)SoundChannelType::KEY_LEFT, noteVolume * master * key);
+    mixer->setBusGain((unsigned)SoundChannelType::KEY_RIGHT, noteVolume * master * key);
+}
+
+void SoundDriverNative::applyDSP(DSPType type, int index, SampleChannel ch, float p1, float p2)
+{
+    LOG_DEBUG << "[Mixer] DSP effects are not supported by the native mixer";
+}
+
+void SoundDriverNative::applyFreqFactor(double f)
+{
+    mixer->setRate(f);
+}
+
+void SoundDriverNative::applySpeed(double speed)
+{
+    // no time stretching; pitch follows speed
+    mixer->setRate(speed);
+}
+
+void SoundDriverNative::applyPitch(double pitch)
+{
+    // the rate belongs to applySpeed
+    LOG_DEBUG << "[Mixer] Pitch shifting is not supported by the native mixer";
+}
+
+void SoundDriverNative::applyEQ(EQFreq freq, int gain)
+{
+    LOG_DEBUG << "[Mixer] EQ is not supported by the native mixer";
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include "sound_fmod.h"
+#include "sound_mixer.h"
+
+// Keysounds and system sounds are decoded to PCM once and mixed by SoftwareMixer instead of
+//  allocating an FMOD channel per playSound call.
+// FMOD is still used to decode files and to talk to the device: the mixer output is pulled by a
+//  DSP on the master channel group, so device selection, ASIO and buffer settings are shared with
+//  SoundDriverFMOD.
+// Not supported natively: setDSP / setEQ effects, pitch shifting without changing speed, and
+//  compressed or streamed keysounds. Every sample is decoded; going over the memory budget only logs a warning.
+class SoundDriverNative : public SoundDriverFMOD
+{
+private:
+    std::unique_ptr<SoftwareMixer> mixer;
+    FMOD::DSP* outputDSP = nullptr;
+    unsigned sampleRate = 48000;
+    size_t ringTarget = 0;
+    SoundClockEstimator playedClock;    // device read position in mixer frames
+
+    std::array<SoftwareMixer::PCMPtr, NOTESAMPLES> notePCM{};
+    std::array<SoftwareMixer::PCMPtr, SYSSAMPLES> sysPCM{};
+    std::array<bool, SYSSAMPLES> sysLoop{};
+    std::atomic<bool> overBudgetWarned{ false };
+
+public:
+    SoundDriverNative();
+    virtual ~SoundDriverNative();
+
+private:
+    int attachOutput();
+    void detachOutput();
+
+public:
+    virtual int setDevice(size_t index);
+
+    virtual int loadNoteSample(const Path& path, size_t index);
+    virtual void playNoteSample(SoundChannelType ch, size_t count, size_t index[]);
+    virtual void scheduleNoteSample(SoundChannelType ch, size_t count, size_t index[], const Time& t);
+    virtual void stopNoteSamples();
+    virtual void freeNoteSamples();
+    virtual long long getNoteSampleLength(size_t index);
+    virtual void update();
+
+    virtual int loadSysSample(const Path& path, size_t index, bool isStream = false, bool loop = false);
+    virtual void playSysSample(SoundChannelType ch, size_t index);
+    virtual void stopSysSamples();
+    virtual void freeSysSamples();
+    virtual SampleMemoryStats getSampleMemoryStats();
+
+    virtual int playPreview(SoftwareMixer::PCMPtr pcm, unsigned sampleRate);
+    virtual void stopPreview();
+
+protected:
+    virtual void applyGroupVolumes();
+    virtual void applyDSP(DSPType type, int index, SampleChannel ch, float p1, float p2);
+    virtual void applyFreqFactor(double f);
+    virtual void applySpeed(double speed);
+    virtual void applyPitch(double pitch);
+    virtual void applyEQ(EQFreq freq, int gain);
+
+public:
+    const SoftwareMixer& getMixer() const { return *mixer; }
+};
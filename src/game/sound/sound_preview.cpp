@@ -0,0 +1,186 @@
+#include "sound_preview.h"
+#include "sound_mgr.h"
+#include "common/log.h"
+#include "common/chartformat/chartformat_bms.h"
+#include "game/chart/chart_bms.h"
+#include "game/scene/scene_context.h"
+
+#include <algorithm>
+#include <execution>
+#include <vector>
+
+SoundPreview SoundPreview::_inst;
+
+void SoundPreview::insertCache(const CacheKey& key, SoftwareMixer::PCMPtr pcm)
+{
+    std::unique_lock l(_cacheMutex);
+    _cache.remove_if([&](const auto& entry) { return entry.first == key; });
+    _cache.emplace_front(key, std::move(pcm));
+    while (_cache.size() > CACHE_ENTRIES)
+        _cache.pop_back();
+}
+
+SoftwareMixer::PCMPtr SoundPreview::findCached(const HashMD5& chartHash, bool dedicated)
+{
+    if (chartHash.empty()) return nullptr;
+
+    std::unique_lock l(_inst._cacheMutex);
+    auto& cache = _inst._cache;
+    for (auto it = cache.begin(); it != cache.end(); ++it)
+    {
+        if (it->first.first == chartHash && it->first.second == dedicated)
+        {
+            cache.splice(cache.begin(), cache, it);
+            return cache.front().second;
+        }
+    }
+    return nullptr;
+}
+
+void SoundPreview::clearCache()
+{
+    std::unique_lock l(_inst._cacheMutex);
+    _inst._cache.clear();
+}
+
+SoftwareMixer::PCMPtr SoundPreview::loadFile(const HashMD5& chartHash, const Path& path)
+{
+    if (auto pcm = findCached(chartHash, true); pcm != nullptr)
+        return pcm;
+
+    // only the preview length is ever played; long files must not sit in the cache whole
+    SoftwareMixer::PCMPtr pcm;
+    const size_t lengthFrames = size_t(PREVIEW_LENGTH_MS * SAMPLE_RATE / 1000);
+    if (SoundMgr::decodeSample(path, SAMPLE_RATE, pcm, lengthFrames) != 0 || pcm == nullptr || pcm->frames == 0)
+        return nullptr;
+
+    // fade out if cut in the middle
+    if (pcm->frames == lengthFrames)
+    {
+        std::vector<float> buffer(pcm->data, pcm->data + pcm->frames * SoftwareMixer::CHANNELS);
+        size_t fadeFrames = std::min(lengthFrames, size_t(FADE_OUT_MS * SAMPLE_RATE / 1000));
+        size_t fadeStart = lengthFrames - fadeFrames;
+        for (size_t i = 0; i < fadeFrames; ++i)
+        {
+            float g = 1.0f - float(i) / fadeFrames;
+            buffer[(fadeStart + i) * 2] *= g;
+            buffer[(fadeStart + i) * 2 + 1] *= g;
+        }
+        pcm = SoftwareMixer::makePCM(buffer.data(), lengthFrames, SoftwareMixer::CHANNELS, SAMPLE_RATE, SAMPLE_RATE);
+    }
+
+    if (!chartHash.empty())
+        _inst.insertCache({ chartHash, true }, pcm);
+    return pcm;
+}
+
+SoftwareMixer::PCMPtr SoundPreview::renderChart(std::shared_ptr<ChartFormatBMS> bms, const std::function<bool()>& isCancelled)
+{
+    if (bms == nullptr) return nullptr;
+    if (auto pcm = findCached(bms->fileHash, false); pcm != nullptr)
+        return pcm;
+
+    auto chartObj = std::make_shared<ChartObjectBMS>(PLAYER_SLOT_PLAYER, bms);
+
+    // same timeline as playing the chart from its lead-in
+    const long long startNs = chartObj->getLeadInTime().hres();
+    const size_t lengthFrames = size_t(PREVIEW_LENGTH_MS * SAMPLE_RATE / 1000);
+
+    struct Event
+    {
+        size_t frame;
+        size_t wav;
+    };
+    std::vector<Event> events;
+    std::vector<bool> wavUsed(bms->wavFiles.size(), false);
+    auto addNote = [&](const Note& note) -> bool
+    {
+        long long ns = std::max(0LL, note.time.hres() - startNs);
+        size_t frame = size_t(ns * SAMPLE_RATE / 1000000000);
+        if (frame >= lengthFrames) return false;
+
+        if (note.dvalue >= 0 && (size_t)note.dvalue < wavUsed.size() && !bms->wavFiles[note.dvalue].empty())
+        {
+            events.push_back({ frame, (size_t)note.dvalue });
+            wavUsed[note.dvalue] = true;
+        }
+        return true;
+    };
+
+    for (size_t idx = 0; idx < ChartObjectBMS::BGM_LANE_COUNT; ++idx)
+    {
+        auto it = chartObj->incomingNoteBgm(idx);
+        while (!chartObj->isLastNoteBgm(idx, it) && addNote(*it))
+            ++it;
+    }
+    for (auto cat : { chart::NoteLaneCategory::Note, chart::NoteLaneCategory::LN })
+    {
+        for (size_t idx = chart::Sc1; idx < chart::NOTELANEINDEX_COUNT; ++idx)
+        {
+            auto lane = (chart::NoteLaneIndex)idx;
+            auto it = chartObj->firstNote(cat, lane);
+            for (; !chartObj->isLastNote(cat, lane, it); ++it)
+            {
+                // heads only, as autoplay would hit them
+                if ((it->flags & ~(Note::SCRATCH | Note::KEY_6_7)) != 0) continue;
+                if (!addNote(*it)) break;
+            }
+        }
+    }
+    if (events.empty()) return nullptr;
+
+    // decode each sample once
+    std::vector<size_t> wavList;
+    for (size_t i = 0; i < wavUsed.size(); ++i)
+        if (wavUsed[i]) wavList.push_back(i);
+
+    std::vector<SoftwareMixer::PCMPtr> pcms(wavUsed.size());
+    auto chartDir = bms->getDirectory();
+    std::for_each(std::execution::par, wavList.begin(), wavList.end(), [&](size_t i)
+    {
+        if (isCancelled()) return;
+        Path pWav = fs::u8path(bms->wavFiles[i]);
+        SoundMgr::decodeSample(pWav.is_absolute() ? pWav : chartDir / pWav, SAMPLE_RATE, pcms[i]);
+    });
+    if (isCancelled()) return nullptr;
+
+    // mix
+    size_t frames = 0;
+    for (const auto& e : events)
+    {
+        if (const auto& pcm = pcms[e.wav]; pcm != nullptr)
+            frames = std::max(frames, std::min(lengthFrames, e.frame + pcm->frames));
+    }
+    if (frames == 0) return nullptr;
+
+    std::vector<float> buffer(frames * SoftwareMixer::CHANNELS, 0.f);
+    for (const auto& e : events)
+    {
+        const auto& pcm = pcms[e.wav];
+        if (pcm == nullptr) continue;
+        size_t n = std::min(pcm->frames, frames - e.frame);
+        SoftwareMixer::mixAdd(&buffer[e.frame * SoftwareMixer::CHANNELS], pcm->data, n * SoftwareMixer::CHANNELS);
+    }
+
+    // fade out if cut in the middle
+    if (frames == lengthFrames)
+    {
+        size_t fadeFrames = std::min(frames, size_t(FADE_OUT_MS * SAMPLE_RATE / 1000));
+        size_t fadeStart = frames - fadeFrames;
+        for (size_t i = 0; i < fadeFrames; ++i)
+        {
+            float g = 1.0f - float(i) / fadeFrames;
+            buffer[(fadeStart + i) * 2] *= g;
+            buffer[(fadeStart + i) * 2 + 1] *= g;
+        }
+    }
+    for (auto& s : buffer)
+        s = std::clamp(s, -1.0f, 1.0f);
+
+    auto pcm = SoftwareMixer::makePCM(buffer.data(), frames, SoftwareMixer::CHANNELS, SAMPLE_RATE, SAMPLE_RATE);
+    LOG_DEBUG << "[Preview] Rendered " << events.size() << " notes from " << wavList.size() << " samples, " << getLength(pcm) << "ms";
+
+    if (!bms->fileHash.empty())
+        _inst.insertCache({ bms->fileHash, false }, pcm);
+    return pcm;
+}
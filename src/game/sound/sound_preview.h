@@ -0,0 +1,48 @@
+#pragma once
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include "sound_mixer.h"
+#include "common/hash.h"
+#include "common/types.h"
+
+class ChartFormatBMS;
+
+// Select screen chart preview.
+//  The opening seconds of a chart (BGM and autoplay keysounds) are rendered offline into one stereo
+//  buffer and played as a single stream, so previews never load into or evict the note sample slots.
+//  Rendered and dedicated (#PREVIEW) buffers are cached per chart hash; revisiting a chart plays at once.
+class SoundPreview
+{
+public:
+    static constexpr unsigned SAMPLE_RATE = 44100;
+    static constexpr long long PREVIEW_LENGTH_MS = 20000;
+    static constexpr long long FADE_OUT_MS = 1000;
+    static constexpr size_t CACHE_ENTRIES = 8;
+
+private:
+    SoundPreview() = default;
+    ~SoundPreview() = default;
+    static SoundPreview _inst;
+
+private:
+    typedef std::pair<HashMD5, bool> CacheKey;     // chart, dedicated
+    std::mutex _cacheMutex;
+    std::list<std::pair<CacheKey, SoftwareMixer::PCMPtr>> _cache;   // most recent first
+
+    void insertCache(const CacheKey& key, SoftwareMixer::PCMPtr pcm);
+
+public:
+    // Any thread; decodes and mixes on the calling thread. isCancelled is polled while decoding.
+    //  Returns nullptr if cancelled or nothing is audible
+    static SoftwareMixer::PCMPtr renderChart(std::shared_ptr<ChartFormatBMS> bms, const std::function<bool()>& isCancelled);
+    // Any thread. Decodes the first PREVIEW_LENGTH_MS of a dedicated preview file
+    static SoftwareMixer::PCMPtr loadFile(const HashMD5& chartHash, const Path& path);
+
+    static SoftwareMixer::PCMPtr findCached(const HashMD5& chartHash, bool dedicated);
+    static void clearCache();
+
+    static long long getLength(const SoftwareMixer::PCMPtr& pcm) { return pcm ? (long long)pcm->frames * 1000 / SAMPLE_RATE : 0; }   // ms
+};
@@ -0,0 +1,66 @@
+// Benchmark, opt-in: built by the apptest_bench target, not part of apptest / ctest
+#include "gmock/gmock.h"
+#include "common/difficultytable/table_bms.h"
+#include "table_bms_body.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstddef>
+#include <iostream>
+#include <new>
+
+// Heap usage while the flag is set. Replaces the global allocator, which is why this benchmark has its own binary
+static std::atomic<bool> trackAllocs = false;
+static std::atomic<long long> liveBytes = 0;
+static std::atomic<long long> peakBytes = 0;
+static constexpr size_t ALLOC_HEADER = alignof(std::max_align_t);
+
+void* operator new(size_t size)
+{
+    char* p = (char*)std::malloc(size + ALLOC_HEADER);
+    if (!p) throw std::bad_alloc();
+    *(size_t*)p = size;
+    if (trackAllocs)
+    {
+        long long live = liveBytes += (long long)size;
+        long long peak = peakBytes;
+        while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {}
+    }
+    return p + ALLOC_HEADER;
+}
+void operator delete(void* ptr) noexcept
+{
+    if (!ptr) return;
+    char* p = (char*)ptr - ALLOC_HEADER;
+    if (trackAllocs)
+        liveBytes -= (long long)*(size_t*)p;
+    std::free(p);
+}
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+
+// Parsing must not build a value tree of the body: memory on top of the body and the resulting entries stays small
+TEST(TableBMS, parse_body_benchmark)
+{
+    const size_t count = 50000;
+    std::string body = makeTableBody(count);
+
+    DifficultyTableBMS t;
+    liveBytes = 0;
+    peakBytes = 0;
+    trackAllocs = true;
+    auto begin = std::chrono::steady_clock::now();
+    t.parseBody(body);
+    auto ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count() / 1000.0;
+    trackAllocs = false;
+    long long transientBytes = peakBytes - liveBytes;
+    std::cout << "parse " << count << " entries, " << body.size() / 1024 << "KB: " << ms << "ms, entries "
+        << liveBytes / 1024 << "KB, transient peak " << transientBytes / 1024 << "KB" << std::endl;
+
+    size_t parsed = 0;
+    for (const auto& lv : t.getLevelList())
+        parsed += t.getEntryList(lv).size();
+    EXPECT_EQ(parsed, count);
+    EXPECT_LT(transientBytes, (long long)body.size() / 4);
+    EXPECT_LT(ms, 3000.0);
+}
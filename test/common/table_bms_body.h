@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdio>
+#include <string>
+
+inline std::string makeTableBody(size_t count)
+{
+    // a large community-table-like body: many charts with long comments and unused fields
+    std::string body = "\xef\xbb\xbf[";
+    for (size_t i = 0; i < count; ++i)
+    {
+        char md5[33];
+        snprintf(md5, sizeof(md5), "%032zx", i);
+        if (i) body += ",";
+        body += R"({"level":)" + (i % 3 == 0 ? std::to_string(i % 25) : "\"" + std::to_string(i % 25) + "\"");
+        body += R"(,"md5":")" + std::string(md5) + R"(","title":"Song \")" + std::to_string(i) + R"(\"")";
+        body += R"(,"artist":"Artist","url":"http://example.com/)" + std::to_string(i) + R"(","url_diff":"","tags":["a","b",{"x":1}])";
+        body += R"(,"comment":")" + std::string(500, 'c') + R"(","lr2_bmsid":)" + std::to_string(i * 7) + "}";
+    }
+    body += "]";
+    return body;
+}
@@ -0,0 +1,228 @@
+#include "gmock/gmock.h"
+#include "common/difficultytable/table_bms.h"
+#include "table_bms_body.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+#define closeSocket closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int socket_t;
+#define closeSocket close
+#endif
+
+// Minimal HTTP/1.1 server on localhost serving fixture tables. Honors If-None-Match
+class TableServer
+{
+public:
+    struct File
+    {
+        std::string body;
+        std::string etag;
+    };
+    std::map<std::string, File> files;
+
+    std::mutex statMutex;
+    std::map<std::string, int> served;      // path -> 200 count
+    std::map<std::string, int> notModified; // path -> 304 count
+
+private:
+    socket_t listenSock;
+    unsigned short port = 0;
+    std::atomic<bool> running = true;
+    std::thread thread;
+
+public:
+    TableServer()
+    {
+#ifdef _WIN32
+        WSADATA wsa;
+        WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+        listenSock = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(listenSock, (sockaddr*)&addr, sizeof(addr));
+        listen(listenSock, 16);
+        socklen_t len = sizeof(addr);
+        getsockname(listenSock, (sockaddr*)&addr, &len);
+        port = ntohs(addr.sin_port);
+
+        thread = std::thread([this] { loop(); });
+    }
+    ~TableServer()
+    {
+        running = false;
+        thread.join();
+        closeSocket(listenSock);
+    }
+
+    std::string url(const std::string& path) const
+    {
+        return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+
+private:
+    void loop()
+    {
+        while (running)
+        {
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(listenSock, &fds);
+            timeval tv = { 0, 100000 };
+            if (select((int)listenSock + 1, &fds, nullptr, nullptr, &tv) <= 0)
+                continue;
+
+            socket_t conn = accept(listenSock, nullptr, nullptr);
+            std::string request;
+            char buf[1024];
+            while (request.find("\r\n\r\n") == request.npos)
+            {
+                int n = recv(conn, buf, sizeof(buf), 0);
+                if (n <= 0) break;
+                request.append(buf, n);
+            }
+            std::string response = respond(request);
+            send(conn, response.c_str(), (int)response.size(), 0);
+            closeSocket(conn);
+        }
+    }
+
+    std::string respond(const std::string& request)
+    {
+        size_t pathBegin = request.find(' ') + 1;
+        std::string path = request.substr(pathBegin, request.find(' ', pathBegin) - pathBegin);
+
+        std::string ifNoneMatch;
+        if (size_t p = request.find("If-None-Match: "); p != request.npos)
+        {
+            p += 15;
+            ifNoneMatch = request.substr(p, request.find("\r\n", p) - p);
+        }
+
+        std::unique_lock l(statMutex);
+        auto it = files.find(path);
+        if (it == files.end())
+            return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+        const File& f = it->second;
+        if (!f.etag.empty() && ifNoneMatch == f.etag)
+        {
+            notModified[path]++;
+            return "HTTP/1.1 304 Not Modified\r\nETag: " + f.etag + "\r\nConnection: close\r\n\r\n";
+        }
+
+        served[path]++;
+        std::string header = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(f.body.size()) + "\r\nConnection: close\r\n";
+        if (!f.etag.empty())
+            header += "ETag: " + f.etag + "\r\n";
+        return header + "\r\n" + f.body;
+    }
+};
+
+static const char* TABLE_HTML = R"(<html><head><meta name="bmstable" content="header.json"></head></html>)";
+static const char* TABLE_HEADER = R"({"name":"Test Table","symbol":"T","data_url":"data.json"})";
+static const char* TABLE_DATA = R"([{"level":"1","md5":"00112233445566778899aabbccddeeff","title":"a"},{"level":"2","md5":"ffeeddccbbaa99887766554433221100","title":"b"}])";
+
+TEST(TableBMS, update_concurrent_and_revalidate)
+{
+    TableServer server;
+    server.files["/a/table.html"] = { TABLE_HTML, "" };
+    server.files["/a/header.json"] = { TABLE_HEADER, "\"ha\"" };
+    server.files["/a/data.json"] = { TABLE_DATA, "\"da\"" };
+    server.files["/b/header.json"] = { TABLE_HEADER, "\"hb\"" };
+    server.files["/b/data.json"] = { TABLE_DATA, "\"db\"" };
+
+    // first run downloads everything
+    {
+        DifficultyTableBMS a, b;
+        a.setUrl(server.url("/a/table.html"));
+        b.setUrl(server.url("/b/header.json"));
+        fs::remove_all(a.getFolderPath());
+        fs::remove_all(b.getFolderPath());
+        EXPECT_FALSE(a.loadFromFile());
+        EXPECT_FALSE(b.loadFromFile());
+
+        std::map<std::string, DifficultyTable::UpdateResult> results;
+        DifficultyTableBMS::updateFromUrl({ &a, &b }, [&](DifficultyTableBMS& t, DifficultyTable::UpdateResult r) { results[t.getUrl()] = r; });
+        ASSERT_EQ(results.size(), 2);
+        EXPECT_EQ(results[a.getUrl()], DifficultyTable::UpdateResult::OK);
+        EXPECT_EQ(results[b.getUrl()], DifficultyTable::UpdateResult::OK);
+        EXPECT_EQ(a.getName(), "Test Table");
+        EXPECT_EQ(a.getLevelList().size(), 2);
+        EXPECT_EQ(b.getLevelList().size(), 2);
+        EXPECT_EQ(server.served["/a/data.json"], 1);
+        EXPECT_EQ(server.served["/b/data.json"], 1);
+    }
+
+    // second run revalidates the cached files
+    {
+        DifficultyTableBMS a, b;
+        a.setUrl(server.url("/a/table.html"));
+        b.setUrl(server.url("/b/header.json"));
+        ASSERT_TRUE(a.loadFromFile());
+        ASSERT_TRUE(b.loadFromFile());
+
+        std::map<std::string, DifficultyTable::UpdateResult> results;
+        DifficultyTableBMS::updateFromUrl({ &a, &b }, [&](DifficultyTableBMS& t, DifficultyTable::UpdateResult r) { results[t.getUrl()] = r; });
+        EXPECT_EQ(results[a.getUrl()], DifficultyTable::UpdateResult::OK);
+        EXPECT_EQ(results[b.getUrl()], DifficultyTable::UpdateResult::OK);
+        EXPECT_EQ(a.getLevelList().size(), 2);
+        EXPECT_EQ(b.getLevelList().size(), 2);
+        EXPECT_EQ(server.served["/a/data.json"], 1);
+        EXPECT_EQ(server.served["/b/data.json"], 1);
+        EXPECT_EQ(server.notModified["/a/header.json"], 1);
+        EXPECT_EQ(server.notModified["/a/data.json"], 1);
+        EXPECT_EQ(server.notModified["/b/data.json"], 1);
+    }
+
+    // changed data is downloaded again
+    {
+        server.files["/b/data.json"] = { R"([{"level":"3","md5":"00112233445566778899aabbccddeeff","title":"a"}])", "\"db2\"" };
+
+        DifficultyTableBMS b;
+        b.setUrl(server.url("/b/header.json"));
+        ASSERT_TRUE(b.loadFromFile());
+
+        DifficultyTable::UpdateResult result = DifficultyTable::UpdateResult::INTERNAL_ERROR;
+        b.updateFromUrl([&](DifficultyTable::UpdateResult r) { result = r; });
+        EXPECT_EQ(result, DifficultyTable::UpdateResult::OK);
+        EXPECT_EQ(b.getLevelList(), std::vector<std::string>{ "3" });
+        EXPECT_EQ(server.served["/b/data.json"], 2);
+    }
+}
+
+TEST(TableBMS, parse_body)
+{
+    const size_t count = 100;
+    std::string body = makeTableBody(count);
+
+    DifficultyTableBMS t;
+    t.parseBody(body);
+    size_t parsed = 0;
+    for (const auto& lv : t.getLevelList())
+        parsed += t.getEntryList(lv).size();
+    EXPECT_EQ(parsed, count);
+    EXPECT_EQ(t.getLevelList().size(), 25);
+    EXPECT_EQ(t.getEntryList("0").front()->_name, "Song \"0\"");
+
+    // a broken body adds nothing
+    DifficultyTableBMS broken;
+    broken.parseBody(body.substr(0, body.size() / 2));
+    EXPECT_TRUE(broken.getLevelList().empty());
+}
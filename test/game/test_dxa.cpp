@@ -0,0 +1,117 @@
+#include "gmock/gmock.h"
+#include "game/graphics/dxa.h"
+#include "common/utils.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Minimal ver5 archive holding one uncompressed file, names in Shift-JIS (code page 932)
+static std::vector<uint8_t> makeArchive(const std::string& nameSJIS, const std::string& content)
+{
+	auto put16 = [](std::vector<uint8_t>& v, uint16_t x) { v.push_back(x & 0xff); v.push_back(x >> 8); };
+	auto put32 = [&](std::vector<uint8_t>& v, uint32_t x) { put16(v, x & 0xffff); put16(v, x >> 16); };
+
+	// name table: length in 4 byte units, parity, upper-case name, original name
+	std::vector<uint8_t> table;
+	uint16_t units = uint16_t((nameSJIS.size() + 4) / 4);
+	put16(table, units);
+	put16(table, 0);
+	for (int copy = 0; copy < 2; ++copy)
+	{
+		table.insert(table.end(), nameSJIS.begin(), nameSJIS.end());
+		table.resize(table.size() + units * 4 - nameSJIS.size(), 0);
+	}
+
+	// file table
+	uint32_t fileTable = uint32_t(table.size());
+	put32(table, 0);                        // NameAddress
+	put32(table, 0);                        // Attributes
+	table.resize(table.size() + 24, 0);     // Time
+	put32(table, 0);                        // DataAddress
+	put32(table, uint32_t(content.size())); // DataSize
+	put32(table, 0xffffffff);               // CompressedDataSize
+
+	// root directory
+	uint32_t dirTable = uint32_t(table.size());
+	put32(table, 0);
+	put32(table, 0xffffffff);
+	put32(table, 1);
+	put32(table, 0);
+
+	const uint32_t headSize = 28;     // sizeof(DARC_HEAD_VER5)
+	std::vector<uint8_t> head;
+	put16(head, *(const uint16_t*)"DX");
+	put16(head, 5);
+	put32(head, uint32_t(table.size()));
+	put32(head, headSize);
+	put32(head, headSize + uint32_t(content.size()));
+	put32(head, fileTable);
+	put32(head, dirTable);
+	put32(head, 932);
+
+	// default key, same as KeyCreate(NULL)
+	uint8_t key[12];
+	std::memset(key, 0xaa, sizeof(key));
+	key[0] = ~key[0];
+	key[1] = (key[1] >> 4) | (key[1] << 4);
+	key[2] = key[2] ^ 0x8a;
+	key[3] = ~((key[3] >> 4) | (key[3] << 4));
+	key[4] = ~key[4];
+	key[5] = key[5] ^ 0xac;
+	key[6] = ~key[6];
+	key[7] = ~((key[7] >> 3) | (key[7] << 5));
+	key[8] = (key[8] >> 5) | (key[8] << 3);
+	key[9] = key[9] ^ 0x7f;
+	key[10] = ((key[10] >> 4) | (key[10] << 4)) ^ 0xd6;
+	key[11] = key[11] ^ 0xcc;
+	auto conv = [&](std::vector<uint8_t>& v, size_t position)
+	{
+		for (size_t i = 0; i < v.size(); ++i)
+			v[i] ^= key[(position + i) % 12];
+	};
+
+	// ver5 keys header and tables from 0, file data from its size
+	std::vector<uint8_t> data(content.begin(), content.end());
+	conv(head, 0);
+	conv(data, data.size());
+	conv(table, 0);
+
+	std::vector<uint8_t> archive;
+	archive.insert(archive.end(), head.begin(), head.end());
+	archive.insert(archive.end(), data.begin(), data.end());
+	archive.insert(archive.end(), table.begin(), table.end());
+	return archive;
+}
+
+TEST(tDxa, non_ascii_entry_name)
+{
+	const std::string nameSJIS = "\x89\xe6\x91\x9c.txt";             // 画像.txt
+	const std::string nameUTF8 = "\xe7\x94\xbb\xe5\x83\x8f.txt";
+	const std::string content = "hello";
+
+	Path archivePath = std::filesystem::absolute("dxa_test_name.dxa");
+	{
+		auto archive = makeArchive(nameSJIS, content);
+		std::ofstream ofs(archivePath, std::ios_base::binary);
+		ofs.write((const char*)archive.data(), archive.size());
+	}
+
+	auto a = extractDxaToMem(archivePath.native());
+	ASSERT_EQ(a.size(), 1);
+	EXPECT_EQ(a.begin()->first, nameUTF8);
+	ASSERT_EQ(a.begin()->second.size, content.size());
+	EXPECT_EQ(std::string((const char*)&*a.begin()->second.data, content.size()), content);
+
+	ASSERT_TRUE(mountDxa(archivePath.native()));
+	DXArchiveSegment seg;
+	Path entryPath = archivePath.parent_path() / "dxa_test_name" / PathFromUTF8(nameUTF8);
+	EXPECT_TRUE(findDxaEntry(entryPath.native(), seg));
+	EXPECT_EQ(seg.size, content.size());
+	unmountDxa(archivePath.native());
+	EXPECT_FALSE(findDxaEntry(entryPath.native(), seg));
+
+	std::filesystem::remove(archivePath);
+}
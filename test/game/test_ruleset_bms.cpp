@@ -0,0 +1,109 @@
+#include "gmock/gmock.h"
+#include "game/ruleset/ruleset_bms.h"
+#include "game/chart/chart_bms.h"
+#include "game/scene/scene_context.h"
+#include "common/chartformat/chartformat_bms.h"
+#include <chrono>
+#include <iostream>
+
+class mock_RulesetBMS : public RulesetBMS
+{
+public:
+	mock_RulesetBMS(std::shared_ptr<ChartFormatBMS> bms, std::shared_ptr<ChartObjectBMS> chart, GameModeKeys keys, JudgeDifficulty diff) :
+		RulesetBase(bms, chart), RulesetBMS(bms, chart, PlayModifierGaugeType::NORMAL, keys, diff, 1.0, PlaySide::SINGLE) {}
+	virtual ~mock_RulesetBMS() = default;
+
+	JudgeRes judge(const Note& note, Time time) { return _judge(note, time); }
+	void disableJudge() { doJudge = false; }
+};
+
+// comparison chain _judge used before the boundary table
+static RulesetBMS::JudgeArea judgeReference(const RulesetBMS::JudgeTime& jt, Time error)
+{
+	using A = RulesetBMS::JudgeArea;
+	if (!(error > -jt.KPOOR)) return A::NOTHING;
+	if (error < -jt.BAD) return A::EARLY_KPOOR;
+	if (error < -jt.GOOD) return A::EARLY_BAD;
+	if (error < -jt.GREAT) return A::EARLY_GOOD;
+	if (error < -jt.PERFECT) return A::EARLY_GREAT;
+	if (error < 0) return A::EARLY_PERFECT;
+	if (error == 0) return A::EXACT_PERFECT;
+	if (error < jt.PERFECT) return A::LATE_PERFECT;
+	if (error < jt.GREAT) return A::LATE_GREAT;
+	if (error < jt.GOOD) return A::LATE_GOOD;
+	if (error < jt.BAD) return A::LATE_BAD;
+	return A::NOTHING;
+}
+
+TEST(tRulesetBMS, judge_table_matches_reference)
+{
+	auto bms = std::make_shared<ChartFormatBMS>("bms/7k.bme");
+	ASSERT_EQ(bms->isLoaded(), true);
+
+	using D = RulesetBMS::JudgeDifficulty;
+	for (D diff : { D::VERYHARD, D::HARD, D::NORMAL, D::EASY, D::VERYEASY, D::WHAT })
+	{
+		auto chart = std::make_shared<ChartObjectBMS>(PLAYER_SLOT_PLAYER, bms);
+		mock_RulesetBMS r(bms, chart, 7, diff);
+		const auto& jt = RulesetBMS::judgeTime[(size_t)diff];
+
+		Note note;
+		note.time = Time(10000);
+		for (long long ms = -1000; ms <= 1000; ++ms)
+		{
+			// step across each ms edge with ns offsets
+			for (long long ns : { -1LL, 0LL, 1LL })
+			{
+				Time hit(note.time.hres() + ms * 1000000 + ns, true);
+				ASSERT_EQ(r.judge(note, hit).area, judgeReference(jt, hit - note.time)) << "diff " << (int)diff << " error " << ms << "ms " << ns << "ns";
+			}
+		}
+	}
+}
+
+// Benchmark, opt-in: --gtest_also_run_disabled_tests
+//  Prints judge and per-tick update cost, and fails if a tick would take a noticeable share of the 1ms input budget
+TEST(tRulesetBMS, DISABLED_judge_throughput)
+{
+	for (auto [file, keys] : { std::pair<const char*, GameModeKeys>{ "bms/7k.bme", 7 }, { "bms/14k.bme", 14 } })
+	{
+		auto bms = std::make_shared<ChartFormatBMS>(file);
+		ASSERT_EQ(bms->isLoaded(), true);
+		auto chart = std::make_shared<ChartObjectBMS>(PLAYER_SLOT_PLAYER, bms);
+		mock_RulesetBMS r(bms, chart, keys, RulesetBMS::JudgeDifficulty::NORMAL);
+		r.disableJudge();
+
+		using namespace std::chrono;
+
+		const size_t judgeCount = 1000000;
+		Note note;
+		note.time = Time(10000);
+		size_t sink = 0;
+		auto t0 = steady_clock::now();
+		for (size_t i = 0; i < judgeCount; ++i)
+		{
+			Time hit(note.time.hres() + (long long)(i % 2000) * 1000000 - 1000000000LL, true);
+			sink += (size_t)r.judge(note, hit).area;
+		}
+		auto t1 = steady_clock::now();
+
+		// 1000Hz ticks over the whole chart, nobody pressing: every note goes through miss expiry
+		long long lengthMs = bms->totalLength * 1000LL + 3000;
+		Time start(0);
+		for (long long ms = 0; ms < lengthMs; ++ms)
+		{
+			Time t(start.norm() + ms);
+			chart->update(t);
+			r.update(t);
+		}
+		auto t2 = steady_clock::now();
+
+		std::cout << file << ": judge " << duration_cast<nanoseconds>(t1 - t0).count() / judgeCount << "ns/call, update "
+			<< duration_cast<nanoseconds>(t2 - t1).count() / std::max(1LL, lengthMs) << "ns/tick over " << lengthMs << " ticks"
+			<< " (" << sink % 2 << ")" << std::endl;
+
+		EXPECT_LT(duration_cast<nanoseconds>(t1 - t0).count() / judgeCount, 2000);
+		EXPECT_LT(duration_cast<nanoseconds>(t2 - t1).count() / std::max(1LL, lengthMs), 100000);
+		EXPECT_EQ(r.isFinished(), true);
+	}
+}
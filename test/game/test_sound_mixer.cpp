@@ -0,0 +1,115 @@
+#include "gmock/gmock.h"
+#include "game/sound/sound_mixer.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static SoftwareMixer::PCMPtr makeImpulse(size_t frames)
+{
+	std::vector<float> buf(frames * 2, 0.f);
+	buf[0] = buf[1] = 1.f;
+	return SoftwareMixer::makePCM(buf.data(), frames, 2, 48000, 48000);
+}
+
+TEST(tSoftwareMixer, simd_matches_scalar)
+{
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> dist(-1.f, 1.f);
+	for (size_t n : { 0, 1, 2, 3, 7, 8, 9, 31, 256, 257 })
+	{
+		std::vector<float> src(n * 2), a(n * 2), b;
+		for (auto& x : src) x = dist(rng);
+		for (auto& x : a) x = dist(rng);
+
+		b = a;
+		SoftwareMixer::mixAdd(a.data(), src.data(), n * 2);
+		SoftwareMixer::mixAddScalar(b.data(), src.data(), n * 2);
+		for (size_t i = 0; i < n * 2; ++i)
+			ASSERT_NEAR(a[i], b[i], 1e-6) << SoftwareMixer::simdName() << " mixAdd n=" << n << " i=" << i;
+
+		b = a;
+		SoftwareMixer::mixAddRamp(a.data(), src.data(), n * 2, 0.2f, 0.9f);
+		SoftwareMixer::mixAddRampScalar(b.data(), src.data(), n * 2, 0.2f, 0.9f);
+		for (size_t i = 0; i < n * 2; ++i)
+			ASSERT_NEAR(a[i], b[i], 1e-5) << SoftwareMixer::simdName() << " mixAddRamp n=" << n << " i=" << i;
+	}
+}
+
+TEST(tSoftwareMixer, sample_accurate_start)
+{
+	SoftwareMixer m(48000);
+	auto pcm = makeImpulse(10);
+
+	// across block boundaries, on different buses, two voices on the same frame
+	const std::vector<long long> starts = { 0, 100, (long long)SoftwareMixer::BLOCK_FRAMES, 1000, 1000 };
+	for (size_t i = 0; i < starts.size(); ++i)
+		ASSERT_TRUE(m.play(unsigned(i % 3), pcm, starts[i]));
+
+	std::vector<float> out(2048 * 2);
+	m.render(out.data(), 2048);
+
+	for (size_t f = 0; f < 2048; ++f)
+	{
+		float expected = (float)std::count(starts.begin(), starts.end(), (long long)f);
+		ASSERT_EQ(out[f * 2], expected) << "frame " << f;
+		ASSERT_EQ(out[f * 2 + 1], expected) << "frame " << f;
+	}
+	EXPECT_EQ(m.getActiveVoices(), 0);
+	EXPECT_EQ(m.getRenderedFrame(), 2048);
+}
+
+TEST(tSoftwareMixer, ring_pump_pull)
+{
+	SoftwareMixer m(48000);
+	std::vector<float> dc(48000 * 2, 0.5f);
+	m.play(0, SoftwareMixer::makePCM(dc.data(), 48000, 2, 48000, 48000));
+
+	m.pump(600);
+	size_t fill = m.getRingFill();
+	EXPECT_GE(fill, 600);
+	EXPECT_EQ(fill % SoftwareMixer::BLOCK_FRAMES, 0);
+
+	// 3 output channels: stereo goes to the first two, the rest is silent
+	std::vector<float> out((fill + 10) * 3, 1.f);
+	m.pull(out.data(), fill + 10, 3, false);
+	EXPECT_EQ(out[0], 0.5f);
+	EXPECT_EQ(out[1], 0.5f);
+	EXPECT_EQ(out[2], 0.f);
+	EXPECT_EQ(out[(fill + 9) * 3], 0.f);
+	EXPECT_EQ(m.getUnderruns(), 1);
+	EXPECT_EQ(m.getPlayedFrame(), (long long)fill);
+}
+
+// Benchmark, opt-in: --gtest_also_run_disabled_tests
+//  Prints offline mixing cost for a dense chart-like load; rendering must stay well ahead of real time
+TEST(tSoftwareMixer, DISABLED_render_to_wav_throughput)
+{
+	const unsigned rate = 48000;
+	std::mt19937 rng(2);
+	std::uniform_real_distribution<float> dist(-0.01f, 0.01f);
+	std::vector<float> noise(rate / 2 * 2);
+	for (auto& x : noise) x = dist(rng);
+	auto pcm = SoftwareMixer::makePCM(noise.data(), rate / 2, 2, rate, rate);
+
+	for (size_t voices : { 64, 256, 512 })
+	{
+		SoftwareMixer m(rate);
+		for (size_t i = 0; i < voices; ++i)
+			m.play(unsigned(i % 5), pcm, (long long)(i * 37));
+
+		using namespace std::chrono;
+		auto t0 = steady_clock::now();
+		ASSERT_TRUE(m.renderToWav("sound_mixer_out.wav", rate));
+		auto t1 = steady_clock::now();
+
+		std::ifstream ifs("sound_mixer_out.wav", std::ios::binary | std::ios::ate);
+		EXPECT_EQ((size_t)ifs.tellg(), 44 + rate * 2 * sizeof(float));
+
+		std::cout << SoftwareMixer::simdName() << ": " << voices << " voices, 1s rendered in "
+			<< duration_cast<microseconds>(t1 - t0).count() << "us" << std::endl;
+		EXPECT_LT(duration_cast<microseconds>(t1 - t0).count(), 250000) << voices << " voices";
+	}
+}
@@ -1,5 +1,8 @@
 #include "gmock/gmock.h"
 #include "db/db_song.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 
 const StringPath pathSongDB = "song.db"_p;
 
@@ -51,3 +54,102 @@ TEST(SongDB, remove_table)
     //ASSERT_FALSE(hash1.empty());
     //ASSERT_EQ(0, db.removeFolder(hash1, true));
 }
+
+class SongDBSearchBench : public SongDB
+{
+public:
+    SongDBSearchBench(const char* path) : SongDB(path) {}
+
+    void fill(size_t count)
+    {
+        static const char* words[] = { "Colorful", "Sky", "Evans", "冥", "ピアノ", "Trance", "Angel", "Dream", "Remix", "音楽" };
+        transactionStart();
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string title = std::string(words[i % 10]) + " " + words[(i / 10) % 10] + " " + std::to_string(i);
+            std::string artist = std::string(words[(i / 100) % 10]) + " feat. " + words[(i / 1000) % 10];
+            std::string file = fs::absolute(Path("bench") / (std::to_string(i) + ".bms")).u8string();
+            exec("INSERT INTO song(md5,parent,type,file,title,title2,artist,artist2,genre,version,"
+                "level,bpm,minbpm,maxbpm,length,totalnotes) VALUES(?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)",
+                { md5(file).hexdigest(), ROOT_FOLDER_HASH.hexdigest(), 0LL, file, title, std::string(), artist, std::string(),
+                  std::string(words[i % 7]), std::string(), 0.0, 150.0, 150.0, 150.0, 120LL, 1000LL });
+        }
+        transactionStop();
+    }
+
+    bool hasSubstringIndex() const { return searchIndexType == SEARCH_TRIGRAM; }
+};
+
+TEST(SongDB, search_substring)
+{
+    const StringPath pathSearchDB = "song_search.db"_p;
+    std::filesystem::remove(pathSearchDB);
+    {
+        SongDBSearchBench db(Path(pathSearchDB).u8string().c_str());
+        db.fill(1000);
+
+        // word prefix, CJK fragment and mid-word fragment all match, whatever index is available
+        for (const char* key : { "Colorful Sky", "ピアノ", "アノ", "olorf", "999" })
+        {
+            EXPECT_FALSE(db.findChartByName(ROOT_FOLDER_HASH, key, 100).empty()) << key;
+        }
+        EXPECT_TRUE(db.findChartByName(ROOT_FOLDER_HASH, "nothing like this", 100).empty());
+
+        // mid-word hits are kept even when word prefixes match too: "99" finds "199", not only "99x"
+        auto result = db.findChartByName(ROOT_FOLDER_HASH, "99", 100);
+        EXPECT_TRUE(std::any_of(result.begin(), result.end(), [](const auto& c)
+            {
+                return c->title.size() >= 4 && c->title.compare(c->title.size() - 4, 4, " 199") == 0;
+            }));
+    }
+    std::filesystem::remove(pathSearchDB);
+}
+
+// opt-in: --gtest_also_run_disabled_tests
+TEST(SongDB, DISABLED_search_benchmark)
+{
+    const StringPath pathBenchDB = "song_bench.db"_p;
+    std::filesystem::remove(pathBenchDB);
+    {
+        SongDBSearchBench db(Path(pathBenchDB).u8string().c_str());
+        db.fill(200000);
+
+        for (const char* key : { "Colorful Sky", "ピアノ", "19999", "feat" })
+        {
+            auto t = std::chrono::steady_clock::now();
+            auto result = db.findChartByName(ROOT_FOLDER_HASH, key, 100);
+            auto ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t).count() / 1000.0;
+            std::cout << "search \"" << key << "\": " << result.size() << " results, " << ms << "ms" << std::endl;
+            EXPECT_FALSE(result.empty());
+            // the trigram index answers within a frame; without it every search scans the table with LIKE
+            if (db.hasSubstringIndex())
+                EXPECT_LT(ms, 10.0) << key;
+        }
+    }
+    std::filesystem::remove(pathBenchDB);
+}
+
+TEST(SongDB, catalog_index)
+{
+    std::vector<HashMD5> keys{ md5("a"), md5("b"), md5("a"), HashMD5(), md5("c"), md5("a") };
+    SongCatalog::HashIndex index;
+    index.build(keys);
+
+    auto a = index.find(md5("a"));
+    ASSERT_EQ(a.size(), 3);
+    EXPECT_EQ(a.begin()[0], 0);
+    EXPECT_EQ(a.begin()[1], 2);
+    EXPECT_EQ(a.begin()[2], 5);
+    EXPECT_EQ(index.find(md5("b")).size(), 1);
+    EXPECT_EQ(*index.find(md5("c")).begin(), 4);
+    EXPECT_TRUE(index.find(md5("d")).empty());
+    EXPECT_TRUE(index.find(HashMD5()).empty());
+
+    SongCatalog catalog;
+    auto s1 = catalog.intern("title");
+    auto s2 = catalog.intern("artist");
+    EXPECT_EQ(catalog.intern("title"), s1);
+    EXPECT_EQ(catalog.intern(""), 0);
+    EXPECT_EQ(catalog.str(s2), "artist");
+    EXPECT_EQ(catalog.str(0), "");
+}